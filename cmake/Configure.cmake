@@ -55,6 +55,7 @@ set(include_files_list
     ctype.h
     dlfcn.h
     errno.h
+    fcntl.h
     float.h
     inttypes.h
     limits.h
@@ -64,6 +65,7 @@ set(include_files_list
     stdio.h
     strings.h
     string.h
+    sys/mman.h
     sys/stat.h
     sys/time.h
     sys/types.h
@@ -77,7 +79,11 @@ set(functions_list
     localtime
     localtime_r
     gmtime
+    fopencookie
+    funopen
     gmtime_r
+    madvise
+    mmap
     strcasecmp
     stricmp
 )
@@ -98,10 +104,40 @@ if (SDL2_FOUND)
     set(HAVE_SDL2 1)
 endif()
 
+# Optional libraries to stream images by rows (see lualept-stream.cpp)
+find_package(PNG)
+find_package(JPEG)
+find_package(TIFF)
+
+if (PNG_FOUND)
+    set(HAVE_PNG_H 1)
+    set(HAVE_LIBPNG 1)
+endif()
+if (JPEG_FOUND)
+    set(HAVE_JPEGLIB_H 1)
+    set(HAVE_LIBJPEG 1)
+endif()
+if (TIFF_FOUND)
+    set(HAVE_TIFFIO_H 1)
+    set(HAVE_LIBTIFF 1)
+endif()
+
 file(APPEND ${AUTOCONFIG_SRC} "
 /* Define to 1 if you have SDL2. */
 #cmakedefine HAVE_SDL2 1
 
+/* Define to 1 if you have libpng and <png.h>. */
+#cmakedefine HAVE_PNG_H 1
+#cmakedefine HAVE_LIBPNG 1
+
+/* Define to 1 if you have libjpeg and <jpeglib.h>. */
+#cmakedefine HAVE_JPEGLIB_H 1
+#cmakedefine HAVE_LIBJPEG 1
+
+/* Define to 1 if you have libtiff and <tiffio.h>. */
+#cmakedefine HAVE_TIFFIO_H 1
+#cmakedefine HAVE_LIBTIFF 1
+
 /* Name of package */
 #define PACKAGE             \"lualept\"
 
@@ -0,0 +1,58 @@
+require "lua/tools"
+
+header("Pix:Async")
+
+local pix = Pix(1200, 900, 8)
+pix:SetAllArbitrary(128)
+
+-- Outside of a coroutine Await() blocks
+local f = pix:Async("Blockconv", 5, 5)
+print(pad("f = pix:Async(\"Blockconv\", 5, 5)"), f)
+print(pad("pcall(pix.GetWidth, pix)"), pcall(pix.GetWidth, pix))
+local pixd = f:Await()
+print(pad("f:Await()"), pixd)
+print(pad("pix:GetWidth() after Await"), pix:GetWidth())
+
+-- An object which is also referenced elsewhere, e.g. by a clone, is refused,
+-- because Leptonica's reference counts are not thread safe
+local na = Numa()
+for i = 0, 255 do na:AddNumber(255 - i) end
+local clone = na:Clone()
+local mask = Pix(1200, 900, 1)
+mask:SetAll()
+print(pad("pcall(pix.Async, pix, \"TRCMap\", mask, na)"), pcall(pix.Async, pix, "TRCMap", mask, na))
+local fpix = FPix(64, 64)
+local fclone = fpix:Clone()
+print(pad("pcall(fpix.Async, fpix, \"GetDimensions\")"), pcall(fpix.Async, fpix, "GetDimensions"))
+clone:Release()
+fclone:Release()
+print(pad("pix:Async(\"TRCMap\", mask, na) after clone:Release()"), pix:Async("TRCMap", mask, na):Await())
+print(pad("fpix:Async(\"GetDimensions\") after fclone:Release()"), fpix:Async("GetDimensions"):Await())
+
+-- Inside coroutines Await() yields, so that other work can overlap
+local tasks = {}
+for i = 1, 3 do
+	local page = Pix(800, 600, 8)
+	page:SetAllArbitrary(40 * i)
+	tasks[i] = coroutine.create(function()
+		local scaled = page:Async("ScaleGray2xLI"):Await()
+		local jpeg = scaled:Async("WriteMemJpeg", 75, 0):Await()
+		return #jpeg
+	end)
+end
+
+local running = #tasks
+while running > 0 do
+	running = 0
+	for i, co in ipairs(tasks) do
+		if coroutine.status(co) ~= "dead" then
+			local ok, size = coroutine.resume(co)
+			if coroutine.status(co) == "dead" then
+				print(pad("page " .. i .. " jpeg bytes"), ok and size or size)
+			else
+				running = running + 1
+			end
+		end
+	end
+end
+header()
@@ -0,0 +1,48 @@
+require "lua/tools"
+
+---
+-- Microbenchmark for pushing and checking user data.
+-- Runs every test with the class tag fast path disabled (registry lookup
+-- by class name) and enabled (tag compare, cached metatable).
+--
+local count = tonumber(arg and arg[2]) or 1000000
+
+local pix = Pix(64, 64, 8)
+local box = Box(1, 2, 3, 4)
+
+local tests = {
+	{ "check: pix:GetWidth()", function(n)
+		for i = 1, n do pix:GetWidth() end
+	end },
+	{ "check: box:GetGeometry()", function(n)
+		for i = 1, n do box:GetGeometry() end
+	end },
+	{ "check: pix:SetPixel(x,y,v)", function(n)
+		for i = 1, n do pix:SetPixel(i & 63, (i >> 6) & 63, i & 255) end
+	end },
+	{ "push: pix:Clone()", function(n)
+		for i = 1, n do pix:Clone() end
+	end },
+	{ "push: box:Copy()", function(n)
+		for i = 1, n do box:Copy() end
+	end }
+}
+
+local function run(fn, n)
+	collectgarbage()
+	local t0 = os.clock()
+	fn(n)
+	return os.clock() - t0
+end
+
+header("User data push/check: " .. count .. " iterations")
+print(string.format("%-32s %12s %12s %8s", "test", "registry", "tagged", "speedup"))
+for _, test in ipairs(tests) do
+	local name, fn = test[1], test[2]
+	LuaLept:SetFastUdata(false)
+	local slow = run(fn, count)
+	LuaLept:SetFastUdata(true)
+	local fast = run(fn, count)
+	print(string.format("%-32s %10.3f s %10.3f s %7.2fx", name, slow, fast, slow / fast))
+end
+header()
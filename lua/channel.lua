@@ -0,0 +1,53 @@
+require "lua/tools"
+
+header("Channel")
+
+-- A channel moves objects between Lua states without a copy
+local ch = LuaLept.Channel(4)
+print(pad("ch = LuaLept.Channel(4)"), ch)
+
+local pix = Pix(320, 240, 8)
+pix:SetAllArbitrary(100)
+print(pad("ch:Send(pix)"), ch:Send(pix))
+print(pad("pix after Send"), pix)
+print(pad("ch:Send(\"done\")"), ch:Send("done"))
+print(pad("#ch"), #ch)
+
+local received = ch:Receive()
+print(pad("ch:Receive()"), received)
+print(pad("received:GetPixel(0, 0)"), received:GetPixel(0, 0))
+print(pad("ch:Receive()"), ch:Receive())
+print(pad("ch:TryReceive()"), ch:TryReceive())
+print(pad("ch:Receive(0.1)"), ch:Receive(0.1))
+
+-- Workers send their histograms through the channel passed as an argument.
+-- The channel is drained only after ParallelMap() returns, so a Send() to a
+-- full channel would wait forever; the workers use TrySend() instead and
+-- count what did not fit.
+local pixa = Pixa()
+for i = 1, 8 do
+	local p = Pix(320, 240, 8)
+	p:SetAllArbitrary(20 * i)
+	pixa:AddPix(p, "insert")
+end
+local results = LuaLept.Channel(4)
+local dropped = LuaLept.Channel(8)
+pixa:ParallelMap(function(pix, i, out, full)
+	if not out:TrySend(pix:GetGrayHistogram(1)) then
+		full:TrySend(i)
+	end
+	return pix
+end, 4, results, dropped)
+results:Close()
+dropped:Close()
+local count = 0
+while true do
+	local na = results:Receive()
+	if not na then break end
+	count = count + 1
+end
+print(pad("histograms received"), count)
+print(pad("histograms dropped (channel full)"), #dropped)
+print(pad("results:Receive()"), results:Receive())
+print(pad("results:Send(1)"), results:Send(1))
+header()
@@ -0,0 +1,17 @@
+require "lua/tools"
+
+header("ReadMapped")
+
+-- Decode straight from a read-only mapping of the file
+local pix = Pix.ReadMapped("images/lualept.jpg")
+print(pad("pix:GetDimensions()"), pix:GetDimensions())
+
+-- Every file in a directory, mapped one at a time
+local pixa = Pixa.ReadMappedFiles("images", ".jpg")
+print(pad("pixa:GetCount()"), pixa:GetCount())
+
+local ms = LuaLept:MemoryStats()
+print(pad("bytes mapped"), ms.mapped, ms.nmapped)
+print(pad("bytes copied"), ms.copied, ms.ncopied)
+
+header()
@@ -22,8 +22,13 @@ print(pad("na"), na)
 print(pad("#na"), #na)
 print(pad("na:GetParameters()"), na:GetParameters())
 
--- As array of numbers
-print("na:GetFArray()", tbl(na:GetFArray()))
+-- As Float32Array of numbers
+local fa = na:GetFArray()
+print(pad("fa = na:GetFArray()"), fa)
+print(pad("#fa"), #fa)
+print(pad("fa[1]"), fa[1])
+print("fa", tbl(fa))
+print(pad("Numa(fa)"), Numa(fa))
 
 -- As array of integers
 print("na:GetIArray()", tbl(na:GetIArray()))
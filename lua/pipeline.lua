@@ -0,0 +1,42 @@
+require "lua/tools"
+
+header("PixPipeline")
+
+local pix = Pix(1200, 900, 32)
+pix:SetAllArbitrary(0x80604000)
+
+-- Compile once...
+local pl = PixPipeline{
+	"ConvertTo8",
+	{"Scale", 0.5},
+	"BackgroundNormSimple",
+	{"ThresholdToBinary", 128},
+	{"OpenBrick", 3, 3}
+}
+print(pad("pl"), pl)
+print(pad("#pl"), #pl)
+
+-- ...and run on many images
+local pixd = pl:Run(pix)
+print(pad("pl:Run(pix)"), pixd)
+print(pad("pixd:GetDimensions()"), pixd:GetDimensions())
+
+local pixa = Pixa(3)
+for i = 1, 3 do
+	local page = Pix(600, 400, 8)
+	page:SetAllArbitrary(60 * i)
+	pixa:AddPix(page, "insert")
+end
+local pixad = pl:Map(pixa)
+print(pad("pl:Map(pixa)"), pixad)
+print(pad("#pixad"), #pixad)
+
+-- A one-shot pipeline on a single Pix
+local pixb = pix:Pipeline{ "ConvertTo8", {"Scale", 0.25}, "Invert" }
+print(pad("pix:Pipeline{...}"), pixb)
+
+-- Steps are validated when compiled
+print(pad("PixPipeline{{\"Scale\"}}"), pcall(PixPipeline, {{"Scale"}}))
+print(pad("PixPipeline{\"Frobnicate\"}"), pcall(PixPipeline, {"Frobnicate"}))
+
+header()
@@ -71,10 +71,15 @@ local pix2 = Pix(filename)
 print(pad("pix2 = Pix('" .. filename .. "')"), pix2);
 pix2:View()
 
--- get the pixel data of pix2 as two dimensional array of integers
+-- get a view of the pixel data of pix2 (no copy is made)
 local data = pix2:GetData();
 print(pad("pix2:GetData()"), data)
-for y,words in pairs(data) do
+print(pad("#data"), #data)
+print(pad("data[1]"), string.format("%08x", data[1]))
+print(pad("data:GetPixel(0,0)"), data:GetPixel(0,0))
+
+-- copy the pixel data to a two dimensional array of integers
+for y,words in pairs(data:ToTable()) do
 	io.write(string.format("%d = {", y))
 	for x,val in pairs(words) do
 		io.write(string.format(" %08x", val))
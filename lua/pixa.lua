@@ -0,0 +1,34 @@
+require "lua/tools"
+
+header("Pixa")
+
+-- Create a Pixa with some pages
+local pixa = Pixa()
+for i = 1, 16 do
+	local pix = Pix(320 + i, 240, 8)
+	pix:SetAllArbitrary(i * 15)
+	pixa:AddPix(pix, "insert")
+end
+print(pad("pixa"), pixa)
+print(pad("#pixa"), #pixa)
+
+-- Invert all pages on worker threads
+-- The function runs in other Lua states: no upvalues, pass data as arguments
+local inverted = pixa:ParallelMap(function(pix, i)
+	return pix:Invert()
+end, 4)
+print(pad("inverted = pixa:ParallelMap(fn, 4)"), inverted)
+print(pad("#inverted"), #inverted)
+print(pad("inverted:GetPix(1):GetWidth()"), inverted:GetPix(1):GetWidth())
+
+-- A chunk string receives its arguments as ...
+local scaled = pixa:ParallelMap("local pix, i = ... return pix:ScaleByIntSampling(2)")
+print(pad("scaled = pixa:ParallelMap(chunk)"), scaled)
+
+-- Errors report the index of the failing page
+local ok, err = pcall(pixa.ParallelMap, pixa, function(pix, i)
+	if i == 5 then error("page five") end
+	return pix
+end)
+print(pad("error"), ok, err)
+header()
@@ -0,0 +1,28 @@
+require "lua/tools"
+
+header("Pix destinations")
+
+local pixs = Pix(640, 480, 1)
+pixs:SetAll()
+
+-- A new Pix* for every call
+local pix1 = Pix.OpenBrick(nil, pixs, 3, 3)
+print(pad("Pix.OpenBrick(nil, pixs, 3, 3)"), pix1)
+
+-- One destination reused for every page
+local pixd = Pix(640, 480, 1)
+for i = 1, 3 do
+	local res = pixd:OpenBrick(pixs, 3, 3)
+	print(pad("pixd:OpenBrick(pixs, 3, 3) == pixd"), res == pixd)
+end
+
+-- In-place
+print(pad("pixs:Invert(pixs) == pixs"), pixs:Invert(pixs) == pixs)
+print(pad("pixs:CountPixels()"), pixs:CountPixels())
+
+-- Trailing destination where the source comes first
+local pix8 = Pix(640, 480, 8)
+print(pad("pixs:Convert1To8(0, 255, pix8) == pix8"), pixs:Convert1To8(0, 255, pix8) == pix8)
+print(pad("pixs:Copy(pixd) == pixd"), pixs:Copy(pixd) == pixd)
+
+header()
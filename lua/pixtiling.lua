@@ -0,0 +1,27 @@
+require "lua/tools"
+
+header("PixTiling")
+
+local pix = Pix(1000, 800, 8)
+pix:SetAllArbitrary(100)
+print(pad("pix"), pix)
+
+-- Without nx, ny, w and h the tiles are sized to fit the L2 cache
+local pt = PixTiling(pix)
+print(pad("pt = PixTiling(pix)"), pt)
+print(pad("pt:GetCount()"), pt:GetCount())
+print(pad("pt:GetSize()"), pt:GetSize())
+
+-- Apply a Pix method to all tiles on worker threads
+local inverted = pt:Apply(pix.Invert)
+print(pad("inverted = pt:Apply(pix.Invert)"), inverted)
+print(pad("inverted:GetPixel(500, 400)"), inverted:GetPixel(500, 400))
+
+-- Tiles with an overlap for a neighborhood operation; the overlap is
+-- stripped when the results are painted into the destination
+pt = PixTiling(pix, 4, 4, 0, 0, 8, 8)
+local blurred = pt:Apply(function(tile, i, j)
+	return tile:BlockconvGray(nil, 5, 5)
+end, 4)
+print(pad("blurred = pt:Apply(fn, 4)"), blurred)
+header()
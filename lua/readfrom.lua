@@ -0,0 +1,44 @@
+require "lua/tools"
+
+header("ReadFrom")
+
+-- Read a file in chunks of 4 KiB; f:read() returns nil at the end
+local f = io.open("images/lualept.jpg", "rb")
+local chunks = 0
+local pix = Pix.ReadFrom(function()
+	local data = f:read(4096)
+	if data then chunks = chunks + 1 end
+	return data
+end)
+f:close()
+print(pad("jpeg from function"), pix:GetDimensions())
+print(pad("chunks"), chunks)
+
+-- Chunks produced in Lua, e.g. by a decompressor, with a format hint
+local png = pix:WriteMem("png")
+local pos = 1
+local pix2 = Pix.ReadFrom(function()
+	if pos > #png then return nil end
+	local data = png:sub(pos, pos + 999)
+	pos = pos + #data
+	return data
+end, "png")
+print(pad("png from function"), pix2:GetDimensions())
+
+-- Formats whose readers seek, e.g. BMP, GIF or PNM, are collected in memory
+for _, format in ipairs({"bmp", "pnm", "tiff"}) do
+	local data = pix:WriteMem(format)
+	local at = 1
+	local pix3 = Pix.ReadFrom(function()
+		if at > #data then return nil end
+		local chunk = data:sub(at, at + 511)
+		at = at + #chunk
+		return chunk
+	end)
+	print(pad(format .. " from function"), pix3 and pix3:GetDimensions())
+end
+
+-- An error raised by the source is raised by ReadFrom
+print(pad("failing source"), pcall(Pix.ReadFrom, function() error("connection lost") end))
+
+header()
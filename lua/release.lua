@@ -0,0 +1,24 @@
+require "lua/tools"
+
+header("Release")
+
+-- Release() frees the raster now instead of when the GC finds it
+for i = 1, 3 do
+	local pix = Pix(2000, 2000, 32)
+	pix:SetAllArbitrary(0x80808000)
+	local gray = pix:ConvertRGBToLuminance()
+	print(pad("gray:GetDimensions()"), gray:GetDimensions())
+	gray:Release()
+	pix:Release()
+end
+
+-- Later use of a released object raises an error
+local pix = Pix(100, 100, 8)
+pix:Release()
+print(pad("pcall(pix.GetWidth, pix)"), pcall(pix.GetWidth, pix))
+print(pad("pix:Release() again"), pcall(pix.Release, pix))
+
+-- With Lua 5.4 the same happens at scope exit:
+--   local pix <close> = Pix("image.png")
+
+header()
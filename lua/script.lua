@@ -37,6 +37,8 @@ print(pad("ll:Debug()"), LuaLept:Debug())
 print(pad("ll:Version()"), LuaLept:Version())
 print(pad("ll:Version('Lua')"), LuaLept:Version('Lua'))
 print(pad("ll:Version('Leptonica')"), LuaLept:Version('Leptonica'))
+local stats = LuaLept:MemoryStats()
+print(pad("ll:MemoryStats()"), stats.lua, stats.external, stats.objects)
 
 print(pad("global sa"), sa)
 print(pad("global box"), box)
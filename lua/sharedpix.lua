@@ -0,0 +1,37 @@
+require "lua/tools"
+
+header("SharedPix")
+
+-- A background map shared by all workers without a copy per worker
+local background = Pix(320, 240, 8)
+background:SetAllArbitrary(40)
+background = background:Share()
+print(pad("background = pix:Share()"), background)
+print(pad("background:GetDimensions()"), background:GetDimensions())
+print(pad("background:GetRefCount()"), background:GetRefCount())
+
+local pixa = Pixa()
+for i = 1, 8 do
+	local pix = Pix(320, 240, 8)
+	pix:SetAllArbitrary(100 + i)
+	pixa:AddPix(pix, "insert")
+end
+
+-- Extra arguments of ParallelMap are passed to every call
+local diff = pixa:ParallelMap(function(pix, i, bg)
+	local d = pix:Copy()
+	return d:SubtractGray(d, bg)
+end, 4, background)
+print(pad("diff = pixa:ParallelMap(fn, 4, background)"), diff)
+print(pad("diff:GetPix(1):GetPixel(0, 0)"), diff:GetPix(1):GetPixel(0, 0))
+
+-- A SharedPix is read-only; modify a private Copy() of it
+local shared = SharedPix(pixa:GetPix(1))
+print(pad("shared = SharedPix(pix)"), shared)
+print(pad("pcall(shared.SetPixel, shared, 0, 0, 255)"), pcall(shared.SetPixel, shared, 0, 0, 255))
+print(pad("pcall(Pix.SetPixel, shared, 0, 0, 255)"), pcall(Pix.SetPixel, shared, 0, 0, 255))
+local copy = shared:Copy()
+copy:SetPixel(0, 0, 255)
+print(pad("copy = shared:Copy(); copy:SetPixel(0, 0, 255)"), copy:GetPixel(0, 0))
+print(pad("shared:GetPixel(0, 0)"), shared:GetPixel(0, 0))
+header()
@@ -0,0 +1,43 @@
+require "lua/tools"
+
+header("SharedQueue and SharedStack")
+
+-- Elements keep their class; objects are moved, not copied
+local q = SharedQueue(8)
+print(pad("q = SharedQueue(8)"), q)
+local pix = Pix(64, 48, 8)
+print(pad("q:Push(pix)"), q:Push(pix))
+print(pad("pix after Push"), pix)
+print(pad("q:Push(Box(1, 2, 3, 4))"), q:Push(Box(1, 2, 3, 4)))
+print(pad("q:Push(\"page\")"), q:Push("page"))
+print(pad("#q"), #q)
+print(pad("q:Pop()"), q:Pop())
+print(pad("q:Pop()"), q:Pop())
+print(pad("q:Pop()"), q:Pop())
+print(pad("q:Pop()"), q:Pop())
+
+local s = SharedStack(2)
+print(pad("s = SharedStack(2)"), s)
+print(pad("s:Push(1)"), s:Push(1))
+print(pad("s:Push(2)"), s:Push(2))
+print(pad("s:Push(3)"), s:Push(3))
+print(pad("s:Pop()"), s:Pop())
+print(pad("s:Pop()"), s:Pop())
+print(pad("s:Pop()"), s:Pop())
+
+-- Workers take page numbers from a shared queue until it is empty
+local pages = SharedQueue(64)
+for i = 1, 20 do pages:Push(i) end
+local pixa = Pixa()
+for i = 1, 4 do pixa:AddPix(Pix(8, 8, 8), "insert") end
+local done = pixa:ParallelMap(function(pix, i, pages)
+	local n = 0
+	while pages:Pop() do n = n + 1 end
+	local d = pix:Copy()
+	d:SetPixel(0, 0, n)
+	return d
+end, 4, pages)
+local total = 0
+for i = 1, done:GetCount() do total = total + done:GetPix(i):GetPixel(0, 0) end
+print(pad("pages taken by the workers"), total)
+header()
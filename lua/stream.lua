@@ -0,0 +1,34 @@
+require "lua/tools"
+
+header("StreamBands")
+
+-- Write an image to stream from
+local input = tmpdir .. "/stream.pnm"
+local pix = Pix(1600, 1200, 8)
+pix:SetAllArbitrary(160)
+pix:WriteImpliedFormat(input)
+
+-- Run a pipeline band by band; the halo comes from its steps
+local pl = PixPipeline{
+	"ConvertTo8",
+	{"OpenBrick", 3, 3},
+	{"ThresholdToBinary", 128}
+}
+print(pad("pl:GetHalo()"), pl:GetHalo())
+local output = tmpdir .. "/stream-binary.pnm"
+print(pad("StreamBands(pipeline)"), Pix.StreamBands(input, output, pl, {rows = 128}))
+print(pad("Read(output)"), Pix.Read(output):GetDimensions())
+
+-- Run a function per band; it gets the band, its first row and the halo rows at its top
+local bands = 0
+output = tmpdir .. "/stream-inverted.pnm"
+print(pad("StreamBands(function)"), Pix.StreamBands(input, output, function(band, y, top)
+	bands = bands + 1
+	return band:Invert()
+end, {rows = 300, halo = 2}))
+print(pad("bands"), bands)
+
+-- Steps changing the geometry can not run on bands
+print(pad("GetHalo() with Scale"), PixPipeline{{"Scale", 0.5}}:GetHalo())
+
+header()
@@ -0,0 +1,31 @@
+require "lua/tools"
+
+header("TiffPages")
+
+-- Write a multipage TIFF (comptype 4 is IFF_TIFF, uncompressed)
+local filename = tmpdir .. "/pages.tif"
+for i = 1, 8 do
+	local pix = Pix(320, 200, 8)
+	pix:SetAllArbitrary(i * 30)
+	pix:WriteTiff(filename, 4, i == 1 and "w" or "a")
+end
+
+-- Decode one page per iteration
+for pix, idx in Pix.TiffPages(filename) do
+	print(pad("page " .. idx), pix:GetDimensions())
+end
+
+-- Decode up to 2 pages ahead on a background thread
+local pages = Pix.TiffPages(filename, 2)
+print(pad("pages"), pages)
+for pix, idx in pages do
+	print(pad("page " .. idx .. " GetPixel(0,0)"), pix:GetPixel(0, 0))
+end
+
+-- Leaving the loop early: Release() stops the thread and unmaps the file
+pages = Pix.TiffPages(filename, 2)
+local pix, idx = pages:Next()
+print(pad("first page"), idx, pix:GetDimensions())
+pages:Release()
+
+header()
@@ -0,0 +1,30 @@
+require "lua/tools"
+
+header("WriteTo")
+
+local pix = Pix(640, 480, 32)
+pix:SetAllArbitrary(0x4080c000)
+
+-- A function sink gets the encoded data in chunks while it is produced
+local chunks, bytes = 0, 0
+local ok = pix:WriteTo(function(data)
+	chunks = chunks + 1
+	bytes = bytes + #data
+end, "png", {chunk = 4096})
+print(pad("png to function"), ok, chunks, bytes)
+
+-- Collect the chunks, e.g. to send them elsewhere
+local parts = {}
+ok = pix:WriteTo(function(data) parts[#parts + 1] = data end, "jpeg", {quality = 90, progressive = true})
+print(pad("jpeg parts"), ok, #parts, #table.concat(parts))
+
+-- An io handle is written to directly
+local f = io.open(tmpdir .. "/writeto.pdf", "wb")
+ok = pix:WriteTo(f, "lpdf", {res = 150, title = "WriteTo"})
+f:close()
+print(pad("pdf to io handle"), ok)
+
+-- An error raised by the sink is raised by WriteTo
+print(pad("failing sink"), pcall(pix.WriteTo, pix, function() error("disk full") end, "tiff-zip"))
+
+header()
@@ -0,0 +1,121 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include <allheaders.h>
+#include "../src/lualept.h"
+
+#if defined(_MSC_VER)
+/* Something goes wrong with importing this */
+int LeptMsgSeverity = 0;
+#endif
+
+/**
+ * \brief Create the global source image, 8 bpp with noise, of %d x %d pixels
+ */
+static const char setup[] =
+    "pix = Pix(%d, %d, 8)\n"
+    "pix:SetAllArbitrary(128)\n"
+    "pix = pix:AddGaussianNoise(30)\n";
+
+/**
+ * \brief Filters to run; %d is replaced by the number of threads
+ */
+static const char *filters[] = {
+    "pix:Blockconv(7, 7, {threads = %d})",
+    "pix:MedianFilter(5, 5, {threads = %d})",
+    "pix:ErodeGray(5, 5, {threads = %d})",
+    "pix:UnsharpMasking(3, 0.5, {threads = %d})",
+    "pix:SauvolaBinarize(7, 0.35, 1, {threads = %d})"
+};
+
+/**
+ * \brief Time one call of a filter on the global pix
+ * \param L Lua state with the global pix
+ * \param filter filter expression
+ * \param nthreads number of threads
+ * \return wall clock time in seconds, or a negative value on error
+ */
+static double bench(lua_State *L, const char *filter, int nthreads)
+{
+    char expr[128];
+    char script[256];
+    snprintf(expr, sizeof(expr), filter, nthreads);
+    snprintf(script, sizeof(script), "local res = %s\nres = nil\n", expr);
+    auto t0 = std::chrono::steady_clock::now();
+    if (ll_load(L, "bench", script))
+        return -1.0;
+    auto t1 = std::chrono::steady_clock::now();
+    ll_load(L, "gc", "collectgarbage()");
+    std::chrono::duration<double> s = t1 - t0;
+    return s.count();
+}
+
+int main(int argc, char **argv)
+{
+    int mp = argc > 1 ? atoi(argv[1]) : 300;
+    int maxthreads = argc > 2 ? atoi(argv[2]) : static_cast<int>(std::thread::hardware_concurrency());
+    int w = 20000;
+    int h;
+    char script[256];
+    lua_State *L;
+    size_t i;
+
+    if (mp <= 0 || maxthreads <= 0) {
+        fprintf(stderr, "Usage: %s [megapixels] [maxthreads]\n", argv[0]);
+        return 1;
+    }
+    h = static_cast<int>(static_cast<long long>(mp) * 1000000 / w);
+
+    L = ll_open(false);
+    snprintf(script, sizeof(script), setup, w, h);
+    if (ll_load(L, "setup", script)) {
+        ll_close(L);
+        return 1;
+    }
+
+    printf("%d x %d pixels (%d MP), 8 bpp\n", w, h, mp);
+    printf("%-48s %8s %10s %8s\n", "filter", "threads", "time", "speedup");
+    for (i = 0; i < sizeof(filters) / sizeof(filters[0]); i++) {
+        double base = bench(L, filters[i], 1);
+        printf("%-48s %8d %8.3f s %7.2fx\n", filters[i], 1, base, 1.0);
+        for (int n = 2; n <= maxthreads; n *= 2) {
+            double t = bench(L, filters[i], n);
+            printf("%-48s %8d %8.3f s %7.2fx\n", filters[i], n, t, base / t);
+        }
+    }
+
+    ll_close(L);
+    return 0;
+}
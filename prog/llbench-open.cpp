@@ -0,0 +1,92 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+#include <allheaders.h>
+#include "../src/lualept.h"
+
+#if defined(_MSC_VER)
+/* Something goes wrong with importing this */
+int LeptMsgSeverity = 0;
+#endif
+
+/**
+ * \brief Small job touching one class, like a thumbnail job would
+ */
+static const char job[] =
+    "local pix = Pix(64, 64, 8)\n"
+    "local w, h, d = pix:GetDimensions()\n";
+
+/**
+ * \brief Time %count runs of ll_open(), optionally a job, and ll_close()
+ * \param lazy register classes on first use if true
+ * \param script optional script to run after ll_open()
+ * \param count number of iterations
+ * \return average time per iteration in microseconds
+ */
+static double bench(bool lazy, const char *script, int count)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < count; i++) {
+        lua_State *L = ll_open(false, nullptr, lazy);
+        if (script)
+            ll_run(L, "job", script);
+        ll_close(L);
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::micro> us = t1 - t0;
+    return us.count() / count;
+}
+
+int main(int argc, char **argv)
+{
+    int count = argc > 1 ? atoi(argv[1]) : 1000;
+    double eager, lazy;
+
+    if (count <= 0) {
+        fprintf(stderr, "Usage: %s [iterations]\n", argv[0]);
+        return 1;
+    }
+
+    printf("%-24s %12s %12s %8s\n", "test", "eager", "lazy", "speedup");
+
+    eager = bench(false, nullptr, count);
+    lazy = bench(true, nullptr, count);
+    printf("%-24s %9.1f us %9.1f us %7.2fx\n", "ll_open/ll_close", eager, lazy, eager / lazy);
+
+    eager = bench(false, job, count);
+    lazy = bench(true, job, count);
+    printf("%-24s %9.1f us %9.1f us %7.2fx\n", "ll_open/Pix job/ll_close", eager, lazy, eager / lazy);
+
+    return 0;
+}
@@ -83,12 +83,60 @@ void hexdump(ll_bytes_t *bytes)
     printf("\n");
 }
 
+/**
+ * \brief Compile all Lua scripts in a directory into the bytecode cache
+ * Chunks are keyed by the script path, so later runs must use the same
+ * path, e.g. "llua -C cache -p lua" prebuilds "llua -C cache lua/pix.lua".
+ * \param progname program name for messages
+ * \param dir directory with the *.lua scripts
+ * \return 0 on success, or 1 if any script failed to compile
+ */
+static int prebuild_dir(const char *progname, const char *dir)
+{
+    char path[1024];
+    ll_bytecode_stats_t stats;
+    l_int32 i, n, failed = 0;
+    size_t len = strlen(dir);
+
+    while (len > 1 && '/' == dir[len - 1])
+        len--;
+    Sarray *sa = getFilenamesInDirectory(dir);
+    if (!sa) {
+        fprintf(stderr, "%s: can not read directory '%s'\n", progname, dir);
+        return 1;
+    }
+    n = sarrayGetCount(sa);
+    for (i = 0; i < n; i++) {
+        const char *name = sarrayGetString(sa, i, L_NOCOPY);
+        size_t nlen = strlen(name);
+        if (nlen < 4 || strcmp(name + nlen - 4, ".lua"))
+            continue;
+        snprintf(path, sizeof(path), "%.*s/%s", static_cast<int>(len), dir, name);
+        if (ll_prebuild(path)) {
+            fprintf(stderr, "%s: failed to compile '%s'\n", progname, path);
+            failed++;
+        }
+    }
+    sarrayDestroy(&sa);
+
+    ll_get_bytecode_stats(&stats);
+    printf("%s: compiled %llu, stored %llu, already cached %llu, failed %d\n", progname,
+           static_cast<unsigned long long>(stats.misses),
+           static_cast<unsigned long long>(stats.stores),
+           static_cast<unsigned long long>(stats.disk_hits),
+           failed);
+    return failed ? 1 : 0;
+}
+
 int main(int argc, char **argv)
 {
     char buff[256];
     lua_State* L = nullptr;
     const char* progname = nullptr;
     const char* filename = nullptr;
+    const char* cachedir = nullptr;
+    const char* prebuild = nullptr;
+    int first = 1;
 
     static Pix *i_pix = nullptr;
     static Box *i_box = nullptr;
@@ -125,11 +173,37 @@ int main(int argc, char **argv)
         progname = argv[0];
     }
 
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <script.lua>\n", progname);
+    /* Options: -C <cachedir> to cache compiled scripts, -p <dir> to prebuild them */
+    while (first + 1 < argc && '-' == argv[first][0]) {
+        if (!strcmp(argv[first], "-C")) {
+            cachedir = argv[first + 1];
+        } else if (!strcmp(argv[first], "-p")) {
+            prebuild = argv[first + 1];
+        } else {
+            break;
+        }
+        first += 2;
+    }
+
+    if (cachedir && ll_set_bytecode_cache(true, cachedir)) {
+        fprintf(stderr, "%s: invalid cache directory '%s'\n", progname, cachedir);
+        return 1;
+    }
+
+    if (prebuild) {
+        if (!cachedir) {
+            fprintf(stderr, "%s: -p requires a cache directory (-C)\n", progname);
+            return 1;
+        }
+        return prebuild_dir(progname, prebuild);
+    }
+
+    if (argc <= first) {
+        fprintf(stderr, "Usage: %s [-C <cachedir>] <script.lua> [args...]\n", progname);
+        fprintf(stderr, "       %s -C <cachedir> -p <scriptdir>\n", progname);
         return 1;
     }
-    filename = argv[1];
+    filename = argv[first];
 
     /* Example for passing a Leptonica type to the script */
 
@@ -148,7 +222,7 @@ int main(int argc, char **argv)
     L = ll_open(false);
 
     /* Set the arg[] table array */
-    ll_set_arg(L, argc, argv);
+    ll_set_arg(L, argc - first + 1, argv + first - 1);
 
     /* Set globals as defined in set_vars */
     ll_set_globals(L, set_vars);
@@ -142,6 +142,8 @@ AddBox(lua_State *L)
     Boxa *boxa = ll_check_Boxa(_fun, L, 1);
     Box *box = ll_check_Box(_fun, L, 2);
     l_int32 flag = ll_check_access_storage(_fun, L, 3, L_COPY);
+    if (L_INSERT == flag)
+        box = ll_take_owned<Box>(_fun, L, 2, LL_BOX);    /* the container owns it now */
     return ll_push_boolean(_fun, L, 0 == boxaAddBox(boxa, box, flag));
 }
 
@@ -171,6 +171,8 @@ AddBoxa(lua_State *L)
     Boxaa *baa = ll_check_Boxaa(_fun, L, 1);
     Boxa *ba = ll_check_Boxa(_fun, L, 2);
     l_int32 flag = ll_check_access_storage(_fun, L, 3, L_COPY);
+    if (L_INSERT == flag)
+        ba = ll_take_owned<Boxa>(_fun, L, 2, LL_BOXA);    /* the container owns it now */
     return ll_push_boolean(_fun, L, 0 == boxaaAddBoxa(baa, ba, flag));
 }
 
@@ -160,6 +160,7 @@ AppendData(lua_State *L)
 {
     LL_FUNC("AppendData");
     Bytea *ba = ll_check_Bytea(_fun, L, 1);
+    ll_check_owned(_fun, L, 1, TNAME);
     size_t newbytes = 0;
     const l_uint8 *newdata = ll_check_lbytes(_fun, L, 2, &newbytes);
     return ll_push_boolean(_fun, L, 0 == l_byteaAppendData(ba, newdata, newbytes));
@@ -180,6 +181,7 @@ AppendString(lua_State *L)
 {
     LL_FUNC("AppendString");
     Bytea *ba = ll_check_Bytea(_fun, L, 1);
+    ll_check_owned(_fun, L, 1, TNAME);
     const char *str = ll_check_string(_fun, L, 2);
     l_ok ok = l_byteaAppendString(ba, str);
     return ll_push_boolean(_fun, L, 0 == ok);
@@ -203,6 +205,8 @@ Copy(lua_State *L)
     LL_FUNC("Copy");
     Bytea *bas = ll_check_Bytea(_fun, L, 1);
     l_int32 copyflag = ll_check_access_storage(_fun, L, 2, L_COPY);
+    if (L_CLONE == copyflag)
+        ll_check_owned(_fun, L, 1, TNAME);
     Bytea *ba = l_byteaCopy(bas, copyflag);
     return ll_push_Bytea(_fun, L, ba);
 }
@@ -351,6 +355,8 @@ Join(lua_State *L)
     LL_FUNC("Join");
     Bytea *ba1 = ll_check_Bytea(_fun, L, 1);
     Bytea *ba2 = ll_opt_Bytea(_fun, L, 2);
+    ll_check_owned(_fun, L, 1, TNAME);
+    ll_check_owned(_fun, L, 2, TNAME);
     if (l_byteaJoin(ba1, &ba2))
         return ll_push_nil(_fun, L);
     ll_push_Bytea(_fun, L, ba2);
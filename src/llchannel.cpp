@@ -0,0 +1,587 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+/**
+ * \file llchannel.cpp
+ * \class Channel
+ *
+ * A bounded queue moving objects between Lua states and threads.
+ *
+ * Sending a Pix, Boxa, Numa or another Leptonica object moves its pointer
+ * into the channel and leaves the user data empty (see ll_take_item()),
+ * so the object is passed on without a copy or re-encoding. The receiving
+ * state pushes it as a new user data of its class. Booleans, numbers and
+ * strings are copied; SharedPix*, Channel*, SharedQueue* and SharedStack*
+ * are passed by reference (see ll_capture_arg()).
+ *
+ * A Channel* can be passed to the jobs of Pixa:ParallelMap() or
+ * PixTiling:Apply(), or from a host to its states with ll_get_channel()
+ * and ll_push_channel(). Send() blocks while the channel holds %capacity
+ * values, Receive() blocks while it is empty; both take an optional
+ * timeout, and TrySend() and TryReceive() never block.
+ * A blocking Send() needs a consumer which drains the channel at the same
+ * time. Pixa:ParallelMap() and PixTiling:Apply() return only after all
+ * jobs, so their jobs must not Send() more values than %capacity; they
+ * use TrySend(), or the caller sizes the channel for all values.
+ */
+
+/** Set TNAME to the class name used in this source file */
+#define TNAME LL_CHANNEL
+
+/** Define a function's name (_fun) with prefix Channel */
+#define LL_FUNC(x) FUNC(TNAME "." x)
+
+/*! Structure behind the Lua class LL_CHANNEL */
+struct ll_channel_s {
+    std::atomic<l_int32>        refs;       /*!< number of user data and host references */
+    std::mutex                  lock;       /*!< guards the members below */
+    std::condition_variable     readable;   /*!< signalled when a value was queued or the channel was closed */
+    std::condition_variable     writable;   /*!< signalled when a slot was freed or the channel was closed */
+    std::deque<ll_item_t>       queue;      /*!< values in the order they were sent */
+    size_t                      capacity;   /*!< maximum number of queued values */
+    size_t                      reserved;   /*!< slots reserved by senders taking their object */
+    bool                        closed;     /*!< no more values can be sent */
+};
+
+/**
+ * \brief Create a new channel.
+ * The caller holds the one reference to the channel.
+ * \param capacity maximum number of queued values (at least 1)
+ * \return pointer to the ll_channel_t.
+ */
+ll_channel_t *
+ll_create_channel(size_t capacity)
+{
+    ll_channel_t *ch = new ll_channel_t();
+    ch->refs = 1;
+    ch->capacity = capacity < 1 ? 1 : capacity;
+    ch->reserved = 0;
+    ch->closed = false;
+    return ch;
+}
+
+/**
+ * \brief Return a new reference to the channel of the Channel* at %arg.
+ * \param L Lua state.
+ * \param arg index of the Channel*
+ * \return pointer to the ll_channel_t, or nullptr if %arg is no Channel*.
+ */
+ll_channel_t *
+ll_get_channel(lua_State *L, int arg)
+{
+    FUNC("ll_get_channel");
+    ll_channel_t *ch = ll_opt_Channel(_fun, L, arg);
+    if (ch)
+        ch->refs++;
+    return ch;
+}
+
+/**
+ * \brief Push a Channel* for the channel %ch to the Lua state %L.
+ * The reference held by the caller is not consumed.
+ * \param L Lua state.
+ * \param ch pointer to the ll_channel_t
+ * \return 1 Channel* on the Lua stack.
+ */
+int
+ll_push_channel(lua_State *L, ll_channel_t *ch)
+{
+    FUNC("ll_push_channel");
+    if (!ch)
+        return ll_push_nil(_fun, L);
+    ch->refs++;
+    return ll_push_Channel(_fun, L, ch);
+}
+
+/**
+ * \brief Release a reference to a channel.
+ * The values still queued are destroyed with the last reference.
+ * \param pch pointer to the ll_channel_t* which is set to nullptr
+ */
+void
+ll_release_channel(ll_channel_t **pch)
+{
+    ll_channel_t *ch = pch ? *pch : nullptr;
+    if (!ch)
+        return;
+    *pch = nullptr;
+    if (--ch->refs > 0)
+        return;
+    for (ll_item_t &item : ch->queue)
+        ll_free_item(&item);
+    delete ch;
+}
+
+/**
+ * \brief Wait for a free slot in the channel and reserve it.
+ * \param ch pointer to the ll_channel_t
+ * \param timeout seconds to wait, or < 0 to wait forever
+ * \return nullptr on success, or the reason of the failure.
+ */
+static const char *
+reserve_slot(ll_channel_t *ch, lua_Number timeout)
+{
+    std::unique_lock<std::mutex> lock(ch->lock);
+    auto ready = [ch]() {
+        return ch->closed || ch->queue.size() + ch->reserved < ch->capacity;
+    };
+    if (timeout < 0) {
+        ch->writable.wait(lock, ready);
+    } else if (!ch->writable.wait_for(lock, std::chrono::duration<lua_Number>(timeout), ready)) {
+        return timeout > 0 ? "timeout" : "full";
+    }
+    if (ch->closed)
+        return "closed";
+    ch->reserved++;
+    return nullptr;
+}
+
+/**
+ * \brief Queue an item in the slot reserved by reserve_slot().
+ * \param ch pointer to the ll_channel_t
+ * \param item pointer to the ll_item_t
+ */
+static void
+queue_item(ll_channel_t *ch, const ll_item_t *item)
+{
+    {
+        std::lock_guard<std::mutex> lock(ch->lock);
+        ch->reserved--;
+        ch->queue.push_back(*item);
+    }
+    ch->readable.notify_one();
+}
+
+/**
+ * \brief Wait for an item in the channel and remove it.
+ * \param ch pointer to the ll_channel_t
+ * \param timeout seconds to wait, or < 0 to wait forever
+ * \param item pointer to the ll_item_t to fill
+ * \return nullptr on success, or the reason of the failure.
+ */
+static const char *
+dequeue_item(ll_channel_t *ch, lua_Number timeout, ll_item_t *item)
+{
+    {
+        std::unique_lock<std::mutex> lock(ch->lock);
+        auto ready = [ch]() {
+            return ch->closed || !ch->queue.empty();
+        };
+        if (timeout < 0) {
+            ch->readable.wait(lock, ready);
+        } else if (!ch->readable.wait_for(lock, std::chrono::duration<lua_Number>(timeout), ready)) {
+            return timeout > 0 ? "timeout" : "empty";
+        }
+        if (ch->queue.empty())
+            return "closed";
+        *item = ch->queue.front();
+        ch->queue.pop_front();
+    }
+    ch->writable.notify_one();
+    return nullptr;
+}
+
+/**
+ * \brief Send the value at %arg through the channel %ch.
+ * <pre>
+ * The value is checked before the sender waits, and an object is taken
+ * from its user data only once a slot is reserved, so that a failed send
+ * leaves it with the sender.
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param ch pointer to the ll_channel_t
+ * \param arg index of the value
+ * \param timeout seconds to wait, or < 0 to wait forever
+ * \return 1 boolean (true) or 2 values (false, reason) on the Lua stack.
+ */
+static int
+send_value(const char *_fun, lua_State *L, ll_channel_t *ch, int arg, lua_Number timeout)
+{
+    const ll_item_type_t *type = ll_check_item(_fun, L, arg);
+    const char *reason;
+    ll_item_t item;
+
+    if (ll_opt_Channel(_fun, L, arg) == ch) {
+        die(_fun, L, "can not send a %s through itself", TNAME);
+        return 0;
+    }
+    reason = reserve_slot(ch, timeout);
+    if (reason) {
+        ll_push_boolean(_fun, L, false);
+        ll_push_string(_fun, L, reason);
+        return 2;
+    }
+    ll_take_item(_fun, L, arg, type, &item);
+    queue_item(ch, &item);
+    return ll_push_boolean(_fun, L, true);
+}
+
+/**
+ * \brief Receive a value from the channel %ch.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param ch pointer to the ll_channel_t
+ * \param timeout seconds to wait, or < 0 to wait forever
+ * \return 1 value or 2 values (nil, reason) on the Lua stack.
+ */
+static int
+receive_value(const char *_fun, lua_State *L, ll_channel_t *ch, lua_Number timeout)
+{
+    ll_item_t item;
+    const char *reason = dequeue_item(ch, timeout, &item);
+
+    if (reason) {
+        ll_push_nil(_fun, L);
+        ll_push_string(_fun, L, reason);
+        return 2;
+    }
+    return ll_push_item(_fun, L, &item);
+}
+
+/**
+ * \brief Destroy a Channel*, i.e. drop its reference to the channel.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Channel* (ch).
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+Destroy(lua_State *L)
+{
+    LL_FUNC("Destroy");
+    ll_channel_t *ch = ll_take_udata<ll_channel_t>(_fun, L, 1, TNAME);
+    DBG(LOG_DESTROY, "%s: '%s' %s = %p\n", _fun,
+        TNAME,
+        "ch", reinterpret_cast<void *>(ch));
+    ll_release_channel(&ch);
+    return 0;
+}
+
+/**
+ * \brief Printable string for a Channel*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Channel* (ch).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 string on the Lua stack.
+ */
+static int
+toString(lua_State *L)
+{
+    LL_FUNC("toString");
+    char *str = ll_calloc<char>(_fun, L, LL_STRBUFF);
+    ll_channel_t *ch = ll_check_Channel(_fun, L, 1);
+    luaL_Buffer B;
+
+    luaL_buffinit(L, &B);
+    if (!ch) {
+        luaL_addstring(&B, "nil");
+    } else {
+        size_t count;
+        bool closed;
+        {
+            std::lock_guard<std::mutex> lock(ch->lock);
+            count = ch->queue.size();
+            closed = ch->closed;
+        }
+        snprintf(str, LL_STRBUFF,
+                 TNAME "*: %p",
+                 reinterpret_cast<void *>(ch));
+        luaL_addstring(&B, str);
+        snprintf(str, LL_STRBUFF,
+                 "\n    count = %d, capacity = %d, refs = %d%s",
+                 static_cast<int>(count), static_cast<int>(ch->capacity),
+                 ch->refs.load(), closed ? ", closed" : "");
+        luaL_addstring(&B, str);
+    }
+    luaL_pushresult(&B);
+    ll_free(str);
+    return 1;
+}
+
+/**
+ * \brief Close the channel.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Channel* (ch).
+ *
+ * Senders waiting for a slot return false, "closed". Receivers get the
+ * values still queued, then nil, "closed".
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+Close(lua_State *L)
+{
+    LL_FUNC("Close");
+    ll_channel_t *ch = ll_check_Channel(_fun, L, 1);
+    {
+        std::lock_guard<std::mutex> lock(ch->lock);
+        ch->closed = true;
+    }
+    ch->readable.notify_all();
+    ch->writable.notify_all();
+    return 0;
+}
+
+/**
+ * \brief Get the capacity of the channel.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Channel* (ch).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 integer on the Lua stack.
+ */
+static int
+GetCapacity(lua_State *L)
+{
+    LL_FUNC("GetCapacity");
+    ll_channel_t *ch = ll_check_Channel(_fun, L, 1);
+    return ll_push_size_t(_fun, L, ch->capacity);
+}
+
+/**
+ * \brief Get the number of values queued in the channel.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Channel* (ch).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 integer on the Lua stack.
+ */
+static int
+GetCount(lua_State *L)
+{
+    LL_FUNC("GetCount");
+    ll_channel_t *ch = ll_check_Channel(_fun, L, 1);
+    std::lock_guard<std::mutex> lock(ch->lock);
+    return ll_push_size_t(_fun, L, ch->queue.size());
+}
+
+/**
+ * \brief Check if the channel is closed.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Channel* (ch).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 boolean on the Lua stack.
+ */
+static int
+IsClosed(lua_State *L)
+{
+    LL_FUNC("IsClosed");
+    ll_channel_t *ch = ll_check_Channel(_fun, L, 1);
+    std::lock_guard<std::mutex> lock(ch->lock);
+    return ll_push_boolean(_fun, L, ch->closed);
+}
+
+/**
+ * \brief Receive a value from the channel, waiting while it is empty.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Channel* (ch).
+ * Arg #2 is an optional number (timeout) in seconds.
+ *
+ * Without %timeout, Receive() waits until a value arrives or the channel
+ * is closed and empty.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 value, or nil and "timeout" or "closed", on the Lua stack.
+ */
+static int
+Receive(lua_State *L)
+{
+    LL_FUNC("Receive");
+    ll_channel_t *ch = ll_check_Channel(_fun, L, 1);
+    lua_Number timeout = ll_opt_l_float64(_fun, L, 2, -1.0);
+    return receive_value(_fun, L, ch, timeout);
+}
+
+/**
+ * \brief Send a value through the channel, waiting while it is full.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Channel* (ch).
+ * Arg #2 is expected to be a value other than nil (value).
+ * Arg #3 is an optional number (timeout) in seconds.
+ *
+ * An object is moved, i.e. its user data is empty after the call, unless
+ * the send fails. Without %timeout, Send() waits until there is a free
+ * slot or the channel is closed.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 boolean true, or false and "timeout" or "closed", on the Lua stack.
+ */
+static int
+Send(lua_State *L)
+{
+    LL_FUNC("Send");
+    ll_channel_t *ch = ll_check_Channel(_fun, L, 1);
+    lua_Number timeout = ll_opt_l_float64(_fun, L, 3, -1.0);
+    return send_value(_fun, L, ch, 2, timeout);
+}
+
+/**
+ * \brief Receive a value from the channel without waiting.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Channel* (ch).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 value, or nil and "empty" or "closed", on the Lua stack.
+ */
+static int
+TryReceive(lua_State *L)
+{
+    LL_FUNC("TryReceive");
+    ll_channel_t *ch = ll_check_Channel(_fun, L, 1);
+    return receive_value(_fun, L, ch, 0);
+}
+
+/**
+ * \brief Send a value through the channel without waiting.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Channel* (ch).
+ * Arg #2 is expected to be a value other than nil (value).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 boolean true, or false and "full" or "closed", on the Lua stack.
+ */
+static int
+TrySend(lua_State *L)
+{
+    LL_FUNC("TrySend");
+    ll_channel_t *ch = ll_check_Channel(_fun, L, 1);
+    return send_value(_fun, L, ch, 2, 0);
+}
+
+/**
+ * \brief Check Lua stack at index (%arg) for user data of class Channel*.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the ll_channel_t contained in the user data.
+ */
+ll_channel_t *
+ll_check_Channel(const char *_fun, lua_State *L, int arg)
+{
+    return *ll_check_udata<ll_channel_t>(_fun, L, arg, TNAME);
+}
+
+/**
+ * \brief Optionally expect a Channel* at index (%arg) on the Lua stack.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the ll_channel_t contained in the user data.
+ */
+ll_channel_t *
+ll_opt_Channel(const char *_fun, lua_State *L, int arg)
+{
+    if (!ll_isudata(_fun, L, arg, TNAME))
+        return nullptr;
+    return ll_check_Channel(_fun, L, arg);
+}
+
+/**
+ * \brief Push Channel* user data to the Lua stack and set its meta table.
+ * The user data takes over the reference held by the caller.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param ch pointer to the ll_channel_t
+ * \return 1 Channel* on the Lua stack.
+ */
+int
+ll_push_Channel(const char *_fun, lua_State *L, ll_channel_t *ch)
+{
+    if (!ch)
+        return ll_push_nil(_fun, L);
+    return ll_push_udata(_fun, L, TNAME, ch);
+}
+
+/**
+ * \brief Create and push a new Channel*.
+ * <pre>
+ * Arg #1 is an optional l_int32 (capacity), default 1.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 Channel* on the Lua stack.
+ */
+int
+ll_new_Channel(lua_State *L)
+{
+    FUNC("ll_new_Channel");
+    l_int32 capacity = ll_opt_l_int32(_fun, L, 1, 1);
+    ll_channel_t *ch = nullptr;
+    if (capacity < 1) {
+        die(_fun, L, "capacity must be at least 1 (%d)", capacity);
+        return 0;
+    }
+    ch = ll_create_channel(static_cast<size_t>(capacity));
+    DBG(LOG_NEW_CLASS, "%s: created %s* %p\n", _fun,
+        TNAME, reinterpret_cast<void *>(ch));
+    return ll_push_Channel(_fun, L, ch);
+}
+
+/**
+ * \brief Register the Channel methods and functions in the Channel meta table.
+ * \param L Lua state.
+ * \return 1 table on the Lua stack.
+ */
+int
+ll_open_Channel(lua_State *L)
+{
+    static const luaL_Reg methods[] = {
+        {"__gc",                Destroy},
+        {"__len",               GetCount},
+        {"__new",               ll_new_Channel},
+        {"__tostring",          toString},
+        {"Close",               Close},
+        {"Destroy",             Destroy},
+        {"GetCapacity",         GetCapacity},
+        {"GetCount",            GetCount},
+        {"IsClosed",            IsClosed},
+        {"Receive",             Receive},
+        {"Send",                Send},
+        {"TryReceive",          TryReceive},
+        {"TrySend",             TrySend},
+        LUA_SENTINEL
+    };
+    LO_FUNC(TNAME);
+    ll_set_global_cfunct(_fun, L, TNAME, ll_new_Channel);
+    ll_register_class(_fun, L, TNAME, methods);
+    return 1;
+}
@@ -287,7 +287,7 @@ FromArray(lua_State *L)
 }
 
 /**
- * \brief Get the Dna* (%da) as table of lua_Number.
+ * \brief Get the Dna* (%da) as a Float64Array*.
  * <pre>
  * Arg #1 (i.e. self) is expected to be a Dna* (da).
  *
@@ -304,18 +304,17 @@ FromArray(lua_State *L)
  *          is another way to insure full initialization.
  * </pre>
  * \param L Lua state.
- * \return 1 table array on the Lua stack.
+ * \return 1 Float64Array* on the Lua stack.
  */
 static int
 GetDArray(lua_State *L)
 {
     LL_FUNC("GetDArray");
     Dna *da = ll_check_Dna(_fun, L, 1);
-    l_float64 *darray = l_dnaGetDArray(da, L_COPY);
+    l_float64 *darray = l_dnaGetDArray(da, L_NOCOPY);
     l_int32 n = l_dnaGetCount(da);
-    int res = ll_pack_Darray(_fun, L, darray, n);
-    ll_free(darray);
-    return res;
+    TypedArray *ta = ll_create_TypedArray(_fun, L, LL_ARRAY_FLOAT64, n, darray);
+    return ll_push_TypedArray(_fun, L, ta);
 }
 
 /**
@@ -693,6 +692,20 @@ ll_new_Dna(lua_State *L)
         da = l_dnaCopy(das);
     }
 
+    if (!da && ll_opt_TypedArray(_fun, L, 1, LL_ARRAY_FLOAT64)) {
+        TypedArray *ta = ll_check_TypedArray(_fun, L, 1, LL_ARRAY_FLOAT64);
+        DBG(LOG_NEW_PARAM, "%s: create for %s* = %p\n", _fun,
+            LL_FLOAT64ARRAY, reinterpret_cast<void *>(ta));
+        da = l_dnaCreateFromDArray(reinterpret_cast<l_float64 *>(ta->data), ta->n, L_COPY);
+    }
+
+    if (!da && ll_opt_TypedArray(_fun, L, 1, LL_ARRAY_INT32)) {
+        TypedArray *ta = ll_check_TypedArray(_fun, L, 1, LL_ARRAY_INT32);
+        DBG(LOG_NEW_PARAM, "%s: create for %s* = %p\n", _fun,
+            LL_INT32ARRAY, reinterpret_cast<void *>(ta));
+        da = l_dnaCreateFromIArray(reinterpret_cast<l_int32 *>(ta->data), ta->n);
+    }
+
     if (ll_isudata(_fun, L, 1, LUA_FILEHANDLE)) {
         luaL_Stream* stream = ll_check_stream(_fun, L, 1);
         DBG(LOG_NEW_PARAM, "%s: create for %s* = %p\n", _fun,
@@ -171,6 +171,8 @@ AddDna(lua_State *L)
     Dnaa *daa = ll_check_Dnaa(_fun, L, 1);
     L_Dna *da = ll_check_Dna(_fun, L, 2);
     l_int32 copyflag = ll_check_access_storage(_fun, L, 3, L_COPY);
+    if (L_INSERT == copyflag)
+        da = ll_take_owned<L_Dna>(_fun, L, 2, LL_DNA);    /* the container owns it now */
     return ll_push_boolean(_fun, L, 0 == l_dnaaAddDna(daa, da, copyflag));
 }
 
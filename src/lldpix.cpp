@@ -374,12 +374,14 @@ EndianByteSwap(lua_State *L)
 }
 
 /**
- * \brief Get the DPix* (%dpix) data as a 2D table array of numbers.
+ * \brief Get the DPix* (%dpix) data as a Float64Array* of (%wpl * %h) elements.
  * <pre>
  * Arg #1 (i.e. self) is expected to be a DPix* (dpix).
+ *
+ * Element (x, y) is found at index (y * wpl + x + 1).
  * </pre>
  * \param L Lua state.
- * \return 1 2D table array of l_float64 on the Lua stack.
+ * \return 1 Float64Array* on the Lua stack.
  */
 static int
 GetData(lua_State *L)
@@ -392,7 +394,8 @@ GetData(lua_State *L)
     l_int32 h = 0;
     if (dpixGetDimensions(dpix, &w, &h))
         return ll_push_nil(_fun, L);
-    return ll_pack_Darray_2d(_fun, L, data, wpl, h);
+    TypedArray *ta = ll_create_TypedArray(_fun, L, LL_ARRAY_FLOAT64, wpl * h, data);
+    return ll_push_TypedArray(_fun, L, ta);
 }
 
 /**
@@ -697,30 +700,38 @@ SetAllArbitrary(lua_State *L)
 }
 
 /**
- * \brief Set data in a DPix (%dpix) from a 2D table array (%data, %wpl, %h).
+ * \brief Set data in a DPix (%dpix) from a Float64Array* or a 2D table array (%data, %wpl, %h).
  * <pre>
  * Arg #1 (i.e. self) is expected to be a DPix* (dpix).
+ * Arg #2 is expected to be a Float64Array* of (%wpl * %h) elements, or
+ *        a Lua array table (h) of array tables (wpl).
  * </pre>
  * \param L Lua state.
- * \return 1 2D table array of l_float64 on the Lua stack.
+ * \return 1 boolean on the Lua stack.
  */
 static int
 SetData(lua_State *L)
 {
     LL_FUNC("SetData");
     DPix *dpix = ll_check_DPix(_fun, L, 1);
+    TypedArray *ta = ll_opt_TypedArray(_fun, L, 2, LL_ARRAY_FLOAT64);
     l_int32 wpl = dpixGetWpl(dpix);
     l_int32 w = 0;
     l_int32 h = 0;
     if (dpixGetDimensions(dpix, &w, &h))
         return ll_push_nil(_fun, L);
+    if (ta) {
+        l_float64 *data = dpixGetData(dpix);
+        if (!data || ta->n != wpl * h)
+            return ll_push_boolean(_fun, L, FALSE);
+        memcpy(data, ta->data, static_cast<size_t>(ta->n) * sizeof(l_float64));
+        return ll_push_boolean(_fun, L, TRUE);
+    }
     l_float64 *data = ll_unpack_Darray_2d(_fun, L, 2, wpl, h);
     if (nullptr == data)
         return ll_push_nil(_fun, L);
-    if (dpixSetData(dpix, data))
-        return ll_push_nil(_fun, L);
-    ll_free(data);
-    return 1;
+    /* Do not ll_free(data); it is owned by the DPix* after dpixSetData() */
+    return ll_push_boolean(_fun, L, 0 == dpixSetData(dpix, data));
 }
 
 /**
@@ -904,7 +915,10 @@ ll_push_DPix(const char *_fun, lua_State *L, DPix *cd)
 {
     if (!cd)
         return ll_push_nil(_fun, L);
-    return ll_push_udata(_fun, L, TNAME, cd);
+    l_int32 w = 0, h = 0;
+    dpixGetDimensions(cd, &w, &h);
+    size_t bytes = static_cast<size_t>(dpixGetWpl(cd)) * static_cast<size_t>(h) * sizeof(l_float64);
+    return ll_push_udata(_fun, L, TNAME, cd, bytes);
 }
 
 /**
@@ -36,6 +36,9 @@
  * \class FPix
  *
  * A 2-D pixels array of floats (l_float32).
+ *
+ * Functions taking a destination FPix* (fpixd) as Arg #1 accept nil for
+ * a new FPix*, or fpixd == fpixs to work in-place (see llpix.cpp).
  */
 
 /** Set TNAME to the class name used in this source file */
@@ -326,6 +329,28 @@ AffinePta(lua_State *L)
     return ll_push_FPix(_fun, L, fpix);
 }
 
+/**
+ * \brief Run a method of the FPix* (%fpix) on a background thread.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a FPix* (fpix).
+ * Arg #2 is expected to be a string (method).
+ * Arg #3 and following are optional arguments of the method.
+ *
+ * The method runs in a worker state of its own. %fpix and the other
+ * objects in the arguments are pinned until the call is awaited (see
+ * Future).
+ * Returns a Future*; Future:Await() returns the results of the method.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 Future* on the Lua stack.
+ */
+static int
+Async(lua_State *L)
+{
+    LL_FUNC("Async");
+    return ll_async(_fun, L, TNAME);
+}
+
 /**
  * \brief Auto render (%ncontours) contours of the FPix* (%fpix) to a Pix* (%pix).
  * <pre>
@@ -521,7 +546,7 @@ ConvolveSep(lua_State *L)
 /**
  * \brief Copy the FPix* (%fpixs) to FPix* (%fpixd).
  * <pre>
- * Arg #1 (i.e. self) is expected to be a FPix* (fpixd).
+ * Arg #1 (i.e. self) is expected to be a FPix* (fpixd) or nil.
  * Arg #2 is expected to be a FPix* (fpixs).
  *
  * Leptonica's Notes:
@@ -551,10 +576,10 @@ static int
 Copy(lua_State *L)
 {
     LL_FUNC("Copy");
-    FPix *fpixd = ll_opt_FPix(_fun, L, 1);
+    FPix *fpixd = ll_opt_FPixd(_fun, L, 1);
     FPix *fpixs = ll_check_FPix(_fun, L, 2);
     FPix *fpix = fpixCopy(fpixd, fpixs);
-    return ll_push_FPix(_fun, L, fpix);
+    return ll_push_FPixd(_fun, L, 1, fpix);
 }
 
 /**
@@ -636,7 +661,7 @@ DisplayMaxDynamicRange(lua_State *L)
 /**
  * \brief Swap endianness of FPix* (%fpixs) giving FPix* (%fpixd).
  * <pre>
- * Arg #1 (i.e. self) is expected to be a FPix* (fpixd).
+ * Arg #1 (i.e. self) is expected to be a FPix* (fpixd) or nil.
  * Arg #2 is expected to be a FPix* (fpixs).
  *
  * Leptonica's Notes:
@@ -656,16 +681,16 @@ static int
 EndianByteSwap(lua_State *L)
 {
     LL_FUNC("EndianByteSwap");
-    FPix *fpixd = ll_opt_FPix(_fun, L, 1);
+    FPix *fpixd = ll_opt_FPixd(_fun, L, 1);
     FPix *fpixs = ll_check_FPix(_fun, L, 2);
     FPix *fpix = fpixEndianByteSwap(fpixd, fpixs);
-    return ll_push_FPix(_fun, L, fpix);
+    return ll_push_FPixd(_fun, L, 1, fpix);
 }
 
 /**
  * \brief Flip left-right FPix* (%fpixs).
  * <pre>
- * Arg #1 (i.e. self) is expected to be a FPix* (fpixd).
+ * Arg #1 (i.e. self) is expected to be a FPix* (fpixd) or nil.
  * Arg #2 is expected to be a FPix* (fpixs).
  * </pre>
  * \param L Lua state.
@@ -675,16 +700,16 @@ static int
 FlipLR(lua_State *L)
 {
     LL_FUNC("FlipLR");
-    FPix *fpixd = ll_check_FPix(_fun, L, 1);
+    FPix *fpixd = ll_opt_FPixd(_fun, L, 1);
     FPix *fpixs = ll_check_FPix(_fun, L, 2);
     FPix *fpix = fpixFlipLR(fpixd, fpixs);
-    return ll_push_FPix(_fun, L, fpix);
+    return ll_push_FPixd(_fun, L, 1, fpix);
 }
 
 /**
  * \brief Flip top-bottom FPix* (%fpixs).
  * <pre>
- * Arg #1 (i.e. self) is expected to be a FPix* (fpixd).
+ * Arg #1 (i.e. self) is expected to be a FPix* (fpixd) or nil.
  * Arg #2 is expected to be a FPix* (fpixs).
  *
  * Leptonica's Notes:
@@ -709,19 +734,21 @@ static int
 FlipTB(lua_State *L)
 {
     LL_FUNC("FlipTB");
-    FPix *fpixd = ll_check_FPix(_fun, L, 1);
+    FPix *fpixd = ll_opt_FPixd(_fun, L, 1);
     FPix *fpixs = ll_check_FPix(_fun, L, 2);
     FPix *fpix = fpixFlipTB(fpixd, fpixs);
-    return ll_push_FPix(_fun, L, fpix);
+    return ll_push_FPixd(_fun, L, 1, fpix);
 }
 
 /**
- * \brief Get the data of FPix* (%fpix) as 2D table array of l_float32 (%farray).
+ * \brief Get the data of FPix* (%fpix) as a Float32Array* of (%wpl * %h) elements.
  * <pre>
  * Arg #1 (i.e. self) is expected to be a FPix* (fpix).
+ *
+ * Element (x, y) is found at index (y * wpl + x + 1).
  * </pre>
  * \param L Lua state.
- * \return 1 on the Lua stack.
+ * \return 1 Float32Array* on the Lua stack.
  */
 static int
 GetData(lua_State *L)
@@ -734,7 +761,8 @@ GetData(lua_State *L)
     if (fpixGetDimensions(fpix, &w, &h))
         return ll_push_nil(_fun, L);
     l_float32 *farray = fpixGetData(fpix);
-    return ll_pack_Farray_2d(_fun, L, farray, wpl, h);
+    TypedArray *ta = ll_create_TypedArray(_fun, L, LL_ARRAY_FLOAT32, wpl * h, farray);
+    return ll_push_TypedArray(_fun, L, ta);
 }
 
 /**
@@ -888,7 +916,7 @@ GetWpl(lua_State *L)
 /**
  * \brief Create a linear combination of two FPix* (%fpix1, %fpix2) using fractions (%a, %b).
  * <pre>
- * Arg #1 (i.e. self) is expected to be a FPix* (fpixd).
+ * Arg #1 (i.e. self) is expected to be a FPix* (fpixd) or nil.
  * Arg #2 is expected to be a FPix* (fpixs1).
  * Arg #3 is expected to be a FPix* (fpixs2).
  * Arg #4 is expected to be a l_float32 (a).
@@ -911,13 +939,13 @@ static int
 LinearCombination(lua_State *L)
 {
     LL_FUNC("LinearCombination");
-    FPix *fpixd = ll_check_FPix(_fun, L, 1);
+    FPix *fpixd = ll_opt_FPixd(_fun, L, 1);
     FPix *fpixs1 = ll_check_FPix(_fun, L, 2);
     FPix *fpixs2 = ll_check_FPix(_fun, L, 3);
     l_float32 a = ll_check_l_float32(_fun, L, 4);
     l_float32 b = ll_check_l_float32(_fun, L, 5);
     FPix *result = fpixLinearCombination(fpixd, fpixs1, fpixs2, a, b);
-    return ll_push_FPix(_fun, L, result);
+    return ll_push_FPixd(_fun, L, 1, result);
 }
 
 /**
@@ -1171,7 +1199,7 @@ ResizeImageData(lua_State *L)
 /**
  * \brief Rotate FPix* (%fpixs) by 180 degrees giving FPix* (%fpixd).
  * <pre>
- * Arg #1 (i.e. self) is expected to be a FPix* (fpixd).
+ * Arg #1 (i.e. self) is expected to be a FPix* (fpixd) or nil.
  * Arg #2 is expected to be a FPix* (fpixs).
  *
  * Leptonica's Notes:
@@ -1195,10 +1223,10 @@ static int
 Rotate180(lua_State *L)
 {
     LL_FUNC("Rotate180");
-    FPix *fpixd = ll_opt_FPix(_fun, L, 1);
+    FPix *fpixd = ll_opt_FPixd(_fun, L, 1);
     FPix *fpixs = ll_check_FPix(_fun, L, 2);
     FPix *fpix = fpixRotate180(fpixd, fpixs);
-    return ll_push_FPix(_fun, L, fpix);
+    return ll_push_FPixd(_fun, L, 1, fpix);
 }
 
 /**
@@ -1293,9 +1321,11 @@ SetAllArbitrary(lua_State *L)
 }
 
 /**
- * \brief Set image data of FPix* (%fpix) to a 2D array of l_float32 (%data).
+ * \brief Set image data of FPix* (%fpix) from a Float32Array* or a 2D array of l_float32 (%data).
  * <pre>
  * Arg #1 (i.e. self) is expected to be a FPix* (fpix).
+ * Arg #2 is expected to be a Float32Array* of (%wpl * %h) elements, or
+ *        a Lua array table (h) of array tables (wpl).
  * </pre>
  * \param L Lua state.
  * \return 1 boolean on the Lua stack.
@@ -1305,16 +1335,23 @@ SetData(lua_State *L)
 {
     LL_FUNC("SetData");
     FPix *fpix = ll_check_FPix(_fun, L, 1);
+    TypedArray *ta = ll_opt_TypedArray(_fun, L, 2, LL_ARRAY_FLOAT32);
     l_int32 w, h;
     l_int32 wpl = fpixGetWpl(fpix);
     if (fpixGetDimensions(fpix, &w, &h))
         return ll_push_nil(_fun, L);
+    if (ta) {
+        l_float32 *data = fpixGetData(fpix);
+        if (!data || ta->n != wpl * h)
+            return ll_push_boolean(_fun, L, FALSE);
+        memcpy(data, ta->data, static_cast<size_t>(ta->n) * sizeof(l_float32));
+        return ll_push_boolean(_fun, L, TRUE);
+    }
     l_float32* data = ll_unpack_Farray_2d(_fun, L, 2, wpl, h);
     if (nullptr == data)
         return ll_push_nil(_fun, L);
-    ll_push_boolean(_fun, L, 0 == fpixSetData(fpix, data));
-    ll_free(data);
-    return 1;
+    /* Do not ll_free(data); it is owned by the FPix* after fpixSetData() */
+    return ll_push_boolean(_fun, L, 0 == fpixSetData(fpix, data));
 }
 
 /**
@@ -1521,7 +1558,47 @@ ll_push_FPix(const char *_fun, lua_State *L, FPix *cd)
 {
     if (!cd)
         return ll_push_nil(_fun, L);
-    return ll_push_udata(_fun, L, TNAME, cd);
+    l_int32 w = 0, h = 0;
+    fpixGetDimensions(cd, &w, &h);
+    size_t bytes = static_cast<size_t>(fpixGetWpl(cd)) * static_cast<size_t>(h) * sizeof(l_float32);
+    return ll_push_udata(_fun, L, TNAME, cd, bytes);
+}
+
+/**
+ * \brief Optionally expect a destination FPix* at index (%arg) on the Lua stack.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data, or nil
+ * \return pointer to the FPix* contained in the user data, or nullptr.
+ */
+FPix *
+ll_opt_FPixd(const char *_fun, lua_State *L, int arg)
+{
+    if (lua_isnoneornil(L, arg))
+        return nullptr;
+    return ll_check_FPix(_fun, L, arg);
+}
+
+/**
+ * \brief Push the FPix* (%fpix) resulting from a function with a destination at index (%arg).
+ * <pre>
+ * If the result is the destination FPix*, its user data is pushed again,
+ * instead of a second user data owning the same FPix*.
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index of the destination FPix* (see ll_opt_FPixd())
+ * \param fpix pointer to the resulting FPix*
+ * \return 1 FPix* on the Lua stack.
+ */
+int
+ll_push_FPixd(const char *_fun, lua_State *L, int arg, FPix *fpix)
+{
+    if (fpix && ll_isudata(_fun, L, arg, TNAME) && fpix == ll_check_FPix(_fun, L, arg)) {
+        lua_pushvalue(L, arg);
+        return 1;
+    }
+    return ll_push_FPix(_fun, L, fpix);
 }
 
 /**
@@ -1605,6 +1682,7 @@ ll_open_FPix(lua_State *L)
         {"AddSlopeBorder",          AddSlopeBorder},
         {"Affine",                  Affine},
         {"AffinePta",               AffinePta},
+        {"Async",                   Async},
         {"AutoRenderContours",      AutoRenderContours},
         {"ChangeRefcount",          ChangeRefcount},
         {"Clone",                   Clone},
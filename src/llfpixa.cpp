@@ -137,6 +137,8 @@ AddFPix(lua_State *L)
     FPixa *fpixa = ll_check_FPixa(_fun, L, 1);
     FPix *fpix = ll_check_FPix(_fun, L, 2);
     l_int32 copyflag = ll_check_access_storage(_fun, L, 3, L_COPY);
+    if (L_INSERT == copyflag)
+        fpix = ll_take_owned<FPix>(_fun, L, 2, LL_FPIX);    /* the container owns it now */
     return ll_push_boolean(_fun, L, 0 == fpixaAddFPix(fpixa, fpix, copyflag));
 }
 
@@ -0,0 +1,534 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * \file llfuture.cpp
+ * \class Future
+ *
+ * The result of a method call running on a background thread.
+ *
+ * Pix:Async("Method", ...) (and the same for Pixa and FPix) runs the
+ * method in a worker state of its own (see ll_run_workers()), so that a
+ * script can e.g. decode the next page while the current one is being
+ * deskewed or encoded, without running several states itself.
+ *
+ * Objects passed to the method are pinned for the duration of the call:
+ * they stay with their user data, which raise an error on every use until
+ * the Future* is awaited, and are lent to the worker state. A Pix* with
+ * clones can not be pinned, because reference counts are not thread safe.
+ * Other values are copied (see ll_capture_arg()).
+ *
+ * Inside a coroutine, Future:Await() yields while the call is running,
+ * so that a scheduler can resume other coroutines in the meantime; outside
+ * of a coroutine it blocks. Future:Poll() checks without waiting.
+ */
+
+/** Set TNAME to the class name used in this source file */
+#define TNAME LL_FUTURE
+
+/** Define a function's name (_fun) with prefix Future */
+#define LL_FUNC(x) FUNC(TNAME "." x)
+
+/*! Structure behind the Lua class LL_FUTURE */
+struct ll_future_s {
+    std::thread                 thread;     /*!< the background thread */
+    std::mutex                  lock;       /*!< guards %done and %error */
+    std::condition_variable     finished;   /*!< signalled when %done is set */
+    bool                        done;       /*!< the call has finished */
+    bool                        joined;     /*!< the thread is joined and the arguments are unpinned */
+    bool                        taken;      /*!< the results were pushed by Await() */
+    ll_bytes_t                  chunk;      /*!< code calling the method */
+    std::vector<ll_item_t>      args;       /*!< arguments, including self */
+    std::vector<void *>         pins;       /*!< objects pinned, in the order of the uservalue table */
+    std::vector<ll_item_t>      results;    /*!< results of the method */
+    std::vector<size_t>         from_pin;   /*!< for each result, 1 + index in %pins, or 0 */
+    std::string                 error;      /*!< error message of the call */
+};
+
+/**
+ * \brief Push the arguments of the call to the worker state.
+ * \param W worker Lua state.
+ * \param idx index of the job (always 0)
+ * \param ctx pointer to the ll_future_t
+ * \return number of arguments pushed.
+ */
+static int
+future_push(lua_State *W, l_int32 idx, void *ctx)
+{
+    FUNC("ll_async");
+    ll_future_t *f = reinterpret_cast<ll_future_t *>(ctx);
+    UNUSED(idx);
+    luaL_checkstack(W, static_cast<int>(f->args.size()), _fun);
+    for (ll_item_t &item : f->args)
+        ll_push_item(_fun, W, &item);
+    return static_cast<int>(f->args.size());
+}
+
+/**
+ * \brief Take the results of the call from the table on top of the worker state.
+ * \param W worker Lua state.
+ * \param idx index of the job (always 0)
+ * \param ctx pointer to the ll_future_t
+ */
+static void
+future_take(lua_State *W, l_int32 idx, void *ctx)
+{
+    FUNC("ll_async");
+    ll_future_t *f = reinterpret_cast<ll_future_t *>(ctx);
+    int t = lua_gettop(W);
+    lua_Integer i, n;
+    UNUSED(idx);
+
+    lua_getfield(W, t, "n");
+    n = lua_tointeger(W, -1);
+    lua_pop(W, 1);
+    for (i = 1; i <= n; i++) {
+        ll_item_t item = ll_item_t();
+        size_t pin = 0;
+        lua_rawgeti(W, t, i);
+        if (ll_udata_borrowed(W, -1)) {
+            /* a pinned argument returned as result, e.g. self */
+            void *ptr = *reinterpret_cast<void **>(lua_touserdata(W, -1));
+            for (size_t j = 0; j < f->pins.size() && !pin; j++)
+                if (f->pins[j] == ptr)
+                    pin = j + 1;
+            if (!pin) {
+                die(_fun, W, "result #%d is a borrowed object", static_cast<int>(i));
+                return;
+            }
+        } else if (!lua_isnil(W, -1)) {
+            /* the worker state is closed before the results are pushed */
+            const ll_item_type_t *type = ll_check_item(_fun, W, -1, LL_ITEM_SHARED_OK);
+            ll_take_item(_fun, W, lua_gettop(W), type, &item);
+        }
+        f->results.push_back(item);
+        f->from_pin.push_back(pin);
+        lua_pop(W, 1);
+    }
+}
+
+/**
+ * \brief Run the call and signal its end; runs on the background thread.
+ * \param f pointer to the ll_future_t
+ */
+static void
+future_run(ll_future_t *f)
+{
+    ll_worker_job_t job = {future_push, future_take, f, nullptr};
+    char msg[LL_STRBUFF];
+    int rc = ll_run_workers(&f->chunk, 1, 1, &job, msg, sizeof(msg));
+    std::lock_guard<std::mutex> lock(f->lock);
+    if (rc)
+        f->error = msg;
+    f->done = true;
+    f->finished.notify_all();
+}
+
+/**
+ * \brief Wait for the thread of the Future* at %arg and unpin its arguments.
+ * \param L Lua state.
+ * \param arg index of the Future*
+ * \param f pointer to the ll_future_t
+ */
+static void
+future_join(lua_State *L, int arg, ll_future_t *f)
+{
+    size_t j;
+    if (f->joined)
+        return;
+    if (f->thread.joinable())
+        f->thread.join();
+    f->joined = true;
+    lua_getuservalue(L, arg);
+    if (lua_istable(L, -1)) {
+        for (j = 1; j <= f->pins.size(); j++) {
+            lua_rawgeti(L, -1, static_cast<lua_Integer>(j));
+            ll_udata_pin(L, -1, false);
+            lua_pop(L, 1);
+        }
+    }
+    lua_pop(L, 1);
+}
+
+/**
+ * \brief Check if the call of the Future* has finished.
+ * \param f pointer to the ll_future_t
+ * \return true if it has finished.
+ */
+static bool
+future_done(ll_future_t *f)
+{
+    std::lock_guard<std::mutex> lock(f->lock);
+    return f->done;
+}
+
+/**
+ * \brief Destroy a Future*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Future* (f).
+ *
+ * A running call is waited for; its results are destroyed.
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+Destroy(lua_State *L)
+{
+    LL_FUNC("Destroy");
+    ll_future_t *f = ll_take_udata<ll_future_t>(_fun, L, 1, TNAME);
+    DBG(LOG_DESTROY, "%s: '%s' %s = %p\n", _fun,
+        TNAME,
+        "f", reinterpret_cast<void *>(f));
+    if (!f)
+        return 0;
+    future_join(L, 1, f);
+    for (ll_item_t &item : f->args)
+        ll_free_item(&item);
+    for (ll_item_t &item : f->results)
+        ll_free_item(&item);
+    ll_free(f->chunk.data);
+    delete f;
+    return 0;
+}
+
+/**
+ * \brief Printable string for a Future*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Future* (f).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 string on the Lua stack.
+ */
+static int
+toString(lua_State *L)
+{
+    LL_FUNC("toString");
+    char *str = ll_calloc<char>(_fun, L, LL_STRBUFF);
+    ll_future_t *f = *ll_check_udata<ll_future_t>(_fun, L, 1, TNAME);
+    luaL_Buffer B;
+
+    luaL_buffinit(L, &B);
+    if (!f) {
+        luaL_addstring(&B, "nil");
+    } else {
+        snprintf(str, LL_STRBUFF,
+                 TNAME "*: %p",
+                 reinterpret_cast<void *>(f));
+        luaL_addstring(&B, str);
+        snprintf(str, LL_STRBUFF,
+                 "\n    %s, pinned = %d",
+                 f->taken ? "awaited" : future_done(f) ? "ready" : "running",
+                 static_cast<int>(f->joined ? 0 : f->pins.size()));
+        luaL_addstring(&B, str);
+    }
+    luaL_pushresult(&B);
+    ll_free(str);
+    return 1;
+}
+
+static int Await(lua_State *L);
+
+/**
+ * \brief Continue Await() after a yield.
+ * \param L Lua state.
+ * \param status status of the coroutine (LUA_YIELD)
+ * \param ctx context (unused)
+ * \return the results of Await() on the Lua stack.
+ */
+static int
+AwaitK(lua_State *L, int status, lua_KContext ctx)
+{
+    UNUSED(status);
+    UNUSED(ctx);
+    return Await(L);
+}
+
+/**
+ * \brief Wait for the call of the Future* and return its results.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Future* (f).
+ *
+ * Inside a coroutine, Await() yields (without values) while the call is
+ * running and checks again when it is resumed. Outside of a coroutine it
+ * blocks. An error of the call is raised here. Afterwards the arguments
+ * are unpinned. The results can be taken only once.
+ * </pre>
+ * \param L Lua state.
+ * \return the results of the method on the Lua stack.
+ */
+static int
+Await(lua_State *L)
+{
+    LL_FUNC("Await");
+    ll_future_t *f = ll_check_Future(_fun, L, 1);
+    char msg[LL_STRBUFF];
+    size_t i;
+
+    lua_settop(L, 1);
+    if (!future_done(f)) {
+        if (lua_isyieldable(L))
+            return lua_yieldk(L, 0, 0, AwaitK);
+        std::unique_lock<std::mutex> lock(f->lock);
+        f->finished.wait(lock, [f]() { return f->done; });
+    }
+    future_join(L, 1, f);
+    if (f->taken) {
+        die(_fun, L, "the results were already taken");
+        return 0;
+    }
+    f->taken = true;
+    if (!f->error.empty()) {
+        snprintf(msg, sizeof(msg), "%s", f->error.c_str());
+        die(_fun, L, "%s", msg);
+        return 0;
+    }
+    luaL_checkstack(L, static_cast<int>(f->results.size()), _fun);
+    lua_getuservalue(L, 1);
+    for (i = 0; i < f->results.size(); i++) {
+        if (f->from_pin[i]) {
+            lua_rawgeti(L, 2, static_cast<lua_Integer>(f->from_pin[i]));
+        } else {
+            ll_push_item(_fun, L, &f->results[i]);
+        }
+    }
+    return static_cast<int>(f->results.size());
+}
+
+/**
+ * \brief Check if the call of the Future* has finished, without waiting.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Future* (f).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 boolean on the Lua stack.
+ */
+static int
+Poll(lua_State *L)
+{
+    LL_FUNC("Poll");
+    ll_future_t *f = ll_check_Future(_fun, L, 1);
+    return ll_push_boolean(_fun, L, future_done(f));
+}
+
+/**
+ * \brief Start the call of a method of the object at #1 on a background thread.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be an object of class %tname.
+ * Arg #2 is expected to be a string (method).
+ * Arg #3 and following are optional arguments of the method.
+ *
+ * Objects in the arguments are checked before any of them is pinned.
+ * An object which is also referenced elsewhere, e.g. by a clone, is
+ * refused (see ll_check_item()), because Leptonica's reference counts
+ * are not thread safe.
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param tname class name of the object
+ * \return 1 Future* on the Lua stack.
+ */
+int
+ll_async(const char *_fun, lua_State *L, const char *tname)
+{
+    const char *name = ll_check_string(_fun, L, 2);
+    std::vector<const ll_item_type_t *> types;
+    std::vector<int> idxs;
+    ll_future_t *f = nullptr;
+    ll_bytes_t chunk;
+    int top = lua_gettop(L);
+    int ft, pt, i;
+    size_t j, k;
+
+    /* the method must be a function of the class */
+    if (!strncmp(name, "__", 2) || !ll_open_class(L, tname)) {
+        die(_fun, L, "'%s' is not a method of %s", name, tname);
+        return 0;
+    }
+    luaL_getmetatable(L, tname);
+    if (LUA_TFUNCTION != lua_getfield(L, -1, name)) {
+        die(_fun, L, "'%s' is not a method of %s", name, tname);
+        return 0;
+    }
+    lua_pop(L, 2);
+
+    idxs.push_back(1);
+    for (i = 3; i <= top; i++)
+        idxs.push_back(i);
+    for (int arg : idxs)
+        types.push_back(lua_isnil(L, arg) ? nullptr : ll_check_item(_fun, L, arg, LL_ITEM_HOST_OK));
+
+    lua_pushfstring(L, "return table.pack((...).%s(...))", name);
+    ll_dump_chunk(_fun, L, -1, nullptr, &chunk);
+    lua_pop(L, 1);
+
+    f = new ll_future_t();
+    f->done = false;
+    f->joined = false;
+    f->taken = false;
+    f->chunk = chunk;
+    ll_push_Future(_fun, L, f);
+    ft = lua_gettop(L);
+    lua_newtable(L);
+    pt = lua_gettop(L);
+
+    /* pin objects (once each) and capture the other values */
+    for (j = 0; j < idxs.size(); j++) {
+        ll_item_t item = ll_item_t();
+        if (types[j]) {
+            for (k = 0; k < j; k++)
+                if (types[k] && lua_rawequal(L, idxs[k], idxs[j]))
+                    break;
+            if (k < j) {
+                item = f->args[k];
+            } else {
+                ll_pin_item(_fun, L, idxs[j], types[j], &item);
+                f->pins.push_back(item.ptr);
+                lua_pushvalue(L, idxs[j]);
+                lua_rawseti(L, pt, static_cast<lua_Integer>(f->pins.size()));
+            }
+        } else {
+            ll_take_item(_fun, L, idxs[j], nullptr, &item);
+        }
+        f->args.push_back(item);
+    }
+    lua_setuservalue(L, ft);
+
+    f->thread = std::thread(future_run, f);
+    DBG(LOG_NEW_CLASS, "%s: started %s* %p for %s.%s\n", _fun,
+        TNAME, reinterpret_cast<void *>(f), tname, name);
+    return 1;
+}
+
+/**
+ * \brief Check Lua stack at index (%arg) for user data of class Future*.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the ll_future_t contained in the user data.
+ */
+ll_future_t *
+ll_check_Future(const char *_fun, lua_State *L, int arg)
+{
+    ll_future_t *f = *ll_check_udata<ll_future_t>(_fun, L, arg, TNAME);
+    if (!f) {
+        die(_fun, L, "%s* at #%d was destroyed", TNAME, arg);
+        return nullptr;
+    }
+    return f;
+}
+
+/**
+ * \brief Optionally expect a Future* at index (%arg) on the Lua stack.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the ll_future_t contained in the user data.
+ */
+ll_future_t *
+ll_opt_Future(const char *_fun, lua_State *L, int arg)
+{
+    if (!ll_isudata(_fun, L, arg, TNAME))
+        return nullptr;
+    return ll_check_Future(_fun, L, arg);
+}
+
+/**
+ * \brief Push Future* user data to the Lua stack and set its meta table.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param f pointer to the ll_future_t
+ * \return 1 Future* on the Lua stack.
+ */
+int
+ll_push_Future(const char *_fun, lua_State *L, ll_future_t *f)
+{
+    if (!f)
+        return ll_push_nil(_fun, L);
+    return ll_push_udata(_fun, L, TNAME, f);
+}
+
+/**
+ * \brief Start the call of a method on a background thread.
+ * <pre>
+ * Arg #1 is expected to be an object, e.g. a Pix* (obj).
+ * Arg #2 is expected to be a string (method).
+ * Arg #3 and following are optional arguments of the method.
+ *
+ * Future(obj, "Method", ...) is the same as obj:Async("Method", ...).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 Future* on the Lua stack.
+ */
+int
+ll_new_Future(lua_State *L)
+{
+    FUNC("ll_new_Future");
+    char tname[64];
+    if (LUA_TSTRING != luaL_getmetafield(L, 1, "__name")) {
+        die(_fun, L, "expected an object at #%d", 1);
+        return 0;
+    }
+    snprintf(tname, sizeof(tname), "%s", lua_tostring(L, -1));
+    lua_pop(L, 1);
+    return ll_async(_fun, L, tname);
+}
+
+/**
+ * \brief Register the Future methods and functions in the Future meta table.
+ * \param L Lua state.
+ * \return 1 table on the Lua stack.
+ */
+int
+ll_open_Future(lua_State *L)
+{
+    static const luaL_Reg methods[] = {
+        {"__gc",                Destroy},
+        {"__new",               ll_new_Future},
+        {"__tostring",          toString},
+        {"Await",               Await},
+        {"Destroy",             Destroy},
+        {"IsReady",             Poll},      /* alias for Poll */
+        {"Poll",                Poll},
+        LUA_SENTINEL
+    };
+    LO_FUNC(TNAME);
+    ll_set_global_cfunct(_fun, L, TNAME, ll_new_Future);
+    ll_register_class(_fun, L, TNAME, methods);
+    return 1;
+}
@@ -306,7 +306,7 @@ FromArray(lua_State *L)
 }
 
 /**
- * \brief Get the Numa* (%na) as a table of lua_Number.
+ * \brief Get the Numa* (%na) as a Float32Array*.
  * <pre>
  * Arg #1 (i.e. self) is expected to be a Numa*.
  *
@@ -323,18 +323,17 @@ FromArray(lua_State *L)
  *          is another way to insure full initialization.
  * </pre>
  * \param L Lua state.
- * \return 1 Numa* on the Lua stack.
+ * \return 1 Float32Array* on the Lua stack.
  */
 static int
 GetFArray(lua_State *L)
 {
     LL_FUNC("GetFArray");
     Numa *na = ll_check_Numa(_fun, L, 1);
-    l_float32 *farray = numaGetFArray(na, L_COPY);
+    l_float32 *farray = numaGetFArray(na, L_NOCOPY);
     l_int32 n = numaGetCount(na);
-    int res = ll_pack_Farray(_fun, L, farray, n);
-    ll_free(farray);
-    return res;
+    TypedArray *ta = ll_create_TypedArray(_fun, L, LL_ARRAY_FLOAT32, n, farray);
+    return ll_push_TypedArray(_fun, L, ta);
 }
 
 /**
@@ -757,6 +756,20 @@ ll_new_Numa(lua_State *L)
         na = numaCopy(das);
     }
 
+    if (!na && ll_opt_TypedArray(_fun, L, 1, LL_ARRAY_FLOAT32)) {
+        TypedArray *ta = ll_check_TypedArray(_fun, L, 1, LL_ARRAY_FLOAT32);
+        DBG(LOG_NEW_PARAM, "%s: create for %s* = %p\n", _fun,
+            LL_FLOAT32ARRAY, reinterpret_cast<void *>(ta));
+        na = numaCreateFromFArray(reinterpret_cast<l_float32 *>(ta->data), ta->n, L_COPY);
+    }
+
+    if (!na && ll_opt_TypedArray(_fun, L, 1, LL_ARRAY_INT32)) {
+        TypedArray *ta = ll_check_TypedArray(_fun, L, 1, LL_ARRAY_INT32);
+        DBG(LOG_NEW_PARAM, "%s: create for %s* = %p\n", _fun,
+            LL_INT32ARRAY, reinterpret_cast<void *>(ta));
+        na = numaCreateFromIArray(reinterpret_cast<l_int32 *>(ta->data), ta->n);
+    }
+
     if (!na && ll_isudata(_fun, L, 1, LUA_FILEHANDLE)) {
         stream = ll_check_stream(_fun, L, 1);
         DBG(LOG_NEW_PARAM, "%s: create for %s* = %p\n", _fun,
@@ -146,6 +146,8 @@ AddNuma(lua_State *L)
     Numaa *naa = ll_check_Numaa(_fun, L, 1);
     Numa *na = ll_check_Numa(_fun, L, 2);
     l_int32 copyflag = ll_check_access_storage(_fun, L, 3, L_CLONE);
+    if (L_INSERT == copyflag)
+        na = ll_take_owned<Numa>(_fun, L, 2, LL_NUMA);    /* the container owns it now */
     return ll_push_boolean(_fun, L, 0 == numaaAddNuma(naa, na, copyflag));
 }
 
@@ -36,6 +36,16 @@
  * \class Pix
  *
  * A 2-D array of pixels and its meta data.
+ *
+ * Functions which Leptonica lets write to an existing Pix* take the
+ * destination (pixd) as an optional argument: as Arg #1 where Leptonica's
+ * own order is (pixd, pixs, ...), otherwise following the other arguments.
+ * With nil a new Pix* is returned, with pixd == pixs the operation works
+ * in-place, and the destination's own user data is returned, e.g.
+ *
+ *   pixd = pixd:OpenBrick(pixs, 3, 3)    -- reuse pixd for every page
+ *   pix:OpenBrick(pix, 3, 3)             -- in-place
+ *   pixd = Pix.OpenBrick(nil, pixs, 3, 3)
  */
 
 #if !defined(PATH_MAX)
@@ -114,18 +124,20 @@ static int
 Subtract(lua_State *L)
 {
     LL_FUNC("Subtract");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pix = pixSubtract(pixd, pixd, pixs);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Invert the Pix* (%pixs).
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is an optional Pix* (pixs).
  *
+ * Without Arg #2 the Pix* at Arg #1 is inverted to a new Pix*.
+ *
  * Leptonica's Notes:
  *      (1) This inverts pixs, for all pixel depths.
  *      (2) There are 3 cases:
@@ -144,10 +156,10 @@ static int
 Invert(lua_State *L)
 {
     LL_FUNC("Invert");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
     Pix *pixs = ll_opt_Pix(_fun, L, 2);
-    Pix *pix = pixInvert(pixs ? nullptr : pixd, pixs ? pixs : pixd);
-    return ll_push_Pix(_fun, L, pix);
+    Pix *pixd = pixs ? ll_opt_Pixd(_fun, L, 1) : nullptr;
+    Pix *pix = pixInvert(pixd, pixs ? pixs : ll_check_Pix(_fun, L, 1));
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -183,10 +195,10 @@ static int
 And(lua_State *L)
 {
     LL_FUNC("And");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pix = pixAnd(pixd, pixd, pixs);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -222,10 +234,10 @@ static int
 Or(lua_State *L)
 {
     LL_FUNC("Or");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pix = pixOr(pixd, pixd, pixs);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -261,10 +273,10 @@ static int
 Xor(lua_State *L)
 {
     LL_FUNC("Xor");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pix = pixXor(pixd, pixd, pixs);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -507,7 +519,7 @@ static int
 Accumulate(lua_State *L)
 {
     LL_FUNC("Accumulate");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 op = ll_check_arithop(_fun, L, 3);
     return ll_push_boolean(_fun, L, 0 == pixAccumulate(pixd, pixs, op));
@@ -627,7 +639,7 @@ AdaptThresholdToBinaryGen(lua_State *L)
 /**
  * \brief Generate a 1 bpp Pix* (%pixd) with alpha channel from Pix* (%pixs).
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  *
  * Leptonica's Notes:
@@ -646,10 +658,10 @@ static int
 AddAlphaTo1bpp(lua_State *L)
 {
     LL_FUNC("AddAlphaTo1bpp");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pix = pixAddAlphaTo1bpp(pixd, pixs);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -821,7 +833,7 @@ static int
 AddConstantGray(lua_State *L)
 {
     LL_FUNC("AddConstantGray");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     l_int32 val = ll_check_l_int32(_fun, L, 2);
     return ll_push_boolean(_fun, L, 0 == pixAddConstantGray(pixs, val));
 }
@@ -881,7 +893,7 @@ AddGaussianNoise(lua_State *L)
 /**
  * \brief Add two gray Pix* (%pixs1, %pixs2).
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs1).
  * Arg #3 is expected to be a Pix* (pixs2).
  *
@@ -904,11 +916,11 @@ static int
 AddGray(lua_State *L)
 {
     LL_FUNC("AddGray");
-    Pix *pixd = ll_opt_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs1 = ll_check_Pix(_fun, L, 2);
     Pix *pixs2 = ll_check_Pix(_fun, L, 3);
     Pix *pix = pixAddGray(pixd, pixs1, pixs2);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -926,7 +938,7 @@ static int
 AddGrayColormap8(lua_State *L)
 {
     LL_FUNC("AddGrayColormap8");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     return ll_push_boolean(_fun, L, 0 == pixAddGrayColormap8(pixs));
 }
 
@@ -1153,7 +1165,7 @@ static int
 AddText(lua_State *L)
 {
     LL_FUNC("AddText");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     const char* text = ll_check_string(_fun, L, 2);
     return ll_push_boolean(_fun, L, 0 == pixAddText(pix, text));
 }
@@ -1248,7 +1260,7 @@ static int
 AddWithIndicator(lua_State *L)
 {
     LL_FUNC("AddWithIndicator");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Pixa *pixa = ll_check_Pixa(_fun, L, 2);
     Numa *na = ll_check_Numa(_fun, L, 3);
     return ll_push_boolean(_fun, L, 0 == pixAddWithIndicator(pixs, pixa, na));
@@ -1741,7 +1753,7 @@ static int
 AssignToNearestColor(lua_State *L)
 {
     LL_FUNC("AssignToNearestColor");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pixm = ll_check_Pix(_fun, L, 3);
     l_int32 level = ll_check_l_int32(_fun, L, 4);
@@ -1751,6 +1763,29 @@ AssignToNearestColor(lua_State *L)
     return ll_push_l_int32(_fun, L, countarray);
 }
 
+/**
+ * \brief Run a method of the Pix* (%pixs) on a background thread.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixs).
+ * Arg #2 is expected to be a string (method).
+ * Arg #3 and following are optional arguments of the method.
+ *
+ * The method runs in a worker state of its own, e.g. for a long Deskew()
+ * or WriteMemJpeg() while the script decodes the next page. %pixs and
+ * the other objects in the arguments are pinned until the call is awaited
+ * (see Future); a Pix* with clones must be copied or shared first.
+ * Returns a Future*; Future:Await() returns the results of the method.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 Future* on the Lua stack.
+ */
+static int
+Async(lua_State *L)
+{
+    LL_FUNC("Async");
+    return ll_async(_fun, L, TNAME);
+}
+
 /**
  * \brief Build the average by column of Pix* (%pixs).
  * <pre>
@@ -2768,7 +2803,7 @@ Blend(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Box* (box).
  * Arg #4 is expected to be a l_uint32 (color).
@@ -2796,7 +2831,7 @@ static int
 BlendBackgroundToColor(lua_State *L)
 {
     LL_FUNC("BlendBackgroundToColor");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Box *box = ll_check_Box(_fun, L, 3);
     l_uint32 color = ll_check_l_uint32(_fun, L, 4);
@@ -2804,7 +2839,7 @@ BlendBackgroundToColor(lua_State *L)
     l_int32 minval = ll_check_l_int32(_fun, L, 6);
     l_int32 maxval = ll_check_l_int32(_fun, L, 7);
     Pix *pix = pixBlendBackgroundToColor(pixd, pixs, box, color, gamma, minval, maxval);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -2868,7 +2903,7 @@ static int
 BlendCmap(lua_State *L)
 {
     LL_FUNC("BlendCmap");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Pix *pixb = ll_check_Pix(_fun, L, 2);
     l_int32 x = ll_check_l_int32(_fun, L, 3);
     l_int32 y = ll_check_l_int32(_fun, L, 4);
@@ -2879,7 +2914,7 @@ BlendCmap(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs1).
  * Arg #3 is expected to be a Pix* (pixs2).
  * Arg #4 is expected to be a l_int32 (x).
@@ -2909,7 +2944,7 @@ static int
 BlendColor(lua_State *L)
 {
     LL_FUNC("BlendColor");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs1 = ll_check_Pix(_fun, L, 2);
     Pix *pixs2 = ll_check_Pix(_fun, L, 3);
     l_int32 x = ll_check_l_int32(_fun, L, 4);
@@ -2918,13 +2953,13 @@ BlendColor(lua_State *L)
     l_int32 transparent = ll_check_l_int32(_fun, L, 7);
     l_uint32 transpix = ll_check_l_uint32(_fun, L, 8);
     Pix *pix = pixBlendColor(pixd, pixs1, pixs2, x, y, fract, transparent, transpix);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs1).
  * Arg #3 is expected to be a Pix* (pixs2).
  * Arg #4 is expected to be a l_int32 (x).
@@ -2942,7 +2977,7 @@ static int
 BlendColorByChannel(lua_State *L)
 {
     LL_FUNC("BlendColorByChannel");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs1 = ll_check_Pix(_fun, L, 2);
     Pix *pixs2 = ll_check_Pix(_fun, L, 3);
     l_int32 x = ll_check_l_int32(_fun, L, 4);
@@ -2953,13 +2988,13 @@ BlendColorByChannel(lua_State *L)
     l_int32 transparent = ll_check_l_int32(_fun, L, 9);
     l_uint32 transpix = ll_check_l_uint32(_fun, L, 10);
     Pix *pix = pixBlendColorByChannel(pixd, pixs1, pixs2, x, y, rfract, gfract, bfract, transparent, transpix);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs1).
  * Arg #3 is expected to be a Pix* (pixs2).
  * Arg #4 is expected to be a l_int32 (x).
@@ -3000,7 +3035,7 @@ static int
 BlendGray(lua_State *L)
 {
     LL_FUNC("BlendGray");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs1 = ll_check_Pix(_fun, L, 2);
     Pix *pixs2 = ll_check_Pix(_fun, L, 3);
     l_int32 x = ll_check_l_int32(_fun, L, 4);
@@ -3010,13 +3045,13 @@ BlendGray(lua_State *L)
     l_int32 transparent = ll_check_l_int32(_fun, L, 8);
     l_uint32 transpix = ll_check_l_uint32(_fun, L, 9);
     Pix *pix = pixBlendGray(pixd, pixs1, pixs2, x, y, fract, type, transparent, transpix);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs1).
  * Arg #3 is expected to be a Pix* (pixs2).
  * Arg #4 is expected to be a l_int32 (x).
@@ -3059,7 +3094,7 @@ static int
 BlendGrayAdapt(lua_State *L)
 {
     LL_FUNC("BlendGrayAdapt");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs1 = ll_check_Pix(_fun, L, 2);
     Pix *pixs2 = ll_check_Pix(_fun, L, 3);
     l_int32 x = ll_check_l_int32(_fun, L, 4);
@@ -3067,13 +3102,13 @@ BlendGrayAdapt(lua_State *L)
     l_float32 fract = ll_check_l_float32(_fun, L, 6);
     l_int32 shift = ll_check_l_int32(_fun, L, 7);
     Pix *pix = pixBlendGrayAdapt(pixd, pixs1, pixs2, x, y, fract, shift);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs1).
  * Arg #3 is expected to be a Pix* (pixs2).
  * Arg #4 is expected to be a l_int32 (x).
@@ -3109,20 +3144,20 @@ static int
 BlendGrayInverse(lua_State *L)
 {
     LL_FUNC("BlendGrayInverse");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs1 = ll_check_Pix(_fun, L, 2);
     Pix *pixs2 = ll_check_Pix(_fun, L, 3);
     l_int32 x = ll_check_l_int32(_fun, L, 4);
     l_int32 y = ll_check_l_int32(_fun, L, 5);
     l_float32 fract = ll_check_l_float32(_fun, L, 6);
     Pix *pix = pixBlendGrayInverse(pixd, pixs1, pixs2, x, y, fract);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs1).
  * Arg #3 is expected to be a Pix* (pixs2).
  * Arg #4 is expected to be a l_int32 (x).
@@ -3136,14 +3171,14 @@ static int
 BlendHardLight(lua_State *L)
 {
     LL_FUNC("BlendHardLight");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs1 = ll_check_Pix(_fun, L, 2);
     Pix *pixs2 = ll_check_Pix(_fun, L, 3);
     l_int32 x = ll_check_l_int32(_fun, L, 4);
     l_int32 y = ll_check_l_int32(_fun, L, 5);
     l_float32 fract = ll_check_l_float32(_fun, L, 6);
     Pix *pix = pixBlendHardLight(pixd, pixs1, pixs2, x, y, fract);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -3166,7 +3201,7 @@ static int
 BlendInRect(lua_State *L)
 {
     LL_FUNC("BlendInRect");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Box *box = ll_check_Box(_fun, L, 2);
     l_uint32 val = ll_check_color_index(_fun, L, 3, pix);
     l_float32 fract = ll_check_l_float32(_fun, L, 4);
@@ -3176,7 +3211,7 @@ BlendInRect(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs1).
  * Arg #3 is expected to be a Pix* (pixs2).
  * Arg #4 is expected to be a l_int32 (x).
@@ -3202,7 +3237,7 @@ static int
 BlendMask(lua_State *L)
 {
     LL_FUNC("BlendMask");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs1 = ll_check_Pix(_fun, L, 2);
     Pix *pixs2 = ll_check_Pix(_fun, L, 3);
     l_int32 x = ll_check_l_int32(_fun, L, 4);
@@ -3210,7 +3245,7 @@ BlendMask(lua_State *L)
     l_float32 fract = ll_check_l_float32(_fun, L, 6);
     l_int32 type = ll_check_l_int32(_fun, L, 7);
     Pix *pix = pixBlendMask(pixd, pixs1, pixs2, x, y, fract, type);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -3313,6 +3348,7 @@ BlockBilateralExact(lua_State *L)
  * Arg #1 (i.e. self) is expected to be a Pix* (pixs).
  * Arg #2 is expected to be a l_int32 (wc).
  * Arg #3 is expected to be a l_int32 (hc).
+ * Arg #4 is an optional table with options ({threads=n}).
  *
  * Leptonica's Notes:
  *      (1) The full width and height of the convolution kernel
@@ -3331,7 +3367,13 @@ Blockconv(lua_State *L)
     Pix *pixs = ll_check_Pix(_fun, L, 1);
     l_int32 wc = ll_check_l_int32(_fun, L, 2);
     l_int32 hc = ll_check_l_int32(_fun, L, 3);
-    Pix *pix = pixBlockconv(pixs, wc, hc);
+    l_int32 nthreads = ll_opt_threads(_fun, L, 4);
+    Pix *pix = nullptr;
+    if (ll_run_bands(pixs, hc + 1, nthreads, 1, &pix, [=](Pix *band, Pix **out) {
+            out[0] = pixBlockconv(band, wc, hc);
+            return out[0] ? 0 : 1;
+        }))
+        pix = pixBlockconv(pixs, wc, hc);
     return ll_push_Pix(_fun, L, pix);
 }
 
@@ -3716,7 +3758,7 @@ static int
 ChangeRefcount(lua_State *L)
 {
     LL_FUNC("ChangeRefcount");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 delta = ll_check_l_int32(_fun, L, 2);
     return ll_push_boolean(_fun, L, 0 == pixChangeRefcount(pix, delta));
 }
@@ -3796,7 +3838,7 @@ static int
 CleanupByteProcessing(lua_State *L)
 {
     LL_FUNC("CleanupByteProcessing");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_uint8 *lineptrs = nullptr;
     size_t size = static_cast<size_t>(pixGetHeight(pix));
     if (pixCleanupByteProcessing(pix, &lineptrs))
@@ -3824,7 +3866,7 @@ static int
 ClearAll(lua_State *L)
 {
     LL_FUNC("ClearAll");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     return ll_push_boolean(_fun, L, 0 == pixClearAll(pix));
 }
 
@@ -3847,7 +3889,7 @@ static int
 ClearInRect(lua_State *L)
 {
     LL_FUNC("ClearInRect");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Box *box = ll_check_Box(_fun, L, 2);
     return ll_push_boolean(_fun, L, 0 == pixClearInRect(pix, box));
 }
@@ -3866,7 +3908,7 @@ static int
 ClearPixel(lua_State *L)
 {
     LL_FUNC("ClearPixel");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 x = ll_check_l_int32(_fun, L, 2);
     l_int32 y = ll_check_l_int32(_fun, L, 3);
     return ll_push_boolean(_fun, L, 0 == pixClearPixel(pix, x, y));
@@ -4124,7 +4166,7 @@ Clone(lua_State *L)
 /**
  * \brief Generic morphological closing for Pix* (%pixs) using hits in Sel* (%sel).
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Sel* (sel).
  *
@@ -4150,17 +4192,17 @@ static int
 Close(lua_State *L)
 {
     LL_FUNC("Close");
-    Pix *pixd = ll_opt_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Sel *sel = ll_check_Sel(_fun, L, 3);
     Pix *pix = pixClose(pixd, pixs, sel);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Morphological closing for Pix* (%pixs) using a brick sel (%hsize, %vsize).
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -4186,18 +4228,18 @@ static int
 CloseBrick(lua_State *L)
 {
     LL_FUNC("CloseBrick");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixCloseBrick(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -4234,18 +4276,18 @@ static int
 CloseBrickDwa(lua_State *L)
 {
     LL_FUNC("CloseBrickDwa");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixCloseBrickDwa(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -4285,18 +4327,18 @@ static int
 CloseCompBrick(lua_State *L)
 {
     LL_FUNC("CloseCompBrick");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixCloseCompBrick(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -4341,18 +4383,18 @@ static int
 CloseCompBrickDwa(lua_State *L)
 {
     LL_FUNC("CloseCompBrickDwa");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixCloseCompBrickDwa(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -4364,18 +4406,18 @@ static int
 CloseCompBrickExtendDwa(lua_State *L)
 {
     LL_FUNC("CloseCompBrickExtendDwa");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixCloseCompBrickExtendDwa(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Sel* (sel).
  *
@@ -4402,11 +4444,11 @@ static int
 CloseGeneralized(lua_State *L)
 {
     LL_FUNC("CloseGeneralized");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Sel *sel = ll_check_Sel(_fun, L, 3);
     Pix *pix = pixCloseGeneralized(pixd, pixs, sel);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -4462,7 +4504,7 @@ CloseGray3(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Sel* (sel).
  *
@@ -4492,17 +4534,17 @@ static int
 CloseSafe(lua_State *L)
 {
     LL_FUNC("CloseSafe");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Sel *sel = ll_check_Sel(_fun, L, 3);
     Pix *pix = pixCloseSafe(pixd, pixs, sel);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -4533,18 +4575,18 @@ static int
 CloseSafeBrick(lua_State *L)
 {
     LL_FUNC("CloseSafeBrick");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixCloseSafeBrick(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -4589,12 +4631,12 @@ static int
 CloseSafeCompBrick(lua_State *L)
 {
     LL_FUNC("CloseSafeCompBrick");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixCloseSafeCompBrick(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -4756,7 +4798,7 @@ static int
 ColorGray(lua_State *L)
 {
     LL_FUNC("ColorGray");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Box *box = ll_check_Box(_fun, L, 2);
     l_int32 type = ll_check_l_int32(_fun, L, 3);
     l_int32 thresh = ll_check_l_int32(_fun, L, 4);
@@ -4811,7 +4853,7 @@ static int
 ColorGrayCmap(lua_State *L)
 {
     LL_FUNC("ColorGrayCmap");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Box *box = ll_check_Box(_fun, L, 2);
     l_int32 type = ll_check_l_int32(_fun, L, 3);
     l_int32 rval = 0;
@@ -4896,7 +4938,7 @@ static int
 ColorGrayMaskedCmap(lua_State *L)
 {
     LL_FUNC("ColorGrayMaskedCmap");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Pix *pixm = ll_check_Pix(_fun, L, 2);
     l_int32 type = ll_check_l_int32(_fun, L, 3);
     l_int32 rval = 0;
@@ -4984,7 +5026,7 @@ static int
 ColorGrayRegionsCmap(lua_State *L)
 {
     LL_FUNC("ColorGrayRegionsCmap");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Boxa *boxa = ll_check_Boxa(_fun, L, 2);
     l_int32 type = ll_check_l_int32(_fun, L, 3);
     l_int32 rval = 0;
@@ -5209,7 +5251,7 @@ static int
 ColorSegmentClean(lua_State *L)
 {
     LL_FUNC("ColorSegmentClean");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     l_int32 selsize = ll_check_l_int32(_fun, L, 2);
     l_int32 countarray = 0;
     if (pixColorSegmentClean(pixs, selsize, &countarray))
@@ -5275,7 +5317,7 @@ static int
 ColorSegmentRemoveColors(lua_State *L)
 {
     LL_FUNC("ColorSegmentRemoveColors");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 finalcolors = ll_check_l_int32(_fun, L, 3);
     return ll_push_boolean(_fun, L, 0 == pixColorSegmentRemoveColors(pixd, pixs, finalcolors));
@@ -5502,7 +5544,7 @@ static int
 CombineMasked(lua_State *L)
 {
     LL_FUNC("CombineMasked");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pixm = ll_check_Pix(_fun, L, 3);
     return ll_push_boolean(_fun, L, 0 == pixCombineMasked(pixd, pixs, pixm));
@@ -5553,7 +5595,7 @@ static int
 CombineMaskedGeneral(lua_State *L)
 {
     LL_FUNC("CombineMaskedGeneral");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pixm = ll_check_Pix(_fun, L, 3);
     l_int32 x = ll_check_l_int32(_fun, L, 4);
@@ -6205,7 +6247,7 @@ static int
 ConnCompIncrAdd(lua_State *L)
 {
     LL_FUNC("ConnCompIncrAdd");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Ptaa *ptaa = ll_check_Ptaa(_fun, L, 2);
     l_float32 x = ll_check_l_float32(_fun, L, 3);
     l_float32 y = ll_check_l_float32(_fun, L, 4);
@@ -6326,7 +6368,7 @@ ConnCompTransform(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (sx).
  * Arg #4 is expected to be a l_int32 (sy).
@@ -6367,7 +6409,7 @@ static int
 ContrastNorm(lua_State *L)
 {
     LL_FUNC("ContrastNorm");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 sx = ll_check_l_int32(_fun, L, 3);
     l_int32 sy = ll_check_l_int32(_fun, L, 4);
@@ -6375,13 +6417,13 @@ ContrastNorm(lua_State *L)
     l_int32 smoothx = ll_check_l_int32(_fun, L, 6);
     l_int32 smoothy = ll_check_l_int32(_fun, L, 7);
     Pix *pix = pixContrastNorm(pixd, pixs, sx, sy, mindiff, smoothx, smoothy);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_float32 (factor).
  *
@@ -6411,17 +6453,17 @@ static int
 ContrastTRC(lua_State *L)
 {
     LL_FUNC("ContrastTRC");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_float32 factor = ll_check_l_float32(_fun, L, 3);
     Pix *pix = pixContrastTRC(pixd, pixs, factor);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Pix* (pixm).
  * Arg #4 is expected to be a l_float32 (factor).
@@ -6439,12 +6481,12 @@ static int
 ContrastTRCMasked(lua_State *L)
 {
     LL_FUNC("ContrastTRCMasked");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pixm = ll_check_Pix(_fun, L, 3);
     l_float32 factor = ll_check_l_float32(_fun, L, 4);
     Pix *pix = pixContrastTRCMasked(pixd, pixs, pixm, factor);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -6477,6 +6519,7 @@ Convert16To8(lua_State *L)
  * Arg #1 (i.e. self) is expected to be a Pix* (pixs).
  * Arg #2 is expected to be a l_uint16 (val0).
  * Arg #3 is expected to be a l_uint16 (val1).
+ * Arg #4 is an optional Pix* (pixd).
  *
  * Leptonica's Notes:
  *      (1) If pixd is null, a new pix is made.
@@ -6493,7 +6536,9 @@ Convert1To16(lua_State *L)
     Pix *pixs = ll_check_Pix(_fun, L, 1);
     l_uint16 val0 = ll_check_l_uint16(_fun, L, 2);
     l_uint16 val1 = ll_check_l_uint16(_fun, L, 3);
-    return ll_push_Pix(_fun, L, pixConvert1To16(nullptr, pixs, val0, val1));
+    Pix *pixd = ll_opt_Pixd(_fun, L, 4);
+    Pix *pix = pixConvert1To16(pixd, pixs, val0, val1);
+    return ll_push_Pixd(_fun, L, 4, pix);
 }
 
 /**
@@ -6502,6 +6547,7 @@ Convert1To16(lua_State *L)
  * Arg #1 (i.e. self) is expected to be a Pix* (pixs).
  * Arg #2 is expected to be a l_int32 (val0).
  * Arg #3 is expected to be a l_int32 (val1).
+ * Arg #4 is an optional Pix* (pixd).
  *
  * Leptonica's Notes:
  *      (1) If pixd is null, a new pix is made.
@@ -6520,7 +6566,9 @@ Convert1To2(lua_State *L)
     Pix *pixs = ll_check_Pix(_fun, L, 1);
     l_int32 val0 = ll_check_l_int32(_fun, L, 2);
     l_int32 val1 = ll_check_l_int32(_fun, L, 3);
-    return ll_push_Pix(_fun, L, pixConvert1To2(nullptr, pixs, val0, val1));
+    Pix *pixd = ll_opt_Pixd(_fun, L, 4);
+    Pix *pix = pixConvert1To2(pixd, pixs, val0, val1);
+    return ll_push_Pixd(_fun, L, 4, pix);
 }
 
 /**
@@ -6548,6 +6596,7 @@ Convert1To2Cmap(lua_State *L)
  * Arg #1 (i.e. self) is expected to be a Pix* (pixs).
  * Arg #2 is expected to be a l_uint32 (val0).
  * Arg #3 is expected to be a l_uint32 (val1).
+ * Arg #4 is an optional Pix* (pixd).
  *
  * Leptonica's Notes:
  *      (1) If pixd is null, a new pix is made.
@@ -6564,7 +6613,9 @@ Convert1To32(lua_State *L)
     Pix *pixs = ll_check_Pix(_fun, L, 1);
     l_uint32 val0 = ll_check_color_index(_fun, L, 2, nullptr);
     l_uint32 val1 = ll_check_color_index(_fun, L, 3, nullptr);
-    return ll_push_Pix(_fun, L, pixConvert1To32(nullptr, pixs, val0, val1));
+    Pix *pixd = ll_opt_Pixd(_fun, L, 4);
+    Pix *pix = pixConvert1To32(pixd, pixs, val0, val1);
+    return ll_push_Pixd(_fun, L, 4, pix);
 }
 
 /**
@@ -6573,6 +6624,7 @@ Convert1To32(lua_State *L)
  * Arg #1 (i.e. self) is expected to be a Pix* (pixs).
  * Arg #2 is expected to be a l_uint32 (val0).
  * Arg #3 is expected to be a l_uint32 (val1).
+ * Arg #4 is an optional Pix* (pixd).
  *
  * Leptonica's Notes:
  *      (1) If pixd is null, a new pix is made.
@@ -6591,7 +6643,9 @@ Convert1To4(lua_State *L)
     Pix *pixs = ll_check_Pix(_fun, L, 1);
     l_int32 val0 = ll_check_l_int32(_fun, L, 2);
     l_int32 val1 = ll_check_l_int32(_fun, L, 3);
-    return ll_push_Pix(_fun, L, pixConvert1To4(nullptr, pixs, val0, val1));
+    Pix *pixd = ll_opt_Pixd(_fun, L, 4);
+    Pix *pix = pixConvert1To4(pixd, pixs, val0, val1);
+    return ll_push_Pixd(_fun, L, 4, pix);
 }
 
 /**
@@ -6619,6 +6673,7 @@ Convert1To4Cmap(lua_State *L)
  * Arg #1 (i.e. self) is expected to be a Pix* (pixs).
  * Arg #2 is expected to be a l_uint8 (val0).
  * Arg #3 is expected to be a l_uint8 (val1).
+ * Arg #4 is an optional Pix* (pixd).
  *
  * Leptonica's Notes:
  *      (1) If pixd is null, a new pix is made.
@@ -6638,7 +6693,9 @@ Convert1To8(lua_State *L)
     Pix *pixs = ll_check_Pix(_fun, L, 1);
     l_uint8 val0 = ll_check_l_uint8(_fun, L, 2);
     l_uint8 val1 = ll_check_l_uint8(_fun, L, 3);
-    return ll_push_Pix(_fun, L, pixConvert1To8(nullptr, pixs, val0, val1));
+    Pix *pixd = ll_opt_Pixd(_fun, L, 4);
+    Pix *pix = pixConvert1To8(pixd, pixs, val0, val1);
+    return ll_push_Pixd(_fun, L, 4, pix);
 }
 
 /**
@@ -7125,7 +7182,7 @@ ConvertGrayToSubpixelRGB(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  *
  * Leptonica's Notes:
@@ -7144,10 +7201,10 @@ static int
 ConvertHSVToRGB(lua_State *L)
 {
     LL_FUNC("ConvertHSVToRGB");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pix = pixConvertHSVToRGB(pixd, pixs);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -7399,7 +7456,7 @@ ConvertRGBToGraySatBoost(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  *
  * Leptonica's Notes:
@@ -7434,10 +7491,10 @@ static int
 ConvertRGBToHSV(lua_State *L)
 {
     LL_FUNC("ConvertRGBToHSV");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pix = pixConvertRGBToHSV(pixd, pixs);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -7591,7 +7648,7 @@ ConvertRGBToXYZ(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  *
  * Leptonica's Notes:
@@ -7619,10 +7676,10 @@ static int
 ConvertRGBToYUV(lua_State *L)
 {
     LL_FUNC("ConvertRGBToYUV");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pix = pixConvertRGBToYUV(pixd, pixs);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -8145,7 +8202,7 @@ ConvertToSubpixelRGB(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  *
  * Leptonica's Notes:
@@ -8163,10 +8220,10 @@ static int
 ConvertYUVToRGB(lua_State *L)
 {
     LL_FUNC("ConvertYUVToRGB");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pix = pixConvertYUVToRGB(pixd, pixs);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -8176,6 +8233,7 @@ ConvertYUVToRGB(lua_State *L)
  * Arg #2 is expected to be a Kernel* (kel).
  * Arg #3 is expected to be a l_int32 (outdepth).
  * Arg #4 is expected to be a boolean (normflag).
+ * Arg #5 is an optional table with options ({threads=n}).
  *
  * Leptonica's Notes:
  *      (1) This gives a convolution with an arbitrary kernel.
@@ -8220,7 +8278,15 @@ Convolve(lua_State *L)
     Kernel *kel = ll_check_Kernel(_fun, L, 2);
     l_int32 outdepth = ll_check_l_int32(_fun, L, 3);
     l_int32 normflag = ll_opt_boolean(_fun, L, 4);
-    Pix *pix = pixConvolve(pixs, kel, outdepth, normflag);
+    l_int32 nthreads = ll_opt_threads(_fun, L, 5);
+    l_int32 sy = 0, sx = 0, cy = 0, cx = 0;
+    Pix *pix = nullptr;
+    kernelGetParameters(kel, &sy, &sx, &cy, &cx);
+    if (ll_run_bands(pixs, L_MAX(cy, sy - cy) + 1, nthreads, 1, &pix, [=](Pix *band, Pix **out) {
+            out[0] = pixConvolve(band, kel, outdepth, normflag);
+            return out[0] ? 0 : 1;
+        }))
+        pix = pixConvolve(pixs, kel, outdepth, normflag);
     return ll_push_Pix(_fun, L, pix);
 }
 
@@ -8398,7 +8464,8 @@ ConvolveWithBias(lua_State *L)
 /**
  * \brief Copy a Pix*.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix*.
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixs).
+ * Arg #2 is an optional Pix* (pixd).
  *
  * Leptonica's Notes:
  *      (1) There are three cases:
@@ -8428,8 +8495,9 @@ Copy(lua_State *L)
 {
     LL_FUNC("Copy");
     Pix *pixs = ll_check_Pix(_fun, L, 1);
-    Pix *pixd = pixCopy(nullptr, pixs);
-    return ll_push_Pix(_fun, L, pixd);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 2);
+    Pix *pix = pixCopy(pixd, pixs);
+    return ll_push_Pixd(_fun, L, 2, pix);
 }
 
 /**
@@ -8440,6 +8508,7 @@ Copy(lua_State *L)
  * Arg #3 is expected to be a l_int32 (right).
  * Arg #4 is expected to be a l_int32 (top).
  * Arg #5 is expected to be a l_int32 (bottom).
+ * Arg #6 is an optional Pix* (pixd).
  *
  * Leptonica's Notes:
  *      (1) pixd can be null, but otherwise it must be the same size
@@ -8462,9 +8531,9 @@ CopyBorder(lua_State *L)
     l_int32 right = ll_check_l_int32(_fun, L, 3);
     l_int32 top = ll_check_l_int32(_fun, L, 4);
     l_int32 bottom = ll_check_l_int32(_fun, L, 5);
-    Pix* pix = pixCopyBorder(nullptr, pixs, left, right, top, bottom);
-    ll_push_Pix(_fun, L, pix);
-    return 1;
+    Pix *pixd = ll_opt_Pixd(_fun, L, 6);
+    Pix* pix = pixCopyBorder(pixd, pixs, left, right, top, bottom);
+    return ll_push_Pixd(_fun, L, 6, pix);
 }
 
 /**
@@ -8484,7 +8553,7 @@ static int
 CopyColormap(lua_State *L)
 {
     LL_FUNC("CopyColormap");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     return ll_push_boolean(_fun, L, 0 == pixCopyColormap(pixd, pixs));
 }
@@ -8502,7 +8571,7 @@ static int
 CopyDimensions(lua_State *L)
 {
     LL_FUNC("CopyDimensions");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     return ll_push_boolean(_fun, L, 0 == pixCopyDimensions(pixd, pixs));
 }
@@ -8520,7 +8589,7 @@ static int
 CopyInputFormat(lua_State *L)
 {
     LL_FUNC("CopyInputFormat");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     return ll_push_boolean(_fun, L, 0 == pixCopyInputFormat(pixd, pixs));
 }
@@ -8543,7 +8612,7 @@ static int
 CopyRGBComponent(lua_State *L)
 {
     LL_FUNC("CopyRGBComponent");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 comp = ll_check_component(_fun, L, 3, L_ALPHA_CHANNEL);
     return ll_push_boolean(_fun, L, 0 == pixCopyRGBComponent(pixd, pixs, comp));
@@ -8562,7 +8631,7 @@ static int
 CopyResolution(lua_State *L)
 {
     LL_FUNC("CopyResolution");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     return ll_push_boolean(_fun, L, 0 == pixCopyResolution(pixd, pixs));
 }
@@ -8580,7 +8649,7 @@ static int
 CopySpp(lua_State *L)
 {
     LL_FUNC("CopySpp");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     return ll_push_boolean(_fun, L, 0 == pixCopySpp(pixd, pixs));
 }
@@ -8598,7 +8667,7 @@ static int
 CopyText(lua_State *L)
 {
     LL_FUNC("CopyText");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     return ll_push_boolean(_fun, L, 0 == pixCopyText(pixd, pixs));
 }
@@ -9434,7 +9503,7 @@ CropToSize(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (thresh).
  * Arg #4 is expected to be a l_int32 (satlimit).
@@ -9459,12 +9528,12 @@ static int
 DarkenGray(lua_State *L)
 {
     LL_FUNC("DarkenGray");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 thresh = ll_check_l_int32(_fun, L, 3);
     l_int32 satlimit = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixDarkenGray(pixd, pixs, thresh, satlimit);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -9808,14 +9877,14 @@ static int
 DestroyColormap(lua_State *L)
 {
     LL_FUNC("DestroyColormap");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     return ll_push_boolean(_fun, L, 0 == pixDestroyColormap(pix));
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Sel* (sel).
  *
@@ -9838,17 +9907,17 @@ static int
 Dilate(lua_State *L)
 {
     LL_FUNC("Dilate");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Sel *sel = ll_check_Sel(_fun, L, 3);
     Pix *pix = pixDilate(pixd, pixs, sel);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -9874,18 +9943,18 @@ static int
 DilateBrick(lua_State *L)
 {
     LL_FUNC("DilateBrick");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixDilateBrick(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -9917,18 +9986,18 @@ static int
 DilateBrickDwa(lua_State *L)
 {
     LL_FUNC("DilateBrickDwa");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixDilateBrickDwa(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -9968,18 +10037,18 @@ static int
 DilateCompBrick(lua_State *L)
 {
     LL_FUNC("DilateCompBrick");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixDilateCompBrick(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -10023,18 +10092,18 @@ static int
 DilateCompBrickDwa(lua_State *L)
 {
     LL_FUNC("DilateCompBrickDwa");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixDilateCompBrickDwa(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -10064,12 +10133,12 @@ static int
 DilateCompBrickExtendDwa(lua_State *L)
 {
     LL_FUNC("DilateCompBrickExtendDwa");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixDilateCompBrickExtendDwa(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -10078,6 +10147,7 @@ DilateCompBrickExtendDwa(lua_State *L)
  * Arg #1 (i.e. self) is expected to be a Pix* (pixs).
  * Arg #2 is expected to be a l_int32 (hsize).
  * Arg #3 is expected to be a l_int32 (vsize).
+ * Arg #4 is an optional table with options ({threads=n}).
  *
  * Leptonica's Notes:
  *      (1) Sel is a brick with all elements being hits
@@ -10093,7 +10163,13 @@ DilateGray(lua_State *L)
     Pix *pixs = ll_check_Pix(_fun, L, 1);
     l_int32 hsize = ll_check_l_int32(_fun, L, 2);
     l_int32 vsize = ll_check_l_int32(_fun, L, 3);
-    Pix *pix = pixDilateGray(pixs, hsize, vsize);
+    l_int32 nthreads = ll_opt_threads(_fun, L, 4);
+    Pix *pix = nullptr;
+    if (ll_run_bands(pixs, vsize / 2 + 1, nthreads, 1, &pix, [=](Pix *band, Pix **out) {
+            out[0] = pixDilateGray(band, hsize, vsize);
+            return out[0] ? 0 : 1;
+        }))
+        pix = pixDilateGray(pixs, hsize, vsize);
     return ll_push_Pix(_fun, L, pix);
 }
 
@@ -10332,7 +10408,7 @@ DisplayMatchedPattern(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Pta* (pta).
  *
@@ -10352,17 +10428,17 @@ static int
 DisplayPta(lua_State *L)
 {
     LL_FUNC("DisplayPta");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pta *pta = ll_check_Pta(_fun, L, 3);
     Pix *pix = pixDisplayPta(pixd, pixs, pta);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Pta* (pta).
  * Arg #4 is expected to be a Pix* (pixp).
@@ -10388,7 +10464,7 @@ static int
 DisplayPtaPattern(lua_State *L)
 {
     LL_FUNC("DisplayPtaPattern");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pta *pta = ll_check_Pta(_fun, L, 3);
     Pix *pixp = ll_check_Pix(_fun, L, 4);
@@ -10396,7 +10472,7 @@ DisplayPtaPattern(lua_State *L)
     l_int32 cy = ll_check_l_int32(_fun, L, 6);
     l_uint32 color = ll_check_l_uint32(_fun, L, 7);
     Pix *pix = pixDisplayPtaPattern(pixd, pixs, pta, pixp, cx, cy, color);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -10421,7 +10497,7 @@ DisplayPtaa(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Ptaa* (ptaa).
  * Arg #4 is expected to be a Pix* (pixp).
@@ -10447,14 +10523,14 @@ static int
 DisplayPtaaPattern(lua_State *L)
 {
     LL_FUNC("DisplayPtaaPattern");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Ptaa *ptaa = ll_check_Ptaa(_fun, L, 3);
     Pix *pixp = ll_check_Pix(_fun, L, 4);
     l_int32 cx = ll_check_l_int32(_fun, L, 5);
     l_int32 cy = ll_check_l_int32(_fun, L, 6);
     Pix *pix = pixDisplayPtaaPattern(pixd, pixs, ptaa, pixp, cx, cy);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -10806,7 +10882,7 @@ static int
 EndianByteSwap(lua_State *L)
 {
     LL_FUNC("EndianByteSwap");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     return ll_push_boolean(_fun, L, 0 == pixEndianByteSwap(pixs));
 }
 
@@ -10862,7 +10938,7 @@ static int
 EndianTwoByteSwap(lua_State *L)
 {
     LL_FUNC("EndianTwoByteSwap");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     return ll_push_boolean(_fun, L, 0 == pixEndianTwoByteSwap(pixs));
 }
 
@@ -11001,7 +11077,7 @@ EqualWithCmap(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_float32 (fract).
  * Arg #4 is expected to be a l_int32 (factor).
@@ -11035,18 +11111,18 @@ static int
 EqualizeTRC(lua_State *L)
 {
     LL_FUNC("EqualizeTRC");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_float32 fract = ll_check_l_float32(_fun, L, 3);
     l_int32 factor = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixEqualizeTRC(pixd, pixs, fract, factor);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Sel* (sel).
  *
@@ -11069,17 +11145,17 @@ static int
 Erode(lua_State *L)
 {
     LL_FUNC("Erode");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Sel *sel = ll_check_Sel(_fun, L, 3);
     Pix *pix = pixErode(pixd, pixs, sel);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -11105,18 +11181,18 @@ static int
 ErodeBrick(lua_State *L)
 {
     LL_FUNC("ErodeBrick");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixErodeBrick(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -11151,18 +11227,18 @@ static int
 ErodeBrickDwa(lua_State *L)
 {
     LL_FUNC("ErodeBrickDwa");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixErodeBrickDwa(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -11202,18 +11278,18 @@ static int
 ErodeCompBrick(lua_State *L)
 {
     LL_FUNC("ErodeCompBrick");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixErodeCompBrick(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -11257,18 +11333,18 @@ static int
 ErodeCompBrickDwa(lua_State *L)
 {
     LL_FUNC("ErodeCompBrickDwa");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixErodeCompBrickDwa(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -11285,12 +11361,12 @@ static int
 ErodeCompBrickExtendDwa(lua_State *L)
 {
     LL_FUNC("ErodeCompBrickExtendDwa");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixErodeCompBrickExtendDwa(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -11299,6 +11375,7 @@ ErodeCompBrickExtendDwa(lua_State *L)
  * Arg #1 (i.e. self) is expected to be a Pix* (pixs).
  * Arg #2 is expected to be a l_int32 (hsize).
  * Arg #3 is expected to be a l_int32 (vsize).
+ * Arg #4 is an optional table with options ({threads=n}).
  *
  * Leptonica's Notes:
  *      (1) Sel is a brick with all elements being hits
@@ -11314,7 +11391,13 @@ ErodeGray(lua_State *L)
     Pix *pixs = ll_check_Pix(_fun, L, 1);
     l_int32 hsize = ll_check_l_int32(_fun, L, 2);
     l_int32 vsize = ll_check_l_int32(_fun, L, 3);
-    Pix *pix = pixErodeGray(pixs, hsize, vsize);
+    l_int32 nthreads = ll_opt_threads(_fun, L, 4);
+    Pix *pix = nullptr;
+    if (ll_run_bands(pixs, vsize / 2 + 1, nthreads, 1, &pix, [=](Pix *band, Pix **out) {
+            out[0] = pixErodeGray(band, hsize, vsize);
+            return out[0] ? 0 : 1;
+        }))
+        pix = pixErodeGray(pixs, hsize, vsize);
     return ll_push_Pix(_fun, L, pix);
 }
 
@@ -11615,22 +11698,44 @@ ExtractBoundary(lua_State *L)
 }
 
 /**
- * \brief Brief comment goes here.
+ * \brief Extract the data of a Pix* (%pixs).
  * <pre>
  * Arg #1 (i.e. self) is expected to be a Pix* (pixs).
+ *
+ * The raster is copied into a new Pix* and a PixelBuffer* viewing the
+ * copy is returned. If %pixs holds the only reference, its raster is
+ * freed like pixExtractData() does; the raster never leaves a Pix*, so
+ * it is always released by the Pix memory manager (see lualept-pixpool.cpp).
+ * Use PixelBuffer:ToTable() to get a Lua table of rows of words.
+ *
+ * Compatibility: ExtractData() used to return that table itself. Scripts
+ * indexing the result as data[y][x] must call ToTable() on it now.
+ *
+ * Leptonica's Notes:
+ *      (1) This extracts the pix image data for use in another context.
+ *          The caller still needs to use pixDestroy() on the input pix.
+ *      (2) If refcount == 1, the data is extracted and the
+ *          pix->data ptr is set to NULL.
+ *      (3) If refcount > 1, this simply returns a copy of the data,
+ *          using the pix allocator, and leaving the input pix unchanged.
  * </pre>
  * \param L Lua state.
- * \return 1 l_uint32 * on the Lua stack.
+ * \return 1 PixelBuffer* on the Lua stack.
  */
 static int
 ExtractData(lua_State *L)
 {
     LL_FUNC("ExtractData");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
-    l_uint32 *data = pixExtractData(pixs);
-    l_int32 wpl = pixGetWpl(pixs);
-    l_int32 h = pixGetHeight(pixs);
-    return ll_pack_Uarray_2d(_fun, L, data, wpl, h);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
+    Pix *pixd = pixGetData(pixs) ? pixCopy(nullptr, pixs) : nullptr;
+    PixelBuffer *buf = nullptr;
+    if (!pixd)
+        return ll_push_nil(_fun, L);
+    if (1 == pixGetRefcount(pixs))
+        pixFreeData(pixs);
+    buf = ll_create_PixelBuffer(_fun, L, pixd);
+    pixDestroy(&pixd);
+    return ll_push_PixelBuffer(_fun, L, buf);
 }
 
 /**
@@ -11781,7 +11886,7 @@ ExtractTextlines(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a string (selname).
  *
@@ -11801,17 +11906,17 @@ static int
 FHMTGen_1(lua_State *L)
 {
     LL_FUNC("FHMTGen_1");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     const char *selname = ll_check_string(_fun, L, 3);
     Pix *pix = pixFHMTGen_1(pixd, pixs, selname);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (operation).
  * Arg #4 is expected to be a char* (selname).
@@ -11834,20 +11939,20 @@ static int
 FMorphopGen_1(lua_State *L)
 {
     LL_FUNC("FMorphopGen_1");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 operation = ll_check_l_int32(_fun, L, 3);
     const char *name = ll_check_string(_fun, L, 4);
     /* XXX: deconstify */
     char *selname = reinterpret_cast<char *>(reinterpret_cast<l_intptr_t>(name));
     Pix *pix = pixFMorphopGen_1(pixd, pixs, operation, selname);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (operation).
  * Arg #4 is expected to be a char* (selname).
@@ -11870,14 +11975,14 @@ static int
 FMorphopGen_2(lua_State *L)
 {
     LL_FUNC("FMorphopGen_2");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 operation = ll_check_l_int32(_fun, L, 3);
     const char *name = ll_check_string(_fun, L, 4);
     /* XXX: deconstify */
     char *selname = reinterpret_cast<char *>(reinterpret_cast<l_intptr_t>(name));
     Pix *pix = pixFMorphopGen_2(pixd, pixs, operation, selname);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -12310,7 +12415,7 @@ static int
 FillMapHoles(lua_State *L)
 {
     LL_FUNC("FillMapHoles");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 nx = ll_check_l_int32(_fun, L, 2);
     l_int32 ny = ll_check_l_int32(_fun, L, 3);
     l_int32 filltype = ll_check_l_int32(_fun, L, 4);
@@ -13691,7 +13796,7 @@ FixedOctcubeQuantGenRGB(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a char* (selname).
  * </pre>
@@ -13702,17 +13807,17 @@ static int
 FlipFHMTGen(lua_State *L)
 {
     LL_FUNC("FlipFHMTGen");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     const char *selname = ll_check_string(_fun, L, 3);
     Pix *pix = pixFlipFHMTGen(pixd, pixs, selname);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  *
  * Leptonica's Notes:
@@ -13755,10 +13860,10 @@ static int
 FlipLR(lua_State *L)
 {
     LL_FUNC("FlipLR");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pix = pixFlipLR(pixd, pixs);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -13775,7 +13880,7 @@ static int
 FlipPixel(lua_State *L)
 {
     LL_FUNC("FlipPixel");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 x = ll_check_l_int32(_fun, L, 2);
     l_int32 y = ll_check_l_int32(_fun, L, 3);
     return ll_push_boolean(_fun, L, 0 == pixFlipPixel(pix, x, y));
@@ -13784,7 +13889,7 @@ FlipPixel(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  *
  * Leptonica's Notes:
@@ -13812,10 +13917,10 @@ static int
 FlipTB(lua_State *L)
 {
     LL_FUNC("FlipTB");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pix = pixFlipTB(pixd, pixs);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -13886,14 +13991,14 @@ static int
 FreeData(lua_State *L)
 {
     LL_FUNC("FreeData");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     return ll_push_boolean(_fun, L, 0 == pixFreeData(pix));
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_float32 (gamma).
  * Arg #4 is expected to be a l_int32 (minval).
@@ -13935,19 +14040,19 @@ static int
 GammaTRC(lua_State *L)
 {
     LL_FUNC("GammaTRC");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_float32 gamma = ll_check_l_float32(_fun, L, 3);
     l_int32 minval = ll_check_l_int32(_fun, L, 4);
     l_int32 maxval = ll_check_l_int32(_fun, L, 5);
     Pix *pix = pixGammaTRC(pixd, pixs, gamma, minval, maxval);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Pix* (pixm).
  * Arg #4 is expected to be a l_float32 (gamma).
@@ -13967,20 +14072,20 @@ static int
 GammaTRCMasked(lua_State *L)
 {
     LL_FUNC("GammaTRCMasked");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pixm = ll_check_Pix(_fun, L, 3);
     l_float32 gamma = ll_check_l_float32(_fun, L, 4);
     l_int32 minval = ll_check_l_int32(_fun, L, 5);
     l_int32 maxval = ll_check_l_int32(_fun, L, 6);
     Pix *pix = pixGammaTRCMasked(pixd, pixs, pixm, gamma, minval, maxval);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_float32 (gamma).
  * Arg #4 is expected to be a l_int32 (minval).
@@ -13998,13 +14103,13 @@ static int
 GammaTRCWithAlpha(lua_State *L)
 {
     LL_FUNC("GammaTRCWithAlpha");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_float32 gamma = ll_check_l_float32(_fun, L, 3);
     l_int32 minval = ll_check_l_int32(_fun, L, 4);
     l_int32 maxval = ll_check_l_int32(_fun, L, 5);
     Pix *pix = pixGammaTRCWithAlpha(pixd, pixs, gamma, minval, maxval);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -15290,19 +15395,25 @@ GetColumnStats(lua_State *L)
  * \brief Get the data of a Pix* (%pix).
  * <pre>
  * Arg #1 (i.e. self) is expected to be a Pix* (pix).
+ *
+ * Returns a PixelBuffer* viewing the raster of %pix in place.
+ * Indexing the view (buf[i], #buf) reads and writes the words
+ * of %pix directly; use PixelBuffer:ToTable() for a copy as
+ * a Lua table (h) of tables (wpl).
+ *
+ * Compatibility: GetData() used to return that table itself. Scripts
+ * indexing the result as data[y][x] must call ToTable() on it now.
  * </pre>
  * \param L Lua state.
- * \return 1 array table (h) of array tables (wpl) on the Lua stack.
+ * \return 1 PixelBuffer* on the Lua stack.
  */
 static int
 GetData(lua_State *L)
 {
     LL_FUNC("GetData");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
-    l_uint32 *data = pixGetData(pix);
-    l_int32 wpl = pixGetWpl(pix);
-    l_int32 h = pixGetHeight(pix);
-    return ll_pack_Uarray_2d(_fun, L, data, wpl, h);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
+    PixelBuffer *buf = ll_create_PixelBuffer(_fun, L, pix);
+    return ll_push_PixelBuffer(_fun, L, buf);
 }
 
 /**
@@ -17076,7 +17187,7 @@ GetYRes(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (factor).
  * Arg #4 is expected to be a l_float32 (rank).
@@ -17111,7 +17222,7 @@ static int
 GlobalNormNoSatRGB(lua_State *L)
 {
     LL_FUNC("GlobalNormNoSatRGB");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 factor = ll_check_l_int32(_fun, L, 3);
     l_float32 rank = ll_check_l_float32(_fun, L, 4);
@@ -17120,13 +17231,13 @@ GlobalNormNoSatRGB(lua_State *L)
     l_int32 bval = 0;
     ll_check_color(_fun, L, 5, &rval, &gval, &bval);
     Pix *pix = pixGlobalNormNoSatRGB(pixd, pixs, rval, gval, bval, factor, rank);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (mapval).
  * Arg #4 is expected to be a l_int32 (rval).
@@ -17162,7 +17273,7 @@ static int
 GlobalNormRGB(lua_State *L)
 {
     LL_FUNC("GlobalNormRGB");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 mapval = ll_check_l_int32(_fun, L, 3);
     l_int32 rval = 0;
@@ -17170,7 +17281,7 @@ GlobalNormRGB(lua_State *L)
     l_int32 bval = 0;
     ll_check_color(_fun, L, 4, &rval, &gval, &bval);
     Pix *pix = pixGlobalNormRGB(pixd, pixs, rval, gval, bval, mapval);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -17257,7 +17368,7 @@ GrayQuantFromCmap(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Pix* (pixm).
  * Arg #4 is expected to be a l_float32 (minfract).
@@ -17303,13 +17414,13 @@ static int
 GrayQuantFromHisto(lua_State *L)
 {
     LL_FUNC("GrayQuantFromHisto");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pixm = ll_check_Pix(_fun, L, 3);
     l_float32 minfract = ll_check_l_float32(_fun, L, 4);
     l_int32 maxsize = ll_check_l_int32(_fun, L, 5);
     Pix *pix = pixGrayQuantFromHisto(pixd, pixs, pixm, minfract, maxsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -17374,7 +17485,7 @@ HDome(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Sel* (sel).
  *
@@ -17399,17 +17510,17 @@ static int
 HMT(lua_State *L)
 {
     LL_FUNC("HMT");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Sel *sel = ll_check_Sel(_fun, L, 3);
     Pix *pix = pixHMT(pixd, pixs, sel);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a string (selname).
  *
@@ -17425,17 +17536,17 @@ static int
 HMTDwa_1(lua_State *L)
 {
     LL_FUNC("HMTDwa_1");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     const char *selname = ll_check_string(_fun, L, 3);
     Pix *pix = pixHMTDwa_1(pixd, pixs, selname);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (yloc).
  * Arg #4 is expected to be a l_float32 (radang).
@@ -17474,19 +17585,19 @@ static int
 HShear(lua_State *L)
 {
     LL_FUNC("HShear");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 yloc = ll_check_l_int32(_fun, L, 3);
     l_float32 radang = ll_check_l_float32(_fun, L, 4);
     l_int32 incolor = ll_check_set_black_white(_fun, L, 5);
     Pix *pix = pixHShear(pixd, pixs, yloc, radang, incolor);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_float32 (radang).
  * Arg #4 is expected to be a string descibing black or white (incolor).
@@ -17503,18 +17614,18 @@ static int
 HShearCenter(lua_State *L)
 {
     LL_FUNC("HShearCenter");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_float32 radang = ll_check_l_float32(_fun, L, 3);
     l_int32 incolor = ll_check_set_black_white(_fun, L, 4);
     Pix *pix = pixHShearCenter(pixd, pixs, radang, incolor);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_float32 (radang).
  * Arg #4 is expected to be a string descibing black or white (incolor).
@@ -17531,12 +17642,12 @@ static int
 HShearCorner(lua_State *L)
 {
     LL_FUNC("HShearCorner");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_float32 radang = ll_check_l_float32(_fun, L, 3);
     l_int32 incolor = ll_check_set_black_white(_fun, L, 4);
     Pix *pix = pixHShearCorner(pixd, pixs, radang, incolor);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -17562,7 +17673,7 @@ static int
 HShearIP(lua_State *L)
 {
     LL_FUNC("HShearIP");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     l_int32 yloc = ll_check_l_int32(_fun, L, 2);
     l_float32 radang = ll_check_l_float32(_fun, L, 3);
     l_int32 incolor = ll_check_set_black_white(_fun, L, 4);
@@ -17883,7 +17994,7 @@ static int
 LinearEdgeFade(lua_State *L)
 {
     LL_FUNC("LinearEdgeFade");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     l_int32 dir = ll_check_l_int32(_fun, L, 2);
     l_int32 fadeto = ll_check_l_int32(_fun, L, 3);
     l_float32 distfract = ll_check_l_float32(_fun, L, 4);
@@ -17894,7 +18005,7 @@ LinearEdgeFade(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_uint32 (srcval).
  * Arg #4 is expected to be a l_uint32 (dstval).
@@ -17923,18 +18034,18 @@ static int
 LinearMapToTargetColor(lua_State *L)
 {
     LL_FUNC("LinearMapToTargetColor");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_uint32 srcval = ll_check_l_uint32(_fun, L, 3);
     l_uint32 dstval = ll_check_l_uint32(_fun, L, 4);
     Pix *pix = pixLinearMapToTargetColor(pixd, pixs, srcval, dstval);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (sx).
  * Arg #4 is expected to be a l_int32 (sy).
@@ -17959,14 +18070,14 @@ static int
 LinearTRCTiled(lua_State *L)
 {
     LL_FUNC("LinearTRCTiled");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 sx = ll_check_l_int32(_fun, L, 3);
     l_int32 sy = ll_check_l_int32(_fun, L, 4);
     Pix *pixmin = ll_check_Pix(_fun, L, 5);
     Pix *pixmax = ll_check_Pix(_fun, L, 6);
     Pix *pix = pixLinearTRCTiled(pixd, pixs, sx, sy, pixmin, pixmax);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -18477,7 +18588,7 @@ MakeRangeMaskSV(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Boxa* (boxa).
  * Arg #4 is expected to be a l_int32 (op).
@@ -18504,12 +18615,12 @@ static int
 MaskBoxa(lua_State *L)
 {
     LL_FUNC("MaskBoxa");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Boxa *boxa = ll_check_Boxa(_fun, L, 3);
     l_int32 op = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixMaskBoxa(pixd, pixs, boxa, op);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -19005,6 +19116,7 @@ MedianCutQuantMixed(lua_State *L)
  * Arg #1 (i.e. self) is expected to be a Pix* (pixs).
  * Arg #2 is expected to be a l_int32 (wf).
  * Arg #3 is expected to be a l_int32 (hf).
+ * Arg #4 is an optional table with options ({threads=n}).
  * </pre>
  * \param L Lua state.
  * \return 1 Pix * on the Lua stack.
@@ -19016,7 +19128,13 @@ MedianFilter(lua_State *L)
     Pix *pixs = ll_check_Pix(_fun, L, 1);
     l_int32 wf = ll_check_l_int32(_fun, L, 2);
     l_int32 hf = ll_check_l_int32(_fun, L, 3);
-    Pix *pix = pixMedianFilter(pixs, wf, hf);
+    l_int32 nthreads = ll_opt_threads(_fun, L, 4);
+    Pix *pix = nullptr;
+    if (ll_run_bands(pixs, hf / 2 + 1, nthreads, 1, &pix, [=](Pix *band, Pix **out) {
+            out[0] = pixMedianFilter(band, wf, hf);
+            return out[0] ? 0 : 1;
+        }))
+        pix = pixMedianFilter(pixs, wf, hf);
     return ll_push_Pix(_fun, L, pix);
 }
 
@@ -19111,7 +19229,7 @@ MinMaxTiles(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs1).
  * Arg #3 is expected to be a Pix* (pixs2).
  * Arg #4 is expected to be a l_int32 (type).
@@ -19133,12 +19251,12 @@ static int
 MinOrMax(lua_State *L)
 {
     LL_FUNC("MinOrMax");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs1 = ll_check_Pix(_fun, L, 2);
     Pix *pixs2 = ll_check_Pix(_fun, L, 3);
     l_int32 type = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixMinOrMax(pixd, pixs1, pixs2, type);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -19257,7 +19375,7 @@ MirroredTiling(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_float32 (fract).
  *
@@ -19279,17 +19397,17 @@ static int
 ModifyBrightness(lua_State *L)
 {
     LL_FUNC("ModifyBrightness");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_float32 fract = ll_check_l_float32(_fun, L, 3);
     Pix *pix = pixModifyBrightness(pixd, pixs, fract);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_float32 (fract).
  *
@@ -19312,17 +19430,17 @@ static int
 ModifyHue(lua_State *L)
 {
     LL_FUNC("ModifyHue");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_float32 fract = ll_check_l_float32(_fun, L, 3);
     Pix *pix = pixModifyHue(pixd, pixs, fract);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_float32 (fract).
  *
@@ -19344,11 +19462,11 @@ static int
 ModifySaturation(lua_State *L)
 {
     LL_FUNC("ModifySaturation");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_float32 fract = ll_check_l_float32(_fun, L, 3);
     Pix *pix = pixModifySaturation(pixd, pixs, fract);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -19456,7 +19574,7 @@ MorphCompSequenceDwa(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (operation).
  * Arg #4 is expected to be a char* (selname).
@@ -19475,20 +19593,20 @@ static int
 MorphDwa_1(lua_State *L)
 {
     LL_FUNC("MorphDwa_1");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 operation = ll_check_l_int32(_fun, L, 3);
     const char *name = ll_check_string(_fun, L, 4);
     /* XXX: deconstify */
     char *selname = reinterpret_cast<char *>(reinterpret_cast<l_intptr_t>(name));
     Pix *pix = pixMorphDwa_1(pixd, pixs, operation, selname);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (operation).
  * Arg #4 is expected to be a char* (selname).
@@ -19507,14 +19625,14 @@ static int
 MorphDwa_2(lua_State *L)
 {
     LL_FUNC("MorphDwa_2");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 operation = ll_check_l_int32(_fun, L, 3);
     const char *name = ll_check_string(_fun, L, 4);
     /* XXX: deconstify */
     char *selname = reinterpret_cast<char *>(reinterpret_cast<l_intptr_t>(name));
     Pix *pix = pixMorphDwa_2(pixd, pixs, operation, selname);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -19540,12 +19658,49 @@ MorphGradient(lua_State *L)
     return ll_push_Pix(_fun, L, pix);
 }
 
+/**
+ * \brief Return the vertical reach of a binary morph %sequence.
+ * <pre>
+ * Only dilations, erosions, openings and closings are considered; the
+ * sum of their brick heights bounds the number of rows which affect a
+ * result pixel. Sequences with reductions, expansions or borders
+ * change the geometry and return -1, i.e. they can not run banded.
+ * </pre>
+ * \param sequence string with the operations
+ * \return halo in rows, or -1.
+ */
+static l_int32
+morph_sequence_halo(const char *sequence)
+{
+    l_int32 halo = 1;
+    const char *op = sequence;
+    while (op && *op) {
+        l_int32 w = 0, h = 0;
+        while (isspace(static_cast<unsigned char>(*op)) || '+' == *op)
+            op++;
+        if (!*op)
+            break;
+        switch (tolower(static_cast<unsigned char>(*op))) {
+        case 'd': case 'e': case 'o': case 'c':
+            if (2 != sscanf(op + 1, "%d.%d", &w, &h) || h < 1)
+                return -1;
+            halo += h;
+            break;
+        default:
+            return -1;
+        }
+        op = strchr(op, '+');
+    }
+    return halo;
+}
+
 /**
  * \brief Brief comment goes here.
  * <pre>
  * Arg #1 (i.e. self) is expected to be a Pix* (pixs).
  * Arg #2 is expected to be a string (sequence).
  * Arg #3 is expected to be a l_int32 (dispsep).
+ * Arg #4 is an optional table with options ({threads=n}).
  *
  * Leptonica's Notes:
  *      (1) This does rasterop morphology on binary images.
@@ -19615,7 +19770,13 @@ MorphSequence(lua_State *L)
     Pix *pixs = ll_check_Pix(_fun, L, 1);
     const char *sequence = ll_check_string(_fun, L, 2);
     l_int32 dispsep = ll_check_l_int32(_fun, L, 3);
-    Pix *pix = pixMorphSequence(pixs, sequence, dispsep);
+    l_int32 nthreads = dispsep ? 1 : ll_opt_threads(_fun, L, 4);
+    Pix *pix = nullptr;
+    if (ll_run_bands(pixs, morph_sequence_halo(sequence), nthreads, 1, &pix, [=](Pix *band, Pix **out) {
+            out[0] = pixMorphSequence(band, sequence, 0);
+            return out[0] ? 0 : 1;
+        }))
+        pix = pixMorphSequence(pixs, sequence, dispsep);
     return ll_push_Pix(_fun, L, pix);
 }
 
@@ -19820,7 +19981,7 @@ static int
 MultConstAccumulate(lua_State *L)
 {
     LL_FUNC("MultConstAccumulate");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     l_float32 factor = ll_check_l_float32(_fun, L, 2);
     l_uint32 offset = ll_check_l_uint32(_fun, L, 3);
     l_int32 result = pixMultConstAccumulate(pixs, factor, offset);
@@ -19875,7 +20036,7 @@ static int
 MultConstantGray(lua_State *L)
 {
     LL_FUNC("MultConstantGray");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     l_float32 val = ll_check_l_float32(_fun, L, 2);
     l_int32 result = pixMultConstantGray(pixs, val);
     return ll_push_l_int32(_fun, L, result);
@@ -19927,7 +20088,7 @@ MultMatrixColor(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Box* (box).
  * Arg #4 is expected to be a l_uint32 (color).
@@ -19947,12 +20108,12 @@ static int
 MultiplyByColor(lua_State *L)
 {
     LL_FUNC("MultiplyByColor");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Box *box = ll_check_Box(_fun, L, 3);
     l_uint32 color = ll_check_l_uint32(_fun, L, 4);
     Pix *pix = pixMultiplyByColor(pixd, pixs, box, color);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -20372,7 +20533,7 @@ OctreeQuantNumColors(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Sel* (sel).
  *
@@ -20395,17 +20556,17 @@ static int
 Open(lua_State *L)
 {
     LL_FUNC("Open");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Sel *sel = ll_check_Sel(_fun, L, 3);
     Pix *pix = pixOpen(pixd, pixs, sel);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -20431,18 +20592,18 @@ static int
 OpenBrick(lua_State *L)
 {
     LL_FUNC("OpenBrick");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixOpenBrick(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -20477,18 +20638,18 @@ static int
 OpenBrickDwa(lua_State *L)
 {
     LL_FUNC("OpenBrickDwa");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixOpenBrickDwa(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -20528,18 +20689,18 @@ static int
 OpenCompBrick(lua_State *L)
 {
     LL_FUNC("OpenCompBrick");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixOpenCompBrick(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -20583,18 +20744,18 @@ static int
 OpenCompBrickDwa(lua_State *L)
 {
     LL_FUNC("OpenCompBrickDwa");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixOpenCompBrickDwa(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hsize).
  * Arg #4 is expected to be a l_int32 (vsize).
@@ -20606,18 +20767,18 @@ static int
 OpenCompBrickExtendDwa(lua_State *L)
 {
     LL_FUNC("OpenCompBrickExtendDwa");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hsize = ll_check_l_int32(_fun, L, 3);
     l_int32 vsize = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixOpenCompBrickExtendDwa(pixd, pixs, hsize, vsize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Sel* (sel).
  *
@@ -20643,11 +20804,11 @@ static int
 OpenGeneralized(lua_State *L)
 {
     LL_FUNC("OpenGeneralized");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Sel *sel = ll_check_Sel(_fun, L, 3);
     Pix *pix = pixOpenGeneralized(pixd, pixs, sel);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -21105,7 +21266,7 @@ static int
 PaintSelfThroughMask(lua_State *L)
 {
     LL_FUNC("PaintSelfThroughMask");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixm = ll_check_Pix(_fun, L, 2);
     l_int32 x = ll_check_l_int32(_fun, L, 3);
     l_int32 y = ll_check_l_int32(_fun, L, 4);
@@ -21165,7 +21326,7 @@ static int
 PaintThroughMask(lua_State *L)
 {
     LL_FUNC("PaintThroughMask");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixm = ll_check_Pix(_fun, L, 2);
     l_int32 x = ll_check_l_int32(_fun, L, 3);
     l_int32 y = ll_check_l_int32(_fun, L, 4);
@@ -21173,6 +21334,34 @@ PaintThroughMask(lua_State *L)
     return ll_push_boolean(_fun, L, 0 == pixPaintThroughMask(pixd, pixm, x, y, val));
 }
 
+/**
+ * \brief Run a list of operations on a Pix* without intermediate user data.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixs).
+ * Arg #2 is expected to be a table of steps, or a PixPipeline* (pl).
+ *
+ * Pix.Pipeline(steps) without a Pix* compiles the steps into a PixPipeline*
+ * which can be run on many images; see llpixpipeline.cpp for the steps.
+ *
+ *   pixd = pixs:Pipeline{ "ConvertTo8", {"Scale", 0.5}, {"OpenBrick", 3, 3} }
+ * </pre>
+ * \param L Lua state.
+ * \return 1 Pix* (or PixPipeline*) on the Lua stack.
+ */
+static int
+Pipeline(lua_State *L)
+{
+    LL_FUNC("Pipeline");
+    if (lua_istable(L, 1))
+        return ll_new_PixPipeline(L);
+    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    ll_pixpipeline_t *pl = ll_opt_PixPipeline(_fun, L, 2);
+    ll_pixpipeline_t *tmp = pl ? nullptr : ll_compile_pipeline(_fun, L, 2);
+    Pix *pixd = ll_run_pipeline(pl ? pl : tmp, pixs, nullptr);
+    ll_free_pipeline(&tmp);
+    return ll_push_Pix(_fun, L, pixd);
+}
+
 /**
  * \brief Brief comment goes here.
  * <pre>
@@ -21888,6 +22077,7 @@ RankColumnTransform(lua_State *L)
  * Arg #2 is expected to be a l_int32 (wf).
  * Arg #3 is expected to be a l_int32 (hf).
  * Arg #4 is expected to be a l_float32 (rank).
+ * Arg #5 is an optional table with options ({threads=n}).
  *
  * Leptonica's Notes:
  *      (1) This defines, for each pixel in pixs, a neighborhood of
@@ -21910,7 +22100,13 @@ RankFilter(lua_State *L)
     l_int32 wf = ll_check_l_int32(_fun, L, 2);
     l_int32 hf = ll_check_l_int32(_fun, L, 3);
     l_float32 rank = ll_check_l_float32(_fun, L, 4);
-    Pix *pix = pixRankFilter(pixs, wf, hf, rank);
+    l_int32 nthreads = ll_opt_threads(_fun, L, 5);
+    Pix *pix = nullptr;
+    if (ll_run_bands(pixs, hf / 2 + 1, nthreads, 1, &pix, [=](Pix *band, Pix **out) {
+            out[0] = pixRankFilter(band, wf, hf, rank);
+            return out[0] ? 0 : 1;
+        }))
+        pix = pixRankFilter(pixs, wf, hf, rank);
     return ll_push_Pix(_fun, L, pix);
 }
 
@@ -22241,7 +22437,7 @@ static int
 Rasterop(lua_State *L)
 {
     LL_FUNC("Rasterop");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     l_int32 dx = ll_check_l_int32(_fun, L, 2);
     l_int32 dy = ll_check_l_int32(_fun, L, 3);
     l_int32 dw = ll_check_l_int32(_fun, L, 4);
@@ -22275,7 +22471,7 @@ static int
 RasteropFullImage(lua_State *L)
 {
     LL_FUNC("RasteropFullImage");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 op = ll_check_l_int32(_fun, L, 3);
     l_int32 result = pixRasteropFullImage(pixd, pixs, op);
@@ -22306,7 +22502,7 @@ static int
 RasteropHip(lua_State *L)
 {
     LL_FUNC("RasteropHip");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     l_int32 by = ll_check_l_int32(_fun, L, 2);
     l_int32 bh = ll_check_l_int32(_fun, L, 3);
     l_int32 hshift = ll_check_l_int32(_fun, L, 4);
@@ -22330,7 +22526,7 @@ static int
 RasteropIP(lua_State *L)
 {
     LL_FUNC("RasteropIP");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     l_int32 hshift = ll_check_l_int32(_fun, L, 2);
     l_int32 vshift = ll_check_l_int32(_fun, L, 3);
     l_int32 incolor = ll_check_set_black_white(_fun, L, 4);
@@ -22362,7 +22558,7 @@ static int
 RasteropVip(lua_State *L)
 {
     LL_FUNC("RasteropVip");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     l_int32 bx = ll_check_l_int32(_fun, L, 2);
     l_int32 bw = ll_check_l_int32(_fun, L, 3);
     l_int32 vshift = ll_check_l_int32(_fun, L, 4);
@@ -22438,6 +22634,60 @@ ReadBarcodes(lua_State *L)
     return 1;
 }
 
+/**
+ * \brief Read a Pix* from a source function (%source).
+ * <pre>
+ * Arg #1 is expected to be a function (source).
+ * Arg #2 is an optional string with the input format name (hint).
+ *
+ * The function is called whenever the decoder needs more data and returns
+ * the next chunk as a string, or nil at the end of the data. Decoding starts
+ * with the first chunk, and the chunks are never concatenated (see
+ * lualept-source.cpp). Without %hint the format is found from the header.
+ *
+ * Only JPEG and PNG are decoded while the chunks arrive. The readers of
+ * the other formats seek, e.g. to the end of the stream to find its size,
+ * so those are read into memory first and decoded with pixReadMem().
+ * An error raised by the function is raised by ReadFrom().
+ * </pre>
+ * \param L Lua state.
+ * \return 1 Pix* on the Lua stack, or nil on error.
+ */
+static int
+ReadFrom(lua_State *L)
+{
+    LL_FUNC("ReadFrom");
+    l_int32 format = ll_check_input_format(_fun, L, 2, IFF_UNKNOWN);
+    ll_source_t src;
+    FILE *fp = ll_open_source(_fun, L, 1, &src);
+    Pix *pix = nullptr;
+
+    if (IFF_UNKNOWN == format || IFF_DEFAULT == format)
+        findFileFormatStream(fp, &format);
+
+    switch (format) {
+    case IFF_JFIF_JPEG:
+        pix = pixReadStreamJpeg(fp, 0, 1, nullptr, 0);
+        break;
+    case IFF_PNG:
+        pix = pixReadStreamPng(fp);
+        break;
+    default:
+        {
+            size_t size = 0;
+            l_uint8 *data = ll_read_source(_fun, L, &src, &size);
+            if (data)
+                pix = pixReadMem(data, size);
+            ll_free(data);
+        }
+    }
+
+    if (LUA_NOREF != src.error)
+        pixDestroy(&pix);
+    ll_close_source(_fun, L, &src);
+    return ll_push_Pix(_fun, L, pix);
+}
+
 /**
  * \brief Brief comment goes here.
  * <pre>
@@ -22697,6 +22947,29 @@ ReadJpeg(lua_State *L)
     return 1;
 }
 
+/**
+ * \brief Read a Pix* from a memory mapped file (%filename).
+ * <pre>
+ * Arg #1 is expected to be a string (filename).
+ * Arg #2 is an optional l_int32 (page) of a multipage TIFF, starting at 0.
+ *
+ * The file is mapped read-only and decoded with pixReadMem(), or
+ * pixReadMemTiff() if %page is given, without copying it through stdio
+ * or a Lua string (see lualept-mapped.cpp).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 Pix* on the Lua stack.
+ */
+static int
+ReadMapped(lua_State *L)
+{
+    LL_FUNC("ReadMapped");
+    const char *filename = ll_check_string(_fun, L, 1);
+    l_int32 page = ll_opt_l_int32(_fun, L, 2, -1);
+    Pix *pix = ll_read_mapped_pix(_fun, L, filename, page);
+    return ll_push_Pix(_fun, L, pix);
+}
+
 /**
  * \brief Read a Pix* from a Lua string (%data).
  * <pre>
@@ -23582,7 +23855,7 @@ static int
 RemoveMatchedPattern(lua_State *L)
 {
     LL_FUNC("RemoveMatchedPattern");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Pix *pixp = ll_check_Pix(_fun, L, 2);
     Pix *pixe = ll_check_Pix(_fun, L, 3);
     l_int32 x0 = ll_check_l_int32(_fun, L, 4);
@@ -23595,7 +23868,7 @@ RemoveMatchedPattern(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Pix* (pixm).
  * Arg #4 is expected to be a l_int32 (connectivity).
@@ -23619,13 +23892,13 @@ static int
 RemoveSeededComponents(lua_State *L)
 {
     LL_FUNC("RemoveSeededComponents");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pixm = ll_check_Pix(_fun, L, 3);
     l_int32 connectivity = ll_check_l_int32(_fun, L, 4);
     l_int32 bordersize = ll_check_l_int32(_fun, L, 5);
     Pix *pix = pixRemoveSeededComponents(pixd, pixs, pixm, connectivity, bordersize);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -23646,7 +23919,7 @@ static int
 RemoveUnusedColors(lua_State *L)
 {
     LL_FUNC("RemoveUnusedColors");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     l_int32 result = pixRemoveUnusedColors(pixs);
     return ll_push_l_int32(_fun, L, result);
 }
@@ -23669,7 +23942,7 @@ static int
 RemoveWithIndicator(lua_State *L)
 {
     LL_FUNC("RemoveWithIndicator");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Pixa *pixa = ll_check_Pixa(_fun, L, 2);
     Numa *na = ll_check_Numa(_fun, L, 3);
     l_int32 result = pixRemoveWithIndicator(pixs, pixa, na);
@@ -23691,7 +23964,7 @@ static int
 RenderBox(lua_State *L)
 {
     LL_FUNC("RenderBox");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Box *box = ll_check_Box(_fun, L, 2);
     l_int32 width = ll_check_l_int32(_fun, L, 3);
     l_int32 op = ll_check_l_int32(_fun, L, 4);
@@ -23716,7 +23989,7 @@ static int
 RenderBoxArb(lua_State *L)
 {
     LL_FUNC("RenderBoxArb");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Box *box = ll_check_Box(_fun, L, 2);
     l_int32 width = ll_check_l_int32(_fun, L, 3);
     l_uint8 rval = ll_check_l_uint8(_fun, L, 4);
@@ -23744,7 +24017,7 @@ static int
 RenderBoxBlend(lua_State *L)
 {
     LL_FUNC("RenderBoxBlend");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Box *box = ll_check_Box(_fun, L, 2);
     l_int32 width = ll_check_l_int32(_fun, L, 3);
     l_uint8 rval = ll_check_l_uint8(_fun, L, 4);
@@ -23770,7 +24043,7 @@ static int
 RenderBoxa(lua_State *L)
 {
     LL_FUNC("RenderBoxa");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Boxa *boxa = ll_check_Boxa(_fun, L, 2);
     l_int32 width = ll_check_l_int32(_fun, L, 3);
     l_int32 op = ll_check_l_int32(_fun, L, 4);
@@ -23795,7 +24068,7 @@ static int
 RenderBoxaArb(lua_State *L)
 {
     LL_FUNC("RenderBoxaArb");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Boxa *boxa = ll_check_Boxa(_fun, L, 2);
     l_int32 width = ll_check_l_int32(_fun, L, 3);
     l_uint8 rval = ll_check_l_uint8(_fun, L, 4);
@@ -23824,7 +24097,7 @@ static int
 RenderBoxaBlend(lua_State *L)
 {
     LL_FUNC("RenderBoxaBlend");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Boxa *boxa = ll_check_Boxa(_fun, L, 2);
     l_int32 width = ll_check_l_int32(_fun, L, 3);
     l_uint8 rval = ll_check_l_uint8(_fun, L, 4);
@@ -23882,7 +24155,7 @@ static int
 RenderGridArb(lua_State *L)
 {
     LL_FUNC("RenderGridArb");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 nx = ll_check_l_int32(_fun, L, 2);
     l_int32 ny = ll_check_l_int32(_fun, L, 3);
     l_int32 width = ll_check_l_int32(_fun, L, 4);
@@ -23911,7 +24184,7 @@ static int
 RenderHashBox(lua_State *L)
 {
     LL_FUNC("RenderHashBox");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Box *box = ll_check_Box(_fun, L, 2);
     l_int32 spacing = ll_check_l_int32(_fun, L, 3);
     l_int32 width = ll_check_l_int32(_fun, L, 4);
@@ -23942,7 +24215,7 @@ static int
 RenderHashBoxArb(lua_State *L)
 {
     LL_FUNC("RenderHashBoxArb");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Box *box = ll_check_Box(_fun, L, 2);
     l_int32 spacing = ll_check_l_int32(_fun, L, 3);
     l_int32 width = ll_check_l_int32(_fun, L, 4);
@@ -23977,7 +24250,7 @@ static int
 RenderHashBoxBlend(lua_State *L)
 {
     LL_FUNC("RenderHashBoxBlend");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Box *box = ll_check_Box(_fun, L, 2);
     l_int32 spacing = ll_check_l_int32(_fun, L, 3);
     l_int32 width = ll_check_l_int32(_fun, L, 4);
@@ -24010,7 +24283,7 @@ static int
 RenderHashBoxa(lua_State *L)
 {
     LL_FUNC("RenderHashBoxa");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Boxa *boxa = ll_check_Boxa(_fun, L, 2);
     l_int32 spacing = ll_check_l_int32(_fun, L, 3);
     l_int32 width = ll_check_l_int32(_fun, L, 4);
@@ -24041,7 +24314,7 @@ static int
 RenderHashBoxaArb(lua_State *L)
 {
     LL_FUNC("RenderHashBoxaArb");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Boxa *boxa = ll_check_Boxa(_fun, L, 2);
     l_int32 spacing = ll_check_l_int32(_fun, L, 3);
     l_int32 width = ll_check_l_int32(_fun, L, 4);
@@ -24076,7 +24349,7 @@ static int
 RenderHashBoxaBlend(lua_State *L)
 {
     LL_FUNC("RenderHashBoxaBlend");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Boxa *boxa = ll_check_Boxa(_fun, L, 2);
     l_int32 spacing = ll_check_l_int32(_fun, L, 3);
     l_int32 width = ll_check_l_int32(_fun, L, 4);
@@ -24118,7 +24391,7 @@ static int
 RenderHashMaskArb(lua_State *L)
 {
     LL_FUNC("RenderHashMaskArb");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Pix *pixm = ll_check_Pix(_fun, L, 2);
     l_int32 x = ll_check_l_int32(_fun, L, 3);
     l_int32 y = ll_check_l_int32(_fun, L, 4);
@@ -24152,7 +24425,7 @@ static int
 RenderLine(lua_State *L)
 {
     LL_FUNC("RenderLine");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 x1 = ll_check_l_int32(_fun, L, 2);
     l_int32 y1 = ll_check_l_int32(_fun, L, 3);
     l_int32 x2 = ll_check_l_int32(_fun, L, 4);
@@ -24183,7 +24456,7 @@ static int
 RenderLineArb(lua_State *L)
 {
     LL_FUNC("RenderLineArb");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 x1 = ll_check_l_int32(_fun, L, 2);
     l_int32 y1 = ll_check_l_int32(_fun, L, 3);
     l_int32 x2 = ll_check_l_int32(_fun, L, 4);
@@ -24217,7 +24490,7 @@ static int
 RenderLineBlend(lua_State *L)
 {
     LL_FUNC("RenderLineBlend");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 x1 = ll_check_l_int32(_fun, L, 2);
     l_int32 y1 = ll_check_l_int32(_fun, L, 3);
     l_int32 x2 = ll_check_l_int32(_fun, L, 4);
@@ -24355,7 +24628,7 @@ static int
 RenderPolyline(lua_State *L)
 {
     LL_FUNC("RenderPolyline");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Pta *ptas = ll_check_Pta(_fun, L, 2);
     l_int32 width = ll_check_l_int32(_fun, L, 3);
     l_int32 op = ll_check_l_int32(_fun, L, 4);
@@ -24385,7 +24658,7 @@ static int
 RenderPolylineArb(lua_State *L)
 {
     LL_FUNC("RenderPolylineArb");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Pta *ptas = ll_check_Pta(_fun, L, 2);
     l_int32 width = ll_check_l_int32(_fun, L, 3);
     l_uint8 rval = ll_check_l_uint8(_fun, L, 4);
@@ -24416,7 +24689,7 @@ static int
 RenderPolylineBlend(lua_State *L)
 {
     LL_FUNC("RenderPolylineBlend");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Pta *ptas = ll_check_Pta(_fun, L, 2);
     l_int32 width = ll_check_l_int32(_fun, L, 3);
     l_uint8 rval = ll_check_l_uint8(_fun, L, 4);
@@ -24453,7 +24726,7 @@ static int
 RenderPta(lua_State *L)
 {
     LL_FUNC("RenderPta");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Pta *pta = ll_check_Pta(_fun, L, 2);
     l_int32 op = ll_check_l_int32(_fun, L, 3);
     l_int32 result = pixRenderPta(pix, pta, op);
@@ -24487,7 +24760,7 @@ static int
 RenderPtaArb(lua_State *L)
 {
     LL_FUNC("RenderPtaArb");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Pta *pta = ll_check_Pta(_fun, L, 2);
     l_uint8 rval = ll_check_l_uint8(_fun, L, 3);
     l_uint8 gval = ll_check_l_uint8(_fun, L, 4);
@@ -24516,7 +24789,7 @@ static int
 RenderPtaBlend(lua_State *L)
 {
     LL_FUNC("RenderPtaBlend");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Pta *pta = ll_check_Pta(_fun, L, 2);
     l_uint8 rval = ll_check_l_uint8(_fun, L, 3);
     l_uint8 gval = ll_check_l_uint8(_fun, L, 4);
@@ -24586,7 +24859,7 @@ static int
 ResizeImageData(lua_State *L)
 {
     LL_FUNC("ResizeImageData");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     return ll_push_boolean(_fun, L, 0 == pixResizeImageData(pixd, pixs));
 }
@@ -24729,7 +25002,7 @@ Rotate(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  *
  * Leptonica's Notes:
@@ -24753,10 +25026,10 @@ static int
 Rotate180(lua_State *L)
 {
     LL_FUNC("Rotate180");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pix = pixRotate180(pixd, pixs);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -25210,7 +25483,7 @@ static int
 RotateShearCenterIP(lua_State *L)
 {
     LL_FUNC("RotateShearCenterIP");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     l_float32 angle = ll_check_l_float32(_fun, L, 2);
     l_int32 incolor = ll_check_set_black_white(_fun, L, 3);
     l_int32 result = pixRotateShearCenterIP(pixs, angle, incolor);
@@ -25249,7 +25522,7 @@ static int
 RotateShearIP(lua_State *L)
 {
     LL_FUNC("RotateShearIP");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     l_int32 xcen = ll_check_l_int32(_fun, L, 2);
     l_int32 ycen = ll_check_l_int32(_fun, L, 3);
     l_float32 angle = ll_check_l_float32(_fun, L, 4);
@@ -25422,6 +25695,7 @@ RunlengthTransform(lua_State *L)
  * Arg #2 is expected to be a l_int32 (whsize).
  * Arg #3 is expected to be a l_float32 (factor).
  * Arg #4 is expected to be a l_int32 (addborder).
+ * Arg #5 is an optional table with options ({threads=n}).
  *
  * Leptonica's Notes:
  *      (1) The window width and height are 2 * %whsize + 1.  The minimum
@@ -25461,8 +25735,19 @@ SauvolaBinarize(lua_State *L)
     Pix *pixsd = nullptr;
     Pix *pixth = nullptr;
     Pix *pixd = nullptr;
-    if (pixSauvolaBinarize(pixs, whsize, factor, addborder, &pixm, &pixsd, &pixth, &pixd))
-	return ll_push_nil(_fun, L);
+    l_int32 nthreads = addborder ? ll_opt_threads(_fun, L, 5) : 1;
+    Pix *out[4];
+    if (0 == ll_run_bands(pixs, whsize + 2, nthreads, 4, out, [=](Pix *band, Pix **pout) {
+            return pixSauvolaBinarize(band, whsize, factor, addborder,
+                                      &pout[0], &pout[1], &pout[2], &pout[3]);
+        })) {
+        pixm = out[0];
+        pixsd = out[1];
+        pixth = out[2];
+        pixd = out[3];
+    } else if (pixSauvolaBinarize(pixs, whsize, factor, addborder, &pixm, &pixsd, &pixth, &pixd)) {
+        return ll_push_nil(_fun, L);
+    }
     ll_push_Pix(_fun, L, pixm);
     ll_push_Pix(_fun, L, pixsd);
     ll_push_Pix(_fun, L, pixth);
@@ -25555,7 +25840,7 @@ static int
 ScaleAndTransferAlpha(lua_State *L)
 {
     LL_FUNC("ScaleAndTransferAlpha");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_float32 scalex = ll_check_l_float32(_fun, L, 3);
     l_float32 scaley = ll_check_l_float32(_fun, L, 4);
@@ -26401,7 +26686,7 @@ static int
 ScaleResolution(lua_State *L)
 {
     LL_FUNC("ScaleResolution");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_float32 xscale = ll_check_l_float32(_fun, L, 2);
     l_float32 yscale = ll_check_l_float32(_fun, L, 3);
     return ll_push_boolean(_fun, L, 0 == pixScaleResolution(pix, xscale, yscale));
@@ -27028,7 +27313,7 @@ static int
 Seedfill(lua_State *L)
 {
     LL_FUNC("Seedfill");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Stack *stack = ll_check_Stack(_fun, L, 2);
     l_int32 x = ll_check_l_int32(_fun, L, 3);
     l_int32 y = ll_check_l_int32(_fun, L, 4);
@@ -27059,7 +27344,7 @@ static int
 Seedfill4(lua_State *L)
 {
     LL_FUNC("Seedfill4");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Stack *stack = ll_check_Stack(_fun, L, 2);
     l_int32 x = ll_check_l_int32(_fun, L, 3);
     l_int32 y = ll_check_l_int32(_fun, L, 4);
@@ -27103,7 +27388,7 @@ static int
 Seedfill4BB(lua_State *L)
 {
     LL_FUNC("Seedfill4BB");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Stack *stack = ll_check_Stack(_fun, L, 2);
     l_int32 x = ll_check_l_int32(_fun, L, 3);
     l_int32 y = ll_check_l_int32(_fun, L, 4);
@@ -27133,7 +27418,7 @@ static int
 Seedfill8(lua_State *L)
 {
     LL_FUNC("Seedfill8");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Stack *stack = ll_check_Stack(_fun, L, 2);
     l_int32 x = ll_check_l_int32(_fun, L, 3);
     l_int32 y = ll_check_l_int32(_fun, L, 4);
@@ -27170,7 +27455,7 @@ static int
 Seedfill8BB(lua_State *L)
 {
     LL_FUNC("Seedfill8BB");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Stack *stack = ll_check_Stack(_fun, L, 2);
     l_int32 x = ll_check_l_int32(_fun, L, 3);
     l_int32 y = ll_check_l_int32(_fun, L, 4);
@@ -27198,7 +27483,7 @@ static int
 SeedfillBB(lua_State *L)
 {
     LL_FUNC("SeedfillBB");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Stack *stack = ll_check_Stack(_fun, L, 2);
     l_int32 x = ll_check_l_int32(_fun, L, 3);
     l_int32 y = ll_check_l_int32(_fun, L, 4);
@@ -27210,7 +27495,7 @@ SeedfillBB(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Pix* (pixm).
  * Arg #4 is expected to be a l_int32 (connectivity).
@@ -27241,18 +27526,18 @@ static int
 SeedfillBinary(lua_State *L)
 {
     LL_FUNC("SeedfillBinary");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pixm = ll_check_Pix(_fun, L, 3);
     l_int32 connectivity = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixSeedfillBinary(pixd, pixs, pixm, connectivity);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a Pix* (pixm).
  * Arg #4 is expected to be a l_int32 (connectivity).
@@ -27285,14 +27570,14 @@ static int
 SeedfillBinaryRestricted(lua_State *L)
 {
     LL_FUNC("SeedfillBinaryRestricted");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     Pix *pixm = ll_check_Pix(_fun, L, 3);
     l_int32 connectivity = ll_check_l_int32(_fun, L, 4);
     l_int32 xmax = ll_check_l_int32(_fun, L, 5);
     l_int32 ymax = ll_check_l_int32(_fun, L, 6);
     Pix *pix = pixSeedfillBinaryRestricted(pixd, pixs, pixm, connectivity, xmax, ymax);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -27323,7 +27608,7 @@ static int
 SeedfillGray(lua_State *L)
 {
     LL_FUNC("SeedfillGray");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Pix *pixm = ll_check_Pix(_fun, L, 2);
     l_int32 connectivity = ll_check_l_int32(_fun, L, 3);
     l_int32 result = pixSeedfillGray(pixs, pixm, connectivity);
@@ -27404,7 +27689,7 @@ static int
 SeedfillGrayInv(lua_State *L)
 {
     LL_FUNC("SeedfillGrayInv");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Pix *pixm = ll_check_Pix(_fun, L, 2);
     l_int32 connectivity = ll_check_l_int32(_fun, L, 3);
     l_int32 result = pixSeedfillGrayInv(pixs, pixm, connectivity);
@@ -27438,7 +27723,7 @@ static int
 SeedfillGrayInvSimple(lua_State *L)
 {
     LL_FUNC("SeedfillGrayInvSimple");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Pix *pixm = ll_check_Pix(_fun, L, 2);
     l_int32 connectivity = ll_check_l_int32(_fun, L, 3);
     l_int32 result = pixSeedfillGrayInvSimple(pixs, pixm, connectivity);
@@ -27473,7 +27758,7 @@ static int
 SeedfillGraySimple(lua_State *L)
 {
     LL_FUNC("SeedfillGraySimple");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Pix *pixm = ll_check_Pix(_fun, L, 2);
     l_int32 connectivity = ll_check_l_int32(_fun, L, 3);
     l_int32 result = pixSeedfillGraySimple(pixs, pixm, connectivity);
@@ -27962,7 +28247,7 @@ static int
 SetAll(lua_State *L)
 {
     LL_FUNC("SetAll");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     return ll_push_boolean(_fun, L, 0 == pixSetAll(pix));
 }
 
@@ -27979,7 +28264,7 @@ static int
 SetAllArbitrary(lua_State *L)
 {
     LL_FUNC("SetAllArbitrary");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_uint32 val = ll_check_color_index(_fun, L, 2, pix);
     return ll_push_boolean(_fun, L, 0 == pixSetAllArbitrary(pix, val));
 }
@@ -28009,7 +28294,7 @@ static int
 SetAllGray(lua_State *L)
 {
     LL_FUNC("SetAllGray");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 grayval = ll_check_l_int32(_fun, L, 2);
     return ll_push_boolean(_fun, L, 0 == pixSetAllGray(pix, grayval));
 }
@@ -28053,7 +28338,7 @@ static int
 SetBlack(lua_State *L)
 {
     LL_FUNC("SetBlack");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     return ll_push_boolean(_fun, L, 0 == pixSetBlackOrWhite(pix, L_SET_BLACK));
 }
 
@@ -28078,7 +28363,7 @@ static int
 SetBlackOrWhite(lua_State *L)
 {
     LL_FUNC("SetBlackOrWhite");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 op = ll_check_set_black_white(_fun, L, 2, L_SET_BLACK);
     return ll_push_boolean(_fun, L, 0 == pixSetBlackOrWhite(pix, op));
 }
@@ -28118,7 +28403,7 @@ static int
 SetBorderRingVal(lua_State *L)
 {
     LL_FUNC("SetBorderRingVal");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 dist = ll_check_l_int32(_fun, L, 2);
     l_uint32 val = ll_check_color_index(_fun, L, 3, pix);
     return ll_push_boolean(_fun, L, 0 == pixSetBorderRingVal(pix, dist, val));
@@ -28153,7 +28438,7 @@ static int
 SetBorderVal(lua_State *L)
 {
     LL_FUNC("SetBorderVal");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 left = ll_check_l_int32(_fun, L, 2);
     l_int32 right = ll_check_l_int32(_fun, L, 3);
     l_int32 top = ll_check_l_int32(_fun, L, 4);
@@ -28181,7 +28466,7 @@ static int
 SetChromaSampling(lua_State *L)
 {
     LL_FUNC("SetChromaSampling");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 sampling = ll_check_l_int32(_fun, L, 2);
     l_int32 result = pixSetChromaSampling(pix, sampling);
     return ll_push_l_int32(_fun, L, result);
@@ -28206,8 +28491,8 @@ static int
 SetColormap(lua_State *L)
 {
     LL_FUNC("SetColormap");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
-    PixColormap* colormap = ll_take_udata<PixColormap>(_fun, L, 2, LL_PIXCMAP);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
+    PixColormap* colormap = ll_take_owned<PixColormap>(_fun, L, 2, LL_PIXCMAP);
     return ll_push_boolean(_fun, L, 0 == pixSetColormap(pix, colormap));
 }
 
@@ -28229,7 +28514,7 @@ static int
 SetComponentArbitrary(lua_State *L)
 {
     LL_FUNC("SetComponentArbitrary");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 comp = ll_check_component(_fun, L, 2, 0);
     l_int32 val = ll_check_l_int32(_fun, L, 3);
     return ll_push_boolean(_fun, L, 0 == pixSetComponentArbitrary(pix, comp, val));
@@ -28239,7 +28524,16 @@ SetComponentArbitrary(lua_State *L)
  * \brief Set the data of a Pix* (%pix).
  * <pre>
  * Arg #1 (i.e. self) is expected to be a Pix* (pix).
- * Arg #2 is expected to be a Lua array table (h) of array tables (wpl).
+ * Arg #2 is expected to be a PixelBuffer* (buf), or
+ *        a Lua array table (h) of array tables (wpl).
+ *
+ * A PixelBuffer* viewing the raster of %pix itself is accepted without
+ * any copying. The words of any other PixelBuffer* with the same width,
+ * depth, wpl and height are copied into the raster of %pix; for any
+ * other PixelBuffer* false is returned and %pix is left unchanged.
+ *
+ * Compatibility: a PixelBuffer* is what GetData() and ExtractData()
+ * return now; tables as returned by them before are still accepted.
  * </pre>
  * \param L Lua state.
  * \return 1 boolean on the Lua stack.
@@ -28248,10 +28542,29 @@ static int
 SetData(lua_State *L)
 {
     LL_FUNC("SetData");
-    Pix* pix = ll_check_Pix(_fun, L, 1);
+    Pix* pix = ll_check_Pixd(_fun, L, 1);
+    PixelBuffer *buf = ll_opt_PixelBuffer(_fun, L, 2);
     l_int32 wpl = pixGetWpl(pix);
     l_int32 h = pixGetHeight(pix);
-    l_uint32 *data = ll_unpack_Uarray_2d(_fun, L, 2, wpl, h);
+    l_uint32 *data = nullptr;
+    if (buf) {
+        l_uint32 *src = pixGetData(buf->pix) + static_cast<size_t>(buf->y0) * static_cast<size_t>(buf->wpl);
+        size_t size = static_cast<size_t>(wpl) * static_cast<size_t>(h);
+        if (buf->w != pixGetWidth(pix) || buf->d != pixGetDepth(pix) ||
+            buf->wpl != wpl || buf->h != h || !pixGetData(buf->pix))
+            return ll_push_boolean(_fun, L, FALSE);
+        data = pixGetData(pix);
+        if (data == src)
+            return ll_push_boolean(_fun, L, TRUE);
+        if (data) {
+            memmove(data, src, size * sizeof(l_uint32));
+            return ll_push_boolean(_fun, L, TRUE);
+        }
+        data = ll_malloc<l_uint32>(_fun, L, size);
+        memcpy(data, src, size * sizeof(l_uint32));
+    } else {
+        data = ll_unpack_Uarray_2d(_fun, L, 2, wpl, h);
+    }
     /* Do not ll_free(data); it is owned by the Pix* after pixSetData() */
     return ll_push_boolean(_fun, L, 0 == pixSetData(pix, data));
 }
@@ -28268,7 +28581,7 @@ static int
 SetDepth(lua_State *L)
 {
     LL_FUNC("SetDepth");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 depth = ll_opt_l_int32(_fun, L, 2, pixGetDepth(pix));
     return ll_push_boolean(_fun, L, 0 == pixSetDepth(pix, depth));
 }
@@ -28288,7 +28601,7 @@ static int
 SetDimensions(lua_State *L)
 {
     LL_FUNC("SetDimensions");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 width = ll_opt_l_int32(_fun, L, 2, 0);
     l_int32 height = ll_opt_l_int32(_fun, L, 3, 0);
     l_int32 depth = ll_opt_l_int32(_fun, L, 4, 1);
@@ -28307,7 +28620,7 @@ static int
 SetHeight(lua_State *L)
 {
     LL_FUNC("SetHeight");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 height = ll_opt_l_int32(_fun, L, 2, pixGetHeight(pix));
     return ll_push_boolean(_fun, L, 0 == pixSetHeight(pix, height));
 }
@@ -28332,7 +28645,7 @@ static int
 SetInRect(lua_State *L)
 {
     LL_FUNC("SetInRect");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Box *box = ll_check_Box(_fun, L, 2);
     return ll_push_boolean(_fun, L, 0 == pixSetInRect(pix, box));
 }
@@ -28358,7 +28671,7 @@ static int
 SetInRectArbitrary(lua_State *L)
 {
     LL_FUNC("SetInRectArbitrary");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     Box *box = ll_check_Box(_fun, L, 2);
     l_uint32 val = ll_check_color_index(_fun, L, 3, pix);
     return ll_push_boolean(_fun, L, 0 == pixSetInRectArbitrary(pix, box, val));
@@ -28377,7 +28690,7 @@ static int
 SetInputFormat(lua_State *L)
 {
     LL_FUNC("SetInputFormat");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 format = ll_check_input_format(_fun, L, 2, IFF_UNKNOWN);
     return ll_push_boolean(_fun, L, 0 == pixSetInputFormat(pix, format));
 }
@@ -28406,8 +28719,8 @@ static int
 SetLowContrast(lua_State *L)
 {
     LL_FUNC("SetLowContrast");
-    Pix *pixs1 = ll_check_Pix(_fun, L, 1);
-    Pix *pixs2 = ll_check_Pix(_fun, L, 2);
+    Pix *pixs1 = ll_check_Pixd(_fun, L, 1);
+    Pix *pixs2 = ll_check_Pixd(_fun, L, 2);
     l_int32 mindiff = ll_check_l_int32(_fun, L, 3);
     l_int32 result = pixSetLowContrast(pixs1, pixs2, mindiff);
     return ll_push_l_int32(_fun, L, result);
@@ -28448,7 +28761,7 @@ static int
 SetMasked(lua_State *L)
 {
     LL_FUNC("SetMasked");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixm = ll_check_Pix(_fun, L, 2);
     l_uint32 val = ll_check_color_index(_fun, L, 3, pixd);
     return ll_push_boolean(_fun, L, 0 == pixSetMasked(pixd, pixm, val));
@@ -28484,7 +28797,7 @@ static int
 SetMaskedCmap(lua_State *L)
 {
     LL_FUNC("SetMaskedCmap");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Pix *pixm = ll_check_Pix(_fun, L, 2);
     l_int32 x = ll_check_l_int32(_fun, L, 3);
     l_int32 y = ll_check_l_int32(_fun, L, 4);
@@ -28529,7 +28842,7 @@ static int
 SetMaskedGeneral(lua_State *L)
 {
     LL_FUNC("SetMaskedGeneral");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixm = ll_check_Pix(_fun, L, 2);
     l_int32 x = ll_check_l_int32(_fun, L, 3);
     l_int32 y = ll_check_l_int32(_fun, L, 4);
@@ -28561,7 +28874,7 @@ static int
 SetMirroredBorder(lua_State *L)
 {
     LL_FUNC("SetMirroredBorder");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 left = ll_check_l_int32(_fun, L, 2);
     l_int32 right = ll_check_l_int32(_fun, L, 3);
     l_int32 top = ll_check_l_int32(_fun, L, 4);
@@ -28596,7 +28909,7 @@ static int
 SetOrClearBorder(lua_State *L)
 {
     LL_FUNC("SetOrClearBorder");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 left = ll_check_l_int32(_fun, L, 2);
     l_int32 right = ll_check_l_int32(_fun, L, 3);
     l_int32 top = ll_check_l_int32(_fun, L, 4);
@@ -28637,7 +28950,7 @@ static int
 SetPadBits(lua_State *L)
 {
     LL_FUNC("SetPadBits");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 val = ll_check_l_int32(_fun, L, 2);
     return ll_push_boolean(_fun, L, 0 == pixSetPadBits(pix, val));
 }
@@ -28667,7 +28980,7 @@ static int
 SetPadBitsBand(lua_State *L)
 {
     LL_FUNC("SetPadBitsBand");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 by = ll_check_l_int32(_fun, L, 2);
     l_int32 bh = ll_check_l_int32(_fun, L, 3);
     l_int32 val = ll_check_l_int32(_fun, L, 4);
@@ -28697,7 +29010,7 @@ static int
 SetPixel(lua_State *L)
 {
     LL_FUNC("SetPixel");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 x = ll_check_l_int32(_fun, L, 2);
     l_int32 y = ll_check_l_int32(_fun, L, 3);
     l_uint32 val = ll_check_color_index(_fun, L, 4, pix);
@@ -28718,7 +29031,7 @@ static int
 SetPixelColumn(lua_State *L)
 {
     LL_FUNC("SetPixelColumn");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     l_int32 col = ll_check_l_int32(_fun, L, 2);
     l_int32 rows = pixGetHeight(pixd);
     l_int32 n;
@@ -28754,7 +29067,7 @@ static int
 SetRGBComponent(lua_State *L)
 {
     LL_FUNC("SetRGBComponent");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 comp = ll_check_component(_fun, L, 3, L_ALPHA_CHANNEL);
     return ll_push_boolean(_fun, L, 0 == pixSetRGBComponent(pixd, pixs, comp));
@@ -28777,7 +29090,7 @@ static int
 SetRGBPixel(lua_State *L)
 {
     LL_FUNC("SetRGBPixel");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 x = ll_check_l_int32(_fun, L, 2);
     l_int32 y = ll_check_l_int32(_fun, L, 3);
     l_int32 rval = 0;
@@ -28801,7 +29114,7 @@ static int
 SetResolution(lua_State *L)
 {
     LL_FUNC("SetResolution");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 xres = ll_opt_l_int32(_fun, L, 2, 300);
     l_int32 yres = ll_opt_l_int32(_fun, L, 3, xres);
     return ll_push_boolean(_fun, L, 0 == pixSetResolution(pix, xres, yres));
@@ -28840,7 +29153,7 @@ static int
 SetSelectCmap(lua_State *L)
 {
     LL_FUNC("SetSelectCmap");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Box *box = ll_check_Box(_fun, L, 2);
     l_int32 sindex = ll_check_l_int32(_fun, L, 3);
     l_int32 rval = 0;
@@ -28881,7 +29194,7 @@ static int
 SetSelectMaskedCmap(lua_State *L)
 {
     LL_FUNC("SetSelectMaskedCmap");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Pix *pixm = ll_check_Pix(_fun, L, 2);
     l_int32 x = ll_check_l_int32(_fun, L, 3);
     l_int32 y = ll_check_l_int32(_fun, L, 4);
@@ -28907,7 +29220,7 @@ static int
 SetSpecial(lua_State *L)
 {
     LL_FUNC("SetSpecial");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 special = ll_check_l_int32(_fun, L, 2);
     return ll_push_boolean(_fun, L, 0 == pixSetSpecial(pix, special));
 }
@@ -28924,7 +29237,7 @@ static int
 SetSpp(lua_State *L)
 {
     LL_FUNC("SetSpp");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 spp = ll_opt_l_int32(_fun, L, 2, pixGetSpp(pix));
     return ll_push_boolean(_fun, L, 0 == pixSetSpp(pix, spp));
 }
@@ -28975,7 +29288,7 @@ static int
 SetText(lua_State *L)
 {
     LL_FUNC("SetText");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     const char* text = ll_check_string(_fun, L, 2);
     lua_pushboolean(L, pixSetText(pix, text));
     return 1;
@@ -29014,7 +29327,7 @@ static int
 SetTextblock(lua_State *L)
 {
     LL_FUNC("SetTextblock");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Bmf *bmf = ll_check_Bmf(_fun, L, 2);
     const char *textstr = ll_check_string(_fun, L, 3);
     l_uint32 val = ll_check_color_index(_fun, L, 4, pixs);
@@ -29060,7 +29373,7 @@ static int
 SetTextline(lua_State *L)
 {
     LL_FUNC("SetTextline");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Bmf *bmf = ll_check_Bmf(_fun, L, 2);
     const char *textstr = ll_check_string(_fun, L, 3);
     l_uint32 val = ll_check_color_index(_fun, L, 4, pixs);
@@ -29149,7 +29462,7 @@ static int
 SetWhite(lua_State *L)
 {
     LL_FUNC("SetWhite");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     return ll_push_boolean(_fun, L, 0 == pixSetBlackOrWhite(pix, L_SET_WHITE));
 }
 
@@ -29165,7 +29478,7 @@ static int
 SetWidth(lua_State *L)
 {
     LL_FUNC("SetWidth");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 width = ll_opt_l_int32(_fun, L, 2, pixGetWidth(pix));
     return ll_push_boolean(_fun, L, 0 == pixSetWidth(pix, width));
 }
@@ -29182,7 +29495,7 @@ static int
 SetWpl(lua_State *L)
 {
     LL_FUNC("SetWpl");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 wpl = ll_opt_l_int32(_fun, L, 2, pixGetWpl(pix));
     return ll_push_boolean(_fun, L, 0 == pixSetWpl(pix, wpl));
 }
@@ -29199,7 +29512,7 @@ static int
 SetXRes(lua_State *L)
 {
     LL_FUNC("SetXRes");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 xres = ll_opt_l_int32(_fun, L, 2, pixGetXRes(pix));
     return ll_push_boolean(_fun, L, 0 == pixSetXRes(pix, xres));
 }
@@ -29216,7 +29529,7 @@ static int
 SetYRes(lua_State *L)
 {
     LL_FUNC("SetYRes");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 yres = ll_opt_l_int32(_fun, L, 2, pixGetYRes(pix));
     return ll_push_boolean(_fun, L, 0 == pixSetYRes(pix, yres));
 }
@@ -29246,7 +29559,7 @@ static int
 SetZlibCompression(lua_State *L)
 {
     LL_FUNC("SetZlibCompression");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 compval = ll_check_l_int32(_fun, L, 2);
     l_int32 result = pixSetZlibCompression(pix, compval);
     return ll_push_l_int32(_fun, L, result);
@@ -29280,7 +29593,7 @@ static int
 SetupByteProcessing(lua_State *L)
 {
     LL_FUNC("SetupByteProcessing");
-    Pix *pix = ll_check_Pix(_fun, L, 1);
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
     l_int32 w = 0;
     l_int32 h = 0;
     if (pixSetupByteProcessing(pix, &w, &h))
@@ -29290,6 +29603,45 @@ SetupByteProcessing(lua_State *L)
     return 2;
 }
 
+/**
+ * \brief Freeze the Pix* (%pix) into a SharedPix*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Pix* (pix).
+ *
+ * The user data is turned into a SharedPix in place, i.e. all references
+ * to it in this state see the frozen Pix. The raster is not copied unless
+ * %pix is also referenced by Leptonica, e.g. by a Pixa*. A SharedPix can
+ * be passed to worker states (see Pixa:ParallelMap()) without a copy.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 SharedPix* on the Lua stack.
+ */
+static int
+Share(lua_State *L)
+{
+    LL_FUNC("Share");
+    if (ll_isudata(_fun, L, 1, LL_SHAREDPIX)) {
+        lua_pushvalue(L, 1);
+        return 1;
+    }
+    Pix **ppix = ll_check_udata<Pix>(_fun, L, 1, TNAME);
+    ll_shared_pix_t *sp;
+    if (ll_udata_borrowed(L, 1)) {
+        die(_fun, L, "can not share a %s* borrowed from the host", TNAME);
+        return 0;
+    }
+    ll_udata_release(_fun, L, 1);
+    sp = ll_share_pix(*ppix);
+    *ppix = ll_shared_pix_view(sp);
+    ll_release_shared_pix(&sp);
+    if (!*ppix)
+        return ll_push_nil(_fun, L);
+    ll_udata_retag(_fun, L, 1, LL_SHAREDPIX);
+    ll_udata_freeze(L, 1);
+    lua_pushvalue(L, 1);
+    return 1;
+}
+
 /**
  * \brief Shift and transfer alpha channel from a Pix* (%pixs) to a Pix* (%pixd).
  * <pre>
@@ -29305,7 +29657,7 @@ static int
 ShiftAndTransferAlpha(lua_State *L)
 {
     LL_FUNC("ShiftAndTransferAlpha");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 shiftx = ll_check_l_int32(_fun, L, 3);
     l_int32 shifty = ll_check_l_int32(_fun, L, 4);
@@ -29316,7 +29668,7 @@ ShiftAndTransferAlpha(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_uint32 (srcval).
  * Arg #4 is expected to be a l_uint32 (dstval).
@@ -29358,12 +29710,12 @@ static int
 ShiftByComponent(lua_State *L)
 {
     LL_FUNC("ShiftByComponent");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_uint32 srcval = ll_check_l_uint32(_fun, L, 3);
     l_uint32 dstval = ll_check_l_uint32(_fun, L, 4);
     Pix *pix = pixShiftByComponent(pixd, pixs, srcval, dstval);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -29478,7 +29830,7 @@ static int
 SmoothConnectedRegions(lua_State *L)
 {
     LL_FUNC("SmoothConnectedRegions");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Pix *pixm = ll_check_Pix(_fun, L, 2);
     l_int32 factor = ll_check_l_int32(_fun, L, 3);
     l_int32 result = pixSmoothConnectedRegions(pixs, pixm, factor);
@@ -29488,7 +29840,7 @@ SmoothConnectedRegions(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_uint32 (srcval).
  * Arg #4 is expected to be a l_uint32 (dstval).
@@ -29510,19 +29862,19 @@ static int
 SnapColor(lua_State *L)
 {
     LL_FUNC("SnapColor");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_uint32 srcval = ll_check_l_uint32(_fun, L, 3);
     l_uint32 dstval = ll_check_l_uint32(_fun, L, 4);
     l_int32 diff = ll_check_l_int32(_fun, L, 5);
     Pix *pix = pixSnapColor(pixd, pixs, srcval, dstval, diff);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_uint32 (srcval).
  * Arg #4 is expected to be a l_uint32 (dstval).
@@ -29544,13 +29896,13 @@ static int
 SnapColorCmap(lua_State *L)
 {
     LL_FUNC("SnapColorCmap");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_uint32 srcval = ll_check_l_uint32(_fun, L, 3);
     l_uint32 dstval = ll_check_l_uint32(_fun, L, 4);
     l_int32 diff = ll_check_l_int32(_fun, L, 5);
     Pix *pix = pixSnapColorCmap(pixd, pixs, srcval, dstval, diff);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -29860,6 +30212,41 @@ StereoFromPair(lua_State *L)
     return ll_push_Pix(_fun, L, pix);
 }
 
+/**
+ * \brief Decode, process and encode an image in horizontal bands of rows.
+ * <pre>
+ * Arg #1 is expected to be a string (input).
+ * Arg #2 is expected to be a string (output).
+ * Arg #3 is expected to be a PixPipeline* or a function (process).
+ * Arg #4 is an optional table of options (opts).
+ *
+ * For images too large for memory: only one band of the image is decoded,
+ * processed and encoded at a time (see lualept-stream.cpp). Formats are
+ * PNM, and PNG, JPEG, TIFF if the libraries were found when building.
+ *
+ * A function is called as process(band, y, top) for each band, with the
+ * band's first row %y in the image and the number of halo rows at its top,
+ * and must return a Pix* of the band's size.
+ *
+ * Options:
+ *   rows       number of rows of a band (default 256)
+ *   halo       rows above and below a band which the processing looks at
+ *              (default: PixPipeline:GetHalo(), resp. 0 for a function)
+ *   format     output format name (default: from the output file name)
+ *   quality    JPEG quality (default 75)
+ * </pre>
+ * \param L Lua state.
+ * \return 1 boolean on the Lua stack.
+ */
+static int
+StreamBands(lua_State *L)
+{
+    LL_FUNC("StreamBands");
+    const char *input = ll_check_string(_fun, L, 1);
+    const char *output = ll_check_string(_fun, L, 2);
+    return ll_push_boolean(_fun, L, ll_stream_bands(_fun, L, input, output, 3, 4));
+}
+
 /**
  * \brief Brief comment goes here.
  * <pre>
@@ -30035,7 +30422,7 @@ SubsampleBoundaryPixels(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs1).
  * Arg #3 is expected to be a Pix* (pixs2).
  *
@@ -30058,11 +30445,11 @@ static int
 SubtractGray(lua_State *L)
 {
     LL_FUNC("SubtractGray");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs1 = ll_check_Pix(_fun, L, 2);
     Pix *pixs2 = ll_check_Pix(_fun, L, 3);
     Pix *pix = pixSubtractGray(pixd, pixs1, pixs2);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -30108,8 +30495,8 @@ SwapAndDestroy(lua_State *L)
     LL_FUNC("SwapAndDestroy");
     Pix **ppixd = ll_check_udata<Pix>(_fun, L, 1, LL_PIX);
     Pix **ppixs = ll_check_udata<Pix>(_fun, L, 2, LL_PIX);
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
-    Pix *pixs = ll_check_Pix(_fun, L, 2);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 2);
     lua_pushboolean(L, 0 == pixSwapAndDestroy(&pixd, &pixs));
     *ppixd = pixd;
     *ppixs = pixs;
@@ -30141,7 +30528,7 @@ static int
 TRCMap(lua_State *L)
 {
     LL_FUNC("TRCMap");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     Pix *pixm = ll_check_Pix(_fun, L, 2);
     Numa *na = ll_check_Numa(_fun, L, 3);
     l_int32 result = pixTRCMap(pixs, pixm, na);
@@ -30790,7 +31177,7 @@ ThresholdToBinary(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (threshval).
  * Arg #4 is expected to be a l_int32 (setval).
@@ -30808,12 +31195,32 @@ static int
 ThresholdToValue(lua_State *L)
 {
     LL_FUNC("ThresholdToValue");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 threshval = ll_check_l_int32(_fun, L, 3);
     l_int32 setval = ll_check_l_int32(_fun, L, 4);
     Pix *pix = pixThresholdToValue(pixd, pixs, threshval, setval);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
+}
+
+/**
+ * \brief Iterate over the pages of a multipage TIFF file (%filename).
+ * <pre>
+ * Arg #1 is expected to be a string (filename).
+ * Arg #2 is an optional l_int32 (prefetch), the number of pages decoded ahead.
+ *
+ * Returns a TiffPages* to be used in a generic for loop:
+ *   for pix, idx in Pix.TiffPages(filename [, prefetch]) do ... end
+ * The file is mapped once and decoded one page per iteration,
+ * optionally on a background thread (see lltiffpages.cpp).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 TiffPages* on the Lua stack, or nil if the file can not be read.
+ */
+static int
+TiffPages(lua_State *L)
+{
+    return ll_new_TiffPages(L);
 }
 
 /**
@@ -30981,7 +31388,7 @@ static int
 TilingPaintTile(lua_State *L)
 {
     LL_FUNC("TilingPaintTile");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
     l_int32 i = ll_check_l_int32(_fun, L, 2);
     l_int32 j = ll_check_l_int32(_fun, L, 3);
     Pix *pixs = ll_check_Pix(_fun, L, 4);
@@ -31079,8 +31486,8 @@ TransferAllData(lua_State *L)
 {
     LL_FUNC("TransferAllData");
     Pix **ppixs = ll_check_udata<Pix>(_fun, L, 2, LL_PIX);
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
-    Pix *pixs = ll_check_Pix(_fun, L, 2);
+    Pix *pixd = ll_check_Pixd(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 2);
     int copytext = ll_opt_boolean(_fun, L, 3, TRUE);
     int copyformat = ll_opt_boolean(_fun, L, 4, TRUE);
     lua_pushboolean(L, 0 == pixTransferAllData(pixd, &pixs, copytext, copyformat));
@@ -31091,7 +31498,7 @@ TransferAllData(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (hshift).
  * Arg #4 is expected to be a l_int32 (vshift).
@@ -31114,13 +31521,13 @@ static int
 Translate(lua_State *L)
 {
     LL_FUNC("Translate");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 hshift = ll_check_l_int32(_fun, L, 3);
     l_int32 vshift = ll_check_l_int32(_fun, L, 4);
     l_int32 incolor = ll_check_set_black_white(_fun, L, 5);
     Pix *pix = pixTranslate(pixd, pixs, hshift, vshift, incolor);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -31212,6 +31619,7 @@ UnpackBinary(lua_State *L)
  * Arg #1 (i.e. self) is expected to be a Pix* (pixs).
  * Arg #2 is expected to be a l_int32 (halfwidth).
  * Arg #3 is expected to be a l_float32 (fract).
+ * Arg #4 is an optional table with options ({threads=n}).
  *
  * Leptonica's Notes:
  *      (1) We use symmetric smoothing filters of odd dimension,
@@ -31231,7 +31639,13 @@ UnsharpMasking(lua_State *L)
     Pix *pixs = ll_check_Pix(_fun, L, 1);
     l_int32 halfwidth = ll_check_l_int32(_fun, L, 2);
     l_float32 fract = ll_check_l_float32(_fun, L, 3);
-    Pix *pix = pixUnsharpMasking(pixs, halfwidth, fract);
+    l_int32 nthreads = ll_opt_threads(_fun, L, 4);
+    Pix *pix = nullptr;
+    if (ll_run_bands(pixs, halfwidth + 1, nthreads, 1, &pix, [=](Pix *band, Pix **out) {
+            out[0] = pixUnsharpMasking(band, halfwidth, fract);
+            return out[0] ? 0 : 1;
+        }))
+        pix = pixUnsharpMasking(pixs, halfwidth, fract);
     return ll_push_Pix(_fun, L, pix);
 }
 
@@ -31579,7 +31993,7 @@ UsesCmapColor(lua_State *L)
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_int32 (xloc).
  * Arg #4 is expected to be a l_float32 (radang).
@@ -31618,19 +32032,19 @@ static int
 VShear(lua_State *L)
 {
     LL_FUNC("VShear");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_int32 xloc = ll_check_l_int32(_fun, L, 3);
     l_float32 radang = ll_check_l_float32(_fun, L, 4);
     l_int32 incolor = ll_check_set_black_white(_fun, L, 5);
     Pix *pix = pixVShear(pixd, pixs, xloc, radang, incolor);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_float32 (radang).
  * Arg #4 is expected to be a string descibing black or white (incolor).
@@ -31647,18 +32061,18 @@ static int
 VShearCenter(lua_State *L)
 {
     LL_FUNC("VShearCenter");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_float32 radang = ll_check_l_float32(_fun, L, 3);
     l_int32 incolor = ll_check_set_black_white(_fun, L, 4);
     Pix *pix = pixVShearCenter(pixd, pixs, radang, incolor);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
  * \brief Brief comment goes here.
  * <pre>
- * Arg #1 (i.e. self) is expected to be a Pix* (pixd).
+ * Arg #1 (i.e. self) is expected to be a Pix* (pixd) or nil.
  * Arg #2 is expected to be a Pix* (pixs).
  * Arg #3 is expected to be a l_float32 (radang).
  * Arg #4 is expected to be a string descibing black or white (incolor).
@@ -31675,12 +32089,12 @@ static int
 VShearCorner(lua_State *L)
 {
     LL_FUNC("VShearCorner");
-    Pix *pixd = ll_check_Pix(_fun, L, 1);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 1);
     Pix *pixs = ll_check_Pix(_fun, L, 2);
     l_float32 radang = ll_check_l_float32(_fun, L, 3);
     l_int32 incolor = ll_check_set_black_white(_fun, L, 4);
     Pix *pix = pixVShearCorner(pixd, pixs, radang, incolor);
-    return ll_push_Pix(_fun, L, pix);
+    return ll_push_Pixd(_fun, L, 1, pix);
 }
 
 /**
@@ -31706,7 +32120,7 @@ static int
 VShearIP(lua_State *L)
 {
     LL_FUNC("VShearIP");
-    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    Pix *pixs = ll_check_Pixd(_fun, L, 1);
     l_int32 xloc = ll_check_l_int32(_fun, L, 2);
     l_float32 radang = ll_check_l_float32(_fun, L, 3);
     l_int32 incolor = ll_check_set_black_white(_fun, L, 4);
@@ -32979,7 +33393,7 @@ WriteStream(lua_State *L)
 {
     LL_FUNC("WriteStream");
     Pix *pix = ll_check_Pix(_fun, L, 1);
-    luaL_Stream *stream = ll_check_stream(_fun, L, 1);
+    luaL_Stream *stream = ll_check_stream(_fun, L, 2);
     l_int32 format = ll_check_input_format(_fun, L, 3, IFF_DEFAULT);
     return ll_push_boolean(_fun, L, 0 == pixWriteStream(stream->f, pix, format));
 }
@@ -33519,6 +33933,122 @@ WriteTiffCustom(lua_State *L)
     return ll_push_boolean(_fun, L, 0 == pixWriteTiffCustom(filename, pix, comptype, modestr, natags, savals, satypes, nasizes));
 }
 
+/**
+ * \brief Write the Pix* (%pix) to a sink (%sink) while it is encoded.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Pix* (pix).
+ * Arg #2 is expected to be a function or a luaL_Stream* (sink).
+ * Arg #3 is an optional string with the input format name (format).
+ * Arg #4 is an optional table of options (opts).
+ *
+ * A function is called with each chunk of the encoded data as a string,
+ * as soon as it is produced; an io handle is written to directly. This
+ * avoids the complete file in memory twice, as with WriteMem().
+ *
+ * Options, where they apply to the format:
+ *   quality      JPEG or WebP quality (default 75 resp. 80)
+ *   progressive  boolean, progressive JPEG
+ *   lossless     boolean, lossless WebP
+ *   gamma        PNG gamma (default 0.0, none)
+ *   res          PDF resolution (default 0, 300 ppi)
+ *   title        PDF title
+ *   chunk        size of the chunks passed to a function (default 65536)
+ *
+ * TIFF needs to seek in its output, so it is encoded in memory first and
+ * then passed to the sink in chunks.
+ * While it is written, %pix is pinned: a sink function using it, e.g.
+ * calling pix:Release(), raises an error.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 boolean on the Lua stack.
+ */
+static int
+WriteTo(lua_State *L)
+{
+    LL_FUNC("WriteTo");
+    Pix *pix = ll_check_Pix(_fun, L, 1);
+    l_int32 format = ll_check_input_format(_fun, L, 3, IFF_DEFAULT);
+    l_int32 quality = 0;
+    l_int32 progressive = FALSE;
+    l_int32 lossless = FALSE;
+    l_float32 gamma = 0.0f;
+    l_int32 res = 0;
+    const char *title = nullptr;
+    size_t chunk = 0;
+    ll_sink_t sink;
+    FILE *fp = nullptr;
+    l_int32 result = 1;
+
+    if (LUA_TTABLE == lua_type(L, 4)) {
+        if (LUA_TNIL != lua_getfield(L, 4, "quality"))
+            quality = ll_check_l_int32(_fun, L, -1);
+        lua_pop(L, 1);
+        if (LUA_TNIL != lua_getfield(L, 4, "progressive"))
+            progressive = lua_toboolean(L, -1) ? TRUE : FALSE;
+        lua_pop(L, 1);
+        if (LUA_TNIL != lua_getfield(L, 4, "lossless"))
+            lossless = lua_toboolean(L, -1) ? TRUE : FALSE;
+        lua_pop(L, 1);
+        if (LUA_TNIL != lua_getfield(L, 4, "gamma"))
+            gamma = ll_check_l_float32(_fun, L, -1);
+        lua_pop(L, 1);
+        if (LUA_TNIL != lua_getfield(L, 4, "res"))
+            res = ll_check_l_int32(_fun, L, -1);
+        lua_pop(L, 1);
+        /* the string stays referenced by the table */
+        if (LUA_TNIL != lua_getfield(L, 4, "title"))
+            title = ll_check_string(_fun, L, -1);
+        lua_pop(L, 1);
+        if (LUA_TNIL != lua_getfield(L, 4, "chunk"))
+            chunk = ll_check_size_t(_fun, L, -1);
+        lua_pop(L, 1);
+    }
+
+    if (IFF_DEFAULT == format)
+        format = pixChooseOutputFormat(pix);
+    fp = ll_open_sink(_fun, L, 2, &sink, chunk);
+    /* a sink function must not Release() or modify %pix while it is encoded */
+    ll_udata_pin(L, 1, true);
+    sink.pinned = 1;
+
+    switch (format) {
+    case IFF_JFIF_JPEG:
+        result = pixWriteStreamJpeg(fp, pix, quality ? quality : 75, progressive);
+        break;
+    case IFF_WEBP:
+        result = pixWriteStreamWebP(fp, pix, quality ? quality : 80, lossless);
+        break;
+    case IFF_PNG:
+        result = pixWriteStreamPng(fp, pix, gamma);
+        break;
+    case IFF_LPDF:
+        result = pixWriteStreamPdf(fp, pix, res, title);
+        break;
+    case IFF_TIFF:
+    case IFF_TIFF_PACKBITS:
+    case IFF_TIFF_RLE:
+    case IFF_TIFF_G3:
+    case IFF_TIFF_G4:
+    case IFF_TIFF_LZW:
+    case IFF_TIFF_ZIP:
+        {
+            l_uint8 *data = nullptr;
+            size_t size = 0;
+            result = pixWriteMemTiff(&data, &size, pix, format);
+            if (!result && !ll_write_sink(&sink, data, size))
+                result = 1;
+            ll_free(data);
+        }
+        break;
+    default:
+        result = pixWriteStream(fp, pix, format);
+    }
+
+    if (!ll_close_sink(_fun, L, &sink))
+        result = 1;
+    return ll_push_boolean(_fun, L, 0 == result);
+}
+
 /**
  * \brief Brief comment goes here.
  * <pre>
@@ -33581,6 +34111,9 @@ Zero(lua_State *L)
 Pix *
 ll_check_Pix(const char *_fun, lua_State *L, int arg)
 {
+    /* a SharedPix is accepted read-only (see llsharedpix.cpp) */
+    if (!ll_isudata(_fun, L, arg, TNAME) && ll_isudata(_fun, L, arg, LL_SHAREDPIX))
+        return ll_check_SharedPix(_fun, L, arg);
     return *ll_check_udata<Pix>(_fun, L, arg, TNAME);
 }
 
@@ -33594,7 +34127,7 @@ ll_check_Pix(const char *_fun, lua_State *L, int arg)
 Pix *
 ll_opt_Pix(const char *_fun, lua_State *L, int arg)
 {
-    if (!ll_isudata(_fun, L, arg, TNAME))
+    if (!ll_isudata(_fun, L, arg, TNAME) && !ll_isudata(_fun, L, arg, LL_SHAREDPIX))
 	return nullptr;
     return ll_check_Pix(_fun, L, arg);
 }
@@ -33610,7 +34143,77 @@ ll_push_Pix(const char *_fun, lua_State *L, Pix *pix)
 {
     if (!pix)
 	return ll_push_nil(_fun, L);
-    return ll_push_udata(_fun, L, TNAME, pix);
+    /* a view of a shared raster, e.g. a clone of a SharedPix, stays read-only */
+    if (ll_is_shared_raster(pixGetData(pix))) {
+	ll_push_udata(_fun, L, LL_SHAREDPIX, pix);
+	ll_udata_freeze(L, -1);
+	return 1;
+    }
+    size_t bytes = static_cast<size_t>(pixGetWpl(pix)) * static_cast<size_t>(pixGetHeight(pix)) * sizeof(l_uint32);
+    return ll_push_udata(_fun, L, TNAME, pix, bytes);
+}
+
+/**
+ * \brief Check Lua stack at index %arg for a Pix* which may be modified.
+ * <pre>
+ * Bindings which modify their Pix* in place use this instead of ll_check_Pix().
+ * A user data marked read-only (LL_UDATA_READONLY), i.e. a SharedPix, is refused.
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the Pix* contained in the user data.
+ */
+Pix *
+ll_check_Pixd(const char *_fun, lua_State *L, int arg)
+{
+    if (ll_udata_readonly(L, arg)) {
+        die(_fun, L, "user data at #%d is read-only; use its Copy()", arg);
+        return nullptr;
+    }
+    return *ll_check_udata<Pix>(_fun, L, arg, TNAME);
+}
+
+/**
+ * \brief Optionally expect a destination Pix* at index (%arg) on the Lua stack.
+ * <pre>
+ * Many Leptonica functions write their result to an existing Pix* (pixd),
+ * or to the source itself if pixd == pixs (in-place), instead of a new one.
+ * A SharedPix is read-only and is not accepted as destination.
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data, or nil
+ * \return pointer to the Pix* contained in the user data, or nullptr.
+ */
+Pix *
+ll_opt_Pixd(const char *_fun, lua_State *L, int arg)
+{
+    if (lua_isnoneornil(L, arg))
+        return nullptr;
+    return ll_check_Pixd(_fun, L, arg);
+}
+
+/**
+ * \brief Push the Pix* (%pix) resulting from a function with a destination at index (%arg).
+ * <pre>
+ * If the result is the destination Pix*, its user data is pushed again,
+ * instead of a second user data owning the same Pix*.
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index of the destination Pix* (see ll_opt_Pixd())
+ * \param pix pointer to the resulting Pix*
+ * \return 1 Pix* on the Lua stack.
+ */
+int
+ll_push_Pixd(const char *_fun, lua_State *L, int arg, Pix *pix)
+{
+    if (pix && ll_isudata(_fun, L, arg, TNAME) && pix == *ll_check_udata<Pix>(_fun, L, arg, TNAME)) {
+        lua_pushvalue(L, arg);
+        return 1;
+    }
+    return ll_push_Pix(_fun, L, pix);
 }
 /**
  * \brief Create and push a new Pix*.
@@ -33747,6 +34350,7 @@ ll_open_Pix(lua_State *L)
 	{"ApplyInvBackgroundRGBMap",        ApplyInvBackgroundRGBMap},
 	{"ApplyVariableGrayMap",            ApplyVariableGrayMap},
 	{"AssignToNearestColor",            AssignToNearestColor},
+	{"Async",                           Async},
 	{"AverageByColumn",                 AverageByColumn},
 	{"AverageByRow",                    AverageByRow},
 	{"AverageInRect",                   AverageInRect},
@@ -34306,6 +34910,7 @@ ll_open_Pix(lua_State *L)
 	{"PaintBoxaRandom",                 PaintBoxaRandom},
 	{"PaintSelfThroughMask",            PaintSelfThroughMask},
 	{"PaintThroughMask",                PaintThroughMask},
+	{"Pipeline",                        Pipeline},
 	{"PlotAlongPta",                    PlotAlongPta},
 	{"Prepare1bpp",                     Prepare1bpp},
 	{"PrintStreamInfo",                 PrintStreamInfo},
@@ -34343,12 +34948,14 @@ ll_open_Pix(lua_State *L)
 	{"Read",                            Read},
 	{"ReadBarcodeWidths",               ReadBarcodeWidths},
 	{"ReadBarcodes",                    ReadBarcodes},
+	{"ReadFrom",                        ReadFrom},
 	{"ReadFromMultipageTiff",           ReadFromMultipageTiff},
 	{"ReadHeader",                      ReadHeader},
 	{"ReadHeaderMem",                   ReadHeaderMem},
 	{"ReadIndexed",                     ReadIndexed},
 	{"ReadJp2k",                        ReadJp2k},
 	{"ReadJpeg",                        ReadJpeg},
+	{"ReadMapped",                      ReadMapped},
 	{"ReadMem",                         ReadMem},
 	{"ReadMemBmp",                      ReadMemBmp},
 	{"ReadMemFromMultipageTiff",        ReadMemFromMultipageTiff},
@@ -34565,6 +35172,7 @@ ll_open_Pix(lua_State *L)
 	{"SetYRes",                         SetYRes},
 	{"SetZlibCompression",              SetZlibCompression},
 	{"SetupByteProcessing",             SetupByteProcessing},
+	{"Share",                           Share},
 	{"ShiftAndTransferAlpha",           ShiftAndTransferAlpha},
 	{"ShiftByComponent",                ShiftByComponent},
 	{"SimpleCaptcha",                   SimpleCaptcha},
@@ -34580,6 +35188,7 @@ ll_open_Pix(lua_State *L)
 	{"SplitIntoBoxa",                   SplitIntoBoxa},
 	{"SplitIntoCharacters",             SplitIntoCharacters},
 	{"StereoFromPair",                  StereoFromPair},
+	{"StreamBands",                     StreamBands},
 	{"StretchHorizontal",               StretchHorizontal},
 	{"StretchHorizontalLI",             StretchHorizontalLI},
 	{"StretchHorizontalSampled",        StretchHorizontalSampled},
@@ -34604,6 +35213,7 @@ ll_open_Pix(lua_State *L)
 	{"ThresholdTo4bpp",                 ThresholdTo4bpp},
 	{"ThresholdToBinary",               ThresholdToBinary},
 	{"ThresholdToValue",                ThresholdToValue},
+	{"TiffPages",                       TiffPages},
 	{"TilingCreate",                    TilingCreate},
 	{"TilingDestroy",                   TilingDestroy},
 	{"TilingGetCount",                  TilingGetCount},
@@ -34689,6 +35299,7 @@ ll_open_Pix(lua_State *L)
 	{"WriteStringPS",                   WriteStringPS},
 	{"WriteTiff",                       WriteTiff},
 	{"WriteTiffCustom",                 WriteTiffCustom},
+	{"WriteTo",                         WriteTo},
 	{"WriteWebP",                       WriteWebP},
 	{"Xor",                             Xor},
 	{"Zero",                            Zero},
@@ -31,6 +31,9 @@
 
 #include "modules.h"
 
+#include <unordered_set>
+#include <vector>
+
 /**
  * \file llpixa.cpp
  * \class Pixa
@@ -230,6 +233,8 @@ AddBox(lua_State *L)
     Pixa *pixa = ll_check_Pixa(_fun, L, 1);
     Box *box = ll_check_Box(_fun, L, 2);
     l_int32 copyflag = ll_check_access_storage(_fun, L, 3);
+    if (L_INSERT == copyflag)
+        box = ll_take_owned<Box>(_fun, L, 2, LL_BOX);    /* the container owns it now */
     l_ok ok = pixaAddBox(pixa, box, copyflag);
     return ll_push_boolean(_fun, L, 0 == ok);
 }
@@ -250,6 +255,8 @@ AddPix(lua_State *L)
     Pixa *pixa = ll_check_Pixa(_fun, L, 1);
     Pix *pix = ll_check_Pix(_fun, L, 2);
     l_int32 flag = ll_check_access_storage(_fun, L, 3, L_COPY);
+    if (L_INSERT == flag)
+        pix = ll_take_owned<Pix>(_fun, L, 2, LL_PIX);    /* the container owns it now */
     return ll_push_boolean(_fun, L, 0 == pixaAddPix(pixa, pix, flag));
 }
 
@@ -398,6 +405,28 @@ AnyColormaps(lua_State *L)
     return 1;
 }
 
+/**
+ * \brief Run a method of the Pixa* (%pixa) on a background thread.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Pixa* (pixa).
+ * Arg #2 is expected to be a string (method).
+ * Arg #3 and following are optional arguments of the method.
+ *
+ * The method runs in a worker state of its own. %pixa and the other
+ * objects in the arguments are pinned until the call is awaited (see
+ * Future); a Pixa* whose Pix* have clones outside of it must be copied.
+ * Returns a Future*; Future:Await() returns the results of the method.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 Future* on the Lua stack.
+ */
+static int
+Async(lua_State *L)
+{
+    LL_FUNC("Async");
+    return ll_async(_fun, L, TNAME);
+}
+
 /**
  * \brief BinSort() brief comment goes here.
  * <pre>
@@ -1280,6 +1309,151 @@ Join(lua_State *L)
     return ll_push_boolean(_fun, L, 0 == pixaJoin(pixad, pixas, istart, iend));
 }
 
+/**
+ * \brief Context of ParallelMap() for the worker callbacks.
+ */
+typedef struct map_ctx_s {
+    std::vector<Pix *>  in;         /*!< input Pix* (clones), moved to the workers */
+    std::vector<Pix *>  src;        /*!< input Pix* pointers, to detect results which are the input */
+    std::vector<Pix *>  out;        /*!< result Pix*, taken from the workers */
+    ll_worker_args_t    args;       /*!< extra arguments for %fn */
+}   map_ctx_t;
+
+/**
+ * \brief Push the Pix* and the index of job %idx to the worker state %W.
+ * \param W worker Lua state.
+ * \param idx index of the job
+ * \param ctx pointer to the map_ctx_t
+ * \return 2 values on the Lua stack.
+ */
+static int
+map_push(lua_State *W, l_int32 idx, void *ctx)
+{
+    FUNC("Pixa.ParallelMap");
+    map_ctx_t *map = reinterpret_cast<map_ctx_t *>(ctx);
+    ll_push_Pix(_fun, W, map->in[idx]);
+    map->in[idx] = nullptr;
+    /* the Pix* is also in the caller's Pixa*, so it must not be modified */
+    ll_udata_freeze(W, -1);
+    ll_push_l_int32(_fun, W, idx + 1);
+    return 2;
+}
+
+/**
+ * \brief Take the Pix* result of job %idx from the worker state %W.
+ * \param W worker Lua state.
+ * \param idx index of the job
+ * \param ctx pointer to the map_ctx_t
+ */
+static void
+map_take(lua_State *W, l_int32 idx, void *ctx)
+{
+    FUNC("Pixa.ParallelMap");
+    map_ctx_t *map = reinterpret_cast<map_ctx_t *>(ctx);
+    if (!ll_isudata(_fun, W, -1, LL_PIX)) {
+        die(_fun, W, "function returned %s instead of a Pix", luaL_typename(W, -1));
+        return;
+    }
+    map->out[idx] = ll_take_udata<Pix>(_fun, W, -1, LL_PIX);
+    if (map->out[idx] && map->out[idx] == map->src[idx]) {
+        /* the input itself (or a clone of it) was returned */
+        Pix *pix = pixCopy(nullptr, map->out[idx]);
+        pixDestroy(&map->out[idx]);
+        map->out[idx] = pix;
+    }
+}
+
+/**
+ * \brief Run a Lua function for each Pix* of the Pixa* (%pixa) on worker threads.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a Pixa* (pixa).
+ * Arg #2 is expected to be a Lua function, a chunk string or a Pix method (fn).
+ * Arg #3 is an optional l_int32 (nthreads); default is the number of cores.
+ * Arg #4 and following are optional values passed to %fn (...).
+ *
+ * Each worker thread runs its own Lua state, so %fn is passed as bytecode
+ * and can not use local variables of the calling scope (upvalues).
+ * %fn is called as fn(pix, i, ...) for each index i and must return a Pix*.
+ * The extra values can be nil, booleans, numbers, strings, SharedPix*,
+ * Channel*, SharedQueue* or SharedStack*, e.g. a template shared with
+ * Pix:Share() instead of a copy per worker, or a Channel* to send further
+ * results to the caller.
+ * ParallelMap() returns only after all calls, so the caller can not drain
+ * a Channel* while the workers send: a Send() to a full channel waits
+ * forever. Give the channel a capacity for all values sent, or use
+ * TrySend() in %fn and handle false, "full".
+ * The Pix* are passed to the workers as clones, not copied; a Pix* which
+ * occurs more than once in %pixa is copied, because reference counts are
+ * not thread safe. The clones are read-only, so %fn can not modify the
+ * Pix* of %pixa in place; it works on a pix:Copy() instead. A result which
+ * is the input Pix* itself, e.g. a clone, is copied, so that the new Pixa*
+ * never shares a Pix* with %pixa.
+ * The results are returned in a new Pixa* in order.
+ * An error in any call stops the workers and reports the failing index.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 Pixa* on the Lua stack.
+ */
+static int
+ParallelMap(lua_State *L)
+{
+    LL_FUNC("ParallelMap");
+    Pixa *pixa = ll_check_Pixa(_fun, L, 1);
+    l_int32 n = pixaGetCount(pixa);
+    l_int32 nthreads = ll_worker_count(ll_opt_l_int32(_fun, L, 3, 0), n);
+    char msg[256];
+    ll_bytes_t chunk;
+    ll_worker_job_t job;
+    map_ctx_t *map;
+    Pixa *pixad;
+    l_int32 i;
+
+    /* check the arguments and the function before anything is allocated */
+    ll_check_args(_fun, L, 4);
+    ll_dump_chunk(_fun, L, 2, LL_PIX, &chunk);
+    map = new map_ctx_t;
+    ll_capture_args(_fun, L, 4, &map->args);
+    map->in.resize(n, nullptr);
+    map->src.resize(n, nullptr);
+    map->out.resize(n, nullptr);
+    std::unordered_set<Pix *> seen;
+    for (i = 0; i < n; i++) {
+        Pix *pix = pixaGetPix(pixa, i, L_CLONE);
+        if (pix && !seen.insert(pix).second) {
+            Pix *copy = pixCopy(nullptr, pix);
+            pixDestroy(&pix);
+            pix = copy;
+        }
+        map->in[i] = pix;
+        map->src[i] = pix;
+    }
+    std::unordered_set<Pix *>().swap(seen);
+
+    job.push = map_push;
+    job.take = map_take;
+    job.ctx = map;
+    job.args = &map->args;
+
+    int res = ll_run_workers(&chunk, n, nthreads, &job, msg, sizeof(msg));
+    ll_free(chunk.data);
+
+    pixad = res ? nullptr : pixaCreate(n);
+    for (i = 0; i < n; i++) {
+        pixDestroy(&map->in[i]);
+        if (pixad)
+            pixaAddPix(pixad, map->out[i], L_INSERT);
+        else
+            pixDestroy(&map->out[i]);
+    }
+    ll_free_args(&map->args);
+    delete map;
+    if (res) {
+        die(_fun, L, "%s", msg);
+        return 0;
+    }
+    return ll_push_Pixa(_fun, L, pixad);
+}
+
 /**
  * \brief Read a Pixa* from an external file.
  * <pre>
@@ -1354,6 +1528,39 @@ ReadFiles(lua_State *L)
     return ll_push_Pixa(_fun, L, pixa);
 }
 
+/**
+ * \brief Read a Pixa* (%pixa) from a number of memory mapped files.
+ * <pre>
+ * Arg #1 is expected to be a string containing the directory (dirname).
+ * Arg #2 is an optional string (substr).
+ *
+ * Like Pixa.ReadFiles(), but every file is mapped read-only and decoded
+ * from memory, one at a time (see lualept-mapped.cpp). Files which can not
+ * be read are skipped.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 Pixa* on the Lua stack.
+ */
+static int
+ReadMappedFiles(lua_State *L)
+{
+    LL_FUNC("ReadMappedFiles");
+    const char *dirname = ll_check_string(_fun, L, 1);
+    const char *substr = ll_opt_string(_fun, L, 2);
+    Sarray *sa = getSortedPathnamesInDirectory(dirname, substr, 0, 0);
+    l_int32 n = sa ? sarrayGetCount(sa) : 0;
+    Pixa *pixa = sa ? pixaCreate(n) : nullptr;
+
+    for (l_int32 i = 0; pixa && i < n; i++) {
+        const char *filename = sarrayGetString(sa, i, L_NOCOPY);
+        Pix *pix = ll_read_mapped_pix(_fun, L, filename);
+        if (pix)
+            pixaAddPix(pixa, pix, L_INSERT);
+    }
+    sarrayDestroy(&sa);
+    return ll_push_Pixa(_fun, L, pixa);
+}
+
 /**
  * \brief Read a Pixa* from a Lua string (%data).
  * <pre>
@@ -1605,7 +1812,16 @@ ll_push_Pixa(const char *_fun, lua_State *L, Pixa *pixa)
 {
     if (!pixa)
         return ll_push_nil(_fun, L);
-    return ll_push_udata(_fun, L, TNAME, pixa);
+    size_t bytes = 0;
+    /* a clone's rasters are accounted by the user data that pushed it first */
+    if (pixa->refcount <= 1) {
+        for (l_int32 i = 0; i < pixa->n; i++) {
+            const Pix *pix = pixa->pix[i];
+            if (pix)
+                bytes += static_cast<size_t>(pix->wpl) * static_cast<size_t>(pix->h) * sizeof(l_uint32);
+        }
+    }
+    return ll_push_udata(_fun, L, TNAME, pixa, bytes);
 }
 
 /**
@@ -1707,6 +1923,7 @@ ll_open_Pixa(lua_State *L)
         {"AddTextNumber",               AddTextNumber},
         {"AddTextlines",                AddTextlines},
         {"AnyColormaps",                AnyColormaps},
+        {"Async",                       Async},
         {"BinSort",                     BinSort},
         {"Centroids",                   Centroids},
         {"ChangeRefcount",              ChangeRefcount},
@@ -1740,9 +1957,11 @@ ll_open_Pixa(lua_State *L)
         {"InsertPix",                   InsertPix},
         {"Interleave",                  Interleave},
         {"Join",                        Join},
+        {"ParallelMap",                 ParallelMap},
         {"Read",                        Read},
         {"ReadBarcodes",                ReadBarcodes},
         {"ReadFiles",                   ReadFiles},
+        {"ReadMappedFiles",             ReadMappedFiles},
         {"ReadMem",                     ReadMem},
         {"ReadStream",                  ReadStream},
         {"RemovePix",                   RemovePix},
@@ -151,6 +151,8 @@ AddBox(lua_State *L)
     Pixaa *pixaa = ll_check_Pixaa(_fun, L, 1);
     Box *box = ll_check_Box(_fun, L, 2);
     l_int32 copyflag = ll_check_access_storage(_fun, L, 3, L_COPY);
+    if (L_INSERT == copyflag)
+        box = ll_take_owned<Box>(_fun, L, 2, LL_BOX);    /* the container owns it now */
     return ll_push_boolean(_fun, L, 0 == pixaaAddBox(pixaa, box, copyflag));
 }
 
@@ -175,6 +177,11 @@ AddPix(lua_State *L)
     Pix *pix = ll_check_Pix(_fun, L, 3);
     Box *box = ll_check_Box(_fun, L, 4);
     l_int32 copyflag = ll_check_access_storage(_fun, L, 5, L_COPY);
+    if (L_INSERT == copyflag) {
+        /* the container owns them now */
+        pix = ll_take_owned<Pix>(_fun, L, 3, LL_PIX);
+        box = ll_take_owned<Box>(_fun, L, 4, LL_BOX);
+    }
     return ll_push_boolean(_fun, L, 0 == pixaaAddPix(pixaa, idx, pix, box, copyflag));
 }
 
@@ -195,6 +202,8 @@ AddPixa(lua_State *L)
     Pixaa *pixaa = ll_check_Pixaa(_fun, L, 1);
     Pixa *pixa = ll_check_Pixa(_fun, L, 2);
     l_int32 flag = ll_check_access_storage(_fun, L, 3, L_COPY);
+    if (L_INSERT == flag)
+        pixa = ll_take_owned<Pixa>(_fun, L, 2, LL_PIXA);    /* the container owns it now */
     return ll_push_boolean(_fun, L, 0 == pixaaAddPixa(pixaa, pixa, flag));
 }
 
@@ -0,0 +1,564 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+/**
+ * \file llpixelbuffer.cpp
+ * \class PixelBuffer
+ *
+ * A view into the raster data of a Pix.
+ *
+ * The PixelBuffer holds a reference (clone) of the Pix it was created
+ * from and accesses the raster words in place, i.e. no data is copied.
+ * Words are indexed 1-based like a Lua array, pixels and rows are
+ * addressed 0-based like in the Pix methods.
+ */
+
+/** Set TNAME to the class name used in this source file */
+#define TNAME LL_PIXELBUFFER
+
+/** Define a function's name (_fun) with prefix PixelBuffer */
+#define LL_FUNC(x) FUNC(TNAME "." x)
+
+/**
+ * \brief Return a pointer to the first word of the PixelBuffer* (%buf).
+ * The pointer is fetched from the Pix* on every access, so that a view
+ * never refers to raster data which was replaced, e.g. by Pix:SetData().
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param buf pointer to the PixelBuffer
+ * \return pointer to the l_uint32 words of the view.
+ */
+static l_uint32 *
+ll_buffer_data(const char *_fun, lua_State *L, PixelBuffer *buf)
+{
+    l_uint32 *data = pixGetData(buf->pix);
+    if (!data || pixGetWpl(buf->pix) != buf->wpl || pixGetHeight(buf->pix) < buf->y0 + buf->h) {
+        die(_fun, L, "stale %s* %p (raster of Pix* %p has changed)",
+            TNAME, reinterpret_cast<void *>(buf), reinterpret_cast<void *>(buf->pix));
+        return nullptr;
+    }
+    return data + static_cast<size_t>(buf->y0) * static_cast<size_t>(buf->wpl);
+}
+
+/**
+ * \brief Read the pixel at column (%x) from the raster line (%line).
+ * \param line pointer to the first word of the line
+ * \param x pixel column
+ * \param d depth of the Pix
+ * \return pixel value.
+ */
+static l_uint32
+ll_buffer_get(const l_uint32 *line, l_int32 x, l_int32 d)
+{
+    switch (d) {
+    case 1:
+        return GET_DATA_BIT(line, x);
+    case 2:
+        return GET_DATA_DIBIT(line, x);
+    case 4:
+        return GET_DATA_QBIT(line, x);
+    case 8:
+        return GET_DATA_BYTE(line, x);
+    case 16:
+        return GET_DATA_TWO_BYTES(line, x);
+    }
+    return line[x];
+}
+
+/**
+ * \brief Write the pixel value (%val) at column (%x) of the raster line (%line).
+ * \param line pointer to the first word of the line
+ * \param x pixel column
+ * \param d depth of the Pix
+ * \param val pixel value
+ */
+static void
+ll_buffer_set(l_uint32 *line, l_int32 x, l_int32 d, l_uint32 val)
+{
+    switch (d) {
+    case 1:
+        SET_DATA_BIT_VAL(line, x, val & 1);
+        break;
+    case 2:
+        SET_DATA_DIBIT(line, x, val & 3);
+        break;
+    case 4:
+        SET_DATA_QBIT(line, x, val & 15);
+        break;
+    case 8:
+        SET_DATA_BYTE(line, x, val & 0xff);
+        break;
+    case 16:
+        SET_DATA_TWO_BYTES(line, x, val & 0xffff);
+        break;
+    default:
+        line[x] = val;
+    }
+}
+
+/**
+ * \brief Destroy a PixelBuffer* (%buf).
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixelBuffer* (buf).
+ *
+ * Only the reference to the Pix* held by the view is dropped.
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+Destroy(lua_State *L)
+{
+    LL_FUNC("Destroy");
+    PixelBuffer *buf = ll_take_udata<PixelBuffer>(_fun, L, 1, TNAME);
+    DBG(LOG_DESTROY, "%s: '%s' %s = %p, %s = %p\n", _fun,
+        TNAME,
+        "buf", reinterpret_cast<void *>(buf),
+        "pix", reinterpret_cast<void *>(buf ? buf->pix : nullptr));
+    if (buf) {
+        pixDestroy(&buf->pix);
+        ll_free(buf);
+    }
+    return 0;
+}
+
+/**
+ * \brief Get the number of words in the PixelBuffer* (%buf).
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixelBuffer* (buf).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 integer on the Lua stack.
+ */
+static int
+GetCount(lua_State *L)
+{
+    LL_FUNC("GetCount");
+    PixelBuffer *buf = ll_check_PixelBuffer(_fun, L, 1);
+    return ll_push_l_int32(_fun, L, buf->wpl * buf->h);
+}
+
+/**
+ * \brief Get the word at index (%idx) of the PixelBuffer* (%buf).
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixelBuffer* (buf).
+ * Arg #2 is expected to be a l_int32 (idx).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 integer on the Lua stack.
+ */
+static int
+GetWord(lua_State *L)
+{
+    LL_FUNC("GetWord");
+    PixelBuffer *buf = ll_check_PixelBuffer(_fun, L, 1);
+    l_int32 idx = ll_check_index(_fun, L, 2, buf->wpl * buf->h);
+    l_uint32 *data = ll_buffer_data(_fun, L, buf);
+    return ll_push_l_uint32(_fun, L, data[idx]);
+}
+
+/**
+ * \brief Set the word at index (%idx) of the PixelBuffer* (%buf).
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixelBuffer* (buf).
+ * Arg #2 is expected to be a l_int32 (idx).
+ * Arg #3 is expected to be a l_uint32 (val).
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+SetWord(lua_State *L)
+{
+    LL_FUNC("SetWord");
+    PixelBuffer *buf = ll_check_PixelBuffer(_fun, L, 1);
+    l_int32 idx = ll_check_index(_fun, L, 2, buf->wpl * buf->h);
+    l_uint32 val = ll_check_l_uint32(_fun, L, 3);
+    l_uint32 *data = ll_buffer_data(_fun, L, buf);
+    data[idx] = val;
+    return 0;
+}
+
+/**
+ * \brief Index the PixelBuffer* (%buf) by word number or method name.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixelBuffer* (buf).
+ * Arg #2 is expected to be a l_int32 (idx) or a string (name).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 integer or method on the Lua stack.
+ */
+static int
+Index(lua_State *L)
+{
+    LL_FUNC("Index");
+    if (ll_isinteger(_fun, L, 2))
+        return GetWord(L);
+    lua_getmetatable(L, 1);
+    lua_pushvalue(L, 2);
+    lua_rawget(L, -2);
+    return 1;
+}
+
+/**
+ * \brief Set a word of the PixelBuffer* (%buf) by index.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixelBuffer* (buf).
+ * Arg #2 is expected to be a l_int32 (idx).
+ * Arg #3 is expected to be a l_uint32 (val).
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+NewIndex(lua_State *L)
+{
+    LL_FUNC("NewIndex");
+    if (!ll_isinteger(_fun, L, 2)) {
+        die(_fun, L, "only integer keys can be assigned to a %s*", TNAME);
+        return 0;
+    }
+    return SetWord(L);
+}
+
+/**
+ * \brief Get the pixel at (%x, %y) of the PixelBuffer* (%buf).
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixelBuffer* (buf).
+ * Arg #2 is expected to be a l_int32 (x).
+ * Arg #3 is expected to be a l_int32 (y).
+ *
+ * Coordinates are 0-based, and %y is relative to the view.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 integer on the Lua stack.
+ */
+static int
+GetPixel(lua_State *L)
+{
+    LL_FUNC("GetPixel");
+    PixelBuffer *buf = ll_check_PixelBuffer(_fun, L, 1);
+    l_int32 x = ll_check_l_int32(_fun, L, 2);
+    l_int32 y = ll_check_l_int32(_fun, L, 3);
+    l_uint32 *line = nullptr;
+    if (x < 0 || x >= buf->w || y < 0 || y >= buf->h)
+        return ll_push_nil(_fun, L);
+    line = ll_buffer_data(_fun, L, buf) + static_cast<size_t>(y) * static_cast<size_t>(buf->wpl);
+    return ll_push_l_uint32(_fun, L, ll_buffer_get(line, x, buf->d));
+}
+
+/**
+ * \brief Set the pixel at (%x, %y) of the PixelBuffer* (%buf).
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixelBuffer* (buf).
+ * Arg #2 is expected to be a l_int32 (x).
+ * Arg #3 is expected to be a l_int32 (y).
+ * Arg #4 is expected to be a l_uint32 (val).
+ *
+ * Coordinates are 0-based, and %y is relative to the view.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 boolean on the Lua stack.
+ */
+static int
+SetPixel(lua_State *L)
+{
+    LL_FUNC("SetPixel");
+    PixelBuffer *buf = ll_check_PixelBuffer(_fun, L, 1);
+    l_int32 x = ll_check_l_int32(_fun, L, 2);
+    l_int32 y = ll_check_l_int32(_fun, L, 3);
+    l_uint32 val = ll_check_l_uint32(_fun, L, 4);
+    l_uint32 *line = nullptr;
+    if (x < 0 || x >= buf->w || y < 0 || y >= buf->h)
+        return ll_push_boolean(_fun, L, FALSE);
+    line = ll_buffer_data(_fun, L, buf) + static_cast<size_t>(y) * static_cast<size_t>(buf->wpl);
+    ll_buffer_set(line, x, buf->d, val);
+    return ll_push_boolean(_fun, L, TRUE);
+}
+
+/**
+ * \brief Get the geometry of the PixelBuffer* (%buf).
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixelBuffer* (buf).
+ * </pre>
+ * \param L Lua state.
+ * \return 5 integers (w, h, d, wpl, y0) on the Lua stack.
+ */
+static int
+GetGeometry(lua_State *L)
+{
+    LL_FUNC("GetGeometry");
+    PixelBuffer *buf = ll_check_PixelBuffer(_fun, L, 1);
+    ll_push_l_int32(_fun, L, buf->w);
+    ll_push_l_int32(_fun, L, buf->h);
+    ll_push_l_int32(_fun, L, buf->d);
+    ll_push_l_int32(_fun, L, buf->wpl);
+    ll_push_l_int32(_fun, L, buf->y0);
+    return 5;
+}
+
+/**
+ * \brief Get the Pix* the PixelBuffer* (%buf) refers to.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixelBuffer* (buf).
+ *
+ * The returned Pix* is a clone, i.e. it shares the raster with the view.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 Pix* on the Lua stack.
+ */
+static int
+GetPix(lua_State *L)
+{
+    LL_FUNC("GetPix");
+    PixelBuffer *buf = ll_check_PixelBuffer(_fun, L, 1);
+    return ll_push_Pix(_fun, L, pixClone(buf->pix));
+}
+
+/**
+ * \brief Get a view of rows (%y) to (%y + %n - 1) of the PixelBuffer* (%buf).
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixelBuffer* (buf).
+ * Arg #2 is expected to be a l_int32 (y).
+ * Arg #3 is an optional l_int32 (n, default 1).
+ *
+ * The row %y is 0-based and relative to the view.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 PixelBuffer* on the Lua stack.
+ */
+static int
+Row(lua_State *L)
+{
+    LL_FUNC("Row");
+    PixelBuffer *buf = ll_check_PixelBuffer(_fun, L, 1);
+    l_int32 y = ll_check_l_int32(_fun, L, 2);
+    l_int32 n = ll_opt_l_int32(_fun, L, 3, 1);
+    if (y < 0 || n < 1 || y + n > buf->h)
+        return ll_push_nil(_fun, L);
+    return ll_push_PixelBuffer(_fun, L, ll_create_PixelBuffer(_fun, L, buf->pix, buf->y0 + y, n));
+}
+
+/**
+ * \brief Copy the words of the PixelBuffer* (%buf) to a table.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixelBuffer* (buf).
+ *
+ * Returns a table of %h rows, each a table of %wpl words,
+ * like Pix:GetData() used to return.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 table on the Lua stack.
+ */
+static int
+ToTable(lua_State *L)
+{
+    LL_FUNC("ToTable");
+    PixelBuffer *buf = ll_check_PixelBuffer(_fun, L, 1);
+    l_uint32 *data = ll_buffer_data(_fun, L, buf);
+    return ll_pack_Uarray_2d(_fun, L, data, buf->wpl, buf->h);
+}
+
+/**
+ * \brief Printable string for a PixelBuffer*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixelBuffer* (buf).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 string on the Lua stack.
+ */
+static int
+toString(lua_State *L)
+{
+    LL_FUNC("toString");
+    char *str = ll_calloc<char>(_fun, L, LL_STRBUFF);
+    PixelBuffer *buf = ll_check_PixelBuffer(_fun, L, 1);
+    luaL_Buffer B;
+
+    luaL_buffinit(L, &B);
+    if (!buf) {
+        luaL_addstring(&B, "nil");
+    } else {
+        snprintf(str, LL_STRBUFF,
+                 TNAME "*: %p",
+                 reinterpret_cast<void *>(buf));
+        luaL_addstring(&B, str);
+        snprintf(str, LL_STRBUFF,
+                 "\n    width = %d, height = %d, depth = %d, wpl = %d, y0 = %d",
+                 buf->w, buf->h, buf->d, buf->wpl, buf->y0);
+        luaL_addstring(&B, str);
+#if defined(LUALEPT_INTERNALS) && (LUALEPT_INTERNALS > 0)
+        snprintf(str, LL_STRBUFF,
+                 "\n    %s = %p, %s = %p",
+                 "pix", reinterpret_cast<void *>(buf->pix),
+                 "data", reinterpret_cast<void *>(pixGetData(buf->pix)));
+        luaL_addstring(&B, str);
+#endif
+    }
+    luaL_pushresult(&B);
+    ll_free(str);
+    return 1;
+}
+
+/**
+ * \brief Check Lua stack at index (%arg) for user data of class PixelBuffer*.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the PixelBuffer* contained in the user data.
+ */
+PixelBuffer *
+ll_check_PixelBuffer(const char *_fun, lua_State *L, int arg)
+{
+    return *ll_check_udata<PixelBuffer>(_fun, L, arg, TNAME);
+}
+
+/**
+ * \brief Optionally expect a PixelBuffer* at index (%arg) on the Lua stack.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the PixelBuffer* contained in the user data.
+ */
+PixelBuffer *
+ll_opt_PixelBuffer(const char *_fun, lua_State *L, int arg)
+{
+    if (!ll_isudata(_fun, L, arg, TNAME))
+        return nullptr;
+    return ll_check_PixelBuffer(_fun, L, arg);
+}
+
+/**
+ * \brief Push PixelBuffer* to the Lua stack and set its meta table.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param buf pointer to the PixelBuffer
+ * \return 1 PixelBuffer* on the Lua stack.
+ */
+int
+ll_push_PixelBuffer(const char *_fun, lua_State *L, PixelBuffer *buf)
+{
+    if (!buf)
+        return ll_push_nil(_fun, L);
+    return ll_push_udata(_fun, L, TNAME, buf);
+}
+
+/**
+ * \brief Create a PixelBuffer* for rows (%y0) to (%y0 + %h - 1) of the Pix* (%pix).
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param pix pointer to the Pix
+ * \param y0 first row of the view
+ * \param h number of rows of the view (-1 for all rows from %y0)
+ * \return pointer to a new PixelBuffer, or nullptr on error.
+ */
+PixelBuffer *
+ll_create_PixelBuffer(const char *_fun, lua_State *L, Pix *pix, l_int32 y0, l_int32 h)
+{
+    PixelBuffer *buf = nullptr;
+    l_int32 height = 0;
+
+    if (!pix || !pixGetData(pix))
+        return nullptr;
+    height = pixGetHeight(pix);
+    if (h < 0)
+        h = height - y0;
+    if (y0 < 0 || h < 1 || y0 + h > height)
+        return nullptr;
+    buf = ll_calloc<PixelBuffer>(_fun, L, 1);
+    buf->pix = pixClone(pix);
+    buf->w = pixGetWidth(pix);
+    buf->h = h;
+    buf->d = pixGetDepth(pix);
+    buf->wpl = pixGetWpl(pix);
+    buf->y0 = y0;
+    return buf;
+}
+
+/**
+ * \brief Create and push a new PixelBuffer*.
+ * <pre>
+ * Arg #1 is expected to be a Pix* (pix).
+ * Arg #2 is an optional l_int32 (y0, default 0).
+ * Arg #3 is an optional l_int32 (h, default all rows).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 PixelBuffer* on the Lua stack.
+ */
+int
+ll_new_PixelBuffer(lua_State *L)
+{
+    FUNC("ll_new_PixelBuffer");
+    Pix *pix = ll_check_Pixd(_fun, L, 1);
+    l_int32 y0 = ll_opt_l_int32(_fun, L, 2, 0);
+    l_int32 h = ll_opt_l_int32(_fun, L, 3, -1);
+    DBG(LOG_NEW_PARAM, "%s: create for %s = %p, %s = %d, %s = %d\n", _fun,
+        LL_PIX, reinterpret_cast<void *>(pix), "y0", y0, "h", h);
+    PixelBuffer *buf = ll_create_PixelBuffer(_fun, L, pix, y0, h);
+    DBG(LOG_NEW_CLASS, "%s: created %s* %p\n", _fun,
+        TNAME, reinterpret_cast<void *>(buf));
+    return ll_push_PixelBuffer(_fun, L, buf);
+}
+
+/**
+ * \brief Register the PixelBuffer methods and functions in the PixelBuffer meta table.
+ * \param L Lua state.
+ * \return 1 table on the Lua stack.
+ */
+int
+ll_open_PixelBuffer(lua_State *L)
+{
+    static const luaL_Reg methods[] = {
+        {"__gc",                Destroy},
+        {"__new",               ll_new_PixelBuffer},
+        {"__len",               GetCount},
+        {"__index",             Index},
+        {"__newindex",          NewIndex},
+        {"__tostring",          toString},
+        {"Destroy",             Destroy},
+        {"GetCount",            GetCount},
+        {"GetGeometry",         GetGeometry},
+        {"GetPix",              GetPix},
+        {"GetPixel",            GetPixel},
+        {"GetWord",             GetWord},
+        {"Row",                 Row},
+        {"SetPixel",            SetPixel},
+        {"SetWord",             SetWord},
+        {"ToTable",             ToTable},
+        LUA_SENTINEL
+    };
+    LO_FUNC(TNAME);
+    ll_set_global_cfunct(_fun, L, TNAME, ll_new_PixelBuffer);
+    ll_register_class(_fun, L, TNAME, methods);
+    return 1;
+}
@@ -0,0 +1,824 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+#include <vector>
+
+/**
+ * \file llpixpipeline.cpp
+ * \class PixPipeline
+ *
+ * A list of Pix* operations compiled once and run on many images.
+ *
+ * Chaining methods, e.g. pix:ConvertTo8():Scale(0.5):OpenBrick(3,3),
+ * pushes a user data for every intermediate Pix*, which stays around
+ * until the garbage collector finds it. A PixPipeline validates its steps
+ * once and runs them in C: every intermediate Pix* is destroyed as soon as
+ * the next step is done with it, so that its raster goes back to the pool
+ * (see lualept-pixpool.cpp) for the next raster of the same size class.
+ *
+ * Steps which accept a destination (e.g. OpenBrick, Invert, FlipLR) write
+ * into the intermediate from two steps back (ping-pong), if that one has the
+ * same size and depth; steps which work in place (e.g. GammaTRC) modify the
+ * intermediate itself. The source Pix* is never modified.
+ *
+ * Steps are given as a table of tables, each with the name of the step and
+ * its arguments; a step without arguments can be given as a string:
+ *
+ *   local pl = PixPipeline{ "ConvertTo8", {"Scale", 0.5}, "BackgroundNormSimple",
+ *                           {"ThresholdToBinary", 128}, {"OpenBrick", 3, 3} }
+ *   local pixd = pl:Run(pixs)
+ *
+ * Supported steps and their arguments (optional ones in brackets):
+ *   AddBorder(npix [, val]), BackgroundNormSimple(), Blockconv(wc, hc),
+ *   CloseBrick(hsize, vsize), ConvertRGBToLuminance(), ConvertTo1([thresh]),
+ *   ConvertTo8([cmapflag]), ConvertTo32(), DilateBrick(hsize, vsize),
+ *   ErodeBrick(hsize, vsize), FlipLR(), FlipTB(), GammaTRC(gamma, minval, maxval),
+ *   Invert(), OpenBrick(hsize, vsize), RemoveBorder(npix), Rotate180(),
+ *   Rotate90(direction), Scale(scalex [, scaley]), ScaleToSize(wd, hd),
+ *   ThresholdToBinary(thresh), UnsharpMasking(halfwidth, fract)
+ *
+ * Pipelines without steps that change the geometry (AddBorder, FlipTB,
+ * RemoveBorder, Rotate90, Rotate180, Scale, ScaleToSize) or look at the
+ * whole image (BackgroundNormSimple) can also run on horizontal bands of
+ * an image too large for memory, see Pix.StreamBands() and GetHalo().
+ */
+
+/** Set TNAME to the class name used in this source file */
+#define TNAME LL_PIXPIPELINE
+
+/** Define a function's name (_fun) with prefix PixPipeline */
+#define LL_FUNC(x) FUNC(TNAME "." x)
+
+/** Maximum number of arguments of a step */
+#define LL_PIPELINE_MAXARGS 4
+
+/** How a step treats its destination */
+typedef enum {
+    PIPE_NEW,               /*!< the step always creates a new Pix* */
+    PIPE_PIXD,              /*!< the step writes to an existing Pix* of the same size and depth */
+    PIPE_INPLACE            /*!< the step modifies its source */
+}   pipeline_mode_e;
+
+/** Function running a step: (pixd, pixs, argc, argv) */
+typedef Pix * (*pipeline_fn_t)(Pix *, Pix *, int, const lua_Number *);
+
+/** Function returning the rows above and below a row a step looks at: (argc, argv) */
+typedef l_int32 (*pipeline_halo_t)(int, const lua_Number *);
+
+/** Description of a step */
+typedef struct {
+    const char     *name;   /*!< name of the step (same as the Pix method) */
+    const char     *args;   /*!< argument types: i=integer, f=number, b=boolean; optional after '|' */
+    pipeline_mode_e mode;   /*!< how the step treats its destination */
+    pipeline_fn_t   fn;     /*!< function running the step */
+    pipeline_halo_t halo;   /*!< halo of the step on a band; nullptr if it can't run on bands */
+}   pipeline_op_t;
+
+/** A compiled step */
+typedef struct {
+    const pipeline_op_t    *op;                         /*!< the step */
+    int                     argc;                       /*!< number of arguments given */
+    lua_Number              argv[LL_PIPELINE_MAXARGS];  /*!< the arguments */
+}   pipeline_step_t;
+
+/*! Structure behind the Lua class LL_PIXPIPELINE */
+struct ll_pixpipeline_s {
+    std::vector<pipeline_step_t> steps;     /*!< the compiled steps */
+    Pix                         *spare = nullptr;   /*!< spare intermediate kept between runs */
+};
+
+/** Integer argument #%n of a step */
+#define ARG_INT(n)      static_cast<l_int32>(argv[n])
+
+/** Floating point argument #%n of a step */
+#define ARG_FLOAT(n)    static_cast<l_float32>(argv[n])
+
+/*
+ * Functions running the steps: each calls the Leptonica function of the
+ * same name, with the arguments of the step and defaults for optional ones.
+ */
+
+static Pix *
+op_AddBorder(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(pixd);
+    return pixAddBorder(pixs, ARG_INT(0), argc > 1 ? static_cast<l_uint32>(argv[1]) : 0);
+}
+
+static Pix *
+op_BackgroundNormSimple(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(pixd);
+    UNUSED(argc);
+    UNUSED(argv);
+    return pixBackgroundNormSimple(pixs, nullptr, nullptr);
+}
+
+static Pix *
+op_Blockconv(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(pixd);
+    UNUSED(argc);
+    return pixBlockconv(pixs, ARG_INT(0), ARG_INT(1));
+}
+
+static Pix *
+op_CloseBrick(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(argc);
+    return pixCloseBrick(pixd, pixs, ARG_INT(0), ARG_INT(1));
+}
+
+static Pix *
+op_ConvertRGBToLuminance(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(pixd);
+    UNUSED(argc);
+    UNUSED(argv);
+    return pixConvertRGBToLuminance(pixs);
+}
+
+static Pix *
+op_ConvertTo1(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(pixd);
+    return pixConvertTo1(pixs, argc > 0 ? ARG_INT(0) : 128);
+}
+
+static Pix *
+op_ConvertTo8(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(pixd);
+    return pixConvertTo8(pixs, argc > 0 ? ARG_INT(0) : FALSE);
+}
+
+static Pix *
+op_ConvertTo32(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(pixd);
+    UNUSED(argc);
+    UNUSED(argv);
+    return pixConvertTo32(pixs);
+}
+
+static Pix *
+op_DilateBrick(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(argc);
+    return pixDilateBrick(pixd, pixs, ARG_INT(0), ARG_INT(1));
+}
+
+static Pix *
+op_ErodeBrick(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(argc);
+    return pixErodeBrick(pixd, pixs, ARG_INT(0), ARG_INT(1));
+}
+
+static Pix *
+op_FlipLR(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(argc);
+    UNUSED(argv);
+    return pixFlipLR(pixd, pixs);
+}
+
+static Pix *
+op_FlipTB(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(argc);
+    UNUSED(argv);
+    return pixFlipTB(pixd, pixs);
+}
+
+static Pix *
+op_GammaTRC(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(argc);
+    return pixGammaTRC(pixd, pixs, ARG_FLOAT(0), ARG_INT(1), ARG_INT(2));
+}
+
+static Pix *
+op_Invert(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(argc);
+    UNUSED(argv);
+    return pixInvert(pixd, pixs);
+}
+
+static Pix *
+op_OpenBrick(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(argc);
+    return pixOpenBrick(pixd, pixs, ARG_INT(0), ARG_INT(1));
+}
+
+static Pix *
+op_RemoveBorder(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(pixd);
+    UNUSED(argc);
+    return pixRemoveBorder(pixs, ARG_INT(0));
+}
+
+static Pix *
+op_Rotate180(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(argc);
+    UNUSED(argv);
+    return pixRotate180(pixd, pixs);
+}
+
+static Pix *
+op_Rotate90(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(pixd);
+    UNUSED(argc);
+    return pixRotate90(pixs, ARG_INT(0));
+}
+
+static Pix *
+op_Scale(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(pixd);
+    return pixScale(pixs, ARG_FLOAT(0), argc > 1 ? ARG_FLOAT(1) : ARG_FLOAT(0));
+}
+
+static Pix *
+op_ScaleToSize(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(pixd);
+    UNUSED(argc);
+    return pixScaleToSize(pixs, ARG_INT(0), ARG_INT(1));
+}
+
+static Pix *
+op_ThresholdToBinary(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(pixd);
+    UNUSED(argc);
+    return pixThresholdToBinary(pixs, ARG_INT(0));
+}
+
+static Pix *
+op_UnsharpMasking(Pix *pixd, Pix *pixs, int argc, const lua_Number *argv)
+{
+    UNUSED(pixd);
+    UNUSED(argc);
+    return pixUnsharpMasking(pixs, ARG_INT(0), ARG_FLOAT(1));
+}
+
+/*
+ * Halo of the steps which can run on horizontal bands of an image (see
+ * lualept-stream.cpp): the number of rows above and below a row which
+ * the result of that row depends on. Steps which change the geometry,
+ * or look at the whole image, have none and can't run on bands.
+ */
+
+static l_int32
+halo_none(int argc, const lua_Number *argv)
+{
+    UNUSED(argc);
+    UNUSED(argv);
+    return 0;
+}
+
+static l_int32
+halo_hc(int argc, const lua_Number *argv)
+{
+    UNUSED(argc);
+    /* (wc, hc): kernel of 2*hc + 1 rows */
+    return ARG_INT(1);
+}
+
+static l_int32
+halo_vsize(int argc, const lua_Number *argv)
+{
+    UNUSED(argc);
+    /* (hsize, vsize): at most vsize/2 rows for each of the erosion and dilation */
+    return ARG_INT(1);
+}
+
+static l_int32
+halo_halfwidth(int argc, const lua_Number *argv)
+{
+    UNUSED(argc);
+    return ARG_INT(0);
+}
+
+/** Table of the supported steps */
+static const pipeline_op_t pipeline_ops[] = {
+    {"AddBorder",               "i|i",  PIPE_NEW,       op_AddBorder,              nullptr},
+    {"BackgroundNormSimple",    "",     PIPE_NEW,       op_BackgroundNormSimple,   nullptr},
+    {"Blockconv",               "ii",   PIPE_NEW,       op_Blockconv,              halo_hc},
+    {"CloseBrick",              "ii",   PIPE_PIXD,      op_CloseBrick,             halo_vsize},
+    {"ConvertRGBToLuminance",   "",     PIPE_NEW,       op_ConvertRGBToLuminance,  halo_none},
+    {"ConvertTo1",              "|i",   PIPE_NEW,       op_ConvertTo1,             halo_none},
+    {"ConvertTo8",              "|b",   PIPE_NEW,       op_ConvertTo8,             halo_none},
+    {"ConvertTo32",             "",     PIPE_NEW,       op_ConvertTo32,            halo_none},
+    {"DilateBrick",             "ii",   PIPE_PIXD,      op_DilateBrick,            halo_vsize},
+    {"ErodeBrick",              "ii",   PIPE_PIXD,      op_ErodeBrick,             halo_vsize},
+    {"FlipLR",                  "",     PIPE_PIXD,      op_FlipLR,                 halo_none},
+    {"FlipTB",                  "",     PIPE_PIXD,      op_FlipTB,                 nullptr},
+    {"GammaTRC",                "fii",  PIPE_INPLACE,   op_GammaTRC,               halo_none},
+    {"Invert",                  "",     PIPE_PIXD,      op_Invert,                 halo_none},
+    {"OpenBrick",               "ii",   PIPE_PIXD,      op_OpenBrick,              halo_vsize},
+    {"RemoveBorder",            "i",    PIPE_NEW,       op_RemoveBorder,           nullptr},
+    {"Rotate180",               "",     PIPE_PIXD,      op_Rotate180,              nullptr},
+    {"Rotate90",                "i",    PIPE_NEW,       op_Rotate90,               nullptr},
+    {"Scale",                   "f|f",  PIPE_NEW,       op_Scale,                  nullptr},
+    {"ScaleToSize",             "ii",   PIPE_NEW,       op_ScaleToSize,            nullptr},
+    {"ThresholdToBinary",       "i",    PIPE_NEW,       op_ThresholdToBinary,      halo_none},
+    {"UnsharpMasking",          "if",   PIPE_NEW,       op_UnsharpMasking,         halo_halfwidth}
+};
+
+/**
+ * \brief Look up a step by its name.
+ * \param name name of the step
+ * \return pointer to the pipeline_op_t, or nullptr if not supported.
+ */
+static const pipeline_op_t *
+pipeline_op(const char *name)
+{
+    for (size_t i = 0; i < ARRAYSIZE(pipeline_ops); i++)
+        if (!strcmp(pipeline_ops[i].name, name))
+            return &pipeline_ops[i];
+    return nullptr;
+}
+
+/**
+ * \brief Check the step at index (%arg) on the Lua stack.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index of the step (a string or a table)
+ * \param i number of the step, for error messages
+ * \param step pointer to the pipeline_step_t to fill in
+ */
+static void
+pipeline_step(const char *_fun, lua_State *L, int arg, int i, pipeline_step_t *step)
+{
+    const char *name = nullptr;
+    int n = 0;
+
+    *step = pipeline_step_t();
+    if (lua_isstring(L, arg)) {
+        name = lua_tostring(L, arg);
+    } else if (lua_istable(L, arg)) {
+        n = static_cast<int>(lua_rawlen(L, arg)) - 1;
+        lua_rawgeti(L, arg, 1);
+        name = lua_tostring(L, -1);
+        lua_pop(L, 1);
+    }
+    if (!name) {
+        die(_fun, L, "step #%d is not a string or a table starting with a name", i);
+        return;
+    }
+    step->op = pipeline_op(name);
+    if (!step->op) {
+        die(_fun, L, "step #%d: '%s' is not supported in a %s", i, name, TNAME);
+        return;
+    }
+
+    const char *args = step->op->args;
+    const char *opt = strchr(args, '|');
+    int required = opt ? static_cast<int>(opt - args) : static_cast<int>(strlen(args));
+    int total = static_cast<int>(strlen(args)) - (opt ? 1 : 0);
+    if (n < required || n > total) {
+        die(_fun, L, "step #%d: '%s' expects %d to %d arguments, got %d", i, name, required, total, n);
+        return;
+    }
+
+    for (int j = 0; j < n; j++) {
+        char type = *args++;
+        if ('|' == type)
+            type = *args++;
+        lua_rawgeti(L, arg, j + 2);
+        int isnum = 0;
+        switch (type) {
+        case 'b':
+            isnum = lua_isboolean(L, -1);
+            step->argv[j] = lua_toboolean(L, -1) ? 1 : 0;
+            break;
+        case 'i':
+            step->argv[j] = static_cast<lua_Number>(lua_tointegerx(L, -1, &isnum));
+            break;
+        default:
+            step->argv[j] = lua_tonumberx(L, -1, &isnum);
+        }
+        lua_pop(L, 1);
+        if (!isnum) {
+            die(_fun, L, "step #%d: '%s' argument #%d must be %s", i, name, j + 1,
+                'b' == type ? "a boolean" : 'i' == type ? "an integer" : "a number");
+            return;
+        }
+    }
+    step->argc = n;
+}
+
+/**
+ * \brief Compile the table of steps at index (%arg) on the Lua stack.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index of the table of steps
+ * \return pointer to a new ll_pixpipeline_t.
+ */
+ll_pixpipeline_t *
+ll_compile_pipeline(const char *_fun, lua_State *L, int arg)
+{
+    luaL_checktype(L, arg, LUA_TTABLE);
+    int n = static_cast<int>(lua_rawlen(L, arg));
+
+    /* check every step before anything is allocated */
+    for (int i = 1; i <= n; i++) {
+        pipeline_step_t step;
+        lua_rawgeti(L, arg, i);
+        pipeline_step(_fun, L, lua_gettop(L), i, &step);
+        lua_pop(L, 1);
+    }
+
+    ll_pixpipeline_t *pl = new ll_pixpipeline_t();
+    pl->steps.resize(static_cast<size_t>(n));
+    for (int i = 1; i <= n; i++) {
+        lua_rawgeti(L, arg, i);
+        pipeline_step(_fun, L, lua_gettop(L), i, &pl->steps[static_cast<size_t>(i - 1)]);
+        lua_pop(L, 1);
+    }
+    return pl;
+}
+
+/**
+ * \brief Free a ll_pixpipeline_t.
+ * \param ppl pointer to the ll_pixpipeline_t*; set to nullptr
+ */
+void
+ll_free_pipeline(ll_pixpipeline_t **ppl)
+{
+    if (!ppl || !*ppl)
+        return;
+    pixDestroy(&(*ppl)->spare);
+    delete *ppl;
+    *ppl = nullptr;
+}
+
+/**
+ * \brief Get the number of halo rows a pipeline needs to run on bands.
+ * <pre>
+ * The halo of the steps add up, because every step looks at the rows
+ * of the previous step's result.
+ * </pre>
+ * \param pl pointer to the ll_pixpipeline_t
+ * \param pname optional pointer receiving the name of the first step which can't run on bands
+ * \return number of rows above and below a band, or -1 if the pipeline can't run on bands.
+ */
+l_int32
+ll_pipeline_halo(const ll_pixpipeline_t *pl, const char **pname)
+{
+    l_int32 halo = 0;
+    for (const pipeline_step_t &step : pl->steps) {
+        if (!step.op->halo) {
+            if (pname)
+                *pname = step.op->name;
+            return -1;
+        }
+        halo += step.op->halo(step.argc, step.argv);
+    }
+    return halo;
+}
+
+/**
+ * \brief Run the steps of a pipeline on a Pix*.
+ * <pre>
+ * The Pix* in (%pspare) is a spare intermediate which the next step
+ * writing to a destination can reuse. It is kept between calls, so that
+ * running the pipeline on images of the same size reuses it, too.
+ * With %pspare nullptr the spare kept in %pl is used, which is destroyed
+ * with the pipeline; otherwise the caller destroys it when done.
+ * </pre>
+ * \param pl pointer to the ll_pixpipeline_t
+ * \param pixs source Pix*; it is not modified
+ * \param pspare pointer to a spare Pix* (initially nullptr), or nullptr
+ * \param pname optional pointer receiving the name of the step which failed
+ * \return pointer to the result Pix*, or nullptr on error.
+ */
+Pix *
+ll_run_pipeline(ll_pixpipeline_t *pl, Pix *pixs, Pix **pspare, const char **pname)
+{
+    Pix *pix = pixs;
+
+    if (!pspare)
+        pspare = &pl->spare;
+
+    for (const pipeline_step_t &step : pl->steps) {
+        bool owned = pix != pixs;
+        Pix *pixd = nullptr;
+
+        if (PIPE_PIXD == step.op->mode && *pspare && pixSizesEqual(*pspare, pix))
+            pixd = *pspare;
+        else if (PIPE_INPLACE == step.op->mode && owned)
+            pixd = pix;
+
+        Pix *pixr = step.op->fn(pixd, pix, step.argc, step.argv);
+        if (!pixr) {
+            if (owned)
+                pixDestroy(&pix);
+            if (pname)
+                *pname = step.op->name;
+            return nullptr;
+        }
+
+        if (pixr == pix) {
+            /* modified in place, or a clone of the source when there was nothing to do */
+            if (pixd != pix)
+                pixDestroy(&pixr);
+            continue;
+        }
+
+        if (pixr == *pspare)
+            *pspare = nullptr;
+        if (owned) {
+            /* the previous intermediate becomes the spare */
+            pixDestroy(pspare);
+            *pspare = pix;
+        }
+        pix = pixr;
+        /* a spare of another size or depth can't be reused: release it now */
+        if (*pspare && !pixSizesEqual(*pspare, pix))
+            pixDestroy(pspare);
+    }
+
+    if (pix == pixs)
+        return pixCopy(nullptr, pixs);
+    return pix;
+}
+
+/**
+ * \brief Destroy a PixPipeline*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixPipeline* (pl).
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+Destroy(lua_State *L)
+{
+    LL_FUNC("Destroy");
+    ll_pixpipeline_t *pl = ll_take_udata<ll_pixpipeline_t>(_fun, L, 1, TNAME);
+    DBG(LOG_DESTROY, "%s: '%s' %s = %p\n", _fun,
+        TNAME,
+        "pl", reinterpret_cast<void *>(pl));
+    ll_free_pipeline(&pl);
+    return 0;
+}
+
+/**
+ * \brief Get the number of steps of a PixPipeline*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixPipeline* (pl).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 integer on the Lua stack.
+ */
+static int
+GetCount(lua_State *L)
+{
+    LL_FUNC("GetCount");
+    ll_pixpipeline_t *pl = ll_check_PixPipeline(_fun, L, 1);
+    return ll_push_size_t(_fun, L, pl->steps.size());
+}
+
+/**
+ * \brief Get the number of halo rows a PixPipeline* needs to run on bands.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixPipeline* (pl).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 integer on the Lua stack, or nil if a step can't run on bands (see Pix.StreamBands).
+ */
+static int
+GetHalo(lua_State *L)
+{
+    LL_FUNC("GetHalo");
+    ll_pixpipeline_t *pl = ll_check_PixPipeline(_fun, L, 1);
+    l_int32 halo = ll_pipeline_halo(pl, nullptr);
+    if (halo < 0)
+        return ll_push_nil(_fun, L);
+    return ll_push_l_int32(_fun, L, halo);
+}
+
+/**
+ * \brief Printable string for a PixPipeline*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixPipeline* (pl).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 string on the Lua stack.
+ */
+static int
+toString(lua_State *L)
+{
+    LL_FUNC("toString");
+    char *str = ll_calloc<char>(_fun, L, LL_STRBUFF);
+    ll_pixpipeline_t *pl = *ll_check_udata<ll_pixpipeline_t>(_fun, L, 1, TNAME);
+    luaL_Buffer B;
+
+    luaL_buffinit(L, &B);
+    if (!pl) {
+        luaL_addstring(&B, "nil");
+    } else {
+        snprintf(str, LL_STRBUFF,
+                 TNAME "*: %p",
+                 reinterpret_cast<void *>(pl));
+        luaL_addstring(&B, str);
+        for (size_t i = 0; i < pl->steps.size(); i++) {
+            const pipeline_step_t &step = pl->steps[i];
+            snprintf(str, LL_STRBUFF, "\n    %d: %s(",
+                     static_cast<int>(i + 1), step.op->name);
+            luaL_addstring(&B, str);
+            for (int j = 0; j < step.argc; j++) {
+                snprintf(str, LL_STRBUFF, "%s%g", j ? ", " : "", step.argv[j]);
+                luaL_addstring(&B, str);
+            }
+            luaL_addstring(&B, ")");
+        }
+    }
+    luaL_pushresult(&B);
+    ll_free(str);
+    return 1;
+}
+
+/**
+ * \brief Run a PixPipeline* on every Pix* of a Pixa*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixPipeline* (pl).
+ * Arg #2 is expected to be a Pixa* (pixas).
+ *
+ * Intermediates of the same size are reused from one image to the next,
+ * and kept for the next Run() or Map() until the PixPipeline* is destroyed.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 Pixa* on the Lua stack, or nil if a step failed.
+ */
+static int
+Map(lua_State *L)
+{
+    LL_FUNC("Map");
+    ll_pixpipeline_t *pl = ll_check_PixPipeline(_fun, L, 1);
+    Pixa *pixas = ll_check_Pixa(_fun, L, 2);
+    l_int32 n = pixaGetCount(pixas);
+    Pixa *pixad = pixaCreate(n);
+
+    for (l_int32 i = 0; pixad && i < n; i++) {
+        Pix *pixs = pixaGetPix(pixas, i, L_CLONE);
+        Pix *pixd = pixs ? ll_run_pipeline(pl, pixs, nullptr) : nullptr;
+        pixDestroy(&pixs);
+        if (!pixd) {
+            pixaDestroy(&pixad);
+            break;
+        }
+        pixaAddPix(pixad, pixd, L_INSERT);
+    }
+    return ll_push_Pixa(_fun, L, pixad);
+}
+
+/**
+ * \brief Run a PixPipeline* on a Pix*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixPipeline* (pl).
+ * Arg #2 is expected to be a Pix* (pixs).
+ *
+ * A spare intermediate is kept in %pl between calls, so that running
+ * it on many images of the same size does not allocate one each time.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 Pix* on the Lua stack, or nil if a step failed.
+ */
+static int
+Run(lua_State *L)
+{
+    LL_FUNC("Run");
+    ll_pixpipeline_t *pl = ll_check_PixPipeline(_fun, L, 1);
+    Pix *pixs = ll_check_Pix(_fun, L, 2);
+    Pix *pixd = ll_run_pipeline(pl, pixs, nullptr);
+    return ll_push_Pix(_fun, L, pixd);
+}
+
+/**
+ * \brief Check Lua stack at index (%arg) for user data of class PixPipeline.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the ll_pixpipeline_t contained in the user data.
+ */
+ll_pixpipeline_t *
+ll_check_PixPipeline(const char *_fun, lua_State *L, int arg)
+{
+    ll_pixpipeline_t *pl = *ll_check_udata<ll_pixpipeline_t>(_fun, L, arg, TNAME);
+    if (!pl) {
+        die(_fun, L, "%s* at #%d was destroyed", TNAME, arg);
+        return nullptr;
+    }
+    return pl;
+}
+
+/**
+ * \brief Optionally expect a PixPipeline* at index (%arg) on the Lua stack.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the ll_pixpipeline_t contained in the user data.
+ */
+ll_pixpipeline_t *
+ll_opt_PixPipeline(const char *_fun, lua_State *L, int arg)
+{
+    if (!ll_isudata(_fun, L, arg, TNAME))
+        return nullptr;
+    return ll_check_PixPipeline(_fun, L, arg);
+}
+
+/**
+ * \brief Push PixPipeline* user data to the Lua stack and set its meta table.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param pl pointer to the ll_pixpipeline_t
+ * \return 1 PixPipeline* on the Lua stack.
+ */
+int
+ll_push_PixPipeline(const char *_fun, lua_State *L, ll_pixpipeline_t *pl)
+{
+    if (!pl)
+        return ll_push_nil(_fun, L);
+    return ll_push_udata(_fun, L, TNAME, pl);
+}
+
+/**
+ * \brief Create and push a new PixPipeline*.
+ * <pre>
+ * Arg #1 is expected to be a table of steps (steps).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 PixPipeline* on the Lua stack.
+ */
+int
+ll_new_PixPipeline(lua_State *L)
+{
+    FUNC("ll_new_PixPipeline");
+    ll_pixpipeline_t *pl = ll_compile_pipeline(_fun, L, 1);
+    return ll_push_PixPipeline(_fun, L, pl);
+}
+
+/**
+ * \brief Register the PixPipeline methods and functions in the PixPipeline meta table.
+ * \param L Lua state.
+ * \return 1 table on the Lua stack.
+ */
+int
+ll_open_PixPipeline(lua_State *L)
+{
+    static const luaL_Reg methods[] = {
+        {"__gc",                Destroy},
+        {"__len",               GetCount},
+        {"__new",               ll_new_PixPipeline},
+        {"__tostring",          toString},
+        {"Destroy",             Destroy},
+        {"GetCount",            GetCount},
+        {"GetHalo",             GetHalo},
+        {"Map",                 Map},
+        {"Run",                 Run},
+        LUA_SENTINEL
+    };
+    LO_FUNC(TNAME);
+    ll_set_global_cfunct(_fun, L, TNAME, ll_new_PixPipeline);
+    ll_register_class(_fun, L, TNAME, methods);
+    return 1;
+}
@@ -31,6 +31,10 @@
 
 #include "modules.h"
 
+#include <cmath>
+#include <mutex>
+#include <vector>
+
 /**
  * \file llpixtiling.cpp
  * \class PixTiling
@@ -149,6 +153,162 @@ GetCount(lua_State *L)
     return ll_push_l_int32(_fun, L, nx * ny);
 }
 
+/**
+ * \brief Context of Apply() for the worker callbacks.
+ */
+typedef struct apply_ctx_s {
+    PixTiling  *pt;         /*!< the tiling of the source Pix* */
+    Pix        *pixd;       /*!< destination Pix*; created by the first result */
+    l_int32     nx;         /*!< number of tiles horizontally */
+    std::vector<l_int32> tw; /*!< width of each tile pushed */
+    std::vector<l_int32> th; /*!< height of each tile pushed */
+    std::mutex  lock;       /*!< serializes GetTile() and PaintTile() */
+    ll_worker_args_t args;  /*!< extra arguments for %fn */
+}   apply_ctx_t;
+
+/**
+ * \brief Push the tile and its indices (i, j) of job %idx to the worker state %W.
+ * \param W worker Lua state.
+ * \param idx index of the job
+ * \param ctx pointer to the apply_ctx_t
+ * \return 3 values on the Lua stack.
+ */
+static int
+apply_push(lua_State *W, l_int32 idx, void *ctx)
+{
+    FUNC("PixTiling.Apply");
+    apply_ctx_t *apply = reinterpret_cast<apply_ctx_t *>(ctx);
+    l_int32 i = idx / apply->nx;
+    l_int32 j = idx % apply->nx;
+    Pix *tile;
+    {
+        std::lock_guard<std::mutex> guard(apply->lock);
+        tile = pixTilingGetTile(apply->pt, i, j);
+        if (tile) {
+            apply->tw[idx] = pixGetWidth(tile);
+            apply->th[idx] = pixGetHeight(tile);
+        }
+    }
+    if (!tile) {
+        die(_fun, W, "failed to get tile (%d, %d)", i + 1, j + 1);
+        return 0;
+    }
+    ll_push_Pix(_fun, W, tile);
+    ll_push_l_int32(_fun, W, i + 1);
+    ll_push_l_int32(_fun, W, j + 1);
+    return 3;
+}
+
+/**
+ * \brief Take the Pix* result of job %idx from the worker state %W and paint it.
+ * \param W worker Lua state.
+ * \param idx index of the job
+ * \param ctx pointer to the apply_ctx_t
+ */
+static void
+apply_take(lua_State *W, l_int32 idx, void *ctx)
+{
+    FUNC("PixTiling.Apply");
+    apply_ctx_t *apply = reinterpret_cast<apply_ctx_t *>(ctx);
+    l_int32 i = idx / apply->nx;
+    l_int32 j = idx % apply->nx;
+    Pix *pix;
+    l_ok ok;
+    if (!ll_isudata(_fun, W, -1, LL_PIX)) {
+        die(_fun, W, "function returned %s instead of a Pix", luaL_typename(W, -1));
+        return;
+    }
+    pix = ll_check_Pix(_fun, W, -1);
+    if (pixGetWidth(pix) != apply->tw[idx] || pixGetHeight(pix) != apply->th[idx]) {
+        die(_fun, W, "tile (%d, %d) is %dx%d, but the function returned %dx%d",
+            i + 1, j + 1, apply->tw[idx], apply->th[idx], pixGetWidth(pix), pixGetHeight(pix));
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> guard(apply->lock);
+        if (!apply->pixd) {
+            Pix *pixs = apply->pt->pix;
+            apply->pixd = pixCreate(pixGetWidth(pixs), pixGetHeight(pixs), pixGetDepth(pix));
+            pixCopyResolution(apply->pixd, pixs);
+            if (pixGetColormap(pix))
+                pixSetColormap(apply->pixd, pixcmapCopy(pixGetColormap(pix)));
+        }
+        ok = pixTilingPaintTile(apply->pixd, i, j, pix, apply->pt);
+    }
+    if (ok)
+        die(_fun, W, "failed to paint tile (%d, %d)", i + 1, j + 1);
+}
+
+/**
+ * \brief Run a function for each tile of the PixTiling* (%pt) on worker threads.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a PixTiling* (pt).
+ * Arg #2 is expected to be a Lua function, a chunk string or a Pix method (fn).
+ * Arg #3 is an optional l_int32 (nthreads); default is the number of cores.
+ * Arg #4 is an optional Pix* (pixd) to paint into.
+ * Arg #5 and following are optional values passed to %fn (...).
+ *
+ * %fn is called as fn(tile, i, j, ...) with the tile including its overlap and
+ * must return a Pix* of the same size, which is painted into %pixd with
+ * the overlap stripped, unless NoStripOnPaint() was called. A result of
+ * another size raises an error naming the tile.
+ * Like Pixa:ParallelMap() each worker thread runs its own Lua state, so
+ * %fn can not use local variables of the calling scope (upvalues).
+ * Fetching and painting tiles is serialized, the calls to %fn run in parallel.
+ * Without %pixd a destination of the size of the tiled Pix* is created
+ * with the depth and colormap of the first result.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 Pix* on the Lua stack.
+ */
+static int
+Apply(lua_State *L)
+{
+    LL_FUNC("Apply");
+    PixTiling *pt = ll_check_PixTiling(_fun, L, 1);
+    l_int32 nthreads = ll_opt_l_int32(_fun, L, 3, 0);
+    Pix *pixd = ll_opt_Pixd(_fun, L, 4);
+    l_int32 nx = 0;
+    l_int32 ny = 0;
+    char msg[256];
+    ll_bytes_t chunk;
+    ll_worker_job_t job;
+    apply_ctx_t *apply;
+
+    if (pixTilingGetCount(pt, &nx, &ny) || nx * ny < 1)
+        return ll_push_nil(_fun, L);
+    /* check the arguments and the function before anything is allocated */
+    ll_check_args(_fun, L, 5);
+    ll_dump_chunk(_fun, L, 2, LL_PIX, &chunk);
+    nthreads = ll_worker_count(nthreads, nx * ny);
+
+    apply = new apply_ctx_t;
+    apply->pt = pt;
+    apply->pixd = pixd ? pixClone(pixd) : nullptr;
+    apply->nx = nx;
+    apply->tw.resize(nx * ny);
+    apply->th.resize(nx * ny);
+    ll_capture_args(_fun, L, 5, &apply->args);
+
+    job.push = apply_push;
+    job.take = apply_take;
+    job.ctx = apply;
+    job.args = &apply->args;
+
+    int res = ll_run_workers(&chunk, nx * ny, nthreads, &job, msg, sizeof(msg));
+    ll_free(chunk.data);
+
+    pixd = apply->pixd;
+    ll_free_args(&apply->args);
+    delete apply;
+    if (res) {
+        pixDestroy(&pixd);
+        die(_fun, L, "%s", msg);
+        return 0;
+    }
+    return ll_push_Pix(_fun, L, pixd);
+}
+
 /**
  * \brief Brief comment goes here.
  * <pre>
@@ -305,7 +465,7 @@ PaintTile(lua_State *L)
     PixTiling *pt = ll_check_PixTiling(_fun, L, 1);
     l_int32 i = ll_check_l_int32(_fun, L, 2);
     l_int32 j = ll_check_l_int32(_fun, L, 3);
-    Pix *pixd = ll_check_Pix(_fun, L, 4);
+    Pix *pixd = ll_check_Pixd(_fun, L, 4);
     Pix *pixs = ll_check_Pix(_fun, L, 5);
     l_ok ok = pixTilingPaintTile(pixd, i, j, pixs, pt);
     return ll_push_boolean(_fun, L, 0 == ok);
@@ -353,11 +513,43 @@ ll_push_PixTiling(const char *_fun, lua_State *L, PixTiling *cd)
     return ll_push_udata(_fun, L, TNAME, cd);
 }
 
+/**
+ * \brief Return the side of a square tile of Pix* (%pixs) which fits the L2 cache.
+ * <pre>
+ * Source and result of a tile should both fit into the L2 cache, so half
+ * of it is used for the source. The side is a multiple of 32 pixels.
+ * </pre>
+ * \param pixs pointer to the Pix* to tile
+ * \return side of the tile in pixels.
+ */
+static l_int32
+tile_side_l2(Pix *pixs)
+{
+    long l2size = 0;
+    l_int32 d = pixGetDepth(pixs);
+    l_int32 side;
+#if defined(HAVE_UNISTD_H) && defined(_SC_LEVEL2_CACHE_SIZE)
+    l2size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+    if (l2size <= 0)
+        l2size = 256 * 1024;
+    side = static_cast<l_int32>(std::sqrt(static_cast<double>(l2size) * 8 / 2 / (d > 0 ? d : 8)));
+    side &= ~31;
+    return side < 64 ? 64 : side > 4096 ? 4096 : side;
+}
+
 /**
  * \brief Create and push a new PixTiling*.
  *
- * Arg #1 is expected to be a string (dir).
- * Arg #2 is expected to be a l_int32 (fontsize).
+ * Arg #1 is expected to be a Pix* (pixs).
+ * Arg #2 is an optional l_int32 (nx).
+ * Arg #3 is an optional l_int32 (ny).
+ * Arg #4 is an optional l_int32 (w).
+ * Arg #5 is an optional l_int32 (h).
+ * Arg #6 is an optional l_int32 (xoverlap).
+ * Arg #7 is an optional l_int32 (yoverlap).
+ *
+ * If none of nx, ny, w and h is given, the tiles are sized to fit the L2 cache.
  *
  * \param L Lua state.
  * \return 1 PixTiling* on the Lua stack.
@@ -369,10 +561,12 @@ ll_new_PixTiling(lua_State *L)
     PixTiling *pixt = nullptr;
     Pix *pixs = ll_opt_Pix(_fun, L, 1);
     if (pixs) {
-        l_int32 nx = ll_opt_l_int32(_fun, L, 2, 2);
-        l_int32 ny = ll_opt_l_int32(_fun, L, 3, 2);
-        l_int32 w = ll_opt_l_int32(_fun, L, 4);
-        l_int32 h = ll_opt_l_int32(_fun, L, 5);
+        l_int32 side = lua_isnoneornil(L, 2) && lua_isnoneornil(L, 3) &&
+            lua_isnoneornil(L, 4) && lua_isnoneornil(L, 5) ? tile_side_l2(pixs) : 0;
+        l_int32 nx = ll_opt_l_int32(_fun, L, 2, side ? 0 : 2);
+        l_int32 ny = ll_opt_l_int32(_fun, L, 3, side ? 0 : 2);
+        l_int32 w = ll_opt_l_int32(_fun, L, 4, side);
+        l_int32 h = ll_opt_l_int32(_fun, L, 5, side);
         l_int32 xoverlap = ll_opt_l_int32(_fun, L, 6);
         l_int32 yoverlap = ll_opt_l_int32(_fun, L, 7);
         pixt = pixTilingCreate(pixs, nx, ny, w, h, xoverlap, yoverlap);
@@ -393,6 +587,7 @@ ll_open_PixTiling(lua_State *L)
         {"__new",               ll_new_PixTiling},
         {"__len",               GetCount},
         {"__tostring",          toString},
+        {"Apply",               Apply},
         {"Create",              Create},
         {"Destroy",             Destroy},
         {"GetCount",            GetCountXY},
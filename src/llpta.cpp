@@ -267,15 +267,17 @@ Empty(lua_State *L)
 }
 
 /**
- * \brief Get the Pta* (%pta) as an two Numa* (%ptax, %ptay) for X and Y.
+ * \brief Get the Pta* (%pta) as two Float32Array* (%xarr, %yarr) for X and Y.
  * <pre>
  * Arg #1 (i.e. self) is expected to be a Pta* user data.
  *
+ * Use Numa(xarr) and Numa(yarr) if Numa* are needed.
+ *
  * Leptonica's Notes:
  *      (1) This copies the internal arrays into new Numas.
  * </pre>
  * \param L Lua state.
- * \return 2 for two Numa* on the Lua stack, or 0 in case of error.
+ * \return 2 for two Float32Array* on the Lua stack, or nil in case of error.
  */
 static int
 GetArrays(lua_State *L)
@@ -284,9 +286,15 @@ GetArrays(lua_State *L)
     Pta *pta = ll_check_Pta(_fun, L, 1);
     Numa *ptax = nullptr;
     Numa *ptay = nullptr;
+    TypedArray *xarr = nullptr;
+    TypedArray *yarr = nullptr;
     if (ptaGetArrays(pta, &ptax, &ptay))
         return ll_push_nil(_fun, L);
-    return ll_push_Numa(_fun, L, ptax) + ll_push_Numa(_fun, L, ptay);
+    xarr = ll_create_TypedArray(_fun, L, LL_ARRAY_FLOAT32, numaGetCount(ptax), numaGetFArray(ptax, L_NOCOPY));
+    yarr = ll_create_TypedArray(_fun, L, LL_ARRAY_FLOAT32, numaGetCount(ptay), numaGetFArray(ptay, L_NOCOPY));
+    numaDestroy(&ptax);
+    numaDestroy(&ptay);
+    return ll_push_TypedArray(_fun, L, xarr) + ll_push_TypedArray(_fun, L, yarr);
 }
 
 /**
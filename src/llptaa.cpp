@@ -170,6 +170,8 @@ AddPta(lua_State *L)
     Ptaa *ptaa = ll_check_Ptaa(_fun, L, 1);
     Pta *pta = ll_check_Pta(_fun, L, 2);
     l_int32 copyflag = ll_check_access_storage(_fun, L, 3, L_COPY);
+    if (L_INSERT == copyflag)
+        pta = ll_take_owned<Pta>(_fun, L, 2, LL_PTA);    /* the container owns it now */
     return ll_push_boolean(_fun, L, 0 == ptaaAddPta(ptaa, pta, copyflag));
 }
 
@@ -169,7 +169,7 @@ Add(lua_State *L)
 {
     LL_FUNC("Add");
     Queue *lq = ll_check_Queue(_fun, L, 1);
-    void *item = ll_take_udata<void>(_fun, L, 2, "*");
+    void *item = ll_take_owned<void>(_fun, L, 2, "*");
     l_int32 result = lqueueAdd(lq, item);
     return ll_push_l_int32(_fun, L, result);
 }
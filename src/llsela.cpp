@@ -360,6 +360,8 @@ AddSel(lua_State *L)
     Sel *sel = ll_check_Sel(_fun, L, 2);
     const char *selname = ll_check_string(_fun, L, 3);
     l_int32 copyflag = ll_check_access_storage(_fun, L, 4, L_COPY);
+    if (L_INSERT == copyflag)
+        sel = ll_take_owned<Sel>(_fun, L, 2, LL_SEL);    /* the container owns it now */
     return ll_push_boolean(_fun, L, 0 == selaAddSel(sela, sel, selname, copyflag));
 }
 
@@ -0,0 +1,472 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * \file llsharedpix.cpp
+ * \class SharedPix
+ *
+ * A Pix whose raster is shared read-only between Lua states and threads.
+ *
+ * Leptonica's reference count of a Pix* is not atomic, so a Pix* can not
+ * be cloned into another thread's state. A SharedPix instead gives each
+ * user data its own Pix* header (a view), which points to the one shared
+ * raster. Views are ordinary Pix* to Leptonica and can be cloned within
+ * their state; the raster keeps an atomic count of its views, which the
+ * deallocator of the Pix memory manager drops (see lualept-pixpool.cpp).
+ *
+ * Every method of Pix which reads a Pix* accepts a SharedPix. The user
+ * data of a SharedPix is marked read-only (LL_UDATA_READONLY), and methods
+ * which modify their Pix* raise an error for it; use SharedPix:Copy() to
+ * get a private Pix* which can be modified.
+ */
+
+/** Set TNAME to the class name used in this source file */
+#define TNAME LL_SHAREDPIX
+
+/** Define a function's name (_fun) with prefix SharedPix */
+#define LL_FUNC(x) FUNC(TNAME "." x)
+
+/** Mutex guarding the map of shared rasters */
+static std::mutex shared_mutex;
+
+/** Shared rasters by their data pointer */
+static std::unordered_map<const void *, ll_shared_pix_t *> shared_rasters;
+
+/** Number of shared rasters, to skip the lookup while there are none */
+static std::atomic<size_t> shared_count(0);
+
+/**
+ * \brief Return the ll_shared_pix_t for the raster %data, if it is shared.
+ * \param data pointer to the raster data
+ * \return pointer to the ll_shared_pix_t, or nullptr.
+ */
+static ll_shared_pix_t *
+shared_find(const void *data)
+{
+    if (!data || 0 == shared_count.load())
+        return nullptr;
+    std::lock_guard<std::mutex> lock(shared_mutex);
+    auto it = shared_rasters.find(data);
+    return it == shared_rasters.end() ? nullptr : it->second;
+}
+
+/**
+ * \brief Return true if the raster %data belongs to a SharedPix.
+ * \param data pointer to the raster data
+ * \return true if shared.
+ */
+bool
+ll_is_shared_raster(const void *data)
+{
+    return nullptr != shared_find(data);
+}
+
+/**
+ * \brief Drop a reference of the shared raster %data.
+ * <pre>
+ * Called by the deallocator of the Pix memory manager for every raster.
+ * When the last reference is dropped the raster is no longer shared and
+ * the caller frees it.
+ * </pre>
+ * \param data pointer to the raster data
+ * \return true if the raster is shared and still referenced.
+ */
+bool
+ll_shared_raster_unref(void *data)
+{
+    ll_shared_pix_t *sp;
+    if (!data || 0 == shared_count.load())
+        return false;
+    {
+        std::lock_guard<std::mutex> lock(shared_mutex);
+        auto it = shared_rasters.find(data);
+        if (it == shared_rasters.end())
+            return false;
+        sp = it->second;
+        if (sp->refs.fetch_sub(1) > 1)
+            return true;
+        shared_rasters.erase(it);
+        shared_count--;
+    }
+    pixcmapDestroy(&sp->cmap);
+    delete sp;
+    return false;
+}
+
+/**
+ * \brief Create a new Pix* header viewing the shared raster of %sp.
+ * \param sp pointer to the ll_shared_pix_t
+ * \return Pix* view holding one reference, or nullptr on error.
+ */
+Pix *
+ll_shared_pix_view(ll_shared_pix_t *sp)
+{
+    Pix *pix;
+    if (!sp)
+        return nullptr;
+    pix = pixCreateHeader(sp->w, sp->h, sp->d);
+    if (!pix)
+        return nullptr;
+    pixSetSpp(pix, sp->spp);
+    pixSetResolution(pix, sp->xres, sp->yres);
+    pixSetInputFormat(pix, sp->informat);
+    if (sp->cmap)
+        pixSetColormap(pix, pixcmapCopy(sp->cmap));
+    sp->refs++;
+    pixSetData(pix, sp->data);
+    return pix;
+}
+
+/**
+ * \brief Share the raster of a Pix* (%pix) read-only.
+ * <pre>
+ * Ownership of %pix is taken. Its raster is moved into the returned
+ * handle without a copy if %pix holds the only reference, otherwise
+ * it is copied. The handle holds one reference; release it with
+ * ll_release_shared_pix(). It can be pushed to any number of Lua states
+ * (see ll_push_shared_pix()), also in other threads.
+ * </pre>
+ * \param pix pointer to the Pix*
+ * \return pointer to the ll_shared_pix_t, or nullptr on error.
+ */
+ll_shared_pix_t *
+ll_share_pix(Pix *pix)
+{
+    FUNC("ll_share_pix");
+    ll_shared_pix_t *sp;
+    l_uint32 *data;
+
+    if (!pix) {
+        ERROR_INT("pix not defined", _fun, 1);
+        return nullptr;
+    }
+    ll_pixpool_install();
+    data = pixExtractData(pix);
+    if (!data) {
+        pixDestroy(&pix);
+        ERROR_INT("no raster data", _fun, 1);
+        return nullptr;
+    }
+    sp = new ll_shared_pix_t;
+    sp->refs = 1;
+    sp->data = data;
+    sp->w = pixGetWidth(pix);
+    sp->h = pixGetHeight(pix);
+    sp->d = pixGetDepth(pix);
+    sp->spp = pixGetSpp(pix);
+    sp->xres = pixGetXRes(pix);
+    sp->yres = pixGetYRes(pix);
+    sp->informat = pixGetInputFormat(pix);
+    sp->cmap = pixGetColormap(pix) ? pixcmapCopy(pixGetColormap(pix)) : nullptr;
+    pixDestroy(&pix);
+
+    std::lock_guard<std::mutex> lock(shared_mutex);
+    shared_rasters[data] = sp;
+    shared_count++;
+    return sp;
+}
+
+/**
+ * \brief Return a new reference to the shared raster of the SharedPix* at %arg.
+ * \param L Lua state.
+ * \param arg index of the SharedPix*
+ * \return pointer to the ll_shared_pix_t, or nullptr if %arg is no SharedPix*.
+ */
+ll_shared_pix_t *
+ll_get_shared_pix(lua_State *L, int arg)
+{
+    FUNC("ll_get_shared_pix");
+    Pix *pix = ll_opt_SharedPix(_fun, L, arg);
+    ll_shared_pix_t *sp = pix ? shared_find(pixGetData(pix)) : nullptr;
+    if (sp)
+        sp->refs++;
+    return sp;
+}
+
+/**
+ * \brief Push a SharedPix* viewing the raster of %sp to the Lua state %L.
+ * The reference held by the caller is not consumed.
+ * \param L Lua state.
+ * \param sp pointer to the ll_shared_pix_t
+ * \return 1 SharedPix* on the Lua stack.
+ */
+int
+ll_push_shared_pix(lua_State *L, ll_shared_pix_t *sp)
+{
+    FUNC("ll_push_shared_pix");
+    return ll_push_SharedPix(_fun, L, sp);
+}
+
+/**
+ * \brief Release a reference to a shared raster.
+ * \param psp pointer to the ll_shared_pix_t* which is set to nullptr
+ */
+void
+ll_release_shared_pix(ll_shared_pix_t **psp)
+{
+    ll_shared_pix_t *sp = psp ? *psp : nullptr;
+    Pix *view;
+    if (!sp)
+        return;
+    *psp = nullptr;
+    /* destroying a view frees the raster with the last reference */
+    view = ll_shared_pix_view(sp);
+    sp->refs--;
+    pixDestroy(&view);
+}
+
+/**
+ * \brief Destroy a SharedPix*, i.e. drop its view of the raster.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedPix* (pix).
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+Destroy(lua_State *L)
+{
+    LL_FUNC("Destroy");
+    Pix *pix = ll_take_udata<Pix>(_fun, L, 1, TNAME);
+    DBG(LOG_DESTROY, "%s: '%s' %s = %p\n", _fun,
+        TNAME,
+        "pix", reinterpret_cast<void *>(pix));
+    pixDestroy(&pix);
+    return 0;
+}
+
+/**
+ * \brief Printable string for a SharedPix*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedPix* (pix).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 string on the Lua stack.
+ */
+static int
+toString(lua_State *L)
+{
+    LL_FUNC("toString");
+    char *str = ll_calloc<char>(_fun, L, LL_STRBUFF);
+    Pix *pix = ll_check_SharedPix(_fun, L, 1);
+    ll_shared_pix_t *sp = pix ? shared_find(pixGetData(pix)) : nullptr;
+    luaL_Buffer B;
+
+    luaL_buffinit(L, &B);
+    if (!pix) {
+        luaL_addstring(&B, "nil");
+    } else {
+        snprintf(str, LL_STRBUFF,
+                 TNAME "*: %p",
+                 reinterpret_cast<void *>(pix));
+        luaL_addstring(&B, str);
+        snprintf(str, LL_STRBUFF,
+                 "\n    width = %d, height = %d, depth = %d, refs = %d",
+                 pixGetWidth(pix), pixGetHeight(pix), pixGetDepth(pix),
+                 sp ? sp->refs.load() : 0);
+        luaL_addstring(&B, str);
+#if defined(LUALEPT_INTERNALS) && (LUALEPT_INTERNALS > 0)
+        snprintf(str, LL_STRBUFF,
+                 "\n    %s = %p",
+                 "data", reinterpret_cast<void *>(pixGetData(pix)));
+        luaL_addstring(&B, str);
+#endif
+    }
+    luaL_pushresult(&B);
+    ll_free(str);
+    return 1;
+}
+
+/**
+ * \brief Return a private copy of the SharedPix* as a Pix*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedPix* (pix).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 Pix* on the Lua stack.
+ */
+static int
+Copy(lua_State *L)
+{
+    LL_FUNC("Copy");
+    Pix *pix = ll_check_SharedPix(_fun, L, 1);
+    Pix *pixd = pixCopy(nullptr, pix);
+    return ll_push_Pix(_fun, L, pixd);
+}
+
+/**
+ * \brief Return the number of views and handles sharing the raster.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedPix* (pix).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 l_int32 on the Lua stack.
+ */
+static int
+GetRefCount(lua_State *L)
+{
+    LL_FUNC("GetRefCount");
+    Pix *pix = ll_check_SharedPix(_fun, L, 1);
+    ll_shared_pix_t *sp = shared_find(pixGetData(pix));
+    return ll_push_l_int32(_fun, L, sp ? sp->refs.load() : 0);
+}
+
+/**
+ * \brief Look up a method of the SharedPix* (%pix).
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedPix* (pix).
+ * Arg #2 is expected to be a string (name).
+ *
+ * Methods of SharedPix come first, then the methods of Pix.
+ * A Pix method which modifies its Pix* raises an error, because the
+ * user data is read-only (see ll_check_Pixd()).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 function (or nil) on the Lua stack.
+ */
+static int
+Index(lua_State *L)
+{
+    LL_FUNC("Index");
+    const char *name = LUA_TSTRING == lua_type(L, 2) ? lua_tostring(L, 2) : nullptr;
+    lua_getmetatable(L, 1);
+    lua_pushvalue(L, 2);
+    if (LUA_TNIL != lua_rawget(L, -2) || !name)
+        return 1;
+    lua_pop(L, 2);
+    ll_open_class(L, LL_PIX);
+    luaL_getmetatable(L, LL_PIX);
+    lua_pushvalue(L, 2);
+    lua_rawget(L, -2);
+    DBG(LOG_CHECK_UDATA, "%s: %s = '%s'\n", _fun, "name", name);
+    return 1;
+}
+
+/**
+ * \brief Check Lua stack at index (%arg) for user data of class SharedPix*.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the Pix* view contained in the user data.
+ */
+Pix *
+ll_check_SharedPix(const char *_fun, lua_State *L, int arg)
+{
+    return *ll_check_udata<Pix>(_fun, L, arg, TNAME);
+}
+
+/**
+ * \brief Optionally expect a SharedPix* at index (%arg) on the Lua stack.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the Pix* view contained in the user data.
+ */
+Pix *
+ll_opt_SharedPix(const char *_fun, lua_State *L, int arg)
+{
+    if (!ll_isudata(_fun, L, arg, TNAME))
+        return nullptr;
+    return ll_check_SharedPix(_fun, L, arg);
+}
+
+/**
+ * \brief Push a new view of the shared raster %sp to the Lua stack.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param sp pointer to the ll_shared_pix_t
+ * \return 1 SharedPix* on the Lua stack.
+ */
+int
+ll_push_SharedPix(const char *_fun, lua_State *L, ll_shared_pix_t *sp)
+{
+    Pix *pix = ll_shared_pix_view(sp);
+    if (!pix)
+        return ll_push_nil(_fun, L);
+    ll_push_udata(_fun, L, TNAME, pix);
+    ll_udata_freeze(L, -1);
+    return 1;
+}
+
+/**
+ * \brief Create and push a new SharedPix*.
+ * <pre>
+ * Arg #1 is expected to be a Pix* (pixs).
+ *
+ * The raster of %pixs is copied once; use Pix:Share() to share a Pix*
+ * without a copy.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 SharedPix* on the Lua stack.
+ */
+int
+ll_new_SharedPix(lua_State *L)
+{
+    FUNC("ll_new_SharedPix");
+    Pix *pixs = ll_check_Pix(_fun, L, 1);
+    ll_shared_pix_t *sp = ll_share_pix(pixCopy(nullptr, pixs));
+    DBG(LOG_NEW_CLASS, "%s: created %s* %p\n", _fun,
+        TNAME, reinterpret_cast<void *>(sp));
+    ll_push_SharedPix(_fun, L, sp);
+    ll_release_shared_pix(&sp);
+    return 1;
+}
+
+/**
+ * \brief Register the SharedPix methods and functions in the SharedPix meta table.
+ * \param L Lua state.
+ * \return 1 table on the Lua stack.
+ */
+int
+ll_open_SharedPix(lua_State *L)
+{
+    static const luaL_Reg methods[] = {
+        {"__gc",                Destroy},
+        {"__new",               ll_new_SharedPix},
+        {"__tostring",          toString},
+        {"Copy",                Copy},
+        {"Destroy",             Destroy},
+        {"GetRefCount",         GetRefCount},
+        LUA_SENTINEL
+    };
+    LO_FUNC(TNAME);
+    ll_set_global_cfunct(_fun, L, TNAME, ll_new_SharedPix);
+    ll_register_class(_fun, L, TNAME, methods);
+    /* look up methods through Index(), which falls back to the Pix methods */
+    lua_pushcfunction(L, Index);
+    lua_setfield(L, -2, "__index");
+    return 1;
+}
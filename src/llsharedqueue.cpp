@@ -0,0 +1,462 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+/**
+ * \file llsharedqueue.cpp
+ * \class SharedQueue
+ *
+ * A bounded lock-free multi-producer/multi-consumer FIFO queue shared
+ * between Lua states and threads.
+ *
+ * Unlike Queue, which wraps Leptonica's single-threaded L_QUEUE of raw
+ * pointers, a SharedQueue keeps each element as a ll_item_t which knows
+ * its class, so Pop() returns a user data of the class which was pushed.
+ * Objects are moved, i.e. taken out of their user data (see ll_take_item()).
+ *
+ * The queue is a ring of cells with sequence numbers (after D. Vyukov):
+ * producers and consumers claim a cell with one compare-and-swap on the
+ * tail or head position and then own it exclusively until they publish
+ * its next sequence number. Push() and Pop() never block; they return
+ * false or nil when the queue is full or empty.
+ *
+ * A SharedQueue* can be passed to the jobs of Pixa:ParallelMap() or
+ * PixTiling:Apply() and sent through a Channel*.
+ */
+
+/** Set TNAME to the class name used in this source file */
+#define TNAME LL_SHAREDQUEUE
+
+/** Define a function's name (_fun) with prefix SharedQueue */
+#define LL_FUNC(x) FUNC(TNAME "." x)
+
+/** Size of a cache line, to keep the positions of producers and consumers apart */
+#define LL_CACHE_LINE   64
+
+/**
+ * The structure ll_queue_cell_t holds one element of the ring.
+ */
+typedef struct ll_queue_cell_s {
+    std::atomic<size_t>     seq;    /*!< position of the cell's next push (== pos) or pop (== pos + 1) */
+    ll_item_t               item;   /*!< the element */
+}   ll_queue_cell_t;
+
+/*! Structure behind the Lua class LL_SHAREDQUEUE */
+struct ll_shared_queue_s {
+    std::atomic<l_int32>    refs;                       /*!< number of user data and host references */
+    size_t                  mask;                       /*!< number of cells - 1 (a power of 2 minus 1) */
+    ll_queue_cell_t        *cells;                      /*!< the ring */
+    char                    pad0[LL_CACHE_LINE];        /*!< keeps %tail off the line of the above */
+    std::atomic<size_t>     tail;                       /*!< position of the next push */
+    char                    pad1[LL_CACHE_LINE];        /*!< keeps %head off the line of %tail */
+    std::atomic<size_t>     head;                       /*!< position of the next pop */
+    char                    pad2[LL_CACHE_LINE];        /*!< keeps %head off the line of whatever follows */
+};
+
+/**
+ * \brief Claim the cell for the next push.
+ * \param q pointer to the ll_shared_queue_t
+ * \param ppos pointer to the position of the cell
+ * \return pointer to the cell, or nullptr if the queue is full.
+ */
+static ll_queue_cell_t *
+claim_push(ll_shared_queue_t *q, size_t *ppos)
+{
+    size_t pos = q->tail.load(std::memory_order_relaxed);
+    for (;;) {
+        ll_queue_cell_t *cell = &q->cells[pos & q->mask];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+        intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+        if (0 == dif) {
+            if (q->tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                *ppos = pos;
+                return cell;
+            }
+        } else if (dif < 0) {
+            return nullptr;
+        } else {
+            pos = q->tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * \brief Claim the cell for the next pop.
+ * \param q pointer to the ll_shared_queue_t
+ * \param ppos pointer to the position of the cell
+ * \return pointer to the cell, or nullptr if the queue is empty.
+ */
+static ll_queue_cell_t *
+claim_pop(ll_shared_queue_t *q, size_t *ppos)
+{
+    size_t pos = q->head.load(std::memory_order_relaxed);
+    for (;;) {
+        ll_queue_cell_t *cell = &q->cells[pos & q->mask];
+        size_t seq = cell->seq.load(std::memory_order_acquire);
+        intptr_t dif = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+        if (0 == dif) {
+            if (q->head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                *ppos = pos;
+                return cell;
+            }
+        } else if (dif < 0) {
+            return nullptr;
+        } else {
+            pos = q->head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * \brief Create a new shared queue.
+ * The caller holds the one reference to the queue.
+ * \param capacity minimum number of elements; rounded up to a power of 2
+ * \return pointer to the ll_shared_queue_t.
+ */
+ll_shared_queue_t *
+ll_create_shared_queue(size_t capacity)
+{
+    ll_shared_queue_t *q = new ll_shared_queue_t();
+    size_t size = 2;
+    while (size < capacity)
+        size <<= 1;
+    q->refs = 1;
+    q->mask = size - 1;
+    q->cells = new ll_queue_cell_t[size]();
+    for (size_t i = 0; i < size; i++)
+        q->cells[i].seq.store(i, std::memory_order_relaxed);
+    q->tail.store(0, std::memory_order_relaxed);
+    q->head.store(0, std::memory_order_relaxed);
+    return q;
+}
+
+/**
+ * \brief Return a new reference to the queue of the SharedQueue* at %arg.
+ * \param L Lua state.
+ * \param arg index of the SharedQueue*
+ * \return pointer to the ll_shared_queue_t, or nullptr if %arg is no SharedQueue*.
+ */
+ll_shared_queue_t *
+ll_get_shared_queue(lua_State *L, int arg)
+{
+    FUNC("ll_get_shared_queue");
+    ll_shared_queue_t *q = ll_opt_SharedQueue(_fun, L, arg);
+    if (q)
+        q->refs++;
+    return q;
+}
+
+/**
+ * \brief Push a SharedQueue* for the queue %q to the Lua state %L.
+ * The reference held by the caller is not consumed.
+ * \param L Lua state.
+ * \param q pointer to the ll_shared_queue_t
+ * \return 1 SharedQueue* on the Lua stack.
+ */
+int
+ll_push_shared_queue(lua_State *L, ll_shared_queue_t *q)
+{
+    FUNC("ll_push_shared_queue");
+    if (!q)
+        return ll_push_nil(_fun, L);
+    q->refs++;
+    return ll_push_SharedQueue(_fun, L, q);
+}
+
+/**
+ * \brief Release a reference to a shared queue.
+ * The elements still queued are destroyed with the last reference.
+ * \param pq pointer to the ll_shared_queue_t* which is set to nullptr
+ */
+void
+ll_release_shared_queue(ll_shared_queue_t **pq)
+{
+    ll_shared_queue_t *q = pq ? *pq : nullptr;
+    size_t pos;
+    if (!q)
+        return;
+    *pq = nullptr;
+    if (--q->refs > 0)
+        return;
+    for (ll_queue_cell_t *cell = claim_pop(q, &pos); cell; cell = claim_pop(q, &pos))
+        ll_free_item(&cell->item);
+    delete[] q->cells;
+    delete q;
+}
+
+/**
+ * \brief Destroy a SharedQueue*, i.e. drop its reference to the queue.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedQueue* (q).
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+Destroy(lua_State *L)
+{
+    LL_FUNC("Destroy");
+    ll_shared_queue_t *q = ll_take_udata<ll_shared_queue_t>(_fun, L, 1, TNAME);
+    DBG(LOG_DESTROY, "%s: '%s' %s = %p\n", _fun,
+        TNAME,
+        "q", reinterpret_cast<void *>(q));
+    ll_release_shared_queue(&q);
+    return 0;
+}
+
+/**
+ * \brief Get the number of elements in the SharedQueue*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedQueue* (q).
+ *
+ * While other threads push or pop, the count is a snapshot.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 integer on the Lua stack.
+ */
+static int
+GetCount(lua_State *L)
+{
+    LL_FUNC("GetCount");
+    ll_shared_queue_t *q = ll_check_SharedQueue(_fun, L, 1);
+    size_t head = q->head.load(std::memory_order_acquire);
+    size_t tail = q->tail.load(std::memory_order_acquire);
+    return ll_push_size_t(_fun, L, tail > head ? tail - head : 0);
+}
+
+/**
+ * \brief Printable string for a SharedQueue*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedQueue* (q).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 string on the Lua stack.
+ */
+static int
+toString(lua_State *L)
+{
+    LL_FUNC("toString");
+    char *str = ll_calloc<char>(_fun, L, LL_STRBUFF);
+    ll_shared_queue_t *q = ll_check_SharedQueue(_fun, L, 1);
+    luaL_Buffer B;
+
+    luaL_buffinit(L, &B);
+    if (!q) {
+        luaL_addstring(&B, "nil");
+    } else {
+        size_t head = q->head.load(std::memory_order_acquire);
+        size_t tail = q->tail.load(std::memory_order_acquire);
+        snprintf(str, LL_STRBUFF,
+                 TNAME "*: %p",
+                 reinterpret_cast<void *>(q));
+        luaL_addstring(&B, str);
+        snprintf(str, LL_STRBUFF,
+                 "\n    count = %d, capacity = %d, refs = %d",
+                 static_cast<int>(tail > head ? tail - head : 0),
+                 static_cast<int>(q->mask + 1), q->refs.load());
+        luaL_addstring(&B, str);
+    }
+    luaL_pushresult(&B);
+    ll_free(str);
+    return 1;
+}
+
+/**
+ * \brief Get the capacity of the SharedQueue*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedQueue* (q).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 integer on the Lua stack.
+ */
+static int
+GetCapacity(lua_State *L)
+{
+    LL_FUNC("GetCapacity");
+    ll_shared_queue_t *q = ll_check_SharedQueue(_fun, L, 1);
+    return ll_push_size_t(_fun, L, q->mask + 1);
+}
+
+/**
+ * \brief Remove the oldest element from the SharedQueue*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedQueue* (q).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 value, or nil if the queue is empty, on the Lua stack.
+ */
+static int
+Pop(lua_State *L)
+{
+    LL_FUNC("Pop");
+    ll_shared_queue_t *q = ll_check_SharedQueue(_fun, L, 1);
+    ll_queue_cell_t *cell;
+    ll_item_t item;
+    size_t pos;
+
+    cell = claim_pop(q, &pos);
+    if (!cell)
+        return ll_push_nil(_fun, L);
+    item = cell->item;
+    cell->item = ll_item_t();
+    cell->seq.store(pos + q->mask + 1, std::memory_order_release);
+    return ll_push_item(_fun, L, &item);
+}
+
+/**
+ * \brief Add an element to the end of the SharedQueue*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedQueue* (q).
+ * Arg #2 is expected to be a value other than nil (value).
+ *
+ * An object is moved, i.e. its user data is empty after the call,
+ * unless the queue is full.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 boolean (false if the queue is full) on the Lua stack.
+ */
+static int
+Push(lua_State *L)
+{
+    LL_FUNC("Push");
+    ll_shared_queue_t *q = ll_check_SharedQueue(_fun, L, 1);
+    const ll_item_type_t *type = ll_check_item(_fun, L, 2);
+    ll_queue_cell_t *cell;
+    size_t pos;
+
+    if (ll_opt_SharedQueue(_fun, L, 2) == q) {
+        die(_fun, L, "can not push a %s onto itself", TNAME);
+        return 0;
+    }
+    cell = claim_push(q, &pos);
+    if (!cell)
+        return ll_push_boolean(_fun, L, false);
+    ll_take_item(_fun, L, 2, type, &cell->item);
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return ll_push_boolean(_fun, L, true);
+}
+
+/**
+ * \brief Check Lua stack at index (%arg) for user data of class SharedQueue*.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the ll_shared_queue_t contained in the user data.
+ */
+ll_shared_queue_t *
+ll_check_SharedQueue(const char *_fun, lua_State *L, int arg)
+{
+    return *ll_check_udata<ll_shared_queue_t>(_fun, L, arg, TNAME);
+}
+
+/**
+ * \brief Optionally expect a SharedQueue* at index (%arg) on the Lua stack.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the ll_shared_queue_t contained in the user data.
+ */
+ll_shared_queue_t *
+ll_opt_SharedQueue(const char *_fun, lua_State *L, int arg)
+{
+    if (!ll_isudata(_fun, L, arg, TNAME))
+        return nullptr;
+    return ll_check_SharedQueue(_fun, L, arg);
+}
+
+/**
+ * \brief Push SharedQueue* user data to the Lua stack and set its meta table.
+ * The user data takes over the reference held by the caller.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param q pointer to the ll_shared_queue_t
+ * \return 1 SharedQueue* on the Lua stack.
+ */
+int
+ll_push_SharedQueue(const char *_fun, lua_State *L, ll_shared_queue_t *q)
+{
+    if (!q)
+        return ll_push_nil(_fun, L);
+    return ll_push_udata(_fun, L, TNAME, q);
+}
+
+/**
+ * \brief Create and push a new SharedQueue*.
+ * <pre>
+ * Arg #1 is an optional l_int32 (capacity), default 64.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 SharedQueue* on the Lua stack.
+ */
+int
+ll_new_SharedQueue(lua_State *L)
+{
+    FUNC("ll_new_SharedQueue");
+    l_int32 capacity = ll_opt_l_int32(_fun, L, 1, 64);
+    ll_shared_queue_t *q = nullptr;
+    if (capacity < 1) {
+        die(_fun, L, "capacity must be at least 1 (%d)", capacity);
+        return 0;
+    }
+    q = ll_create_shared_queue(static_cast<size_t>(capacity));
+    DBG(LOG_NEW_CLASS, "%s: created %s* %p\n", _fun,
+        TNAME, reinterpret_cast<void *>(q));
+    return ll_push_SharedQueue(_fun, L, q);
+}
+
+/**
+ * \brief Register the SharedQueue methods and functions in the SharedQueue meta table.
+ * \param L Lua state.
+ * \return 1 table on the Lua stack.
+ */
+int
+ll_open_SharedQueue(lua_State *L)
+{
+    static const luaL_Reg methods[] = {
+        {"__gc",                Destroy},
+        {"__len",               GetCount},
+        {"__new",               ll_new_SharedQueue},
+        {"__tostring",          toString},
+        {"Add",                 Push},      /* alias for Push */
+        {"Destroy",             Destroy},
+        {"GetCapacity",         GetCapacity},
+        {"GetCount",            GetCount},
+        {"Pop",                 Pop},
+        {"Push",                Push},
+        {"Remove",              Pop},       /* alias for Pop */
+        LUA_SENTINEL
+    };
+    LO_FUNC(TNAME);
+    ll_set_global_cfunct(_fun, L, TNAME, ll_new_SharedQueue);
+    ll_register_class(_fun, L, TNAME, methods);
+    return 1;
+}
@@ -0,0 +1,441 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+/**
+ * \file llsharedstack.cpp
+ * \class SharedStack
+ *
+ * A bounded lock-free multi-producer/multi-consumer LIFO stack shared
+ * between Lua states and threads.
+ *
+ * Unlike Stack, which wraps Leptonica's single-threaded L_STACK of raw
+ * pointers, a SharedStack keeps each element as a ll_item_t which knows
+ * its class, so Pop() returns a user data of the class which was pushed.
+ * Objects are moved, i.e. taken out of their user data (see ll_take_item()).
+ *
+ * The elements live in a fixed array of nodes, which are linked into
+ * either the stack or a list of free nodes (Treiber stacks). The head of
+ * each list holds a node index and a tag, which is incremented with every
+ * change, so that a node which was popped and pushed again in between
+ * fails the compare-and-swap (the ABA problem). Nodes are never freed
+ * while the stack exists. Push() and Pop() never block; they return false
+ * or nil when the stack is full or empty.
+ *
+ * A SharedStack* can be passed to the jobs of Pixa:ParallelMap() or
+ * PixTiling:Apply() and sent through a Channel*.
+ */
+
+/** Set TNAME to the class name used in this source file */
+#define TNAME LL_SHAREDSTACK
+
+/** Define a function's name (_fun) with prefix SharedStack */
+#define LL_FUNC(x) FUNC(TNAME "." x)
+
+/**
+ * The structure ll_stack_node_t holds one element of the stack.
+ */
+typedef struct ll_stack_node_s {
+    std::atomic<l_uint32>   next;   /*!< index + 1 of the next node in its list, or 0 */
+    ll_item_t               item;   /*!< the element */
+}   ll_stack_node_t;
+
+/*! Structure behind the Lua class LL_SHAREDSTACK */
+struct ll_shared_stack_s {
+    std::atomic<l_int32>    refs;       /*!< number of user data and host references */
+    l_uint32                capacity;   /*!< number of nodes */
+    ll_stack_node_t        *nodes;      /*!< the nodes */
+    std::atomic<l_uint64>   top;        /*!< tag << 32 | index + 1 of the top node, or 0 */
+    std::atomic<l_uint64>   spare;      /*!< tag << 32 | index + 1 of the first free node, or 0 */
+    std::atomic<l_int32>    count;      /*!< number of elements */
+};
+
+/**
+ * \brief Unlink the first node from the list at %head.
+ * \param s pointer to the ll_shared_stack_t
+ * \param head pointer to the head of the list
+ * \return index + 1 of the node, or 0 if the list is empty.
+ */
+static l_uint32
+list_pop(ll_shared_stack_t *s, std::atomic<l_uint64> *head)
+{
+    l_uint64 old = head->load(std::memory_order_acquire);
+    for (;;) {
+        l_uint32 idx = static_cast<l_uint32>(old);
+        if (!idx)
+            return 0;
+        /* a stale next fails the exchange, because the tag has changed */
+        l_uint64 next = s->nodes[idx - 1].next.load(std::memory_order_relaxed);
+        l_uint64 val = (((old >> 32) + 1) << 32) | next;
+        if (head->compare_exchange_weak(old, val, std::memory_order_acq_rel,
+                                        std::memory_order_acquire))
+            return idx;
+    }
+}
+
+/**
+ * \brief Link the node %idx to the front of the list at %head.
+ * \param s pointer to the ll_shared_stack_t
+ * \param head pointer to the head of the list
+ * \param idx index + 1 of the node
+ */
+static void
+list_push(ll_shared_stack_t *s, std::atomic<l_uint64> *head, l_uint32 idx)
+{
+    l_uint64 old = head->load(std::memory_order_relaxed);
+    for (;;) {
+        s->nodes[idx - 1].next.store(static_cast<l_uint32>(old), std::memory_order_relaxed);
+        l_uint64 val = (((old >> 32) + 1) << 32) | idx;
+        if (head->compare_exchange_weak(old, val, std::memory_order_release,
+                                        std::memory_order_relaxed))
+            return;
+    }
+}
+
+/**
+ * \brief Create a new shared stack.
+ * The caller holds the one reference to the stack.
+ * \param capacity maximum number of elements (at least 1)
+ * \return pointer to the ll_shared_stack_t.
+ */
+ll_shared_stack_t *
+ll_create_shared_stack(size_t capacity)
+{
+    ll_shared_stack_t *s = new ll_shared_stack_t();
+    l_uint32 i;
+    s->refs = 1;
+    s->capacity = static_cast<l_uint32>(capacity < 1 ? 1 : capacity);
+    s->nodes = new ll_stack_node_t[s->capacity]();
+    for (i = 0; i < s->capacity; i++)
+        s->nodes[i].next.store(i + 1 < s->capacity ? i + 2 : 0, std::memory_order_relaxed);
+    s->top.store(0, std::memory_order_relaxed);
+    s->spare.store(1, std::memory_order_relaxed);
+    s->count.store(0, std::memory_order_relaxed);
+    return s;
+}
+
+/**
+ * \brief Return a new reference to the stack of the SharedStack* at %arg.
+ * \param L Lua state.
+ * \param arg index of the SharedStack*
+ * \return pointer to the ll_shared_stack_t, or nullptr if %arg is no SharedStack*.
+ */
+ll_shared_stack_t *
+ll_get_shared_stack(lua_State *L, int arg)
+{
+    FUNC("ll_get_shared_stack");
+    ll_shared_stack_t *s = ll_opt_SharedStack(_fun, L, arg);
+    if (s)
+        s->refs++;
+    return s;
+}
+
+/**
+ * \brief Push a SharedStack* for the stack %s to the Lua state %L.
+ * The reference held by the caller is not consumed.
+ * \param L Lua state.
+ * \param s pointer to the ll_shared_stack_t
+ * \return 1 SharedStack* on the Lua stack.
+ */
+int
+ll_push_shared_stack(lua_State *L, ll_shared_stack_t *s)
+{
+    FUNC("ll_push_shared_stack");
+    if (!s)
+        return ll_push_nil(_fun, L);
+    s->refs++;
+    return ll_push_SharedStack(_fun, L, s);
+}
+
+/**
+ * \brief Release a reference to a shared stack.
+ * The elements still on the stack are destroyed with the last reference.
+ * \param ps pointer to the ll_shared_stack_t* which is set to nullptr
+ */
+void
+ll_release_shared_stack(ll_shared_stack_t **ps)
+{
+    ll_shared_stack_t *s = ps ? *ps : nullptr;
+    l_uint32 idx;
+    if (!s)
+        return;
+    *ps = nullptr;
+    if (--s->refs > 0)
+        return;
+    while (0 != (idx = list_pop(s, &s->top)))
+        ll_free_item(&s->nodes[idx - 1].item);
+    delete[] s->nodes;
+    delete s;
+}
+
+/**
+ * \brief Destroy a SharedStack*, i.e. drop its reference to the stack.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedStack* (s).
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+Destroy(lua_State *L)
+{
+    LL_FUNC("Destroy");
+    ll_shared_stack_t *s = ll_take_udata<ll_shared_stack_t>(_fun, L, 1, TNAME);
+    DBG(LOG_DESTROY, "%s: '%s' %s = %p\n", _fun,
+        TNAME,
+        "s", reinterpret_cast<void *>(s));
+    ll_release_shared_stack(&s);
+    return 0;
+}
+
+/**
+ * \brief Get the number of elements on the SharedStack*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedStack* (s).
+ *
+ * While other threads push or pop, the count is a snapshot.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 integer on the Lua stack.
+ */
+static int
+GetCount(lua_State *L)
+{
+    LL_FUNC("GetCount");
+    ll_shared_stack_t *s = ll_check_SharedStack(_fun, L, 1);
+    l_int32 count = s->count.load(std::memory_order_acquire);
+    return ll_push_l_int32(_fun, L, count < 0 ? 0 : count);
+}
+
+/**
+ * \brief Printable string for a SharedStack*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedStack* (s).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 string on the Lua stack.
+ */
+static int
+toString(lua_State *L)
+{
+    LL_FUNC("toString");
+    char *str = ll_calloc<char>(_fun, L, LL_STRBUFF);
+    ll_shared_stack_t *s = ll_check_SharedStack(_fun, L, 1);
+    luaL_Buffer B;
+
+    luaL_buffinit(L, &B);
+    if (!s) {
+        luaL_addstring(&B, "nil");
+    } else {
+        snprintf(str, LL_STRBUFF,
+                 TNAME "*: %p",
+                 reinterpret_cast<void *>(s));
+        luaL_addstring(&B, str);
+        snprintf(str, LL_STRBUFF,
+                 "\n    count = %d, capacity = %u, refs = %d",
+                 s->count.load(), s->capacity, s->refs.load());
+        luaL_addstring(&B, str);
+    }
+    luaL_pushresult(&B);
+    ll_free(str);
+    return 1;
+}
+
+/**
+ * \brief Get the capacity of the SharedStack*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedStack* (s).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 integer on the Lua stack.
+ */
+static int
+GetCapacity(lua_State *L)
+{
+    LL_FUNC("GetCapacity");
+    ll_shared_stack_t *s = ll_check_SharedStack(_fun, L, 1);
+    return ll_push_l_uint32(_fun, L, s->capacity);
+}
+
+/**
+ * \brief Remove the top element from the SharedStack*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedStack* (s).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 value, or nil if the stack is empty, on the Lua stack.
+ */
+static int
+Pop(lua_State *L)
+{
+    LL_FUNC("Pop");
+    ll_shared_stack_t *s = ll_check_SharedStack(_fun, L, 1);
+    l_uint32 idx = list_pop(s, &s->top);
+    ll_item_t item;
+
+    if (!idx)
+        return ll_push_nil(_fun, L);
+    s->count--;
+    item = s->nodes[idx - 1].item;
+    s->nodes[idx - 1].item = ll_item_t();
+    list_push(s, &s->spare, idx);
+    return ll_push_item(_fun, L, &item);
+}
+
+/**
+ * \brief Push an element onto the SharedStack*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a SharedStack* (s).
+ * Arg #2 is expected to be a value other than nil (value).
+ *
+ * An object is moved, i.e. its user data is empty after the call,
+ * unless the stack is full.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 boolean (false if the stack is full) on the Lua stack.
+ */
+static int
+Push(lua_State *L)
+{
+    LL_FUNC("Push");
+    ll_shared_stack_t *s = ll_check_SharedStack(_fun, L, 1);
+    const ll_item_type_t *type = ll_check_item(_fun, L, 2);
+    l_uint32 idx;
+
+    if (ll_opt_SharedStack(_fun, L, 2) == s) {
+        die(_fun, L, "can not push a %s onto itself", TNAME);
+        return 0;
+    }
+    idx = list_pop(s, &s->spare);
+    if (!idx)
+        return ll_push_boolean(_fun, L, false);
+    ll_take_item(_fun, L, 2, type, &s->nodes[idx - 1].item);
+    s->count++;
+    list_push(s, &s->top, idx);
+    return ll_push_boolean(_fun, L, true);
+}
+
+/**
+ * \brief Check Lua stack at index (%arg) for user data of class SharedStack*.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the ll_shared_stack_t contained in the user data.
+ */
+ll_shared_stack_t *
+ll_check_SharedStack(const char *_fun, lua_State *L, int arg)
+{
+    return *ll_check_udata<ll_shared_stack_t>(_fun, L, arg, TNAME);
+}
+
+/**
+ * \brief Optionally expect a SharedStack* at index (%arg) on the Lua stack.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the ll_shared_stack_t contained in the user data.
+ */
+ll_shared_stack_t *
+ll_opt_SharedStack(const char *_fun, lua_State *L, int arg)
+{
+    if (!ll_isudata(_fun, L, arg, TNAME))
+        return nullptr;
+    return ll_check_SharedStack(_fun, L, arg);
+}
+
+/**
+ * \brief Push SharedStack* user data to the Lua stack and set its meta table.
+ * The user data takes over the reference held by the caller.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param s pointer to the ll_shared_stack_t
+ * \return 1 SharedStack* on the Lua stack.
+ */
+int
+ll_push_SharedStack(const char *_fun, lua_State *L, ll_shared_stack_t *s)
+{
+    if (!s)
+        return ll_push_nil(_fun, L);
+    return ll_push_udata(_fun, L, TNAME, s);
+}
+
+/**
+ * \brief Create and push a new SharedStack*.
+ * <pre>
+ * Arg #1 is an optional l_int32 (capacity), default 64.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 SharedStack* on the Lua stack.
+ */
+int
+ll_new_SharedStack(lua_State *L)
+{
+    FUNC("ll_new_SharedStack");
+    l_int32 capacity = ll_opt_l_int32(_fun, L, 1, 64);
+    ll_shared_stack_t *s = nullptr;
+    if (capacity < 1) {
+        die(_fun, L, "capacity must be at least 1 (%d)", capacity);
+        return 0;
+    }
+    s = ll_create_shared_stack(static_cast<size_t>(capacity));
+    DBG(LOG_NEW_CLASS, "%s: created %s* %p\n", _fun,
+        TNAME, reinterpret_cast<void *>(s));
+    return ll_push_SharedStack(_fun, L, s);
+}
+
+/**
+ * \brief Register the SharedStack methods and functions in the SharedStack meta table.
+ * \param L Lua state.
+ * \return 1 table on the Lua stack.
+ */
+int
+ll_open_SharedStack(lua_State *L)
+{
+    static const luaL_Reg methods[] = {
+        {"__gc",                Destroy},
+        {"__len",               GetCount},
+        {"__new",               ll_new_SharedStack},
+        {"__tostring",          toString},
+        {"Add",                 Push},      /* alias for Push */
+        {"Destroy",             Destroy},
+        {"GetCapacity",         GetCapacity},
+        {"GetCount",            GetCount},
+        {"Pop",                 Pop},
+        {"Push",                Push},
+        {"Remove",              Pop},       /* alias for Pop */
+        LUA_SENTINEL
+    };
+    LO_FUNC(TNAME);
+    ll_set_global_cfunct(_fun, L, TNAME, ll_new_SharedStack);
+    ll_register_class(_fun, L, TNAME, methods);
+    return 1;
+}
@@ -155,7 +155,7 @@ Add(lua_State *L)
 {
     LL_FUNC("Add");
     Stack *lstack = ll_check_Stack(_fun, L, 1);
-    void *item = ll_take_udata<void>(_fun, L, 2, "*");
+    void *item = ll_take_owned<void>(_fun, L, 2, "*");
     l_int32 result = lstackAdd(lstack, item);
     return ll_push_l_int32(_fun, L, result);
 }
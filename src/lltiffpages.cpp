@@ -0,0 +1,367 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+/**
+ * \file lltiffpages.cpp
+ * \class TiffPages
+ *
+ * A lazy iterator over the pages of a multipage TIFF file.
+ *
+ * Pix.ReadFromMultipageTiff() opens the file again for every page and
+ * leaves the offset of the next page to the script. A TiffPages maps the
+ * file once (see lualept-mapped.cpp), keeps the offset of the next
+ * directory, and decodes one page per call with pixReadMemFromMultipageTiff():
+ *
+ *   for pix, idx in Pix.TiffPages("scans.tif", 2) do
+ *       ...
+ *   end
+ *
+ * With a prefetch count K > 0 the pages are decoded on a background
+ * thread, while the script works on the previous one. No more than K
+ * decoded pages are ever waiting, including the one being decoded.
+ * The file stays mapped until the iterator reaches the last page or
+ * is destroyed, e.g. with Release() when leaving a loop early.
+ * A page which fails to decode, e.g. in a truncated file, raises an
+ * error instead of ending the iteration early.
+ */
+
+/** Set TNAME to the class name used in this source file */
+#define TNAME LL_TIFFPAGES
+
+/** Define a function's name (_fun) with prefix TiffPages */
+#define LL_FUNC(x) FUNC(TNAME "." x)
+
+/*! Structure behind the Lua class LL_TIFFPAGES */
+struct ll_tiffpages_s {
+    ll_mapped_file_t            mf;         /*!< the mapped TIFF file */
+    size_t                      offset;     /*!< offset of the next directory, 0 for the first */
+    l_int32                     prefetch;   /*!< max. number of decoded pages waiting (K) */
+    l_int32                     index;      /*!< number of pages returned so far */
+    bool                        eof;        /*!< the last page was decoded, or decoding failed */
+    bool                        failed;     /*!< decoding a page failed */
+    bool                        stop;       /*!< the background thread shall exit */
+    std::thread                 thread;     /*!< the background thread, if %prefetch > 0 */
+    std::mutex                  lock;       /*!< guards %pages, %eof, %failed and %stop */
+    std::condition_variable     changed;    /*!< signalled when %pages, %eof or %stop change */
+    std::deque<Pix *>           pages;      /*!< decoded pages waiting */
+};
+
+/**
+ * \brief Decode the page at the current offset of a TiffPages*.
+ * <pre>
+ * Leptonica returns an offset of 0 after the last page.
+ * A page which fails to decode ends the file, too; the caller tells
+ * the two apart by the nullptr result.
+ * </pre>
+ * \param tp pointer to the ll_tiffpages_t
+ * \param poffset pointer to the offset of the page; updated to the next page
+ * \param peof pointer to a bool set to true after the last page
+ * \return pointer to the Pix*, or nullptr on error.
+ */
+static Pix *
+decode_page(ll_tiffpages_t *tp, size_t *poffset, bool *peof)
+{
+    Pix *pix = pixReadMemFromMultipageTiff(tp->mf.data, tp->mf.size, poffset);
+    *peof = !pix || 0 == *poffset;
+    return pix;
+}
+
+/**
+ * \brief Background thread decoding pages ahead of the script.
+ * \param tp pointer to the ll_tiffpages_t
+ */
+static void
+prefetch_run(ll_tiffpages_t *tp)
+{
+    size_t offset = tp->offset;
+    bool eof = false;
+
+    while (!eof) {
+        {
+            std::unique_lock<std::mutex> guard(tp->lock);
+            /* the page being decoded counts as waiting */
+            tp->changed.wait(guard, [tp] {
+                return tp->stop || tp->pages.size() + 1 <= static_cast<size_t>(tp->prefetch);
+            });
+            if (tp->stop)
+                return;
+        }
+        Pix *pix = decode_page(tp, &offset, &eof);
+        std::lock_guard<std::mutex> guard(tp->lock);
+        if (pix)
+            tp->pages.push_back(pix);
+        else
+            tp->failed = true;
+        tp->eof = eof;
+        tp->changed.notify_all();
+    }
+}
+
+/**
+ * \brief Stop the background thread and unmap the file of a TiffPages*.
+ * \param tp pointer to the ll_tiffpages_t
+ */
+static void
+tiffpages_close(ll_tiffpages_t *tp)
+{
+    if (tp->thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(tp->lock);
+            tp->stop = true;
+            tp->changed.notify_all();
+        }
+        tp->thread.join();
+    }
+    for (Pix *pix : tp->pages)
+        pixDestroy(&pix);
+    tp->pages.clear();
+    tp->eof = true;
+    ll_unmap_file(&tp->mf);
+}
+
+/**
+ * \brief Destroy a TiffPages*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a TiffPages* (tp).
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+Destroy(lua_State *L)
+{
+    LL_FUNC("Destroy");
+    ll_tiffpages_t *tp = ll_take_udata<ll_tiffpages_t>(_fun, L, 1, TNAME);
+    DBG(LOG_DESTROY, "%s: '%s' %s = %p\n", _fun,
+        TNAME,
+        "tp", reinterpret_cast<void *>(tp));
+    if (tp) {
+        tiffpages_close(tp);
+        delete tp;
+    }
+    return 0;
+}
+
+/**
+ * \brief Get the next page of a TiffPages*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a TiffPages* (tp).
+ *
+ * This is also the __call metamethod, so that a TiffPages* can be used
+ * as the iterator function of a generic for loop; its second argument
+ * (the control variable) is ignored.
+ * If a page fails to decode, an error naming its index is raised.
+ * </pre>
+ * \param L Lua state.
+ * \return 2 values on the Lua stack: Pix* and its index (1 based), or nil after the last page.
+ */
+static int
+Next(lua_State *L)
+{
+    LL_FUNC("Next");
+    ll_tiffpages_t *tp = ll_check_TiffPages(_fun, L, 1);
+    Pix *pix = nullptr;
+    bool failed = false;
+
+    if (tp->thread.joinable()) {
+        std::unique_lock<std::mutex> guard(tp->lock);
+        tp->changed.wait(guard, [tp] { return !tp->pages.empty() || tp->eof; });
+        if (!tp->pages.empty()) {
+            pix = tp->pages.front();
+            tp->pages.pop_front();
+            tp->changed.notify_all();
+        }
+    } else if (!tp->eof) {
+        pix = decode_page(tp, &tp->offset, &tp->eof);
+        tp->failed = !pix;
+    }
+
+    if (!pix) {
+        /* done: release the mapping without waiting for the collector */
+        tiffpages_close(tp);
+        failed = tp->failed;
+        tp->failed = false;
+        if (failed) {
+            die(_fun, L, "failed to decode page %d", tp->index + 1);
+            return 0;
+        }
+        return ll_push_nil(_fun, L);
+    }
+    tp->index++;
+    ll_push_Pix(_fun, L, pix);
+    ll_push_l_int32(_fun, L, tp->index);
+    return 2;
+}
+
+/**
+ * \brief Printable string for a TiffPages*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a TiffPages* (tp).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 string on the Lua stack.
+ */
+static int
+toString(lua_State *L)
+{
+    LL_FUNC("toString");
+    char *str = ll_calloc<char>(_fun, L, LL_STRBUFF);
+    ll_tiffpages_t *tp = *ll_check_udata<ll_tiffpages_t>(_fun, L, 1, TNAME);
+    luaL_Buffer B;
+
+    luaL_buffinit(L, &B);
+    if (!tp) {
+        luaL_addstring(&B, "nil");
+    } else {
+        snprintf(str, LL_STRBUFF,
+                 TNAME "*: %p\n"
+                 "    size = %lu (%s), prefetch = %d, returned = %d%s",
+                 reinterpret_cast<void *>(tp),
+                 static_cast<unsigned long>(tp->mf.size),
+                 tp->mf.mapped ? "mapped" : "copied",
+                 tp->prefetch, tp->index,
+                 tp->mf.data ? "" : ", closed");
+        luaL_addstring(&B, str);
+    }
+    luaL_pushresult(&B);
+    ll_free(str);
+    return 1;
+}
+
+/**
+ * \brief Check Lua stack at index (%arg) for user data of class TiffPages.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the ll_tiffpages_t contained in the user data.
+ */
+ll_tiffpages_t *
+ll_check_TiffPages(const char *_fun, lua_State *L, int arg)
+{
+    ll_tiffpages_t *tp = *ll_check_udata<ll_tiffpages_t>(_fun, L, arg, TNAME);
+    if (!tp) {
+        die(_fun, L, "%s* at #%d was destroyed", TNAME, arg);
+        return nullptr;
+    }
+    return tp;
+}
+
+/**
+ * \brief Optionally expect a TiffPages* at index (%arg) on the Lua stack.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \return pointer to the ll_tiffpages_t contained in the user data.
+ */
+ll_tiffpages_t *
+ll_opt_TiffPages(const char *_fun, lua_State *L, int arg)
+{
+    if (!ll_isudata(_fun, L, arg, TNAME))
+        return nullptr;
+    return ll_check_TiffPages(_fun, L, arg);
+}
+
+/**
+ * \brief Push TiffPages* user data to the Lua stack and set its meta table.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param tp pointer to the ll_tiffpages_t
+ * \return 1 TiffPages* on the Lua stack.
+ */
+int
+ll_push_TiffPages(const char *_fun, lua_State *L, ll_tiffpages_t *tp)
+{
+    if (!tp)
+        return ll_push_nil(_fun, L);
+    return ll_push_udata(_fun, L, TNAME, tp);
+}
+
+/**
+ * \brief Create and push a new TiffPages*.
+ * <pre>
+ * Arg #1 is expected to be a string (filename).
+ * Arg #2 is an optional l_int32 (prefetch), the number of pages decoded ahead (default 0).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 TiffPages* on the Lua stack, or nil if the file can not be read.
+ */
+int
+ll_new_TiffPages(lua_State *L)
+{
+    FUNC("ll_new_TiffPages");
+    const char *filename = ll_check_string(_fun, L, 1);
+    l_int32 prefetch = ll_opt_l_int32(_fun, L, 2, 0);
+    ll_tiffpages_t *tp = nullptr;
+
+    if (prefetch < 0) {
+        die(_fun, L, "prefetch must be >= 0 (%d)", prefetch);
+        return 0;
+    }
+    tp = new ll_tiffpages_t();
+    if (!ll_map_file(_fun, L, filename, &tp->mf)) {
+        delete tp;
+        return ll_push_nil(_fun, L);
+    }
+    tp->prefetch = prefetch;
+    if (prefetch > 0)
+        tp->thread = std::thread(prefetch_run, tp);
+    return ll_push_TiffPages(_fun, L, tp);
+}
+
+/**
+ * \brief Register the TiffPages methods and functions in the TiffPages meta table.
+ * \param L Lua state.
+ * \return 1 table on the Lua stack.
+ */
+int
+ll_open_TiffPages(lua_State *L)
+{
+    static const luaL_Reg methods[] = {
+        {"__call",              Next},
+        {"__gc",                Destroy},
+        {"__new",               ll_new_TiffPages},
+        {"__tostring",          toString},
+        {"Destroy",             Destroy},
+        {"Next",                Next},
+        LUA_SENTINEL
+    };
+    LO_FUNC(TNAME);
+    ll_set_global_cfunct(_fun, L, TNAME, ll_new_TiffPages);
+    ll_register_class(_fun, L, TNAME, methods);
+    return 1;
+}
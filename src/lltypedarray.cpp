@@ -0,0 +1,686 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+#include <cmath>
+
+/**
+ * \file lltypedarray.cpp
+ * \class TypedArray
+ *
+ * Contiguous arrays of numbers: Int32Array, UInt32Array,
+ * Float32Array and Float64Array.
+ *
+ * The four classes share their methods; they differ in element type only.
+ * A TypedArray is exchanged with Leptonica's arrays by a single memcpy(),
+ * so no per-element Lua table work is done, and elements can be indexed
+ * 1-based from Lua like a table (ta[i], #ta).
+ */
+
+/** Set TNAME to the class name used in this source file */
+#define TNAME "TypedArray"
+
+/** Define a function's name (_fun) with prefix TypedArray */
+#define LL_FUNC(x) FUNC(TNAME "." x)
+
+/** Lua class names of the typed arrays indexed by ll_array_type_e */
+static const char *ll_array_tname[] = {
+    LL_INT32ARRAY,
+    LL_UINT32ARRAY,
+    LL_FLOAT32ARRAY,
+    LL_FLOAT64ARRAY
+};
+
+/** Element sizes of the typed arrays indexed by ll_array_type_e */
+static const size_t ll_array_esize[] = {
+    sizeof(l_int32),
+    sizeof(l_uint32),
+    sizeof(l_float32),
+    sizeof(l_float64)
+};
+
+/**
+ * \brief Push the element at 0-based index (%i) of the TypedArray* (%ta).
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param ta pointer to the TypedArray
+ * \param i element index
+ * \return 1 number on the Lua stack.
+ */
+static int
+ll_array_push(const char *_fun, lua_State *L, const TypedArray *ta, l_int32 i)
+{
+    switch (ta->type) {
+    case LL_ARRAY_INT32:
+        return ll_push_l_int32(_fun, L, reinterpret_cast<const l_int32 *>(ta->data)[i]);
+    case LL_ARRAY_UINT32:
+        return ll_push_l_uint32(_fun, L, reinterpret_cast<const l_uint32 *>(ta->data)[i]);
+    case LL_ARRAY_FLOAT32:
+        return ll_push_l_float32(_fun, L, reinterpret_cast<const l_float32 *>(ta->data)[i]);
+    }
+    return ll_push_l_float64(_fun, L, reinterpret_cast<const l_float64 *>(ta->data)[i]);
+}
+
+/**
+ * \brief Set the element at 0-based index (%i) of the TypedArray* (%ta)
+ * to the number at index (%arg) of the Lua stack.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param ta pointer to the TypedArray
+ * \param i element index
+ * \param arg index of the number on the Lua stack
+ */
+static void
+ll_array_check(const char *_fun, lua_State *L, TypedArray *ta, l_int32 i, int arg)
+{
+    switch (ta->type) {
+    case LL_ARRAY_INT32:
+        reinterpret_cast<l_int32 *>(ta->data)[i] = ll_check_l_int32(_fun, L, arg);
+        break;
+    case LL_ARRAY_UINT32:
+        reinterpret_cast<l_uint32 *>(ta->data)[i] = ll_check_l_uint32(_fun, L, arg);
+        break;
+    case LL_ARRAY_FLOAT32:
+        reinterpret_cast<l_float32 *>(ta->data)[i] = ll_check_l_float32(_fun, L, arg);
+        break;
+    default:
+        reinterpret_cast<l_float64 *>(ta->data)[i] = ll_check_l_float64(_fun, L, arg);
+    }
+}
+
+/**
+ * \brief Get the element at 0-based index (%i) of the TypedArray* (%ta) as l_float64.
+ * \param ta pointer to the TypedArray
+ * \param i element index
+ * \return element value.
+ */
+static l_float64
+ll_array_get(const TypedArray *ta, l_int32 i)
+{
+    switch (ta->type) {
+    case LL_ARRAY_INT32:
+        return reinterpret_cast<const l_int32 *>(ta->data)[i];
+    case LL_ARRAY_UINT32:
+        return reinterpret_cast<const l_uint32 *>(ta->data)[i];
+    case LL_ARRAY_FLOAT32:
+        return static_cast<l_float64>(reinterpret_cast<const l_float32 *>(ta->data)[i]);
+    }
+    return reinterpret_cast<const l_float64 *>(ta->data)[i];
+}
+
+/**
+ * \brief Saturate a l_float64 (%val) to the range [%lo, %hi].
+ * NaN gives 0, because converting it, or a value out of range, to an
+ * integer type is undefined.
+ * \param val value
+ * \param lo lowest value
+ * \param hi highest value
+ * \return value in the range [%lo, %hi].
+ */
+static l_float64
+ll_array_clamp(l_float64 val, l_float64 lo, l_float64 hi)
+{
+    if (std::isnan(val))
+        return 0.0;
+    return val < lo ? lo : val > hi ? hi : val;
+}
+
+/**
+ * \brief Set the element at 0-based index (%i) of the TypedArray* (%ta) from a l_float64.
+ * Values out of the range of the element type are saturated (see ll_array_clamp()).
+ * \param ta pointer to the TypedArray
+ * \param i element index
+ * \param val element value
+ */
+static void
+ll_array_set(TypedArray *ta, l_int32 i, l_float64 val)
+{
+    switch (ta->type) {
+    case LL_ARRAY_INT32:
+        reinterpret_cast<l_int32 *>(ta->data)[i] = static_cast<l_int32>(ll_array_clamp(val, INT32_MIN, INT32_MAX));
+        break;
+    case LL_ARRAY_UINT32:
+        reinterpret_cast<l_uint32 *>(ta->data)[i] = static_cast<l_uint32>(ll_array_clamp(val, 0, UINT32_MAX));
+        break;
+    case LL_ARRAY_FLOAT32:
+        /* infinities and NaN convert as they are */
+        if (std::isfinite(val))
+            val = ll_array_clamp(val, -FLT_MAX, FLT_MAX);
+        reinterpret_cast<l_float32 *>(ta->data)[i] = static_cast<l_float32>(val);
+        break;
+    default:
+        reinterpret_cast<l_float64 *>(ta->data)[i] = val;
+    }
+}
+
+/**
+ * \brief Destroy a TypedArray* (%ta).
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a TypedArray* (ta).
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+Destroy(lua_State *L)
+{
+    LL_FUNC("Destroy");
+    TypedArray *ta = nullptr;
+    for (l_int32 type = LL_ARRAY_INT32; type <= LL_ARRAY_FLOAT64 && !ta; type++)
+        if (ll_isudata(_fun, L, 1, ll_array_tname[type]))
+            ta = ll_take_udata<TypedArray>(_fun, L, 1, ll_array_tname[type]);
+    DBG(LOG_DESTROY, "%s: '%s' %s = %p, %s = %d\n", _fun,
+        ta ? ll_array_tname[ta->type] : TNAME,
+        "ta", reinterpret_cast<void *>(ta),
+        "n", ta ? ta->n : 0);
+    if (ta) {
+        ll_free(ta->data);
+        ll_free(ta);
+    }
+    return 0;
+}
+
+/**
+ * \brief Get the number of elements in the TypedArray* (%ta).
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a TypedArray* (ta).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 integer on the Lua stack.
+ */
+static int
+GetCount(lua_State *L)
+{
+    LL_FUNC("GetCount");
+    TypedArray *ta = ll_check_TypedArray(_fun, L, 1);
+    return ll_push_l_int32(_fun, L, ta->n);
+}
+
+/**
+ * \brief Get the element at index (%idx) of the TypedArray* (%ta).
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a TypedArray* (ta).
+ * Arg #2 is expected to be a l_int32 (idx).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 number on the Lua stack.
+ */
+static int
+Get(lua_State *L)
+{
+    LL_FUNC("Get");
+    TypedArray *ta = ll_check_TypedArray(_fun, L, 1);
+    l_int32 idx = ll_check_index(_fun, L, 2, ta->n);
+    return ll_array_push(_fun, L, ta, idx);
+}
+
+/**
+ * \brief Set the element at index (%idx) of the TypedArray* (%ta).
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a TypedArray* (ta).
+ * Arg #2 is expected to be a l_int32 (idx).
+ * Arg #3 is expected to be a number (val).
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+Set(lua_State *L)
+{
+    LL_FUNC("Set");
+    TypedArray *ta = ll_check_TypedArray(_fun, L, 1);
+    l_int32 idx = ll_check_index(_fun, L, 2, ta->n);
+    ll_array_check(_fun, L, ta, idx, 3);
+    return 0;
+}
+
+/**
+ * \brief Index the TypedArray* (%ta) by element number or method name.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a TypedArray* (ta).
+ * Arg #2 is expected to be a l_int32 (idx) or a string (name).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 number or method on the Lua stack.
+ */
+static int
+Index(lua_State *L)
+{
+    LL_FUNC("Index");
+    if (ll_isinteger(_fun, L, 2))
+        return Get(L);
+    lua_getmetatable(L, 1);
+    lua_pushvalue(L, 2);
+    lua_rawget(L, -2);
+    return 1;
+}
+
+/**
+ * \brief Set an element of the TypedArray* (%ta) by index.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a TypedArray* (ta).
+ * Arg #2 is expected to be a l_int32 (idx).
+ * Arg #3 is expected to be a number (val).
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+NewIndex(lua_State *L)
+{
+    LL_FUNC("NewIndex");
+    if (!ll_isinteger(_fun, L, 2)) {
+        die(_fun, L, "only integer keys can be assigned to a %s*", TNAME);
+        return 0;
+    }
+    return Set(L);
+}
+
+/**
+ * \brief Iterator function for pairs() on a TypedArray* (%ta).
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a TypedArray* (ta).
+ * Arg #2 is expected to be a l_int32 (idx) of the previous element, or 0.
+ * </pre>
+ * \param L Lua state.
+ * \return 2 (index, number) or 1 nil on the Lua stack.
+ */
+static int
+PairsNext(lua_State *L)
+{
+    LL_FUNC("PairsNext");
+    TypedArray *ta = ll_check_TypedArray(_fun, L, 1);
+    l_int32 idx = ll_opt_l_int32(_fun, L, 2, 0);
+    if (idx < 0 || idx >= ta->n)
+        return ll_push_nil(_fun, L);
+    ll_push_l_int32(_fun, L, idx + 1);
+    return 1 + ll_array_push(_fun, L, ta, idx);
+}
+
+/**
+ * \brief Return the iterator triple for pairs() on a TypedArray* (%ta).
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a TypedArray* (ta).
+ * </pre>
+ * \param L Lua state.
+ * \return 3 (function, self, 0) on the Lua stack.
+ */
+static int
+Pairs(lua_State *L)
+{
+    LL_FUNC("Pairs");
+    ll_check_TypedArray(_fun, L, 1);
+    lua_pushcfunction(L, PairsNext);
+    lua_pushvalue(L, 1);
+    lua_pushinteger(L, 0);
+    return 3;
+}
+
+/**
+ * \brief Fill the TypedArray* (%ta) with a value (%val).
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a TypedArray* (ta).
+ * Arg #2 is expected to be a number (val).
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+Fill(lua_State *L)
+{
+    LL_FUNC("Fill");
+    TypedArray *ta = ll_check_TypedArray(_fun, L, 1);
+    for (l_int32 i = 0; i < ta->n; i++)
+        ll_array_check(_fun, L, ta, i, 2);
+    return 0;
+}
+
+/**
+ * \brief Copy the TypedArray* (%ta), optionally converting the element type.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a TypedArray* (ta).
+ * Arg #2 is an optional string (type name, e.g. "Float64Array").
+ *
+ * Values out of the range of the new element type are saturated,
+ * and NaN becomes 0 in an integer array.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 TypedArray* on the Lua stack.
+ */
+static int
+Copy(lua_State *L)
+{
+    LL_FUNC("Copy");
+    TypedArray *tas = ll_check_TypedArray(_fun, L, 1);
+    const char *tname = ll_opt_string(_fun, L, 2, ll_array_tname[tas->type]);
+    TypedArray *ta = nullptr;
+    for (l_int32 type = LL_ARRAY_INT32; type <= LL_ARRAY_FLOAT64; type++) {
+        if (strcmp(tname, ll_array_tname[type]))
+            continue;
+        if (type == tas->type) {
+            ta = ll_create_TypedArray(_fun, L, type, tas->n, tas->data);
+        } else {
+            ta = ll_create_TypedArray(_fun, L, type, tas->n);
+            for (l_int32 i = 0; i < tas->n; i++)
+                ll_array_set(ta, i, ll_array_get(tas, i));
+        }
+    }
+    return ll_push_TypedArray(_fun, L, ta);
+}
+
+/**
+ * \brief Copy the elements of the TypedArray* (%ta) to a table.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a TypedArray* (ta).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 table on the Lua stack.
+ */
+static int
+ToTable(lua_State *L)
+{
+    LL_FUNC("ToTable");
+    TypedArray *ta = ll_check_TypedArray(_fun, L, 1);
+    lua_createtable(L, ta->n, 0);
+    for (l_int32 i = 0; i < ta->n; i++) {
+        ll_array_push(_fun, L, ta, i);
+        lua_rawseti(L, -2, i + 1);
+    }
+    return 1;
+}
+
+/**
+ * \brief Printable string for a TypedArray*.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a TypedArray* (ta).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 string on the Lua stack.
+ */
+static int
+toString(lua_State *L)
+{
+    LL_FUNC("toString");
+    char *str = ll_calloc<char>(_fun, L, LL_STRBUFF);
+    TypedArray *ta = ll_check_TypedArray(_fun, L, 1);
+    luaL_Buffer B;
+
+    luaL_buffinit(L, &B);
+    if (!ta) {
+        luaL_addstring(&B, "nil");
+    } else {
+        snprintf(str, LL_STRBUFF,
+                 "%s*: %p",
+                 ll_array_tname[ta->type],
+                 reinterpret_cast<void *>(ta));
+        luaL_addstring(&B, str);
+        snprintf(str, LL_STRBUFF,
+                 "\n    n = %d",
+                 ta->n);
+        luaL_addstring(&B, str);
+#if defined(LUALEPT_INTERNALS) && (LUALEPT_INTERNALS > 0)
+        snprintf(str, LL_STRBUFF,
+                 "\n    %s = %p, %s = %d",
+                 "data", ta->data,
+                 "esize", static_cast<int>(ll_array_esize[ta->type]));
+        luaL_addstring(&B, str);
+#endif
+    }
+    luaL_pushresult(&B);
+    ll_free(str);
+    return 1;
+}
+
+/**
+ * \brief Check Lua stack at index (%arg) for user data of a typed array class.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \param type element type expected (LL_ARRAY_ANY for any typed array)
+ * \return pointer to the TypedArray* contained in the user data.
+ */
+TypedArray *
+ll_check_TypedArray(const char *_fun, lua_State *L, int arg, l_int32 type)
+{
+    TypedArray *ta = ll_opt_TypedArray(_fun, L, arg, type);
+    if (!ta) {
+        die(_fun, L, "expected a %s* at arg #%d",
+            LL_ARRAY_ANY == type ? TNAME : ll_array_tname[type], arg);
+        return nullptr;
+    }
+    return ta;
+}
+
+/**
+ * \brief Optionally expect a TypedArray* at index (%arg) on the Lua stack.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index where to find the user data (usually 1)
+ * \param type element type expected (LL_ARRAY_ANY for any typed array)
+ * \return pointer to the TypedArray* contained in the user data, or nullptr.
+ */
+TypedArray *
+ll_opt_TypedArray(const char *_fun, lua_State *L, int arg, l_int32 type)
+{
+    for (l_int32 t = LL_ARRAY_INT32; t <= LL_ARRAY_FLOAT64; t++) {
+        if (LL_ARRAY_ANY != type && t != type)
+            continue;
+        if (ll_isudata(_fun, L, arg, ll_array_tname[t]))
+            return *ll_check_udata<TypedArray>(_fun, L, arg, ll_array_tname[t]);
+    }
+    return nullptr;
+}
+
+/**
+ * \brief Push TypedArray* to the Lua stack and set its meta table.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param ta pointer to the TypedArray
+ * \return 1 TypedArray* on the Lua stack.
+ */
+int
+ll_push_TypedArray(const char *_fun, lua_State *L, TypedArray *ta)
+{
+    if (!ta)
+        return ll_push_nil(_fun, L);
+    return ll_push_udata(_fun, L, ll_array_tname[ta->type], ta,
+                         static_cast<size_t>(ta->n) * ll_array_esize[ta->type]);
+}
+
+/**
+ * \brief Create a TypedArray* of (%n) elements of type (%type).
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param type element type (ll_array_type_e)
+ * \param n number of elements
+ * \param src optional pointer to (%n) elements to copy; zeroed if nullptr
+ * \return pointer to a new TypedArray.
+ */
+TypedArray *
+ll_create_TypedArray(const char *_fun, lua_State *L, l_int32 type, l_int32 n, const void *src)
+{
+    TypedArray *ta = nullptr;
+    size_t size = 0;
+    if (type < LL_ARRAY_INT32 || type > LL_ARRAY_FLOAT64 || n < 0)
+        return nullptr;
+    size = static_cast<size_t>(n) * ll_array_esize[type];
+    ta = ll_calloc<TypedArray>(_fun, L, 1);
+    ta->type = type;
+    ta->n = n;
+    ta->data = ll_calloc<l_uint8>(_fun, L, size ? size : 1);
+    if (src && size)
+        memcpy(ta->data, src, size);
+    return ta;
+}
+
+/**
+ * \brief Create and push a new typed array of element type (%type).
+ * <pre>
+ * Arg #1 is expected to be a l_int32 (n), or
+ *        a Lua array table of numbers, or
+ *        a TypedArray* of any type (converted).
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param type element type (ll_array_type_e)
+ * \return 1 TypedArray* on the Lua stack.
+ */
+static int
+ll_new_TypedArray(const char *_fun, lua_State *L, l_int32 type)
+{
+    TypedArray *ta = nullptr;
+    TypedArray *tas = ll_opt_TypedArray(_fun, L, 1);
+
+    if (tas) {
+        DBG(LOG_NEW_PARAM, "%s: create for %s* = %p\n", _fun,
+            ll_array_tname[tas->type], reinterpret_cast<void *>(tas));
+        if (tas->type == type) {
+            ta = ll_create_TypedArray(_fun, L, type, tas->n, tas->data);
+        } else {
+            ta = ll_create_TypedArray(_fun, L, type, tas->n);
+            for (l_int32 i = 0; i < tas->n; i++)
+                ll_array_set(ta, i, ll_array_get(tas, i));
+        }
+    }
+
+    if (!ta && ll_istable(_fun, L, 1)) {
+        l_int32 n = static_cast<l_int32>(lua_rawlen(L, 1));
+        DBG(LOG_NEW_PARAM, "%s: create for %s = %d\n", _fun,
+            "#table", n);
+        ta = ll_create_TypedArray(_fun, L, type, n);
+        for (l_int32 i = 0; i < n; i++) {
+            lua_rawgeti(L, 1, i + 1);
+            ll_array_check(_fun, L, ta, i, -1);
+            lua_pop(L, 1);
+        }
+    }
+
+    if (!ta) {
+        l_int32 n = ll_opt_l_int32(_fun, L, 1, 0);
+        DBG(LOG_NEW_PARAM, "%s: create for %s = %d\n", _fun,
+            "n", n);
+        ta = ll_create_TypedArray(_fun, L, type, n);
+    }
+
+    DBG(LOG_NEW_CLASS, "%s: created %s* %p\n", _fun,
+        ll_array_tname[type], reinterpret_cast<void *>(ta));
+    return ll_push_TypedArray(_fun, L, ta);
+}
+
+/**
+ * \brief Create and push a new Int32Array*.
+ * \param L Lua state.
+ * \return 1 Int32Array* on the Lua stack.
+ */
+int
+ll_new_Int32Array(lua_State *L)
+{
+    FUNC("ll_new_Int32Array");
+    return ll_new_TypedArray(_fun, L, LL_ARRAY_INT32);
+}
+
+/**
+ * \brief Create and push a new UInt32Array*.
+ * \param L Lua state.
+ * \return 1 UInt32Array* on the Lua stack.
+ */
+int
+ll_new_UInt32Array(lua_State *L)
+{
+    FUNC("ll_new_UInt32Array");
+    return ll_new_TypedArray(_fun, L, LL_ARRAY_UINT32);
+}
+
+/**
+ * \brief Create and push a new Float32Array*.
+ * \param L Lua state.
+ * \return 1 Float32Array* on the Lua stack.
+ */
+int
+ll_new_Float32Array(lua_State *L)
+{
+    FUNC("ll_new_Float32Array");
+    return ll_new_TypedArray(_fun, L, LL_ARRAY_FLOAT32);
+}
+
+/**
+ * \brief Create and push a new Float64Array*.
+ * \param L Lua state.
+ * \return 1 Float64Array* on the Lua stack.
+ */
+int
+ll_new_Float64Array(lua_State *L)
+{
+    FUNC("ll_new_Float64Array");
+    return ll_new_TypedArray(_fun, L, LL_ARRAY_FLOAT64);
+}
+
+/**
+ * \brief Register the typed array classes Int32Array, UInt32Array,
+ * Float32Array and Float64Array with their shared methods.
+ * \param L Lua state.
+ * \return 1 table on the Lua stack.
+ */
+int
+ll_open_TypedArray(lua_State *L)
+{
+    static const lua_CFunction creators[] = {
+        ll_new_Int32Array,
+        ll_new_UInt32Array,
+        ll_new_Float32Array,
+        ll_new_Float64Array
+    };
+    luaL_Reg methods[] = {
+        {"__gc",                Destroy},
+        {"__new",               nullptr},
+        {"__len",               GetCount},
+        {"__index",             Index},
+        {"__newindex",          NewIndex},
+        {"__pairs",             Pairs},
+        {"__tostring",          toString},
+        {"Copy",                Copy},
+        {"Destroy",             Destroy},
+        {"Fill",                Fill},
+        {"Get",                 Get},
+        {"GetCount",            GetCount},
+        {"Set",                 Set},
+        {"ToTable",             ToTable},
+        LUA_SENTINEL
+    };
+    LO_FUNC(TNAME);
+    for (l_int32 type = LL_ARRAY_INT32; type <= LL_ARRAY_FLOAT64; type++) {
+        methods[1].func = creators[type];
+        ll_set_global_cfunct(_fun, L, ll_array_tname[type], creators[type]);
+        ll_register_class(_fun, L, ll_array_tname[type], methods);
+    }
+    return 1;
+}
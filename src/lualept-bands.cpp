@@ -0,0 +1,227 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/**
+ * \file lualept-bands.cpp
+ * Run neighborhood filters on horizontal bands of a Pix* in parallel.
+ *
+ * The source is split into as many horizontal bands as threads are used.
+ * Each band is clipped with a halo of %halo rows above and below, so that
+ * the filter sees the same neighborhood as it would on the whole image.
+ * The results are stitched into the destination without their halo.
+ *
+ * Leptonica functions do not share state between different Pix*, so the
+ * filter can run on the bands concurrently. Clipping and creating the
+ * destinations happens in the calling thread; stitching writes disjoint
+ * rows and runs in the threads again.
+ */
+
+/** Default number of threads for filters without a threads option */
+static std::atomic<l_int32> ll_threads(1);
+
+/** Minimum number of rows of a band, not counting the halo */
+#define LL_BAND_MIN_ROWS 64
+
+/**
+ * \brief Set the default number of threads of the banded filters.
+ * <pre>
+ * A value of 1 (the default) runs the filters unbanded, a value of 0
+ * or less uses as many threads as the system has cores.
+ * </pre>
+ * \param nthreads number of threads
+ * \return previous number of threads.
+ */
+l_int32
+ll_set_threads(l_int32 nthreads)
+{
+    return ll_threads.exchange(nthreads);
+}
+
+/**
+ * \brief Return the number of threads for a filter call.
+ * <pre>
+ * If the value at %arg is a table, its field "threads" is used,
+ * otherwise the default set by ll_set_threads().
+ * A value of 0 or less is replaced by the number of cores.
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index of the optional options table
+ * \return number of threads.
+ */
+l_int32
+ll_opt_threads(const char *_fun, lua_State *L, int arg)
+{
+    l_int32 nthreads = ll_threads.load();
+    if (LUA_TTABLE == lua_type(L, arg)) {
+        if (LUA_TNIL != lua_getfield(L, arg, "threads"))
+            nthreads = ll_check_l_int32(_fun, L, -1);
+        lua_pop(L, 1);
+    }
+    if (nthreads <= 0)
+        nthreads = static_cast<l_int32>(std::thread::hardware_concurrency());
+    return nthreads > 0 ? nthreads : 1;
+}
+
+/**
+ * \brief Run %func(i) for i = 0 ... %n-1 on %n threads.
+ * \param n number of threads
+ * \param func function to call
+ */
+template<typename F>
+static void
+run_threads(l_int32 n, const F &func)
+{
+    std::vector<std::thread> threads;
+    l_int32 i;
+    threads.reserve(static_cast<size_t>(n));
+    for (i = 1; i < n; i++)
+        threads.emplace_back(func, i);
+    func(0);
+    for (std::thread &t : threads)
+        t.join();
+}
+
+/**
+ * \brief Run a filter on horizontal bands of a Pix* (%pixs) in parallel.
+ * <pre>
+ * %filter is called for each band with the clipped band including its halo
+ * and must set %nout result Pix* of the band's size. It returns 0 on success.
+ * %out is set to %nout result Pix* of the size of %pixs.
+ *
+ * If the image is too small to be split for %nthreads, or any band fails,
+ * nothing is returned and the caller is expected to run the filter on
+ * the whole image instead.
+ * </pre>
+ * \param pixs source Pix*
+ * \param halo number of rows above and below each band
+ * \param nthreads number of threads (bands)
+ * \param nout number of result Pix*
+ * \param out array of %nout Pix* to set
+ * \param filter function to run on a band
+ * \return 0 on success, 1 if the filter was not run banded.
+ */
+int
+ll_run_bands(Pix *pixs, l_int32 halo, l_int32 nthreads, l_int32 nout, Pix **out,
+             const std::function<int(Pix *band, Pix **out)> &filter)
+{
+    l_int32 w = pixGetWidth(pixs);
+    l_int32 h = pixGetHeight(pixs);
+    l_int32 nbands, i, k;
+
+    for (k = 0; k < nout; k++)
+        out[k] = nullptr;
+    if (halo < 0 || nthreads < 2 || nout < 1)
+        return 1;
+    nbands = std::min(nthreads, h / std::max(LL_BAND_MIN_ROWS, 2 * halo));
+    if (nbands < 2)
+        return 1;
+
+    std::vector<l_int32> y0(static_cast<size_t>(nbands + 1));
+    std::vector<l_int32> top(static_cast<size_t>(nbands));
+    std::vector<Pix *> bands(static_cast<size_t>(nbands), nullptr);
+    std::vector<Pix *> res(static_cast<size_t>(nbands * nout), nullptr);
+    std::atomic<int> failed(0);
+
+    for (i = 0; i <= nbands; i++)
+        y0[i] = static_cast<l_int32>(static_cast<l_int64>(h) * i / nbands);
+    for (i = 0; i < nbands; i++) {
+        l_int32 y1 = std::max(0, y0[i] - halo);
+        l_int32 y2 = std::min(h, y0[i + 1] + halo);
+        Box *box = boxCreate(0, y1, w, y2 - y1);
+        top[i] = y0[i] - y1;
+        bands[i] = pixClipRectangle(pixs, box, nullptr);
+        boxDestroy(&box);
+        if (!bands[i])
+            failed = 1;
+    }
+
+    /* run the filter on the bands */
+    if (!failed) {
+        run_threads(nbands, [&](l_int32 b) {
+            Pix **pout = &res[static_cast<size_t>(b * nout)];
+            if (filter(bands[b], pout))
+                failed = 1;
+            for (l_int32 j = 0; j < nout; j++) {
+                if (!pout[j] ||
+                    pixGetWidth(pout[j]) != pixGetWidth(bands[b]) ||
+                    pixGetHeight(pout[j]) != pixGetHeight(bands[b]))
+                    failed = 1;
+            }
+            pixDestroy(&bands[b]);
+        });
+    }
+
+    /* create the destinations like the results of the first band */
+    for (k = 0; !failed && k < nout; k++) {
+        Pix *pix = res[static_cast<size_t>(k)];
+        out[k] = pixCreate(w, h, pixGetDepth(pix));
+        if (!out[k]) {
+            failed = 1;
+            break;
+        }
+        pixCopyResolution(out[k], pixs);
+        if (pixGetColormap(pix))
+            pixSetColormap(out[k], pixcmapCopy(pixGetColormap(pix)));
+    }
+
+    /* stitch the bands without their halo */
+    if (!failed) {
+        run_threads(nbands, [&](l_int32 b) {
+            for (l_int32 j = 0; j < nout; j++) {
+                Pix *pix = res[static_cast<size_t>(b * nout + j)];
+                if (pixGetDepth(pix) != pixGetDepth(out[j]))
+                    failed = 1;
+                else
+                    pixRasterop(out[j], 0, y0[b], w, y0[b + 1] - y0[b],
+                                PIX_SRC, pix, 0, top[b]);
+            }
+        });
+    }
+
+    for (Pix *&pix : bands)
+        pixDestroy(&pix);
+    for (Pix *&pix : res)
+        pixDestroy(&pix);
+    if (failed) {
+        for (k = 0; k < nout; k++)
+            pixDestroy(&out[k]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,334 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * \file lualept-bytecode.cpp
+ * A cache of compiled Lua chunks for ll_run() and ll_load().
+ *
+ * Scripts are compiled once and dumped with lua_dump(). Later loads of
+ * the same script use the binary chunk and skip the parser.
+ *
+ * Entries are keyed by chunk name. An entry is only used if the file's
+ * modification time and the hash of the chunk name and source text
+ * still match. The source is always read and hashed, so a changed
+ * script is never run from a stale chunk.
+ *
+ * Optionally the chunks are also stored in a directory, named by the
+ * hash, so that other processes (see llua -p) can share them.
+ * Binary chunks are not verified by Lua beyond their header, so the
+ * cache directory must only be writable by trusted users.
+ */
+
+/** Maximum number of chunks kept in the process */
+#define LL_BYTECODE_MAX_ENTRIES     256
+
+/**
+ * The structure ll_bytecode_entry_t is one cached chunk.
+ */
+typedef struct ll_bytecode_entry_s {
+    time_t          mtime;      /*!< modification time of the file, or 0 for strings */
+    l_uint64        hash;       /*!< hash of the chunk name and source text */
+    std::string     code;       /*!< binary chunk from lua_dump() */
+}   ll_bytecode_entry_t;
+
+/** Mutex guarding the cache */
+static std::mutex cache_mutex;
+
+/** True if the cache is enabled */
+static bool cache_enabled = true;
+
+/** Directory to store the chunks in, if not empty */
+static std::string cache_dir;
+
+/** Cached chunks by chunk name */
+static std::unordered_map<std::string, ll_bytecode_entry_t> cache;
+
+/** Statistics of the cache */
+static ll_bytecode_stats_t cache_stats;
+
+/**
+ * \brief Return the 64 bit FNV-1a hash of %size bytes at %data.
+ * \param hash hash to continue from
+ * \param data pointer to the data
+ * \param size number of bytes
+ * \return updated hash
+ */
+static l_uint64
+fnv1a64(l_uint64 hash, const void *data, size_t size)
+{
+    const l_uint8 *p = reinterpret_cast<const l_uint8 *>(data);
+    while (size--) {
+        hash ^= *p++;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+/**
+ * \brief lua_Writer appending a dumped chunk to a std::string.
+ * \param L Lua state.
+ * \param p pointer to the data
+ * \param size number of bytes
+ * \param ud pointer to the std::string
+ * \return 0 on success.
+ */
+static int
+dump_writer(lua_State *L, const void *p, size_t size, void *ud)
+{
+    UNUSED(L);
+    reinterpret_cast<std::string *>(ud)->append(reinterpret_cast<const char *>(p), size);
+    return 0;
+}
+
+/**
+ * \brief Read the file %filename into %data.
+ * \param filename name of the file
+ * \param data string to fill
+ * \return true on success.
+ */
+static bool
+read_file(const char *filename, std::string &data)
+{
+    FILE *fp = fopen(filename, "rb");
+    char buff[16384];
+    size_t n;
+
+    if (!fp)
+        return false;
+    data.clear();
+    while ((n = fread(buff, 1, sizeof(buff), fp)) > 0)
+        data.append(buff, n);
+    bool ok = !ferror(fp);
+    fclose(fp);
+    return ok;
+}
+
+/**
+ * \brief Write %data to the file %filename, replacing it atomically.
+ * \param filename name of the file
+ * \param data string to write
+ * \return true on success.
+ */
+static bool
+write_file(const std::string &filename, const std::string &data)
+{
+    char tmp[32];
+    snprintf(tmp, sizeof(tmp), ".%lu.tmp", static_cast<unsigned long>(getpid()));
+    std::string tmpname = filename + tmp;
+    FILE *fp = fopen(tmpname.c_str(), "wb");
+
+    if (!fp)
+        return false;
+    bool ok = data.size() == fwrite(data.data(), 1, data.size(), fp);
+    ok = (0 == fclose(fp)) && ok;
+    if (ok)
+        ok = 0 == rename(tmpname.c_str(), filename.c_str());
+    if (!ok)
+        remove(tmpname.c_str());
+    return ok;
+}
+
+/**
+ * \brief Return the name of the file in the cache directory for %hash.
+ * \param hash hash of the chunk
+ * \return file name, or an empty string if there is no cache directory.
+ */
+static std::string
+cache_filename(l_uint64 hash)
+{
+    char name[32];
+    if (cache_dir.empty())
+        return std::string();
+    snprintf(name, sizeof(name), "/%016llx.luac", static_cast<unsigned long long>(hash));
+    return cache_dir + name;
+}
+
+/**
+ * \brief Load a Lua chunk, using the cache of compiled chunks.
+ * <pre>
+ * Like luaL_loadfile() if %script is nullptr, or like luaL_loadbufferx()
+ * with mode "t" and %name as chunk name otherwise.
+ * </pre>
+ * \param L Lua state.
+ * \param name filename of an external file to load, if script == nullptr
+ * \param script if != nullptr, the text of the script
+ * \return LUA_OK and the chunk on the Lua stack, or an error code and message.
+ */
+int
+ll_load_cached(lua_State *L, const char *name, const char *script)
+{
+    std::string source;
+    std::string chunkname;
+    time_t mtime = 0;
+    size_t skip = 0;
+
+    if (!cache_enabled)
+        return script ? luaL_loadbufferx(L, script, strlen(script), name, "t")
+                      : luaL_loadfile(L, name);
+
+    if (nullptr == script) {
+#if defined(HAVE_SYS_STAT_H)
+        struct stat st;
+        if (0 == stat(name, &st))
+            mtime = st.st_mtime;
+#endif
+        /* let luaL_loadfile() report unreadable files */
+        if (!read_file(name, source))
+            return luaL_loadfile(L, name);
+        /* skip an UTF-8 BOM and a first line comment (#!), like luaL_loadfile() */
+        if (0 == source.compare(0, 3, "\xEF\xBB\xBF"))
+            skip = 3;
+        if (skip < source.size() && '#' == source[skip]) {
+            size_t eol = source.find('\n', skip);
+            skip = eol == std::string::npos ? source.size() : eol;
+        }
+        chunkname = std::string("@") + name;
+    } else {
+        source = script;
+        chunkname = name;
+    }
+
+    l_uint64 hash = fnv1a64(0xcbf29ce484222325ull, chunkname.c_str(), chunkname.size() + 1);
+    hash = fnv1a64(hash, source.data() + skip, source.size() - skip);
+
+    std::string code;
+    std::string filename;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        auto it = cache.find(chunkname);
+        if (it != cache.end() && it->second.mtime == mtime && it->second.hash == hash) {
+            cache_stats.hits++;
+            code = it->second.code;
+        }
+        filename = cache_filename(hash);
+    }
+    if (!code.empty())
+        return luaL_loadbufferx(L, code.data(), code.size(), chunkname.c_str(), "b");
+
+    if (!filename.empty() && read_file(filename.c_str(), code)) {
+        /* a chunk with an invalid header is rejected and rebuilt */
+        if (LUA_OK == luaL_loadbufferx(L, code.data(), code.size(), chunkname.c_str(), "b")) {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            if (cache.size() >= LL_BYTECODE_MAX_ENTRIES && !cache.count(chunkname))
+                cache.erase(cache.begin());
+            cache[chunkname] = {mtime, hash, code};
+            cache_stats.disk_hits++;
+            return LUA_OK;
+        }
+        lua_pop(L, 1);
+    }
+
+    int res = luaL_loadbufferx(L, source.data() + skip, source.size() - skip, chunkname.c_str(), "t");
+    if (LUA_OK != res)
+        return res;
+
+    code.clear();
+    lua_dump(L, dump_writer, &code, 0);
+
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (cache.size() >= LL_BYTECODE_MAX_ENTRIES && !cache.count(chunkname))
+        cache.erase(cache.begin());
+    cache_stats.misses++;
+    if (!filename.empty() && write_file(filename, code))
+        cache_stats.stores++;
+    cache[chunkname] = {mtime, hash, std::move(code)};
+    return LUA_OK;
+}
+
+/**
+ * \brief Configure the cache of compiled Lua chunks.
+ * \param enable if false, chunks are neither cached nor looked up
+ * \param dir optional directory to store chunks in (nullptr: in process only)
+ * \return 0 on success, or 1 on error.
+ */
+int
+ll_set_bytecode_cache(bool enable, const char *dir)
+{
+    FUNC("ll_set_bytecode_cache");
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    cache_enabled = enable;
+    cache_dir = dir ? dir : "";
+    while (cache_dir.size() > 1 && '/' == cache_dir.back())
+        cache_dir.pop_back();
+    if (!enable)
+        cache.clear();
+#if defined(HAVE_SYS_STAT_H)
+    struct stat st;
+    if (!cache_dir.empty() && (0 != stat(cache_dir.c_str(), &st) || !S_ISDIR(st.st_mode))) {
+        cache_dir.clear();
+        return ERROR_INT("not a directory", _fun, 1);
+    }
+#endif
+    return 0;
+}
+
+/**
+ * \brief Return the counters of the cache of compiled Lua chunks.
+ * \param stats pointer to a ll_bytecode_stats_t to fill
+ * \return 0 on success, or 1 on error.
+ */
+int
+ll_get_bytecode_stats(ll_bytecode_stats_t *stats)
+{
+    FUNC("ll_get_bytecode_stats");
+    if (!stats)
+        return ERROR_INT("stats not defined", _fun, 1);
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    *stats = cache_stats;
+    stats->entries = cache.size();
+    stats->bytes = 0;
+    for (const auto &e : cache)
+        stats->bytes += e.second.code.size();
+    return 0;
+}
+
+/**
+ * \brief Compile the script %filename into the cache of compiled Lua chunks.
+ * \param filename name of the Lua script
+ * \return 0 on success, or 1 on error.
+ */
+int
+ll_prebuild(const char *filename)
+{
+    FUNC("ll_prebuild");
+    lua_State *L = luaL_newstate();
+    int res = ll_load_cached(L, filename, nullptr);
+    if (LUA_OK != res)
+        ERROR_INT(lua_tostring(L, -1), _fun, 1);
+    lua_close(L);
+    return LUA_OK == res ? 0 : 1;
+}
@@ -31,6 +31,11 @@
 
 #include "modules.h"
 
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 /**
  * \file lualept-flags.cpp
  * Convert between strings and Leptonica enumeration values in both directions.
@@ -90,6 +95,114 @@ ll_list_tbl_options(const char* _fun, lua_State *L, const lept_enum *tbl, size_t
     return 1;
 }
 
+/**
+ * \brief Sorted views of a lept_enum table.
+ * The tables in this file are ordered for listing the options, not for
+ * searching. Each table gets two sorted arrays of pointers to its entries,
+ * one by case folded key and one by value, which are then searched with
+ * a binary search. The arrays of all tables are built once, on the first
+ * lookup (see enum_index_build()), and are read without a lock afterwards.
+ */
+typedef struct ll_enum_index_t {
+    std::vector<const lept_enum *> by_key;      /*!< entries sorted by key, case insensitive */
+    std::vector<const lept_enum *> by_value;    /*!< entries sorted by value, first key first */
+}   ll_enum_index_t;
+
+/** Guard for building the indexes of all tables once */
+static std::once_flag enum_index_once;
+
+/** Sorted views by table; not modified after enum_index_build() */
+static std::unordered_map<const lept_enum *, ll_enum_index_t *> enum_index;
+
+static void enum_index_build(void);
+
+/**
+ * \brief Compare a key of length %la with the key %b ignoring case.
+ * \param a first key (not necessarily NUL terminated)
+ * \param la length of first key
+ * \param b second key (NUL terminated)
+ * \return < 0, 0, or > 0 like strcasecmp(3).
+ */
+static int
+enum_keycmp(const char *a, size_t la, const char *b)
+{
+    for (size_t i = 0; i < la; i++) {
+        const int cb = tolower(static_cast<unsigned char>(b[i]));
+        const int ca = tolower(static_cast<unsigned char>(a[i]));
+        if (!cb)
+            return 1;   /* %b ends before %la bytes, even if %a holds a NUL here */
+        if (ca != cb)
+            return ca - cb;
+    }
+    return b[la] ? -1 : 0;
+}
+
+/**
+ * \brief Add the sorted index for a lept_enum table to enum_index.
+ * Called from enum_index_build() only.
+ * \param tbl table of key/name/value tuples
+ * \param len length of that table
+ */
+static void
+enum_index_add(const lept_enum *tbl, size_t len)
+{
+    ll_enum_index_t *idx = new ll_enum_index_t;
+    idx->by_key.reserve(len);
+    for (size_t i = 0; i < len; i++)
+        idx->by_key.push_back(&tbl[i]);
+    idx->by_value = idx->by_key;
+
+    std::stable_sort(idx->by_key.begin(), idx->by_key.end(),
+        [](const lept_enum *a, const lept_enum *b) {
+            return enum_keycmp(a->key, strlen(a->key), b->key) < 0;
+        });
+    std::stable_sort(idx->by_value.begin(), idx->by_value.end(),
+        [](const lept_enum *a, const lept_enum *b) {
+            return a->value < b->value;
+        });
+    enum_index[tbl] = idx;
+}
+
+/**
+ * \brief Return the sorted index for a lept_enum table.
+ * \param tbl table of key/name/value tuples
+ * \return pointer to the ll_enum_index_t for %tbl, or nullptr if it is not one of ours.
+ */
+static const ll_enum_index_t *
+enum_index_get(const lept_enum *tbl)
+{
+    std::call_once(enum_index_once, enum_index_build);
+    auto it = enum_index.find(tbl);
+    return it == enum_index.end() ? nullptr : it->second;
+}
+
+/**
+ * \brief Find the entry for key %str of length %lstr in a lept_enum table.
+ * \param tbl table of key/name/value tuples
+ * \param len length of that table
+ * \param str key string (not necessarily NUL terminated)
+ * \param lstr length of key string
+ * \return pointer to the lept_enum entry, or nullptr if not found.
+ */
+static const lept_enum *
+ll_find_tbl(const lept_enum *tbl, size_t len, const char *str, size_t lstr)
+{
+    const ll_enum_index_t *idx = enum_index_get(tbl);
+    if (!idx) {
+        for (size_t i = 0; i < len; i++)
+            if (!enum_keycmp(str, lstr, tbl[i].key))
+                return &tbl[i];
+        return nullptr;
+    }
+    auto it = std::lower_bound(idx->by_key.begin(), idx->by_key.end(), str,
+        [lstr](const lept_enum *p, const char *s) {
+            return enum_keycmp(s, lstr, p->key) > 0;
+        });
+    if (it == idx->by_key.end() || enum_keycmp(str, lstr, (*it)->key))
+        return nullptr;
+    return *it;
+}
+
 /**
  * \brief Return a const char* with the (first) key for a enumeration value.
  * \param value value to search for
@@ -100,18 +213,30 @@ ll_list_tbl_options(const char* _fun, lua_State *L, const lept_enum *tbl, size_t
 const char*
 ll_string_tbl(l_int32 value, const lept_enum *tbl, size_t len)
 {
-    size_t i;
-
-    for (i = 0; i < len; i++) {
-        const lept_enum* p = &tbl[i];
-        if (p->value == value)
-            return p->key;
+    const ll_enum_index_t *idx = enum_index_get(tbl);
+    if (!idx) {
+        for (size_t i = 0; i < len; i++)
+            if (tbl[i].value == value)
+                return tbl[i].key;
+        return "<undefined>";
     }
-    return "<undefined>";
+    auto it = std::lower_bound(idx->by_value.begin(), idx->by_value.end(), value,
+        [](const lept_enum *p, l_int32 v) {
+            return p->value < v;
+        });
+    if (it == idx->by_value.end() || (*it)->value != value)
+        return "<undefined>";
+    return (*it)->key;
 }
 
 /**
  * \brief Find a option %str in a lept_enum_t array %tbl of size %len.
+ *
+ * Lua strings are interned, so each Lua state keeps a table per
+ * lept_enum table in the registry (keyed by the light userdata %tbl),
+ * which maps the Lua strings seen so far to their values. Known
+ * strings are then found with a single raw table lookup.
+ *
  * \param _fun calling function's name
  * \param L Lua state.
  * \param arg index where to find the string
@@ -124,15 +249,45 @@ l_int32
 ll_check_tbl(const char *_fun, lua_State *L, int arg, l_int32 def, const lept_enum *tbl, size_t len)
 {
     char msg[256];
-    size_t i;
-
-    const char* str = lua_isstring(L, arg) ? lua_tostring(L, arg) : nullptr;
-    if (!str)
-        return def;
-
-    for (i = 0; i < len; i++) {
-        const lept_enum* p = &tbl[i];
-        if (!ll_strcasecmp(str, p->key))
+    const lept_enum *p;
+    size_t lstr = 0;
+    const char *str;
+
+    arg = lua_absindex(L, arg);
+    if (LUA_TSTRING == lua_type(L, arg)) {
+        /* Look up the interned string in this state's cache */
+        if (LUA_TTABLE != lua_rawgetp(L, LUA_REGISTRYINDEX, tbl)) {
+            lua_pop(L, 1);
+            lua_newtable(L);
+            lua_pushvalue(L, -1);
+            lua_rawsetp(L, LUA_REGISTRYINDEX, tbl);
+        }
+        lua_pushvalue(L, arg);
+        if (LUA_TNUMBER == lua_rawget(L, -2)) {
+            l_int32 value = static_cast<l_int32>(lua_tointeger(L, -1));
+            lua_pop(L, 2);
+            return value;
+        }
+        lua_pop(L, 1);
+
+        str = lua_tolstring(L, arg, &lstr);
+        p = ll_find_tbl(tbl, len, str, lstr);
+        if (p) {
+            /* Remember this string for the next call */
+            lua_pushvalue(L, arg);
+            lua_pushinteger(L, p->value);
+            lua_rawset(L, -3);
+            lua_pop(L, 1);
+            return p->value;
+        }
+        lua_pop(L, 1);
+    } else {
+        /* Numbers are converted, but not cached */
+        str = lua_isstring(L, arg) ? lua_tolstring(L, arg, &lstr) : nullptr;
+        if (!str)
+            return def;
+        p = ll_find_tbl(tbl, len, str, lstr);
+        if (p)
             return p->value;
     }
 
@@ -2883,3 +3038,67 @@ ll_check_color(const char *_fun, lua_State *L, int arg, l_uint32 *ppixel)
         return 1;
     return composeRGBAPixel(r, g, b, a, ppixel);
 }
+
+/**
+ * \brief Build the sorted indexes of all lept_enum tables in this file.
+ * Run once by enum_index_get(); the indexes are read-only afterwards.
+ */
+static void
+enum_index_build(void)
+{
+    static const struct {
+        const lept_enum *tbl;
+        size_t len;
+    } tables[] = {
+        {tbl_debug, ARRAYSIZE(tbl_debug)},
+        {tbl_access_storage, ARRAYSIZE(tbl_access_storage)},
+        {tbl_more_less_clip, ARRAYSIZE(tbl_more_less_clip)},
+        {tbl_encoding, ARRAYSIZE(tbl_encoding)},
+        {tbl_input_format, ARRAYSIZE(tbl_input_format)},
+        {tbl_keytype, ARRAYSIZE(tbl_keytype)},
+        {tbl_consecutive_skip_by, ARRAYSIZE(tbl_consecutive_skip_by)},
+        {tbl_text_orientation, ARRAYSIZE(tbl_text_orientation)},
+        {tbl_edge_orientation, ARRAYSIZE(tbl_edge_orientation)},
+        {tbl_component, ARRAYSIZE(tbl_component)},
+        {tbl_compression, ARRAYSIZE(tbl_compression)},
+        {tbl_choose_min_max, ARRAYSIZE(tbl_choose_min_max)},
+        {tbl_what_is_max, ARRAYSIZE(tbl_what_is_max)},
+        {tbl_getval, ARRAYSIZE(tbl_getval)},
+        {tbl_direction, ARRAYSIZE(tbl_direction)},
+        {tbl_distance, ARRAYSIZE(tbl_distance)},
+        {tbl_set_black_white, ARRAYSIZE(tbl_set_black_white)},
+        {tbl_arithop, ARRAYSIZE(tbl_arithop)},
+        {tbl_rasterop, ARRAYSIZE(tbl_rasterop)},
+        {tbl_hint, ARRAYSIZE(tbl_hint)},
+        {tbl_searchdir, ARRAYSIZE(tbl_searchdir)},
+        {tbl_number_value, ARRAYSIZE(tbl_number_value)},
+        {tbl_position, ARRAYSIZE(tbl_position)},
+        {tbl_stats_type, ARRAYSIZE(tbl_stats_type)},
+        {tbl_select_color, ARRAYSIZE(tbl_select_color)},
+        {tbl_select_minmax, ARRAYSIZE(tbl_select_minmax)},
+        {tbl_sel, ARRAYSIZE(tbl_sel)},
+        {tbl_select_size, ARRAYSIZE(tbl_select_size)},
+        {tbl_sort_by, ARRAYSIZE(tbl_sort_by)},
+        {tbl_set_side, ARRAYSIZE(tbl_set_side)},
+        {tbl_from_side, ARRAYSIZE(tbl_from_side)},
+        {tbl_adjust_sides, ARRAYSIZE(tbl_adjust_sides)},
+        {tbl_location, ARRAYSIZE(tbl_location)},
+        {tbl_sort_mode, ARRAYSIZE(tbl_sort_mode)},
+        {tbl_sort_order, ARRAYSIZE(tbl_sort_order)},
+        {tbl_trans_order, ARRAYSIZE(tbl_trans_order)},
+        {tbl_region, ARRAYSIZE(tbl_region)},
+        {tbl_relation, ARRAYSIZE(tbl_relation)},
+        {tbl_rotation, ARRAYSIZE(tbl_rotation)},
+        {tbl_overlap, ARRAYSIZE(tbl_overlap)},
+        {tbl_subflag, ARRAYSIZE(tbl_subflag)},
+        {tbl_useflag, ARRAYSIZE(tbl_useflag)},
+        {tbl_negvals, ARRAYSIZE(tbl_negvals)},
+        {tbl_value_flags, ARRAYSIZE(tbl_value_flags)},
+        {tbl_paint_flags, ARRAYSIZE(tbl_paint_flags)},
+        {tbl_pts_flag, ARRAYSIZE(tbl_pts_flag)},
+        {tbl_coord_type, ARRAYSIZE(tbl_coord_type)},
+        {tbl_color_name, ARRAYSIZE(tbl_color_name)}
+    };
+    for (size_t i = 0; i < ARRAYSIZE(tables); i++)
+        enum_index_add(tables[i].tbl, tables[i].len);
+}
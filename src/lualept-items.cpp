@@ -0,0 +1,429 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+/**
+ * \file lualept-items.cpp
+ * Values and objects moved from one Lua state to another.
+ *
+ * An ll_item_t holds either a copied value (see ll_capture_arg()), or an
+ * object of one of the classes in item_types[], which is taken out of its
+ * user data (see ll_take_udata()) and later pushed to the receiving state
+ * with its class' push function. Channel, SharedQueue and SharedStack
+ * keep their elements as ll_item_t.
+ *
+ * An object can also be pinned (see ll_pin_item()): it stays with its
+ * user data, which can not be used until it is unpinned, and is lent to
+ * the receiving state as a borrowed user data (see Pix:Async()).
+ */
+
+/**
+ * The structure ll_item_type_s describes a class whose objects can be
+ * moved between Lua states.
+ */
+struct ll_item_type_s {
+    const char *tname;                                          /*!< class name */
+    void      (*destroy)(void *ptr);                            /*!< destroy an object which was not received */
+    int       (*push)(const char *_fun, lua_State *L, void *ptr); /*!< push an object to the receiving state */
+    bool      (*busy)(void *ptr);                               /*!< true if the object is also referenced elsewhere, or nullptr */
+};
+
+/**
+ * \brief Destroy an object of type T with its Leptonica destructor D.
+ * \param ptr pointer to the object
+ */
+template<typename T, void (*D)(T **)> static void
+destroy_object(void *ptr)
+{
+    T *obj = reinterpret_cast<T *>(ptr);
+    D(&obj);
+}
+
+/**
+ * \brief Push an object of type T with its lualept push function P.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param ptr pointer to the object
+ * \return 1 user data on the Lua stack.
+ */
+template<typename T, int (*P)(const char *, lua_State *, T *)> static int
+push_object(const char *_fun, lua_State *L, void *ptr)
+{
+    return P(_fun, L, reinterpret_cast<T *>(ptr));
+}
+
+/**
+ * \brief Return true if the object (%ptr) of type T has clones.
+ * <pre>
+ * Leptonica's reference counts are not atomic, so an object which is
+ * also referenced elsewhere in the state, e.g. by a clone, can not be
+ * moved to another thread.
+ * </pre>
+ * \param ptr pointer to the object
+ * \return true if the reference count is greater than 1.
+ */
+template<typename T> static bool
+refcount_busy(void *ptr)
+{
+    return reinterpret_cast<T *>(ptr)->refcount > 1;
+}
+
+/**
+ * \brief Return true if the Boxa* (%boxa) or one of its Box* has clones.
+ * \param boxa pointer to the Boxa, or nullptr
+ * \return true if the Boxa* or a Box* is referenced elsewhere.
+ */
+static bool
+boxa_members_busy(Boxa *boxa)
+{
+    if (!boxa)
+        return false;
+    if (boxa->refcount > 1)
+        return true;
+    for (l_int32 i = 0; i < boxa->n; i++)
+        if (boxa->box[i] && boxa->box[i]->refcount > 1)
+            return true;
+    return false;
+}
+
+/**
+ * \brief Return true if the Pixa* (%pixa), its Boxa* or one of its Pix* has clones.
+ * \param pixa pointer to the Pixa, or nullptr
+ * \return true if the Pixa* or a member is referenced elsewhere.
+ */
+static bool
+pixa_members_busy(Pixa *pixa)
+{
+    if (!pixa)
+        return false;
+    if (pixa->refcount > 1)
+        return true;
+    for (l_int32 i = 0; i < pixa->n; i++)
+        if (pixa->pix[i] && pixa->pix[i]->refcount > 1)
+            return true;
+    return boxa_members_busy(pixa->boxa);
+}
+
+/**
+ * \brief Return true if a member of the container (%ptr) of type T has clones.
+ * <pre>
+ * The containers without a reference count of their own (Numaa, Ptaa)
+ * hand out clones of their members, which must not be referenced elsewhere.
+ * </pre>
+ * \param ptr pointer to the container
+ * \return true if a member is referenced elsewhere.
+ */
+template<typename T, typename M, M **T::*A> static bool
+members_busy(void *ptr)
+{
+    T *obj = reinterpret_cast<T *>(ptr);
+    for (l_int32 i = 0; i < obj->n; i++)
+        if ((obj->*A)[i] && (obj->*A)[i]->refcount > 1)
+            return true;
+    return false;
+}
+
+/**
+ * \brief Return true if the Boxa* (%ptr) or one of its Box* has clones.
+ * \param ptr pointer to the Boxa
+ * \return true if referenced elsewhere.
+ */
+static bool
+boxa_busy(void *ptr)
+{
+    return boxa_members_busy(reinterpret_cast<Boxa *>(ptr));
+}
+
+/**
+ * \brief Return true if one of the Boxa* in the Boxaa* (%ptr) or their Box* has clones.
+ * \param ptr pointer to the Boxaa
+ * \return true if referenced elsewhere.
+ */
+static bool
+boxaa_busy(void *ptr)
+{
+    Boxaa *baa = reinterpret_cast<Boxaa *>(ptr);
+    for (l_int32 i = 0; i < baa->n; i++)
+        if (boxa_members_busy(baa->boxa[i]))
+            return true;
+    return false;
+}
+
+/**
+ * \brief Return true if the FPixa* (%ptr) or one of its FPix* has clones.
+ * \param ptr pointer to the FPixa
+ * \return true if referenced elsewhere.
+ */
+static bool
+fpixa_busy(void *ptr)
+{
+    FPixa *fpixa = reinterpret_cast<FPixa *>(ptr);
+    return fpixa->refcount > 1 || members_busy<FPixa, FPix, &FPixa::fpix>(ptr);
+}
+
+/**
+ * \brief Return true if the Pixa* (%ptr), its Boxa* or one of its Pix* has clones.
+ * \param ptr pointer to the Pixa
+ * \return true if referenced elsewhere.
+ */
+static bool
+pixa_busy(void *ptr)
+{
+    return pixa_members_busy(reinterpret_cast<Pixa *>(ptr));
+}
+
+/**
+ * \brief Return true if a Pixa* of the Pixaa* (%ptr), its members, or the Boxa* has clones.
+ * \param ptr pointer to the Pixaa
+ * \return true if referenced elsewhere.
+ */
+static bool
+pixaa_busy(void *ptr)
+{
+    Pixaa *paa = reinterpret_cast<Pixaa *>(ptr);
+    for (l_int32 i = 0; i < paa->n; i++)
+        if (pixa_members_busy(paa->pixa[i]))
+            return true;
+    return boxa_members_busy(paa->boxa);
+}
+
+/**
+ * \brief Return true if the Boxa* of the PixaComp* (%ptr) has clones.
+ * \param ptr pointer to the PixaComp
+ * \return true if referenced elsewhere.
+ */
+static bool
+pixacomp_busy(void *ptr)
+{
+    return boxa_members_busy(reinterpret_cast<PixaComp *>(ptr)->boxa);
+}
+
+/** Use this macro to define one entry in item_types[] */
+#define LL_ITEM_TYPE(tname, type, destroy, push, busy) \
+    {tname, destroy_object<type, destroy>, push_object<type, push>, busy}
+
+/**
+ * Classes whose objects can be moved between Lua states.
+ * Their objects must not be referenced elsewhere, e.g. by a clone or
+ * by a container, which the busy check of each refcounted class tests.
+ * Kernel, PixComp, Sel and Sela can not be cloned.
+ */
+static const ll_item_type_t item_types[] = {
+    LL_ITEM_TYPE(LL_BOX,        Box,        boxDestroy,         ll_push_Box,        refcount_busy<Box>),
+    LL_ITEM_TYPE(LL_BOXA,       Boxa,       boxaDestroy,        ll_push_Boxa,       boxa_busy),
+    LL_ITEM_TYPE(LL_BOXAA,      Boxaa,      boxaaDestroy,       ll_push_Boxaa,      boxaa_busy),
+    LL_ITEM_TYPE(LL_BYTEA,      Bytea,      l_byteaDestroy,     ll_push_Bytea,      refcount_busy<Bytea>),
+    LL_ITEM_TYPE(LL_DNA,        Dna,        l_dnaDestroy,       ll_push_Dna,        refcount_busy<Dna>),
+    LL_ITEM_TYPE(LL_DPIX,       DPix,       dpixDestroy,        ll_push_DPix,       refcount_busy<DPix>),
+    LL_ITEM_TYPE(LL_FPIX,       FPix,       fpixDestroy,        ll_push_FPix,       refcount_busy<FPix>),
+    LL_ITEM_TYPE(LL_FPIXA,      FPixa,      fpixaDestroy,       ll_push_FPixa,      fpixa_busy),
+    LL_ITEM_TYPE(LL_KERNEL,     Kernel,     kernelDestroy,      ll_push_Kernel,     nullptr),
+    LL_ITEM_TYPE(LL_NUMA,       Numa,       numaDestroy,        ll_push_Numa,       refcount_busy<Numa>),
+    LL_ITEM_TYPE(LL_NUMAA,      Numaa,      numaaDestroy,       ll_push_Numaa,      (members_busy<Numaa, Numa, &Numaa::numa>)),
+    LL_ITEM_TYPE(LL_PIX,        Pix,        pixDestroy,         ll_push_Pix,        refcount_busy<Pix>),
+    LL_ITEM_TYPE(LL_PIXA,       Pixa,       pixaDestroy,        ll_push_Pixa,       pixa_busy),
+    LL_ITEM_TYPE(LL_PIXAA,      Pixaa,      pixaaDestroy,       ll_push_Pixaa,      pixaa_busy),
+    LL_ITEM_TYPE(LL_PIXCOMP,    PixComp,    pixcompDestroy,     ll_push_PixComp,    nullptr),
+    LL_ITEM_TYPE(LL_PIXACOMP,   PixaComp,   pixacompDestroy,    ll_push_PixaComp,   pixacomp_busy),
+    LL_ITEM_TYPE(LL_PTA,        Pta,        ptaDestroy,         ll_push_Pta,        refcount_busy<Pta>),
+    LL_ITEM_TYPE(LL_PTAA,       Ptaa,       ptaaDestroy,        ll_push_Ptaa,       (members_busy<Ptaa, Pta, &Ptaa::pta>)),
+    LL_ITEM_TYPE(LL_SARRAY,     Sarray,     sarrayDestroy,      ll_push_Sarray,     refcount_busy<Sarray>),
+    LL_ITEM_TYPE(LL_SEL,        Sel,        selDestroy,         ll_push_Sel,        nullptr),
+    LL_ITEM_TYPE(LL_SELA,       Sela,       selaDestroy,        ll_push_Sela,       nullptr)
+};
+
+/**
+ * \brief Find the item type of the user data at %arg.
+ * \param L Lua state.
+ * \param arg index of the user data
+ * \return pointer to the ll_item_type_t, or nullptr if the class can not be moved.
+ */
+static const ll_item_type_t *
+item_type(lua_State *L, int arg)
+{
+    const ll_item_type_t *type = nullptr;
+    size_t i;
+
+    if (LUA_TSTRING != luaL_getmetafield(L, arg, "__name"))
+        return nullptr;
+    for (i = 0; i < ARRAYSIZE(item_types) && !type; i++)
+        if (!strcmp(lua_tostring(L, -1), item_types[i].tname))
+            type = &item_types[i];
+    lua_pop(L, 1);
+    return type;
+}
+
+/**
+ * \brief Check that the value at %arg can be moved to another Lua state.
+ * <pre>
+ * Objects of the classes in item_types[] are moved; they must not be
+ * empty, owned by the host (unless LL_ITEM_HOST_OK is in %flags), or
+ * referenced elsewhere (unless LL_ITEM_SHARED_OK is in %flags).
+ * Values accepted by ll_capture_arg() other than nil are copied or
+ * passed by reference.
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index of the value
+ * \param flags LL_ITEM_HOST_OK and LL_ITEM_SHARED_OK, or 0
+ * \return pointer to the ll_item_type_t of an object, nullptr for other values, or die on error.
+ */
+const ll_item_type_t *
+ll_check_item(const char *_fun, lua_State *L, int arg, l_uint32 flags)
+{
+    const ll_item_type_t *type = nullptr;
+    void *ptr = nullptr;
+
+    switch (lua_type(L, arg)) {
+    case LUA_TNONE:
+    case LUA_TNIL:
+        die(_fun, L, "can not move nil at #%d", arg);
+        return nullptr;
+    case LUA_TBOOLEAN:
+    case LUA_TNUMBER:
+    case LUA_TSTRING:
+        return nullptr;
+    case LUA_TUSERDATA:
+        if (ll_isudata(_fun, L, arg, LL_SHAREDPIX) || ll_isudata(_fun, L, arg, LL_CHANNEL) ||
+            ll_isudata(_fun, L, arg, LL_SHAREDQUEUE) || ll_isudata(_fun, L, arg, LL_SHAREDSTACK))
+            return nullptr;
+        type = item_type(L, arg);
+        break;
+    }
+    if (!type) {
+        die(_fun, L, "can not move %s at #%d to another state", luaL_typename(L, arg), arg);
+        return nullptr;
+    }
+    ptr = *ll_check_udata<void>(_fun, L, arg, type->tname);
+    if (!ptr) {
+        die(_fun, L, "%s* at #%d is empty", type->tname, arg);
+        return nullptr;
+    }
+    if (!(flags & LL_ITEM_HOST_OK) && ll_udata_borrowed(L, arg)) {
+        die(_fun, L, "%s* at #%d is owned by the host", type->tname, arg);
+        return nullptr;
+    }
+    if (!(flags & LL_ITEM_SHARED_OK) && type->busy && type->busy(ptr)) {
+        die(_fun, L, "%s* at #%d is referenced elsewhere; move a copy", type->tname, arg);
+        return nullptr;
+    }
+    return type;
+}
+
+/**
+ * \brief Take the value at %arg checked by ll_check_item() into %item.
+ * <pre>
+ * An object is taken out of its user data, which is empty afterwards.
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index of the value
+ * \param type the result of ll_check_item()
+ * \param item pointer to the ll_item_t to fill
+ */
+void
+ll_take_item(const char *_fun, lua_State *L, int arg, const ll_item_type_t *type, ll_item_t *item)
+{
+    item->type = type;
+    item->ptr = nullptr;
+    item->pinned = false;
+    if (type) {
+        item->value = ll_worker_arg_t();
+        item->ptr = ll_take_udata<void>(_fun, L, arg, type->tname);
+    } else {
+        ll_capture_arg(L, arg, &item->value);
+    }
+}
+
+/**
+ * \brief Pin the object at %arg checked by ll_check_item() into %item.
+ * <pre>
+ * The user data keeps the object, but raises an error on every use until
+ * it is unpinned with ll_udata_pin(). The object must not be destroyed
+ * by the receiving state, which gets it as a borrowed user data.
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index of the object
+ * \param type the result of ll_check_item(), not nullptr
+ * \param item pointer to the ll_item_t to fill
+ */
+void
+ll_pin_item(const char *_fun, lua_State *L, int arg, const ll_item_type_t *type, ll_item_t *item)
+{
+    item->value = ll_worker_arg_t();
+    item->type = type;
+    item->ptr = *ll_check_udata<void>(_fun, L, arg, type->tname);
+    item->pinned = true;
+    ll_udata_pin(L, arg, true);
+}
+
+/**
+ * \brief Push the value or object of %item to the Lua stack.
+ * A moved object is owned by the new user data, a pinned object is
+ * borrowed by it; %item is freed.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param item pointer to the ll_item_t
+ * \return 1 value on the Lua stack.
+ */
+int
+ll_push_item(const char *_fun, lua_State *L, ll_item_t *item)
+{
+    void *ptr = item->ptr;
+    item->ptr = nullptr;
+    if (item->type && item->pinned) {
+        ll_push_udata(_fun, L, item->type->tname, ptr);
+        ll_udata_borrow(_fun, L, -1);
+    } else if (item->type) {
+        item->type->push(_fun, L, ptr);
+    } else {
+        ll_push_arg(_fun, L, &item->value);
+    }
+    ll_free_item(item);
+    return 1;
+}
+
+/**
+ * \brief Free the value or object held by %item.
+ * \param item pointer to the ll_item_t
+ */
+void
+ll_free_item(ll_item_t *item)
+{
+    if (item->type && item->ptr && !item->pinned)
+        item->type->destroy(item->ptr);
+    item->type = nullptr;
+    item->ptr = nullptr;
+    item->pinned = false;
+    ll_free_arg(&item->value);
+}
@@ -0,0 +1,188 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+/**
+ * \file lualept-mapped.cpp
+ * Read-only memory mapped input files.
+ *
+ * Reading an image with pixRead() goes through a FILE* and stdio buffers,
+ * and pixReadMem() from a Lua string needs the whole file copied into the
+ * string first. Pix.ReadMapped() and Pixa.ReadMappedFiles() instead map
+ * the file and hand the mapping to pixReadMem() (or pixReadMemTiff()), so
+ * that the compressed data is paged in by the kernel, with a hint that it
+ * is read sequentially, and never copied.
+ *
+ * Where mmap() is not available, or fails (e.g. for a pipe), the file is
+ * read into a buffer instead. The bytes mapped and copied are counted per
+ * Lua state and returned by LuaLept:MemoryStats().
+ */
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP) && defined(HAVE_FCNTL_H) && defined(HAVE_UNISTD_H)
+#define LL_HAVE_MAPPED_FILES    1
+#endif
+
+/**
+ * \brief Map the file (%filename) with mmap().
+ * \param filename name of the file
+ * \param mf pointer to the ll_mapped_file_t to fill in
+ * \return true on success, false if the file could not be mapped.
+ */
+static bool
+map_file(const char *filename, ll_mapped_file_t *mf)
+{
+#if defined(LL_HAVE_MAPPED_FILES)
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return false;
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void *ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    /* the mapping stays valid after the descriptor is closed */
+    close(fd);
+    if (MAP_FAILED == ptr)
+        return false;
+#if defined(HAVE_MADVISE) && defined(MADV_SEQUENTIAL)
+    madvise(ptr, size, MADV_SEQUENTIAL);
+#endif
+#if defined(HAVE_MADVISE) && defined(MADV_WILLNEED)
+    madvise(ptr, size, MADV_WILLNEED);
+#endif
+    mf->data = reinterpret_cast<const l_uint8 *>(ptr);
+    mf->size = size;
+    mf->mapped = true;
+    return true;
+#else
+    UNUSED(filename);
+    UNUSED(mf);
+    return false;
+#endif
+}
+
+/**
+ * \brief Read the file (%filename) into a buffer.
+ * \param filename name of the file
+ * \param mf pointer to the ll_mapped_file_t to fill in
+ * \return true on success, false if the file could not be read.
+ */
+static bool
+copy_file(const char *filename, ll_mapped_file_t *mf)
+{
+    size_t size = 0;
+    l_uint8 *data = l_binaryRead(filename, &size);
+    if (!data)
+        return false;
+    mf->data = data;
+    mf->size = size;
+    mf->mapped = false;
+    return true;
+}
+
+/**
+ * \brief Make the contents of the file (%filename) available in memory.
+ * <pre>
+ * The file is mapped read-only if possible, otherwise it is read into a
+ * buffer. Release it with ll_unmap_file().
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param filename name of the file
+ * \param mf pointer to the ll_mapped_file_t to fill in
+ * \return true on success, false if the file could not be read.
+ */
+bool
+ll_map_file(const char *_fun, lua_State *L, const char *filename, ll_mapped_file_t *mf)
+{
+    ll_memstats_t *ms = ll_memstats(_fun, L);
+
+    *mf = ll_mapped_file_t();
+    if (map_file(filename, mf)) {
+        ms->mapped += static_cast<l_int64>(mf->size);
+        ms->nmapped++;
+        return true;
+    }
+    if (copy_file(filename, mf)) {
+        ms->copied += static_cast<l_int64>(mf->size);
+        ms->ncopied++;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * \brief Release the contents of a file made available by ll_map_file().
+ * \param mf pointer to the ll_mapped_file_t
+ */
+void
+ll_unmap_file(ll_mapped_file_t *mf)
+{
+    if (!mf->data)
+        return;
+#if defined(LL_HAVE_MAPPED_FILES)
+    if (mf->mapped)
+        munmap(const_cast<l_uint8 *>(mf->data), mf->size);
+    else
+#endif
+        LEPT_FREE(const_cast<l_uint8 *>(mf->data));
+    *mf = ll_mapped_file_t();
+}
+
+/**
+ * \brief Read a Pix* from the file (%filename) through ll_map_file().
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param filename name of the file
+ * \param page page of a multipage TIFF (0 based), or -1 for any format
+ * \return pointer to the Pix*, or nullptr on error.
+ */
+Pix *
+ll_read_mapped_pix(const char *_fun, lua_State *L, const char *filename, l_int32 page)
+{
+    ll_mapped_file_t mf;
+    Pix *pix = nullptr;
+
+    if (!ll_map_file(_fun, L, filename, &mf)) {
+        ERROR_INT("file can not be read", _fun, 1);
+        return nullptr;
+    }
+    if (page < 0) {
+        pix = pixReadMem(mf.data, mf.size);
+    } else {
+        pix = pixReadMemTiff(mf.data, mf.size, page);
+    }
+    ll_unmap_file(&mf);
+    return pix;
+}
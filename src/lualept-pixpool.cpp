@@ -0,0 +1,299 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * \file lualept-pixpool.cpp
+ * A pool of Pix raster data installed with setPixMemoryManager().
+ *
+ * Rasters are rounded up to page size (or huge page size) classes.
+ * Freed rasters are kept on a free list per class, up to a cap of
+ * cached bytes, and handed out again for the next raster of that class,
+ * avoiding the malloc(), page faults and zeroing of fresh memory.
+ *
+ * Leptonica's memory manager is process wide, so is the pool.
+ * It is installed only when the host or a script opts in, i.e. enables
+ * the pool (see ll_set_pixpool()) or creates a SharedPix. Raster data
+ * which was not allocated by the pool (e.g. set with pixSetData() from
+ * a LEPT_MALLOC() buffer) is passed on to free(); while no pool block
+ * is live, the deallocator does so without taking the mutex.
+ * Pool blocks never leave a Pix*; Pix:ExtractData() copies the raster.
+ *
+ * The deallocator also drops the references of SharedPix rasters,
+ * which are freed only when their last view goes away.
+ */
+
+/** Granularity of the size classes */
+#define LL_PIXPOOL_PAGE         (4096)
+
+/** Granularity of the size classes backed by huge pages */
+#define LL_PIXPOOL_HUGEPAGE     (2 * 1024 * 1024)
+
+/** Flag in the size of a block: the block was mmap()ed */
+#define LL_PIXPOOL_MAPPED       (1)
+
+/** Mutex guarding the pool */
+static std::mutex pool_mutex;
+
+/** Configuration of the pool */
+static ll_pixpool_t pool_config = {0, 0, false};
+
+/** Statistics of the pool */
+static ll_pixpool_stats_t pool_stats;
+
+/** Size class (with LL_PIXPOOL_MAPPED flag) of the blocks handed out */
+static std::unordered_map<void *, size_t> pool_live;
+
+/** Number of entries in pool_live, to skip the lookup while there are none */
+static std::atomic<size_t> pool_live_count(0);
+
+/** True while pool_config.max_bytes > 0, to bypass the pool without the mutex */
+static std::atomic<bool> pool_enabled(false);
+
+/** Free lists of cached blocks per size class (with LL_PIXPOOL_MAPPED flag) */
+static std::map<size_t, std::vector<void *>> pool_free;
+
+/** True once the memory manager is installed */
+static bool pool_installed = false;
+
+/**
+ * \brief Allocate a new block for size class (%pcls).
+ * \param pcls pointer to the size class; LL_PIXPOOL_MAPPED is set if the block was mmap()ed
+ * \return pointer to the block, or nullptr on failure.
+ */
+static void *
+pool_block_alloc(size_t *pcls)
+{
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP) && defined(MADV_HUGEPAGE)
+    if (pool_config.hugepages && *pcls >= LL_PIXPOOL_HUGEPAGE) {
+        void *ptr = mmap(nullptr, *pcls, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (MAP_FAILED != ptr) {
+            madvise(ptr, *pcls, MADV_HUGEPAGE);
+            *pcls |= LL_PIXPOOL_MAPPED;
+            return ptr;
+        }
+    }
+#endif
+    return malloc(*pcls);
+}
+
+/**
+ * \brief Release a block of size class (%cls) to the system.
+ * \param ptr pointer to the block
+ * \param cls size class (with LL_PIXPOOL_MAPPED flag)
+ */
+static void
+pool_block_free(void *ptr, size_t cls)
+{
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+    if (cls & LL_PIXPOOL_MAPPED) {
+        munmap(ptr, cls & ~static_cast<size_t>(LL_PIXPOOL_MAPPED));
+        return;
+    }
+#endif
+    UNUSED(cls);
+    free(ptr);
+}
+
+/**
+ * \brief Release cached blocks until at most (%limit) bytes are cached.
+ * The caller holds pool_mutex.
+ * \param limit number of bytes to keep
+ */
+static void
+pool_trim(size_t limit)
+{
+    auto it = pool_free.begin();
+    while (pool_stats.cached_bytes > limit && it != pool_free.end()) {
+        size_t size = it->first & ~static_cast<size_t>(LL_PIXPOOL_MAPPED);
+        while (pool_stats.cached_bytes > limit && !it->second.empty()) {
+            pool_block_free(it->second.back(), it->first);
+            it->second.pop_back();
+            pool_stats.cached_bytes -= size;
+            pool_stats.cached_blocks--;
+            pool_stats.trimmed++;
+        }
+        it = it->second.empty() ? pool_free.erase(it) : std::next(it);
+    }
+}
+
+/**
+ * \brief Allocator for Pix raster data (see setPixMemoryManager()).
+ * \param size number of bytes
+ * \return pointer to the raster data.
+ */
+static void *
+pool_alloc(size_t size)
+{
+    if (!pool_enabled.load(std::memory_order_relaxed))
+        return malloc(size);
+
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    size_t gran = pool_config.hugepages && size >= LL_PIXPOOL_HUGEPAGE ?
+                LL_PIXPOOL_HUGEPAGE : LL_PIXPOOL_PAGE;
+    size_t cls = (size + gran - 1) / gran * gran;
+    void *ptr = nullptr;
+
+    if (0 == pool_config.max_bytes || size < pool_config.min_bytes) {
+        pool_stats.bypassed++;
+        return malloc(size);
+    }
+
+    /* look for a cached block of this class, mmap()ed or not */
+    for (size_t flag = 0; flag <= LL_PIXPOOL_MAPPED && !ptr; flag++) {
+        auto it = pool_free.find(cls | flag);
+        if (it == pool_free.end() || it->second.empty())
+            continue;
+        ptr = it->second.back();
+        it->second.pop_back();
+        cls |= flag;
+        pool_stats.cached_bytes -= cls & ~static_cast<size_t>(LL_PIXPOOL_MAPPED);
+        pool_stats.cached_blocks--;
+    }
+
+    if (ptr) {
+        pool_stats.hits++;
+    } else {
+        pool_stats.misses++;
+        ptr = pool_block_alloc(&cls);
+        if (!ptr)
+            return nullptr;
+    }
+    pool_live[ptr] = cls;
+    pool_live_count++;
+    pool_stats.live_bytes += cls & ~static_cast<size_t>(LL_PIXPOOL_MAPPED);
+    pool_stats.live_blocks++;
+    return ptr;
+}
+
+/**
+ * \brief Deallocator for Pix raster data (see setPixMemoryManager()).
+ * \param ptr pointer to the raster data
+ */
+static void
+pool_dealloc(void *ptr)
+{
+    if (ll_shared_raster_unref(ptr)) {
+        /* a SharedPix raster still referenced by other views */
+        return;
+    }
+    if (0 == pool_live_count.load()) {
+        /* no pool block is live, so this is not one of ours */
+        free(ptr);
+        return;
+    }
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    auto it = pool_live.find(ptr);
+    if (it == pool_live.end()) {
+        /* not one of ours */
+        lock.unlock();
+        free(ptr);
+        return;
+    }
+    size_t cls = it->second;
+    size_t size = cls & ~static_cast<size_t>(LL_PIXPOOL_MAPPED);
+    pool_live.erase(it);
+    pool_live_count--;
+    pool_stats.live_bytes -= size;
+    pool_stats.live_blocks--;
+    if (pool_stats.cached_bytes + size > pool_config.max_bytes) {
+        pool_stats.released++;
+        pool_block_free(ptr, cls);
+        return;
+    }
+    pool_free[cls].push_back(ptr);
+    pool_stats.cached_bytes += size;
+    pool_stats.cached_blocks++;
+}
+
+/**
+ * \brief Configure the pool of Pix raster data.
+ * The memory manager is installed on first use and stays installed,
+ * so that blocks handed out earlier are returned to the pool.
+ * A %max_bytes of 0 disables pooling and releases all cached blocks.
+ * \param pool pointer to the configuration
+ * \return 0 on success.
+ */
+int
+ll_set_pixpool(const ll_pixpool_t *pool)
+{
+    if (!pool)
+        return 1;
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    pool_config = *pool;
+    pool_enabled = pool_config.max_bytes > 0;
+    pool_trim(pool_config.max_bytes);
+    if (!pool_installed && pool_config.max_bytes > 0) {
+        setPixMemoryManager(pool_alloc, pool_dealloc);
+        pool_installed = true;
+    }
+    return 0;
+}
+
+/**
+ * \brief Install the memory manager for SharedPix, even if pooling is disabled.
+ * SharedPix rasters rely on the deallocator to count their views. Without
+ * the pool, allocation is malloc() and freeing is free() after the SharedPix
+ * lookup, which is skipped while there are no shared rasters.
+ */
+void
+ll_pixpool_install(void)
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    if (!pool_installed) {
+        setPixMemoryManager(pool_alloc, pool_dealloc);
+        pool_installed = true;
+    }
+}
+
+/**
+ * \brief Get the configuration and statistics of the pool of Pix raster data.
+ * \param pool pointer to a ll_pixpool_t to fill (may be nullptr)
+ * \param stats pointer to a ll_pixpool_stats_t to fill (may be nullptr)
+ * \return 0 on success.
+ */
+int
+ll_get_pixpool(ll_pixpool_t *pool, ll_pixpool_stats_t *stats)
+{
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    if (pool)
+        *pool = pool_config;
+    if (stats)
+        *stats = pool_stats;
+    return 0;
+}
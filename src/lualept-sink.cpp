@@ -0,0 +1,269 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+/**
+ * \file lualept-sink.cpp
+ * Streams writing encoded data to a Lua function or io handle.
+ *
+ * The WriteMem functions encode the complete file into a buffer, copy it
+ * into a Lua string and free the buffer, so the peak memory is twice the
+ * size of the output, and nothing is available before encoding is done.
+ * A sink instead is a FILE* passed to Leptonica's stream writers: when the
+ * sink is an io handle, this is its FILE*; when it is a function, it is a
+ * FILE* opened with fopencookie() (or funopen() on BSD) whose buffer is
+ * passed to the function as a Lua string each time it fills up.
+ *
+ * Where neither is available, a temporary file is written and passed to
+ * the function in chunks after encoding.
+ *
+ * An error raised by the function makes the write fail; it is raised
+ * again when the sink is closed.
+ */
+
+#if defined(HAVE_FOPENCOOKIE)
+#define LL_SINK_COOKIE  1
+#elif defined(HAVE_FUNOPEN)
+#define LL_SINK_FUNOPEN 1
+#endif
+
+/**
+ * \brief Write a chunk of data to a sink function.
+ * \param sink pointer to the ll_sink_t
+ * \param data pointer to the data
+ * \param size number of bytes
+ * \return true on success, false if the function raised an error.
+ */
+static bool
+call_sink(ll_sink_t *sink, const char *data, size_t size)
+{
+    lua_State *L = sink->L;
+    if (LUA_NOREF != sink->error)
+        return false;
+    if (!lua_checkstack(L, 2)) {
+        lua_pushliteral(L, "stack overflow in sink");
+        sink->error = luaL_ref(L, LUA_REGISTRYINDEX);
+        return false;
+    }
+    lua_pushvalue(L, sink->arg);
+    lua_pushlstring(L, data, size);
+    if (LUA_OK != lua_pcall(L, 1, 0, 0)) {
+        sink->error = luaL_ref(L, LUA_REGISTRYINDEX);
+        return false;
+    }
+    sink->bytes += size;
+    sink->chunks++;
+    return true;
+}
+
+#if defined(LL_SINK_COOKIE)
+/**
+ * \brief Write function of a FILE* opened with fopencookie().
+ * \param cookie pointer to the ll_sink_t
+ * \param buf pointer to the data
+ * \param size number of bytes
+ * \return number of bytes written, or 0 on error.
+ */
+static ssize_t
+cookie_write(void *cookie, const char *buf, size_t size)
+{
+    ll_sink_t *sink = reinterpret_cast<ll_sink_t *>(cookie);
+    return call_sink(sink, buf, size) ? static_cast<ssize_t>(size) : 0;
+}
+#endif
+
+#if defined(LL_SINK_FUNOPEN)
+/**
+ * \brief Write function of a FILE* opened with funopen().
+ * \param cookie pointer to the ll_sink_t
+ * \param buf pointer to the data
+ * \param size number of bytes
+ * \return number of bytes written, or -1 on error.
+ */
+static int
+funopen_write(void *cookie, const char *buf, int size)
+{
+    ll_sink_t *sink = reinterpret_cast<ll_sink_t *>(cookie);
+    return call_sink(sink, buf, static_cast<size_t>(size)) ? size : -1;
+}
+#endif
+
+/**
+ * \brief Open a FILE* writing to the sink at index (%arg) on the Lua stack.
+ * <pre>
+ * The sink is either an io handle, which is written to directly, or a
+ * function called with each chunk of at most %chunk bytes as a string.
+ * Close the FILE* with ll_close_sink().
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index of the sink
+ * \param sink pointer to the ll_sink_t to fill in
+ * \param chunk size of the chunks passed to a function (0 for LL_SINK_CHUNK)
+ * \return FILE* to write to.
+ */
+FILE *
+ll_open_sink(const char *_fun, lua_State *L, int arg, ll_sink_t *sink, size_t chunk)
+{
+    *sink = ll_sink_t();
+    sink->L = L;
+    sink->arg = lua_absindex(L, arg);
+    sink->error = LUA_NOREF;
+    if (!chunk)
+        chunk = LL_SINK_CHUNK;
+
+    if (LUA_TFUNCTION != lua_type(L, arg)) {
+        luaL_Stream *stream = ll_check_stream(_fun, L, arg);
+        if (!stream->closef) {
+            die(_fun, L, "%s at #%d is closed", LUA_FILEHANDLE, arg);
+            return nullptr;
+        }
+        sink->fp = stream->f;
+        return sink->fp;
+    }
+
+#if defined(LL_SINK_COOKIE)
+    cookie_io_functions_t io = cookie_io_functions_t();
+    io.write = cookie_write;
+    sink->fp = fopencookie(sink, "wb", io);
+#elif defined(LL_SINK_FUNOPEN)
+    sink->fp = funopen(sink, nullptr, funopen_write, nullptr, nullptr);
+#else
+    /* allocated first, so that a failure leaks no open file */
+    sink->spool = ll_malloc<char>(_fun, L, chunk);
+    sink->fp = tmpfile();
+    sink->spooled = true;
+#endif
+    if (!sink->fp) {
+        ll_free(sink->spool);
+        sink->spool = nullptr;
+        die(_fun, L, "can not open a stream for the sink at #%d", arg);
+        return nullptr;
+    }
+    sink->owned = true;
+    sink->chunk = chunk;
+    setvbuf(sink->fp, nullptr, _IOFBF, chunk);
+    return sink->fp;
+}
+
+/**
+ * \brief Write a block of data (%data, %size) to a sink.
+ * <pre>
+ * For data which had to be encoded in memory, e.g. TIFF, which needs
+ * to seek in its output. A function sink gets it in chunks.
+ * </pre>
+ * \param sink pointer to the ll_sink_t
+ * \param data pointer to the data
+ * \param size number of bytes
+ * \return true on success, false on error.
+ */
+bool
+ll_write_sink(ll_sink_t *sink, const l_uint8 *data, size_t size)
+{
+    if (!sink->owned)
+        return size == fwrite(data, 1, size, sink->fp);
+    if (fflush(sink->fp))
+        return false;
+    while (size > 0) {
+        size_t n = size < sink->chunk ? size : sink->chunk;
+        if (!call_sink(sink, reinterpret_cast<const char *>(data), n))
+            return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+/**
+ * \brief Unpin the user data which was pinned while writing to a sink.
+ * \param L Lua state.
+ * \param sink pointer to the ll_sink_t
+ */
+static void
+unpin_sink(lua_State *L, ll_sink_t *sink)
+{
+    if (!sink->pinned)
+        return;
+    ll_udata_pin(L, sink->pinned, false);
+    sink->pinned = 0;
+}
+
+/**
+ * \brief Flush and close the FILE* of a sink.
+ * <pre>
+ * An io handle is flushed but stays open. If the sink function raised
+ * an error, that error is raised again now. The user data at %pinned,
+ * if any, is unpinned before that.
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param sink pointer to the ll_sink_t
+ * \return true on success, false if writing failed.
+ */
+bool
+ll_close_sink(const char *_fun, lua_State *L, ll_sink_t *sink)
+{
+    bool ok = true;
+
+    UNUSED(_fun);
+    if (!sink->fp) {
+        unpin_sink(L, sink);
+        return false;
+    }
+    if (!sink->owned) {
+        ok = 0 == fflush(sink->fp);
+        sink->fp = nullptr;
+        unpin_sink(L, sink);
+        return ok;
+    }
+    if (sink->spooled) {
+        size_t n;
+        ok = 0 == fflush(sink->fp);
+        rewind(sink->fp);
+        while (ok && (n = fread(sink->spool, 1, sink->chunk, sink->fp)) > 0)
+            ok = call_sink(sink, sink->spool, n);
+        ll_free(sink->spool);
+        sink->spool = nullptr;
+    }
+    if (fclose(sink->fp))
+        ok = false;
+    sink->fp = nullptr;
+    unpin_sink(L, sink);
+    if (LUA_NOREF != sink->error) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, sink->error);
+        luaL_unref(L, LUA_REGISTRYINDEX, sink->error);
+        sink->error = LUA_NOREF;
+        lua_error(L);
+        return false;    /* NOTREACHED */
+    }
+    return ok;
+}
@@ -0,0 +1,373 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+/**
+ * \file lualept-source.cpp
+ * Streams reading encoded data from a Lua function.
+ *
+ * To decode data which arrives in chunks, e.g. from a pipe or from a
+ * decompressor written in Lua, with ReadMem() the chunks must first be
+ * concatenated into one string. A source instead is a FILE* opened with
+ * fopencookie() (or funopen() on BSD) which calls the function whenever
+ * Leptonica's stream readers need more data. The function returns the
+ * next chunk as a string, and nil at the end of the data.
+ *
+ * Only the chunk being read is referenced. The readers rewind the stream
+ * after looking at the header, so the first LL_SOURCE_HEAD bytes are kept
+ * as well; seeking back behind that fails, and so does SEEK_END, because
+ * the size is not known before the last chunk. Readers which seek must
+ * get the data from ll_read_source() instead (see Pix.ReadFrom()). Where neither fopencookie()
+ * nor funopen() is available, the source is read into a temporary file.
+ */
+
+#if defined(HAVE_FOPENCOOKIE)
+#define LL_SOURCE_COOKIE    1
+#elif defined(HAVE_FUNOPEN)
+#define LL_SOURCE_FUNOPEN   1
+#endif
+
+/**
+ * \brief Get the next chunk from a source function.
+ * \param src pointer to the ll_source_t
+ * \return true if a chunk was read, false at the end of data or on error.
+ */
+static bool
+pull_chunk(ll_source_t *src)
+{
+    lua_State *L = src->L;
+    size_t len = 0;
+    const char *data = nullptr;
+
+    while (!src->eof && LUA_NOREF == src->error) {
+        if (!lua_checkstack(L, 1)) {
+            lua_pushliteral(L, "stack overflow in source");
+            src->error = luaL_ref(L, LUA_REGISTRYINDEX);
+            break;
+        }
+        lua_pushvalue(L, src->arg);
+        if (LUA_OK != lua_pcall(L, 0, 1, 0)) {
+            src->error = luaL_ref(L, LUA_REGISTRYINDEX);
+            break;
+        }
+        if (lua_isnil(L, -1)) {
+            lua_pop(L, 1);
+            src->eof = true;
+            break;
+        }
+        if (LUA_TSTRING != lua_type(L, -1)) {
+            lua_pushfstring(L, "source returned a %s instead of a string",
+                            luaL_typename(L, -1));
+            src->error = luaL_ref(L, LUA_REGISTRYINDEX);
+            lua_pop(L, 1);
+            break;
+        }
+        data = lua_tolstring(L, -1, &len);
+        if (!len) {
+            lua_pop(L, 1);
+            continue;
+        }
+        /* the string stays valid while it is referenced */
+        luaL_unref(L, LUA_REGISTRYINDEX, src->chunk);
+        src->chunk = luaL_ref(L, LUA_REGISTRYINDEX);
+        src->cdata = reinterpret_cast<const l_uint8 *>(data);
+        src->cstart = src->total;
+        src->clen = len;
+        src->total += len;
+        src->chunks++;
+        if (src->hlen < LL_SOURCE_HEAD && src->cstart == src->hlen) {
+            size_t n = LL_SOURCE_HEAD - src->hlen;
+            if (n > len)
+                n = len;
+            memcpy(src->head + src->hlen, data, n);
+            src->hlen += n;
+        }
+        return true;
+    }
+    return false;
+}
+
+#if defined(LL_SOURCE_COOKIE) || defined(LL_SOURCE_FUNOPEN)
+/**
+ * \brief Read up to %size bytes from the current position of a source.
+ * \param src pointer to the ll_source_t
+ * \param buf buffer to fill
+ * \param size size of the buffer
+ * \return number of bytes read, 0 at the end of data, or -1 on error.
+ */
+static ssize_t
+read_source(ll_source_t *src, char *buf, size_t size)
+{
+    size_t done = 0;
+
+    while (done < size) {
+        size_t pos = src->pos;
+        const l_uint8 *from = nullptr;
+        size_t avail = 0;
+        if (pos < src->hlen) {
+            from = src->head + pos;
+            avail = src->hlen - pos;
+        } else if (pos >= src->cstart && pos < src->cstart + src->clen) {
+            from = src->cdata + (pos - src->cstart);
+            avail = src->cstart + src->clen - pos;
+        } else if (pos >= src->total) {
+            /* skip over chunks when seeking forward */
+            if (!pull_chunk(src))
+                break;
+            continue;
+        } else {
+            /* the data at %pos is no longer available */
+            errno = ESPIPE;
+            return -1;
+        }
+        if (avail > size - done)
+            avail = size - done;
+        memcpy(buf + done, from, avail);
+        done += avail;
+        src->pos += avail;
+    }
+    if (!done && LUA_NOREF != src->error)
+        return -1;
+    return static_cast<ssize_t>(done);
+}
+
+/**
+ * \brief Move the current position of a source.
+ * \param src pointer to the ll_source_t
+ * \param offset offset relative to %whence
+ * \param whence SEEK_SET or SEEK_CUR; SEEK_END is not supported
+ * \return new position, or -1 on error.
+ */
+static l_int64
+seek_source(ll_source_t *src, l_int64 offset, int whence)
+{
+    l_int64 pos;
+    switch (whence) {
+    case SEEK_SET:
+        pos = offset;
+        break;
+    case SEEK_CUR:
+        pos = static_cast<l_int64>(src->pos) + offset;
+        break;
+    default:
+        errno = ESPIPE;
+        return -1;
+    }
+    if (pos < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    src->pos = static_cast<size_t>(pos);
+    return pos;
+}
+
+#endif
+
+#if defined(LL_SOURCE_COOKIE)
+/**
+ * \brief Read function of a FILE* opened with fopencookie().
+ * \param cookie pointer to the ll_source_t
+ * \param buf buffer to fill
+ * \param size size of the buffer
+ * \return number of bytes read, 0 at the end of data, or -1 on error.
+ */
+static ssize_t
+cookie_read(void *cookie, char *buf, size_t size)
+{
+    return read_source(reinterpret_cast<ll_source_t *>(cookie), buf, size);
+}
+
+/**
+ * \brief Seek function of a FILE* opened with fopencookie().
+ * \param cookie pointer to the ll_source_t
+ * \param offset pointer to the offset; set to the new position
+ * \param whence SEEK_SET or SEEK_CUR
+ * \return 0 on success, or -1 on error.
+ */
+static int
+cookie_seek(void *cookie, off64_t *offset, int whence)
+{
+    l_int64 pos = seek_source(reinterpret_cast<ll_source_t *>(cookie), *offset, whence);
+    if (pos < 0)
+        return -1;
+    *offset = static_cast<off64_t>(pos);
+    return 0;
+}
+#endif
+
+#if defined(LL_SOURCE_FUNOPEN)
+/**
+ * \brief Read function of a FILE* opened with funopen().
+ * \param cookie pointer to the ll_source_t
+ * \param buf buffer to fill
+ * \param size size of the buffer
+ * \return number of bytes read, 0 at the end of data, or -1 on error.
+ */
+static int
+funopen_read(void *cookie, char *buf, int size)
+{
+    return static_cast<int>(read_source(reinterpret_cast<ll_source_t *>(cookie), buf, static_cast<size_t>(size)));
+}
+
+/**
+ * \brief Seek function of a FILE* opened with funopen().
+ * \param cookie pointer to the ll_source_t
+ * \param offset offset relative to %whence
+ * \param whence SEEK_SET or SEEK_CUR
+ * \return new position, or -1 on error.
+ */
+static fpos_t
+funopen_seek(void *cookie, fpos_t offset, int whence)
+{
+    return static_cast<fpos_t>(seek_source(reinterpret_cast<ll_source_t *>(cookie), offset, whence));
+}
+#endif
+
+/**
+ * \brief Open a FILE* reading from the source function at index (%arg).
+ * <pre>
+ * Close the FILE* with ll_close_source().
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index of the source function
+ * \param src pointer to the ll_source_t to fill in
+ * \return FILE* to read from.
+ */
+FILE *
+ll_open_source(const char *_fun, lua_State *L, int arg, ll_source_t *src)
+{
+    luaL_checktype(L, arg, LUA_TFUNCTION);
+    *src = ll_source_t();
+    src->L = L;
+    src->arg = lua_absindex(L, arg);
+    src->chunk = LUA_NOREF;
+    src->error = LUA_NOREF;
+    src->head = ll_malloc<l_uint8>(_fun, L, LL_SOURCE_HEAD);
+
+#if defined(LL_SOURCE_COOKIE)
+    cookie_io_functions_t io = cookie_io_functions_t();
+    io.read = cookie_read;
+    io.seek = cookie_seek;
+    src->fp = fopencookie(src, "rb", io);
+#elif defined(LL_SOURCE_FUNOPEN)
+    src->fp = funopen(src, funopen_read, nullptr, funopen_seek, nullptr);
+#else
+    src->fp = tmpfile();
+    if (src->fp) {
+        while (pull_chunk(src))
+            fwrite(src->cdata, 1, src->clen, src->fp);
+        rewind(src->fp);
+    }
+#endif
+    if (!src->fp) {
+        ll_free(src->head);
+        die(_fun, L, "can not open a stream for the source at #%d", arg);
+        return nullptr;
+    }
+    return src->fp;
+}
+
+/**
+ * \brief Read the rest of a source into memory.
+ * <pre>
+ * For formats which need random access, e.g. TIFF.
+ * Free the result with ll_free().
+ * If memory runs out, the source is closed before the error is raised,
+ * so the caller's %src needs no cleanup then.
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param src pointer to the ll_source_t
+ * \param psize pointer to a size_t receiving the number of bytes
+ * \return pointer to the data, or nullptr on error.
+ */
+l_uint8 *
+ll_read_source(const char *_fun, lua_State *L, ll_source_t *src, size_t *psize)
+{
+    size_t size = 0, alloc = LL_SOURCE_HEAD;
+    /* not ll_malloc(), which would raise an error with %src still open */
+    l_uint8 *data = reinterpret_cast<l_uint8 *>(LEPT_MALLOC(alloc));
+    size_t n;
+
+    while (data && (n = fread(data + size, 1, alloc - size, src->fp)) > 0) {
+        size += n;
+        if (size == alloc) {
+            l_uint8 *more = reinterpret_cast<l_uint8 *>(LEPT_REALLOC(data, 2 * alloc));
+            if (!more)
+                ll_free(data);
+            data = more;
+            alloc *= 2;
+        }
+    }
+    if (!data) {
+        *psize = 0;
+        ll_close_source(_fun, L, src);
+        die(_fun, L, "failed to allocate %zu bytes for the source", alloc);
+        return nullptr;
+    }
+    if (ferror(src->fp)) {
+        ll_free(data);
+        *psize = 0;
+        return nullptr;
+    }
+    *psize = size;
+    return data;
+}
+
+/**
+ * \brief Close the FILE* of a source.
+ * <pre>
+ * If the source function raised an error, that error is raised again now.
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param src pointer to the ll_source_t
+ */
+void
+ll_close_source(const char *_fun, lua_State *L, ll_source_t *src)
+{
+    UNUSED(_fun);
+    if (src->fp)
+        fclose(src->fp);
+    src->fp = nullptr;
+    ll_free(src->head);
+    src->head = nullptr;
+    luaL_unref(L, LUA_REGISTRYINDEX, src->chunk);
+    src->chunk = LUA_NOREF;
+    if (LUA_NOREF != src->error) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, src->error);
+        luaL_unref(L, LUA_REGISTRYINDEX, src->error);
+        src->error = LUA_NOREF;
+        lua_error(L);
+    }
+}
@@ -0,0 +1,1213 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+#include <algorithm>
+
+#if defined(HAVE_PNG_H) && defined(HAVE_LIBPNG)
+#define LL_STREAM_PNG   1
+#include <png.h>
+#endif
+
+#if defined(HAVE_JPEGLIB_H) && defined(HAVE_LIBJPEG)
+#define LL_STREAM_JPEG  1
+#include <setjmp.h>
+extern "C" {
+#include <jpeglib.h>
+}
+#endif
+
+#if defined(HAVE_TIFFIO_H) && defined(HAVE_LIBTIFF)
+#define LL_STREAM_TIFF  1
+#include <tiffio.h>
+#endif
+
+/**
+ * \file lualept-stream.cpp
+ * Decode, process and encode images in horizontal bands.
+ *
+ * Images too large for memory, together with their intermediates, are
+ * read a band of rows at a time, processed and written out again, so that
+ * memory use is bounded by the band height instead of the image height.
+ *
+ * Leptonica reads and writes whole images only, so the rows are read and
+ * written here: PNM always, PNG, JPEG and TIFF if libpng, libjpeg resp.
+ * libtiff were found when building. Interlaced PNG and tiled TIFF can't
+ * be read by rows. Bands are 1 bpp, 8 bpp gray or 32 bpp RGB Pix*.
+ *
+ * A band is processed either by a PixPipeline*, whose halo is known (see
+ * ll_pipeline_halo()), or by a Lua function using any of the Pix methods,
+ * with the halo given as an option. Each band is read with %halo rows of
+ * its neighbours above and below, which are dropped again when writing,
+ * so that neighborhood filters see the same rows as on the whole image.
+ */
+
+/** Default number of rows of a band, not counting the halo */
+#define LL_STREAM_ROWS  256
+
+typedef struct rowstream_s rowstream_t;
+
+/** Functions reading or writing an image format by rows */
+typedef struct {
+    const char     *name;                                                   /*!< name of the format */
+    l_int32         format;                                                 /*!< IFF_xxx format */
+    bool          (*open_read)(rowstream_t *rs, const char *filename);     /*!< open a file for reading */
+    bool          (*read_row)(rowstream_t *rs, l_uint32 *line);             /*!< read the next row */
+    bool          (*open_write)(rowstream_t *rs, const char *filename);    /*!< create a file for writing */
+    bool          (*write_row)(rowstream_t *rs, const l_uint32 *line);      /*!< write the next row */
+    bool          (*close)(rowstream_t *rs);                                /*!< close the file */
+}   rowcodec_t;
+
+/** An image file read or written by rows */
+struct rowstream_s {
+    const rowcodec_t   *codec;      /*!< the functions for the format */
+    bool                writing;    /*!< opened for writing */
+    FILE               *fp;         /*!< file, for formats using stdio */
+    l_int32             w;          /*!< width in pixels */
+    l_int32             h;          /*!< height in pixels */
+    l_int32             d;          /*!< depth of the Pix* lines: 1, 8 or 32 */
+    l_int32             fd;         /*!< bits per pixel in the file: 1, 8 or 24 */
+    l_int32             spp;        /*!< samples per pixel in the file for 24 bits */
+    bool                invert;     /*!< 0 is black in the file for 1 bpp, resp. white for 8 bpp */
+    l_int32             row;        /*!< next row to read or write */
+    l_int32             quality;    /*!< JPEG quality */
+    l_int32             comptype;   /*!< TIFF compression (IFF_TIFF_xxx) */
+    l_uint8            *buf;        /*!< one row in the layout of the file */
+    void               *ctx;        /*!< state of the codec */
+    void               *info;       /*!< more state of the codec */
+    const char         *error;      /*!< why the file can not be read by rows, or nullptr */
+};
+
+/**
+ * \brief Get the size of a row in the layout of the file.
+ * \param rs pointer to the rowstream_t
+ * \return number of bytes.
+ */
+static size_t
+row_bytes(const rowstream_t *rs)
+{
+    size_t w = static_cast<size_t>(rs->w);
+    switch (rs->fd) {
+    case 1:
+        return (w + 7) / 8;
+    case 8:
+        return w;
+    default:
+        return w * static_cast<size_t>(rs->spp);
+    }
+}
+
+/**
+ * \brief Allocate the row buffer of a rowstream_t.
+ * \param rs pointer to the rowstream_t
+ * \param size size of a row as the codec reads it, or 0 for row_bytes()
+ * \return true on success.
+ */
+static bool
+alloc_row(rowstream_t *rs, size_t size)
+{
+    if (size < row_bytes(rs))
+        size = row_bytes(rs);
+    rs->buf = reinterpret_cast<l_uint8 *>(LEPT_CALLOC(size, 1));
+    return nullptr != rs->buf;
+}
+
+/**
+ * \brief Convert a row from the layout of the file to a Pix* line.
+ * \param rs pointer to the rowstream_t
+ * \param line pointer to the line
+ */
+static void
+row_to_line(const rowstream_t *rs, l_uint32 *line)
+{
+    const l_uint8 *buf = rs->buf;
+    l_int32 x;
+
+    switch (rs->d) {
+    case 1:
+        for (x = 0; x < (rs->w + 7) / 8; x++)
+            SET_DATA_BYTE(line, x, rs->invert ? ~buf[x] & 0xff : buf[x]);
+        if (rs->w & 7) {
+            /* clear the pad bits */
+            x = (rs->w - 1) / 8;
+            SET_DATA_BYTE(line, x, GET_DATA_BYTE(line, x) & (0xff00 >> (rs->w & 7)));
+        }
+        break;
+    case 8:
+        for (x = 0; x < rs->w; x++)
+            SET_DATA_BYTE(line, x, rs->invert ? 255 - buf[x] : buf[x]);
+        break;
+    default:
+        for (x = 0; x < rs->w; x++, buf += rs->spp)
+            composeRGBPixel(buf[0], buf[1], buf[2], &line[x]);
+    }
+}
+
+/**
+ * \brief Convert a Pix* line to a row in the layout of the file.
+ * \param rs pointer to the rowstream_t
+ * \param line pointer to the line
+ */
+static void
+line_to_row(rowstream_t *rs, const l_uint32 *line)
+{
+    l_uint8 *buf = rs->buf;
+    l_int32 x, rval, gval, bval;
+
+    switch (rs->d) {
+    case 1:
+        if (8 == rs->fd) {
+            /* 1 bpp written as 8 bpp gray, e.g. JPEG */
+            for (x = 0; x < rs->w; x++)
+                buf[x] = GET_DATA_BIT(line, x) ? 0 : 255;
+            break;
+        }
+        for (x = 0; x < (rs->w + 7) / 8; x++)
+            buf[x] = static_cast<l_uint8>(rs->invert ? ~GET_DATA_BYTE(line, x) : GET_DATA_BYTE(line, x));
+        break;
+    case 8:
+        for (x = 0; x < rs->w; x++)
+            buf[x] = static_cast<l_uint8>(rs->invert ? 255 - GET_DATA_BYTE(line, x) : GET_DATA_BYTE(line, x));
+        break;
+    default:
+        for (x = 0; x < rs->w; x++, buf += 3) {
+            extractRGBValues(line[x], &rval, &gval, &bval);
+            buf[0] = static_cast<l_uint8>(rval);
+            buf[1] = static_cast<l_uint8>(gval);
+            buf[2] = static_cast<l_uint8>(bval);
+        }
+    }
+}
+
+/*
+ * PNM: binary PBM (P4), PGM (P5) and PPM (P6) with a maxval of 255
+ */
+
+/**
+ * \brief Read a number from a PNM header, skipping white space and comments.
+ * <pre>
+ * The single white space character after the number is consumed.
+ * </pre>
+ * \param fp FILE* to read from
+ * \return the number, or -1 on error.
+ */
+static l_int32
+pnmrows_number(FILE *fp)
+{
+    l_int32 val = 0;
+    int c = fgetc(fp);
+
+    for (;;) {
+        if ('#' == c) {
+            while (EOF != c && '\n' != c)
+                c = fgetc(fp);
+        } else if (!isspace(c)) {
+            break;
+        }
+        c = fgetc(fp);
+    }
+    if (!isdigit(c))
+        return -1;
+    while (isdigit(c) && val < 0x7fffffff / 10) {
+        val = val * 10 + (c - '0');
+        c = fgetc(fp);
+    }
+    return isspace(c) ? val : -1;
+}
+
+/**
+ * \brief Open the PNM file (%filename) for reading rows.
+ * \param rs pointer to the rowstream_t
+ * \param filename name of the file
+ * \return true on success.
+ */
+static bool
+pnmrows_open_read(rowstream_t *rs, const char *filename)
+{
+    char magic[2];
+    l_int32 maxval = 255;
+
+    rs->fp = fopenReadStream(filename);
+    if (!rs->fp)
+        return false;
+    if (2 != fread(magic, 1, 2, rs->fp) || 'P' != magic[0] || magic[1] < '4' || magic[1] > '6') {
+        rs->error = "unsupported PNM variant; only binary P4, P5 and P6 can be read by rows";
+        return false;
+    }
+    rs->w = pnmrows_number(rs->fp);
+    rs->h = pnmrows_number(rs->fp);
+    if ('4' != magic[1])
+        maxval = pnmrows_number(rs->fp);
+    if (rs->w <= 0 || rs->h <= 0 || 255 != maxval) {
+        rs->error = "unsupported PNM variant; only a maxval of 255 can be read by rows";
+        return false;
+    }
+    rs->d = '4' == magic[1] ? 1 : '5' == magic[1] ? 8 : 32;
+    rs->fd = '6' == magic[1] ? 24 : rs->d;
+    rs->spp = 3;
+    return alloc_row(rs, 0);
+}
+
+/**
+ * \brief Read the next row of a PNM file into a Pix* line.
+ * \param rs pointer to the rowstream_t
+ * \param line pointer to the line
+ * \return true on success.
+ */
+static bool
+pnmrows_read(rowstream_t *rs, l_uint32 *line)
+{
+    size_t size = row_bytes(rs);
+    if (size != fread(rs->buf, 1, size, rs->fp))
+        return false;
+    row_to_line(rs, line);
+    return true;
+}
+
+/**
+ * \brief Create the PNM file (%filename) for writing rows.
+ * \param rs pointer to the rowstream_t, with %w, %h and %d set
+ * \param filename name of the file
+ * \return true on success.
+ */
+static bool
+pnmrows_open_write(rowstream_t *rs, const char *filename)
+{
+    rs->fp = fopenWriteStream(filename, "wb");
+    if (!rs->fp)
+        return false;
+    rs->fd = 32 == rs->d ? 24 : rs->d;
+    rs->spp = 3;
+    if (1 == rs->d)
+        fprintf(rs->fp, "P4\n%d %d\n", rs->w, rs->h);
+    else
+        fprintf(rs->fp, "P%c\n%d %d\n255\n", 8 == rs->d ? '5' : '6', rs->w, rs->h);
+    return alloc_row(rs, 0);
+}
+
+/**
+ * \brief Write a Pix* line as the next row of a PNM file.
+ * \param rs pointer to the rowstream_t
+ * \param line pointer to the line
+ * \return true on success.
+ */
+static bool
+pnmrows_write(rowstream_t *rs, const l_uint32 *line)
+{
+    size_t size = row_bytes(rs);
+    line_to_row(rs, line);
+    return size == fwrite(rs->buf, 1, size, rs->fp);
+}
+
+/**
+ * \brief Close a PNM file read or written by rows.
+ * \param rs pointer to the rowstream_t
+ * \return true on success, false if writing failed.
+ */
+static bool
+pnmrows_close(rowstream_t *rs)
+{
+    bool ok = true;
+    if (rs->fp && fclose(rs->fp))
+        ok = false;
+    rs->fp = nullptr;
+    return ok;
+}
+
+#if defined(LL_STREAM_PNG)
+/*
+ * PNG: not interlaced; 16 bit samples are reduced to 8 bit, palettes are
+ * expanded to RGB, and alpha is dropped
+ */
+
+/**
+ * \brief Open the PNG file (%filename) for reading rows.
+ * \param rs pointer to the rowstream_t
+ * \param filename name of the file
+ * \return true on success.
+ */
+static bool
+pngrows_open_read(rowstream_t *rs, const char *filename)
+{
+    FUNC("pngrows_open_read");
+    png_structp png;
+    png_infop info;
+    png_uint_32 w, h;
+    int bit_depth, color_type, interlace;
+
+    rs->fp = fopenReadStream(filename);
+    if (!rs->fp)
+        return false;
+    png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    info = png ? png_create_info_struct(png) : nullptr;
+    rs->ctx = png;
+    rs->info = info;
+    if (!info)
+        return false;
+    if (setjmp(png_jmpbuf(png)))
+        return false;
+    png_init_io(png, rs->fp);
+    png_read_info(png, info);
+    png_get_IHDR(png, info, &w, &h, &bit_depth, &color_type, &interlace, nullptr, nullptr);
+    if (PNG_INTERLACE_NONE != interlace) {
+        ERROR_INT("interlaced PNG can not be read by rows", _fun, 0);
+        rs->error = "interlaced PNG";
+        return false;
+    }
+    if (16 == bit_depth)
+        png_set_strip_16(png);
+    if (PNG_COLOR_TYPE_PALETTE == color_type)
+        png_set_palette_to_rgb(png);
+    if (color_type & PNG_COLOR_MASK_ALPHA)
+        png_set_strip_alpha(png);
+    if (PNG_COLOR_TYPE_GRAY == color_type || PNG_COLOR_TYPE_GRAY_ALPHA == color_type) {
+        if (1 == bit_depth) {
+            /* 1 is white in PNG */
+            rs->d = 1;
+            rs->invert = true;
+        } else {
+            if (bit_depth < 8)
+                png_set_expand_gray_1_2_4_to_8(png);
+            rs->d = 8;
+        }
+    } else {
+        rs->d = 32;
+    }
+    png_read_update_info(png, info);
+    rs->w = static_cast<l_int32>(w);
+    rs->h = static_cast<l_int32>(h);
+    rs->fd = 32 == rs->d ? 24 : rs->d;
+    rs->spp = 3;
+    return alloc_row(rs, png_get_rowbytes(png, info));
+}
+
+/**
+ * \brief Read the next row of a PNG file into a Pix* line.
+ * \param rs pointer to the rowstream_t
+ * \param line pointer to the line
+ * \return true on success.
+ */
+static bool
+pngrows_read(rowstream_t *rs, l_uint32 *line)
+{
+    png_structp png = reinterpret_cast<png_structp>(rs->ctx);
+    if (setjmp(png_jmpbuf(png)))
+        return false;
+    png_read_row(png, rs->buf, nullptr);
+    row_to_line(rs, line);
+    return true;
+}
+
+/**
+ * \brief Create the PNG file (%filename) for writing rows.
+ * \param rs pointer to the rowstream_t, with %w, %h and %d set
+ * \param filename name of the file
+ * \return true on success.
+ */
+static bool
+pngrows_open_write(rowstream_t *rs, const char *filename)
+{
+    png_structp png;
+    png_infop info;
+
+    rs->fp = fopenWriteStream(filename, "wb");
+    if (!rs->fp)
+        return false;
+    png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    info = png ? png_create_info_struct(png) : nullptr;
+    rs->ctx = png;
+    rs->info = info;
+    if (!info)
+        return false;
+    if (setjmp(png_jmpbuf(png)))
+        return false;
+    rs->fd = 32 == rs->d ? 24 : rs->d;
+    rs->spp = 3;
+    rs->invert = 1 == rs->d;
+    png_init_io(png, rs->fp);
+    png_set_IHDR(png, info, static_cast<png_uint_32>(rs->w), static_cast<png_uint_32>(rs->h),
+                 1 == rs->d ? 1 : 8, 32 == rs->d ? PNG_COLOR_TYPE_RGB : PNG_COLOR_TYPE_GRAY,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    return alloc_row(rs, 0);
+}
+
+/**
+ * \brief Write a Pix* line as the next row of a PNG file.
+ * \param rs pointer to the rowstream_t
+ * \param line pointer to the line
+ * \return true on success.
+ */
+static bool
+pngrows_write(rowstream_t *rs, const l_uint32 *line)
+{
+    png_structp png = reinterpret_cast<png_structp>(rs->ctx);
+    if (setjmp(png_jmpbuf(png)))
+        return false;
+    line_to_row(rs, line);
+    png_write_row(png, rs->buf);
+    return true;
+}
+
+/**
+ * \brief Close a PNG file read or written by rows.
+ * \param rs pointer to the rowstream_t
+ * \return true on success, false if writing failed.
+ */
+static bool
+pngrows_close(rowstream_t *rs)
+{
+    png_structp png = reinterpret_cast<png_structp>(rs->ctx);
+    png_infop info = reinterpret_cast<png_infop>(rs->info);
+    bool ok = true;
+
+    if (rs->writing) {
+        if (png && info && rs->row == rs->h) {
+            if (setjmp(png_jmpbuf(png)))
+                ok = false;
+            else
+                png_write_end(png, nullptr);
+        }
+        png_destroy_write_struct(&png, &info);
+    } else {
+        png_destroy_read_struct(&png, &info, nullptr);
+    }
+    rs->ctx = nullptr;
+    rs->info = nullptr;
+    return pnmrows_close(rs) && ok;
+}
+#endif /* defined(LL_STREAM_PNG) */
+
+#if defined(LL_STREAM_JPEG)
+/*
+ * JPEG: gray or YCbCr/RGB; 1 bpp is written as 8 bpp gray
+ */
+
+/** State of libjpeg, with a jump buffer for its errors */
+typedef struct {
+    struct jpeg_decompress_struct   dinfo;  /*!< decompressor */
+    struct jpeg_compress_struct     cinfo;  /*!< compressor */
+    struct jpeg_error_mgr           jerr;   /*!< error manager */
+    jmp_buf                         jmp;    /*!< where to go on errors */
+}   jpegrows_t;
+
+/**
+ * \brief Error exit of libjpeg: print the message and jump back.
+ * \param cinfo pointer to the compressor or decompressor
+ */
+static void
+jpegrows_error(j_common_ptr cinfo)
+{
+    jpegrows_t *jc = reinterpret_cast<jpegrows_t *>(cinfo->client_data);
+    (*cinfo->err->output_message)(cinfo);
+    longjmp(jc->jmp, 1);
+}
+
+/**
+ * \brief Open the JPEG file (%filename) for reading rows.
+ * \param rs pointer to the rowstream_t
+ * \param filename name of the file
+ * \return true on success.
+ */
+static bool
+jpegrows_open_read(rowstream_t *rs, const char *filename)
+{
+    FUNC("jpegrows_open_read");
+    jpegrows_t *jc;
+
+    rs->fp = fopenReadStream(filename);
+    if (!rs->fp)
+        return false;
+    jc = new jpegrows_t();
+    rs->ctx = jc;
+    jc->dinfo.err = jpeg_std_error(&jc->jerr);
+    jc->jerr.error_exit = jpegrows_error;
+    jc->dinfo.client_data = jc;
+    if (setjmp(jc->jmp))
+        return false;
+    jpeg_create_decompress(&jc->dinfo);
+    rs->info = &jc->dinfo;
+    jpeg_stdio_src(&jc->dinfo, rs->fp);
+    jpeg_read_header(&jc->dinfo, TRUE);
+    if (1 == jc->dinfo.num_components) {
+        jc->dinfo.out_color_space = JCS_GRAYSCALE;
+        rs->d = 8;
+    } else if (JCS_YCbCr == jc->dinfo.jpeg_color_space || JCS_RGB == jc->dinfo.jpeg_color_space) {
+        jc->dinfo.out_color_space = JCS_RGB;
+        rs->d = 32;
+    } else {
+        ERROR_INT("JPEG color space can not be read by rows", _fun, 0);
+        return false;
+    }
+    jpeg_start_decompress(&jc->dinfo);
+    rs->w = static_cast<l_int32>(jc->dinfo.output_width);
+    rs->h = static_cast<l_int32>(jc->dinfo.output_height);
+    rs->fd = 32 == rs->d ? 24 : 8;
+    rs->spp = 3;
+    return alloc_row(rs, 0);
+}
+
+/**
+ * \brief Read the next row of a JPEG file into a Pix* line.
+ * \param rs pointer to the rowstream_t
+ * \param line pointer to the line
+ * \return true on success.
+ */
+static bool
+jpegrows_read(rowstream_t *rs, l_uint32 *line)
+{
+    jpegrows_t *jc = reinterpret_cast<jpegrows_t *>(rs->ctx);
+    JSAMPROW row = rs->buf;
+    if (setjmp(jc->jmp))
+        return false;
+    if (1 != jpeg_read_scanlines(&jc->dinfo, &row, 1))
+        return false;
+    row_to_line(rs, line);
+    return true;
+}
+
+/**
+ * \brief Create the JPEG file (%filename) for writing rows.
+ * \param rs pointer to the rowstream_t, with %w, %h and %d set
+ * \param filename name of the file
+ * \return true on success.
+ */
+static bool
+jpegrows_open_write(rowstream_t *rs, const char *filename)
+{
+    jpegrows_t *jc;
+
+    rs->fp = fopenWriteStream(filename, "wb");
+    if (!rs->fp)
+        return false;
+    jc = new jpegrows_t();
+    rs->ctx = jc;
+    jc->cinfo.err = jpeg_std_error(&jc->jerr);
+    jc->jerr.error_exit = jpegrows_error;
+    jc->cinfo.client_data = jc;
+    if (setjmp(jc->jmp))
+        return false;
+    jpeg_create_compress(&jc->cinfo);
+    rs->info = &jc->cinfo;
+    jpeg_stdio_dest(&jc->cinfo, rs->fp);
+    rs->fd = 32 == rs->d ? 24 : 8;
+    rs->spp = 3;
+    jc->cinfo.image_width = static_cast<JDIMENSION>(rs->w);
+    jc->cinfo.image_height = static_cast<JDIMENSION>(rs->h);
+    jc->cinfo.input_components = 32 == rs->d ? 3 : 1;
+    jc->cinfo.in_color_space = 32 == rs->d ? JCS_RGB : JCS_GRAYSCALE;
+    jpeg_set_defaults(&jc->cinfo);
+    jpeg_set_quality(&jc->cinfo, rs->quality, TRUE);
+    jpeg_start_compress(&jc->cinfo, TRUE);
+    return alloc_row(rs, 0);
+}
+
+/**
+ * \brief Write a Pix* line as the next row of a JPEG file.
+ * \param rs pointer to the rowstream_t
+ * \param line pointer to the line
+ * \return true on success.
+ */
+static bool
+jpegrows_write(rowstream_t *rs, const l_uint32 *line)
+{
+    jpegrows_t *jc = reinterpret_cast<jpegrows_t *>(rs->ctx);
+    JSAMPROW row = rs->buf;
+    if (setjmp(jc->jmp))
+        return false;
+    line_to_row(rs, line);
+    return 1 == jpeg_write_scanlines(&jc->cinfo, &row, 1);
+}
+
+/**
+ * \brief Close a JPEG file read or written by rows.
+ * \param rs pointer to the rowstream_t
+ * \return true on success, false if writing failed.
+ */
+static bool
+jpegrows_close(rowstream_t *rs)
+{
+    jpegrows_t *jc = reinterpret_cast<jpegrows_t *>(rs->ctx);
+    bool ok = true;
+
+    if (jc && rs->info) {
+        if (setjmp(jc->jmp))
+            ok = false;
+        else if (rs->writing && rs->row == rs->h)
+            jpeg_finish_compress(&jc->cinfo);
+        if (rs->writing)
+            jpeg_destroy_compress(&jc->cinfo);
+        else
+            jpeg_destroy_decompress(&jc->dinfo);
+    }
+    delete jc;
+    rs->ctx = nullptr;
+    rs->info = nullptr;
+    return pnmrows_close(rs) && ok;
+}
+#endif /* defined(LL_STREAM_JPEG) */
+
+#if defined(LL_STREAM_TIFF)
+/*
+ * TIFF: striped, 1 bpp, 8 bpp gray or 8 bit RGB(A) with contiguous samples
+ */
+
+/**
+ * \brief Open the TIFF file (%filename) for reading rows.
+ * \param rs pointer to the rowstream_t
+ * \param filename name of the file
+ * \return true on success.
+ */
+static bool
+tiffrows_open_read(rowstream_t *rs, const char *filename)
+{
+    FUNC("tiffrows_open_read");
+    TIFF *tif = TIFFOpen(filename, "r");
+    uint32_t w = 0, h = 0;
+    uint16_t bps = 1, spp = 1, photometric = PHOTOMETRIC_MINISWHITE;
+    uint16_t planar = PLANARCONFIG_CONTIG, compression = COMPRESSION_NONE;
+
+    rs->ctx = tif;
+    if (!tif)
+        return false;
+    if (TIFFIsTiled(tif)) {
+        ERROR_INT("tiled TIFF can not be read by rows", _fun, 0);
+        rs->error = "tiled TIFF";
+        return false;
+    }
+    TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &w);
+    TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &h);
+    TIFFGetFieldDefaulted(tif, TIFFTAG_BITSPERSAMPLE, &bps);
+    TIFFGetFieldDefaulted(tif, TIFFTAG_SAMPLESPERPIXEL, &spp);
+    TIFFGetFieldDefaulted(tif, TIFFTAG_PLANARCONFIG, &planar);
+    TIFFGetFieldDefaulted(tif, TIFFTAG_COMPRESSION, &compression);
+    TIFFGetField(tif, TIFFTAG_PHOTOMETRIC, &photometric);
+    if (PHOTOMETRIC_YCBCR == photometric && COMPRESSION_JPEG == compression) {
+        /* let libtiff convert to RGB */
+        TIFFSetField(tif, TIFFTAG_JPEGCOLORMODE, JPEGCOLORMODE_RGB);
+        photometric = PHOTOMETRIC_RGB;
+    }
+    rs->w = static_cast<l_int32>(w);
+    rs->h = static_cast<l_int32>(h);
+    rs->spp = spp;
+    if (1 == bps && 1 == spp) {
+        /* 1 is black in Leptonica */
+        rs->d = 1;
+        rs->invert = PHOTOMETRIC_MINISBLACK == photometric;
+    } else if (8 == bps && 1 == spp && PHOTOMETRIC_PALETTE != photometric) {
+        rs->d = 8;
+        rs->invert = PHOTOMETRIC_MINISWHITE == photometric;
+    } else if (8 == bps && spp >= 3 && PHOTOMETRIC_RGB == photometric && PLANARCONFIG_CONTIG == planar) {
+        rs->d = 32;
+    } else {
+        ERROR_INT("TIFF samples can not be read by rows", _fun, 0);
+        rs->error = "unsupported TIFF samples";
+        return false;
+    }
+    rs->fd = 32 == rs->d ? 24 : rs->d;
+    return alloc_row(rs, static_cast<size_t>(TIFFScanlineSize(tif)));
+}
+
+/**
+ * \brief Read the next row of a TIFF file into a Pix* line.
+ * \param rs pointer to the rowstream_t
+ * \param line pointer to the line
+ * \return true on success.
+ */
+static bool
+tiffrows_read(rowstream_t *rs, l_uint32 *line)
+{
+    TIFF *tif = reinterpret_cast<TIFF *>(rs->ctx);
+    if (TIFFReadScanline(tif, rs->buf, static_cast<uint32_t>(rs->row), 0) < 0)
+        return false;
+    row_to_line(rs, line);
+    return true;
+}
+
+/**
+ * \brief Create the TIFF file (%filename) for writing rows.
+ * \param rs pointer to the rowstream_t, with %w, %h and %d set
+ * \param filename name of the file
+ * \return true on success.
+ */
+static bool
+tiffrows_open_write(rowstream_t *rs, const char *filename)
+{
+    TIFF *tif = TIFFOpen(filename, "w");
+    uint16_t compression;
+
+    rs->ctx = tif;
+    if (!tif)
+        return false;
+    switch (rs->comptype) {
+    case IFF_TIFF_PACKBITS:
+        compression = COMPRESSION_PACKBITS;
+        break;
+    case IFF_TIFF_RLE:
+        compression = COMPRESSION_CCITTRLE;
+        break;
+    case IFF_TIFF_G3:
+        compression = COMPRESSION_CCITTFAX3;
+        break;
+    case IFF_TIFF_G4:
+        compression = COMPRESSION_CCITTFAX4;
+        break;
+    case IFF_TIFF_LZW:
+        compression = COMPRESSION_LZW;
+        break;
+    case IFF_TIFF_ZIP:
+        compression = COMPRESSION_ADOBE_DEFLATE;
+        break;
+    default:
+        compression = COMPRESSION_NONE;
+    }
+    if (1 != rs->d && (COMPRESSION_CCITTRLE == compression ||
+                       COMPRESSION_CCITTFAX3 == compression ||
+                       COMPRESSION_CCITTFAX4 == compression)) {
+        /* same as pixWriteTiff() for images which are not 1 bpp */
+        compression = COMPRESSION_ADOBE_DEFLATE;
+    }
+    rs->fd = 32 == rs->d ? 24 : rs->d;
+    rs->spp = 3;
+    TIFFSetField(tif, TIFFTAG_IMAGEWIDTH, static_cast<uint32_t>(rs->w));
+    TIFFSetField(tif, TIFFTAG_IMAGELENGTH, static_cast<uint32_t>(rs->h));
+    TIFFSetField(tif, TIFFTAG_BITSPERSAMPLE, static_cast<uint16_t>(1 == rs->d ? 1 : 8));
+    TIFFSetField(tif, TIFFTAG_SAMPLESPERPIXEL, static_cast<uint16_t>(32 == rs->d ? 3 : 1));
+    TIFFSetField(tif, TIFFTAG_PHOTOMETRIC, static_cast<uint16_t>(1 == rs->d ? PHOTOMETRIC_MINISWHITE :
+                                                               8 == rs->d ? PHOTOMETRIC_MINISBLACK :
+                                                               PHOTOMETRIC_RGB));
+    TIFFSetField(tif, TIFFTAG_PLANARCONFIG, static_cast<uint16_t>(PLANARCONFIG_CONTIG));
+    TIFFSetField(tif, TIFFTAG_COMPRESSION, compression);
+    TIFFSetField(tif, TIFFTAG_ROWSPERSTRIP, TIFFDefaultStripSize(tif, 0));
+    return alloc_row(rs, 0);
+}
+
+/**
+ * \brief Write a Pix* line as the next row of a TIFF file.
+ * \param rs pointer to the rowstream_t
+ * \param line pointer to the line
+ * \return true on success.
+ */
+static bool
+tiffrows_write(rowstream_t *rs, const l_uint32 *line)
+{
+    TIFF *tif = reinterpret_cast<TIFF *>(rs->ctx);
+    line_to_row(rs, line);
+    return TIFFWriteScanline(tif, rs->buf, static_cast<uint32_t>(rs->row), 0) >= 0;
+}
+
+/**
+ * \brief Close a TIFF file read or written by rows.
+ * \param rs pointer to the rowstream_t
+ * \return true on success, false if writing failed.
+ */
+static bool
+tiffrows_close(rowstream_t *rs)
+{
+    TIFF *tif = reinterpret_cast<TIFF *>(rs->ctx);
+    if (tif)
+        TIFFClose(tif);
+    rs->ctx = nullptr;
+    return true;
+}
+#endif /* defined(LL_STREAM_TIFF) */
+
+/** Table of the formats which can be read and written by rows */
+static const rowcodec_t rowcodecs[] = {
+    {"PNM",  IFF_PNM,       pnmrows_open_read,  pnmrows_read,   pnmrows_open_write,  pnmrows_write,   pnmrows_close},
+#if defined(LL_STREAM_PNG)
+    {"PNG",  IFF_PNG,       pngrows_open_read,  pngrows_read,  pngrows_open_write,  pngrows_write,  pngrows_close},
+#endif
+#if defined(LL_STREAM_JPEG)
+    {"JPEG", IFF_JFIF_JPEG, jpegrows_open_read, jpegrows_read,  jpegrows_open_write, jpegrows_write,  jpegrows_close},
+#endif
+#if defined(LL_STREAM_TIFF)
+    {"TIFF", IFF_TIFF,      tiffrows_open_read, tiffrows_read,  tiffrows_open_write, tiffrows_write,  tiffrows_close}
+#endif
+};
+
+/**
+ * \brief Look up the functions for an image format.
+ * \param format IFF_xxx format
+ * \return pointer to the rowcodec_t, or nullptr if the format can't be streamed.
+ */
+static const rowcodec_t *
+rowcodec(l_int32 format)
+{
+    switch (format) {
+    case IFF_TIFF_PACKBITS:
+    case IFF_TIFF_RLE:
+    case IFF_TIFF_G3:
+    case IFF_TIFF_G4:
+    case IFF_TIFF_LZW:
+    case IFF_TIFF_ZIP:
+        format = IFF_TIFF;
+        break;
+    }
+    for (size_t i = 0; i < ARRAYSIZE(rowcodecs); i++)
+        if (rowcodecs[i].format == format)
+            return &rowcodecs[i];
+    return nullptr;
+}
+
+/**
+ * \brief Close a rowstream_t and free its row buffer.
+ * \param rs pointer to the rowstream_t
+ * \return true on success, false if writing failed.
+ */
+static bool
+rowstream_close(rowstream_t *rs)
+{
+    bool ok = true;
+    if (rs->codec)
+        ok = rs->codec->close(rs);
+    if (rs->fp)
+        fclose(rs->fp);
+    rs->fp = nullptr;
+    LEPT_FREE(rs->buf);
+    rs->buf = nullptr;
+    rs->codec = nullptr;
+    return ok;
+}
+
+/**
+ * \brief Copy %n lines from (%pixs, %ys) to (%pixd, %yd); both have the same width and depth.
+ * \param pixd destination Pix*
+ * \param yd first line in %pixd
+ * \param pixs source Pix*
+ * \param ys first line in %pixs
+ * \param n number of lines
+ */
+static void
+copy_lines(Pix *pixd, l_int32 yd, Pix *pixs, l_int32 ys, l_int32 n)
+{
+    l_int32 wpl = pixGetWpl(pixd);
+    memcpy(pixGetData(pixd) + yd * wpl, pixGetData(pixs) + ys * wpl,
+           static_cast<size_t>(n) * static_cast<size_t>(wpl) * sizeof(l_uint32));
+}
+
+/** State of streaming an image by bands */
+typedef struct {
+    rowstream_t         in;         /*!< the input image */
+    rowstream_t         out;        /*!< the output image, opened with the first band */
+    ll_pixpipeline_t   *pl;         /*!< pipeline processing a band, or nullptr */
+    int                 fn;         /*!< stack index of the function processing a band */
+    Pix                *spare;      /*!< spare intermediate of the pipeline */
+    Pix                *keep;       /*!< rows of the previous band needed by the next */
+    int                 error;      /*!< reference to an error to raise, or LUA_NOREF */
+}   bandstream_t;
+
+/**
+ * \brief Process a band with the pipeline or the Lua function.
+ * <pre>
+ * The band is consumed. The Lua function is called as fn(band, y, top)
+ * with the band's first row %y in the image, and the number of halo rows
+ * at its %top; it returns the processed band. Both Pix* are released after
+ * the call, so that their memory does not wait for the garbage collector.
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param bs pointer to the bandstream_t
+ * \param band the band
+ * \param y first row of the band in the image
+ * \param top number of halo rows at the top of the band
+ * \return the processed band, or nullptr on error.
+ */
+static Pix *
+process_band(const char *_fun, lua_State *L, bandstream_t *bs, Pix *band, l_int32 y, l_int32 top)
+{
+    Pix *pixd = nullptr;
+
+    if (bs->pl) {
+        const char *name = nullptr;
+        pixd = ll_run_pipeline(bs->pl, band, &bs->spare, &name);
+        pixDestroy(&band);
+        if (!pixd) {
+            lua_pushfstring(L, "band at row %d: step '%s' failed", y, name ? name : "?");
+            bs->error = luaL_ref(L, LUA_REGISTRYINDEX);
+        }
+        return pixd;
+    }
+
+    ll_push_Pix(_fun, L, band);
+    int idx = lua_gettop(L);
+    lua_pushvalue(L, bs->fn);
+    lua_pushvalue(L, idx);
+    lua_pushinteger(L, y);
+    lua_pushinteger(L, top);
+    if (LUA_OK != lua_pcall(L, 3, 1, 0)) {
+        bs->error = luaL_ref(L, LUA_REGISTRYINDEX);
+    } else if (!ll_isudata(_fun, L, -1, LL_PIX)) {
+        lua_pushfstring(L, "band function returned a %s instead of a %s*",
+                        luaL_typename(L, -1), LL_PIX);
+        bs->error = luaL_ref(L, LUA_REGISTRYINDEX);
+    } else {
+        Pix *pix = *reinterpret_cast<Pix **>(lua_touserdata(L, -1));
+        pixd = pix ? pixClone(pix) : nullptr;
+        if (!pixd) {
+            lua_pushfstring(L, "band at row %d: band function returned a released %s*", y, LL_PIX);
+            bs->error = luaL_ref(L, LUA_REGISTRYINDEX);
+        }
+        lua_getfield(L, -1, "Release");
+        lua_pushvalue(L, -2);
+        lua_pcall(L, 1, 0, 0);
+    }
+    lua_settop(L, idx);
+    lua_getfield(L, idx, "Release");
+    lua_pushvalue(L, idx);
+    lua_pcall(L, 1, 0, 0);
+    lua_settop(L, idx - 1);
+    return pixd;
+}
+
+/**
+ * \brief Read, process and write all bands of the image.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param bs pointer to the bandstream_t with the input open
+ * \param output name of the output file
+ * \param rows number of rows of a band
+ * \param halo number of halo rows above and below a band
+ * \return true on success, false on error.
+ */
+static bool
+stream_bands(const char *_fun, lua_State *L, bandstream_t *bs, const char *output, l_int32 rows, l_int32 halo)
+{
+    rowstream_t *in = &bs->in;
+    rowstream_t *out = &bs->out;
+    l_int32 keep_y = 0, keep_h = 0;
+
+    for (l_int32 y0 = 0, n = 0; y0 < in->h; y0 += n) {
+        /* a short last band is merged into this one, so that no band
+         * has less than 2 * halo + 1 rows, which would clip a kernel */
+        n = in->h - y0 - rows < 2 * halo + 1 ? in->h - y0 : rows;
+        l_int32 a = std::max(0, y0 - halo);
+        l_int32 b = std::min(in->h, y0 + n + halo);
+        Pix *band = pixCreateNoInit(in->w, b - a, in->d);
+        if (!band)
+            return false;
+
+        /* rows from the previous band, then the rows not yet read */
+        l_int32 r = a;
+        if (bs->keep && r >= keep_y && r < keep_y + keep_h) {
+            copy_lines(band, 0, bs->keep, r - keep_y, keep_y + keep_h - r);
+            r = keep_y + keep_h;
+        }
+        pixDestroy(&bs->keep);
+        l_uint32 *data = pixGetData(band);
+        l_int32 wpl = pixGetWpl(band);
+        for (; r < b; r++, in->row++) {
+            if (r != in->row || !in->codec->read_row(in, data + (r - a) * wpl)) {
+                lua_pushfstring(L, "band at row %d: failed to read row %d", a, r);
+                bs->error = luaL_ref(L, LUA_REGISTRYINDEX);
+                pixDestroy(&band);
+                return false;
+            }
+        }
+
+        /* the halo of the next band */
+        keep_y = std::max(a, b - 2 * halo);
+        keep_h = b - keep_y;
+        if (halo > 0 && b < in->h) {
+            bs->keep = pixCreateNoInit(in->w, keep_h, in->d);
+            if (!bs->keep) {
+                pixDestroy(&band);
+                return false;
+            }
+            copy_lines(bs->keep, 0, band, keep_y - a, keep_h);
+        }
+
+        Pix *pixr = process_band(_fun, L, bs, band, a, y0 - a);
+        if (!pixr)
+            return false;
+        if (pixGetWidth(pixr) != in->w || pixGetHeight(pixr) != b - a) {
+            lua_pushfstring(L, "band at row %d: result is %dx%d instead of %dx%d",
+                            a, pixGetWidth(pixr), pixGetHeight(pixr), in->w, b - a);
+            bs->error = luaL_ref(L, LUA_REGISTRYINDEX);
+            pixDestroy(&pixr);
+            return false;
+        }
+        if (pixGetColormap(pixr)) {
+            Pix *pixt = pixRemoveColormap(pixr, REMOVE_CMAP_BASED_ON_SRC);
+            pixDestroy(&pixr);
+            pixr = pixt;
+        }
+        if (pixr && 1 != pixGetDepth(pixr) && 8 != pixGetDepth(pixr) && 32 != pixGetDepth(pixr)) {
+            Pix *pixt = pixConvertTo8(pixr, FALSE);
+            pixDestroy(&pixr);
+            pixr = pixt;
+        }
+        if (!pixr)
+            return false;
+
+        if (!out->codec) {
+            /* the first band determines the depth of the output */
+            const rowcodec_t *codec = rowcodec(out->comptype);
+            out->w = in->w;
+            out->h = in->h;
+            out->d = pixGetDepth(pixr);
+            out->writing = true;
+            out->codec = codec;
+            if (!codec->open_write(out, output)) {
+                pixDestroy(&pixr);
+                return false;
+            }
+        } else if (pixGetDepth(pixr) != out->d) {
+            lua_pushfstring(L, "band at row %d: result has depth %d instead of %d",
+                            a, pixGetDepth(pixr), out->d);
+            bs->error = luaL_ref(L, LUA_REGISTRYINDEX);
+            pixDestroy(&pixr);
+            return false;
+        }
+
+        data = pixGetData(pixr);
+        wpl = pixGetWpl(pixr);
+        for (l_int32 i = 0; i < n; i++, out->row++) {
+            if (!out->codec->write_row(out, data + (y0 - a + i) * wpl)) {
+                pixDestroy(&pixr);
+                return false;
+            }
+        }
+        pixDestroy(&pixr);
+    }
+    return true;
+}
+
+/**
+ * \brief Decode, process and encode an image in horizontal bands.
+ * <pre>
+ * The value at %process is a PixPipeline* or a function(band, y, top)
+ * returning the processed band (see process_band()). The optional table
+ * at %opts has the fields:
+ *   rows       number of rows of a band (default 256); at least
+ *              2 * halo + 1, and a short last band is merged into
+ *              the one before it
+ *   halo       number of rows above and below a band which the processing
+ *              looks at; for a PixPipeline* at least its GetHalo()
+ *   format     output format name (default: from the output file name,
+ *              else the input format), e.g. "png", "jpeg", "tiff-g4", "pnm"
+ *   quality    JPEG quality (default 75)
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param input name of the input file
+ * \param output name of the output file
+ * \param process index of the PixPipeline* or function
+ * \param opts index of the optional options table
+ * \return true on success, false on error.
+ */
+bool
+ll_stream_bands(const char *_fun, lua_State *L, const char *input, const char *output, int process, int opts)
+{
+    bandstream_t bs = bandstream_t();
+    l_int32 rows = LL_STREAM_ROWS;
+    l_int32 halo = 0;
+    l_int32 iformat = IFF_UNKNOWN;
+    l_int32 oformat = IFF_UNKNOWN;
+    bool ok;
+
+    process = lua_absindex(L, process);
+    opts = lua_absindex(L, opts);
+    bs.error = LUA_NOREF;
+    bs.out.quality = 75;
+    if (LUA_TFUNCTION == lua_type(L, process)) {
+        bs.fn = process;
+    } else {
+        const char *name = nullptr;
+        bs.pl = ll_check_PixPipeline(_fun, L, process);
+        halo = ll_pipeline_halo(bs.pl, &name);
+        if (halo < 0) {
+            die(_fun, L, "step '%s' of the %s at #%d can not run on bands", name, LL_PIXPIPELINE, process);
+            return false;
+        }
+    }
+
+    if (LUA_TTABLE == lua_type(L, opts)) {
+        if (LUA_TNIL != lua_getfield(L, opts, "rows"))
+            rows = ll_check_l_int32(_fun, L, -1);
+        lua_pop(L, 1);
+        if (LUA_TNIL != lua_getfield(L, opts, "halo"))
+            halo = std::max(halo, ll_check_l_int32(_fun, L, -1));
+        lua_pop(L, 1);
+        if (LUA_TNIL != lua_getfield(L, opts, "format"))
+            oformat = ll_check_input_format(_fun, L, lua_gettop(L), IFF_UNKNOWN);
+        lua_pop(L, 1);
+        if (LUA_TNIL != lua_getfield(L, opts, "quality"))
+            bs.out.quality = ll_check_l_int32(_fun, L, -1);
+        lua_pop(L, 1);
+    }
+    if (rows < 1 || halo < 0) {
+        die(_fun, L, "invalid band of %d rows with a halo of %d rows", rows, halo);
+        return false;
+    }
+    /* the first band has no halo above it */
+    rows = std::max(rows, 2 * halo + 1);
+
+    if (findFileFormat(input, &iformat))
+        return false;
+    if (IFF_UNKNOWN == oformat || IFF_DEFAULT == oformat)
+        oformat = getImpliedFileFormat(output);
+    if (IFF_UNKNOWN == oformat || IFF_DEFAULT == oformat)
+        oformat = iformat;
+    bs.in.codec = rowcodec(iformat);
+    if (!bs.in.codec) {
+        die(_fun, L, "the format of '%s' (%s) can not be read by rows", input, ll_string_input_format(iformat));
+        return false;
+    }
+    if (!rowcodec(oformat)) {
+        die(_fun, L, "the format %s can not be written by rows", ll_string_input_format(oformat));
+        return false;
+    }
+    bs.out.comptype = oformat;
+
+    ok = bs.in.codec->open_read(&bs.in, input);
+    if (!ok) {
+        lua_pushfstring(L, "can not read '%s' by rows: %s", input,
+                        bs.in.error ? bs.in.error : "failed to open the file");
+        bs.error = luaL_ref(L, LUA_REGISTRYINDEX);
+    }
+    if (ok)
+        ok = stream_bands(_fun, L, &bs, output, rows, halo);
+
+    pixDestroy(&bs.keep);
+    pixDestroy(&bs.spare);
+    rowstream_close(&bs.in);
+    if (!rowstream_close(&bs.out))
+        ok = false;
+    if (LUA_NOREF != bs.error) {
+        lua_rawgeti(L, LUA_REGISTRYINDEX, bs.error);
+        luaL_unref(L, LUA_REGISTRYINDEX, bs.error);
+        lua_error(L);
+        return false;    /* NOTREACHED */
+    }
+    return ok;
+}
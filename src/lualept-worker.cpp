@@ -0,0 +1,504 @@
+/************************************************************************
+ * Copyright (c) Jürgen Buchmüller <pullmoll@t-online.de>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *************************************************************************/
+
+#include "modules.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * \file lualept-worker.cpp
+ * Run a Lua function for a number of jobs on worker threads.
+ *
+ * A lua_State can only be used by one thread at a time, so each call of
+ * ll_run_workers() starts its threads, and each thread opens a fresh state
+ * (see worker_open()) and loads the function from its bytecode (see
+ * ll_dump_chunk()). The states are closed when the jobs are done; there
+ * is no pool of states kept between calls. The function can not share
+ * upvalues with the calling state; data is passed in as arguments.
+ *
+ * Jobs are handed out in order of their index from an atomic counter.
+ * Arguments are pushed and results are taken by the callbacks of a
+ * ll_worker_job_t, which run in the worker threads while the calling
+ * state is blocked, and must therefore only touch the worker state
+ * and their own job's data.
+ */
+
+/**
+ * \brief lua_Writer appending a dumped chunk to a std::string.
+ * \param L Lua state.
+ * \param p pointer to the data
+ * \param size number of bytes
+ * \param ud pointer to the std::string
+ * \return 0 on success.
+ */
+static int
+chunk_writer(lua_State *L, const void *p, size_t size, void *ud)
+{
+    UNUSED(L);
+    reinterpret_cast<std::string *>(ud)->append(reinterpret_cast<const char *>(p), size);
+    return 0;
+}
+
+/**
+ * \brief Return the Lua function or chunk at %arg as code for worker states.
+ * <pre>
+ * A Lua function is dumped to bytecode; it must not use upvalues other
+ * than _ENV, i.e. locals of the enclosing scope. A string is taken as
+ * the source text of a chunk, which receives its arguments as "...".
+ * A C function must be a method of the class %tname (e.g. pix.Invert);
+ * it is called with the first argument only, i.e. (...):Invert().
+ * The data in %chunk must be freed with ll_free().
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index of the function or string
+ * \param tname class name for C function methods, or nullptr
+ * \param chunk pointer to a ll_bytes_t to fill
+ * \return 0 on success, or die on error.
+ */
+int
+ll_dump_chunk(const char *_fun, lua_State *L, int arg, const char *tname, ll_bytes_t *chunk)
+{
+    std::string code;
+    const char *name;
+    size_t size = 0;
+    int i;
+
+    chunk->data = nullptr;
+    chunk->size = 0;
+    if (LUA_TSTRING == lua_type(L, arg)) {
+        const char *str = lua_tolstring(L, arg, &size);
+        code.assign(str, size);
+    } else if (lua_iscfunction(L, arg)) {
+        /* find the method's name in the class meta table */
+        arg = lua_absindex(L, arg);
+        if (tname && ll_open_class(L, tname)) {
+            int top = lua_gettop(L);
+            if (LUA_TTABLE == luaL_getmetatable(L, tname)) {
+                lua_pushnil(L);
+                while (code.empty() && lua_next(L, -2)) {
+                    if (LUA_TSTRING == lua_type(L, -2) && lua_rawequal(L, -1, arg) &&
+                        strncmp(lua_tostring(L, -2), "__", 2))
+                        code = std::string("return (...):") + lua_tostring(L, -2) + "()";
+                    lua_pop(L, 1);
+                }
+            }
+            lua_settop(L, top);
+        }
+        if (code.empty()) {
+            die(_fun, L, "C function at #%d is not a method of %s", arg, tname ? tname : "a class");
+            return 1;
+        }
+    } else if (lua_isfunction(L, arg)) {
+        for (i = 1; nullptr != (name = lua_getupvalue(L, arg, i)); i++) {
+            lua_pop(L, 1);
+            if (strcmp(name, "_ENV")) {
+                die(_fun, L, "function uses upvalue '%s'; pass it as an argument", name);
+                return 1;
+            }
+        }
+        lua_pushvalue(L, arg);
+        lua_dump(L, chunk_writer, &code, 0);
+        lua_pop(L, 1);
+    } else {
+        die(_fun, L, "expected a function or a chunk string at #%d", arg);
+        return 1;
+    }
+
+    chunk->data = ll_malloc<l_uint8>(_fun, L, code.size());
+    chunk->size = code.size();
+    memcpy(chunk->data, code.data(), code.size());
+    return 0;
+}
+
+/**
+ * \brief Return the number of worker threads to use.
+ * \param nthreads requested number of threads, or <= 0 for the default
+ * \param njobs number of jobs
+ * \return number of threads between 1 and %njobs.
+ */
+l_int32
+ll_worker_count(l_int32 nthreads, l_int32 njobs)
+{
+    if (nthreads <= 0)
+        nthreads = static_cast<l_int32>(std::thread::hardware_concurrency());
+    if (nthreads > njobs)
+        nthreads = njobs;
+    return nthreads < 1 ? 1 : nthreads;
+}
+
+/**
+ * \brief Capture the value at %arg for another Lua state.
+ * <pre>
+ * Values can be nil, booleans, numbers, strings, SharedPix*, Channel*,
+ * SharedQueue* and SharedStack*; other objects can not be shared between
+ * threads. A SharedPix* is passed without a copy: every receiver gets its
+ * own view. The others are passed by reference.
+ * Free the captured value with ll_free_arg().
+ * </pre>
+ * \param L Lua state.
+ * \param arg index of the value
+ * \param val pointer to the ll_worker_arg_t to fill
+ * \return true on success, or false if the value can not be captured.
+ */
+bool
+ll_capture_arg(lua_State *L, int arg, ll_worker_arg_t *val)
+{
+    val->type = lua_type(L, arg);
+    val->isint = false;
+    val->i = 0;
+    val->n = 0;
+    val->str.clear();
+    val->sp = nullptr;
+    val->ch = nullptr;
+    val->sq = nullptr;
+    val->ss = nullptr;
+    switch (val->type) {
+    case LUA_TNIL:
+    case LUA_TNONE:
+        val->type = LUA_TNIL;
+        break;
+    case LUA_TBOOLEAN:
+        val->i = lua_toboolean(L, arg);
+        break;
+    case LUA_TNUMBER:
+        val->isint = lua_isinteger(L, arg) ? true : false;
+        val->i = lua_tointeger(L, arg);
+        val->n = lua_tonumber(L, arg);
+        break;
+    case LUA_TSTRING:
+        {
+            size_t len = 0;
+            const char *str = lua_tolstring(L, arg, &len);
+            val->str.assign(str, len);
+        }
+        break;
+    default:
+        val->sp = ll_get_shared_pix(L, arg);
+        if (!val->sp)
+            val->ch = ll_get_channel(L, arg);
+        if (!val->sp && !val->ch)
+            val->sq = ll_get_shared_queue(L, arg);
+        if (!val->sp && !val->ch && !val->sq)
+            val->ss = ll_get_shared_stack(L, arg);
+        if (!val->sp && !val->ch && !val->sq && !val->ss) {
+            val->type = LUA_TNIL;
+            return false;
+        }
+        val->type = LUA_TUSERDATA;
+    }
+    return true;
+}
+
+/**
+ * \brief Release the references held by a value captured by ll_capture_arg().
+ * \param val pointer to the ll_worker_arg_t
+ */
+void
+ll_free_arg(ll_worker_arg_t *val)
+{
+    ll_release_shared_pix(&val->sp);
+    ll_release_channel(&val->ch);
+    ll_release_shared_queue(&val->sq);
+    ll_release_shared_stack(&val->ss);
+    val->type = LUA_TNIL;
+}
+
+/**
+ * \brief Push a value captured by ll_capture_arg() to the Lua state %L.
+ * The references held by %val are not consumed.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param val pointer to the ll_worker_arg_t
+ * \return 1 value on the Lua stack.
+ */
+int
+ll_push_arg(const char *_fun, lua_State *L, const ll_worker_arg_t *val)
+{
+    switch (val->type) {
+    case LUA_TBOOLEAN:
+        return ll_push_boolean(_fun, L, val->i != 0);
+    case LUA_TNUMBER:
+        if (val->isint)
+            lua_pushinteger(L, val->i);
+        else
+            lua_pushnumber(L, val->n);
+        return 1;
+    case LUA_TSTRING:
+        return ll_push_lstring(_fun, L, val->str.data(), val->str.size());
+    case LUA_TUSERDATA:
+        if (val->sp)
+            return ll_push_shared_pix(L, val->sp);
+        if (val->ch)
+            return ll_push_channel(L, val->ch);
+        if (val->sq)
+            return ll_push_shared_queue(L, val->sq);
+        return ll_push_shared_stack(L, val->ss);
+    }
+    return ll_push_nil(_fun, L);
+}
+
+/**
+ * \brief Check that the values from %first to the top of the stack can be captured.
+ * <pre>
+ * Callers check their arguments with this before they allocate anything,
+ * so that the error does not leak their allocations; ll_capture_args()
+ * then does not fail.
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param first index of the first value
+ * \return 0 on success, or die on error.
+ */
+int
+ll_check_args(const char *_fun, lua_State *L, int first)
+{
+    int top = lua_gettop(L);
+    int i;
+
+    for (i = first; i <= top; i++) {
+        switch (lua_type(L, i)) {
+        case LUA_TNIL:
+        case LUA_TBOOLEAN:
+        case LUA_TNUMBER:
+        case LUA_TSTRING:
+            continue;
+        }
+        if (ll_isudata(_fun, L, i, LL_SHAREDPIX) || ll_isudata(_fun, L, i, LL_CHANNEL) ||
+            ll_isudata(_fun, L, i, LL_SHAREDQUEUE) || ll_isudata(_fun, L, i, LL_SHAREDSTACK))
+            continue;
+        die(_fun, L, "can not pass %s at #%d to a worker%s", luaL_typename(L, i), i,
+            ll_isudata(_fun, L, i, LL_PIX) ? "; share it with Pix:Share()" : "");
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * \brief Capture the values from %first to the top of the stack for worker states.
+ * <pre>
+ * See ll_capture_arg() for the values which can be passed.
+ * Free the captured values with ll_free_args().
+ * </pre>
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param first index of the first value
+ * \param args pointer to the ll_worker_args_t to fill
+ * \return number of values captured.
+ */
+int
+ll_capture_args(const char *_fun, lua_State *L, int first, ll_worker_args_t *args)
+{
+    int top = lua_gettop(L);
+    int i;
+
+    args->clear();
+    for (i = first; i <= top; i++) {
+        ll_worker_arg_t arg;
+        if (!ll_capture_arg(L, i, &arg)) {
+            ll_free_args(args);
+            die(_fun, L, "can not pass %s at #%d to a worker%s", luaL_typename(L, i), i,
+                ll_isudata(_fun, L, i, LL_PIX) ? "; share it with Pix:Share()" : "");
+            return 0;
+        }
+        args->push_back(arg);
+    }
+    return static_cast<int>(args->size());
+}
+
+/**
+ * \brief Release the values captured by ll_capture_args().
+ * \param args pointer to the ll_worker_args_t
+ */
+void
+ll_free_args(ll_worker_args_t *args)
+{
+    for (ll_worker_arg_t &arg : *args)
+        ll_free_arg(&arg);
+    args->clear();
+}
+
+/**
+ * \brief Push the values captured by ll_capture_args() to the worker state %W.
+ * \param W worker Lua state.
+ * \param args pointer to the ll_worker_args_t, or nullptr
+ * \return number of values pushed.
+ */
+static int
+push_args(lua_State *W, const ll_worker_args_t *args)
+{
+    FUNC("ll_run_workers");
+    if (!args)
+        return 0;
+    luaL_checkstack(W, static_cast<int>(args->size()), _fun);
+    for (const ll_worker_arg_t &arg : *args)
+        ll_push_arg(_fun, W, &arg);
+    return static_cast<int>(args->size());
+}
+
+/**
+ * \brief Open a new Lua state for a worker thread.
+ * <pre>
+ * Unlike ll_open() this does not touch process wide Leptonica settings
+ * (setLeptDebugOK()), which the host's main thread may be using. The
+ * classes are registered on first use (see luaopen_lualept_lazy()).
+ * </pre>
+ * \return pointer to the Lua state, or nullptr on error.
+ */
+static lua_State *
+worker_open(void)
+{
+    lua_State *W = luaL_newstate();
+    if (!W)
+        return nullptr;
+    luaL_openlibs(W);
+    luaopen_lualept_lazy(W);
+    lua_settop(W, 0);
+    return W;
+}
+
+/**
+ * The structure ll_worker_call_t holds one job while it runs protected.
+ */
+typedef struct ll_worker_call_s {
+    const ll_worker_job_t  *job;    /*!< callbacks and their context */
+    int                     ref;    /*!< reference to the function in the worker state */
+    l_int32                 idx;    /*!< index of the job */
+}   ll_worker_call_t;
+
+/**
+ * \brief Run one job in a worker state.
+ * <pre>
+ * Arg #1 is expected to be a light user data (ll_worker_call_t*).
+ * </pre>
+ * \param W worker Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+WorkerCall(lua_State *W)
+{
+    const ll_worker_call_t *call = reinterpret_cast<const ll_worker_call_t *>(lua_touserdata(W, 1));
+    int nargs;
+
+    lua_rawgeti(W, LUA_REGISTRYINDEX, call->ref);
+    nargs = call->job->push(W, call->idx, call->job->ctx);
+    nargs += push_args(W, call->job->args);
+    lua_call(W, nargs, 1);
+    call->job->take(W, call->idx, call->job->ctx);
+    return 0;
+}
+
+/**
+ * \brief Run the function in %chunk for jobs 0 to %njobs - 1 on %nthreads workers.
+ * <pre>
+ * For each job, the function is called with the values pushed by
+ * job->push() followed by job->args, and its first result is passed
+ * to job->take().
+ * The first error stops the other workers and is returned in %msg with
+ * the index of the failing job (1-based, like Lua indices), so that the
+ * caller can clean up before raising it.
+ * </pre>
+ * \param chunk code from ll_dump_chunk()
+ * \param njobs number of jobs
+ * \param nthreads number of worker threads (see ll_worker_count())
+ * \param job pointer to the callbacks and their context
+ * \param msg buffer for the error message
+ * \param size size of the buffer
+ * \return 0 on success, or 1 on error.
+ */
+int
+ll_run_workers(const ll_bytes_t *chunk, l_int32 njobs, l_int32 nthreads,
+               const ll_worker_job_t *job, char *msg, size_t size)
+{
+    std::atomic<l_int32> next(0);
+    std::atomic<bool> failed(false);
+    l_int32 fail_idx = njobs;
+    std::string fail_msg;
+    std::mutex fail_mutex;
+    std::vector<std::thread> threads;
+
+    auto fail = [&](l_int32 idx, const char *msg) {
+        std::lock_guard<std::mutex> lock(fail_mutex);
+        if (idx < fail_idx) {
+            fail_idx = idx;
+            fail_msg = msg ? msg : "unknown error";
+        }
+        failed = true;
+    };
+
+    auto worker = [&]() {
+        lua_State *W = worker_open();
+        if (!W) {
+            fail(-1, "can not open a worker state");
+            return;
+        }
+        ll_new_lualept(W);
+        lua_setglobal(W, LL_LUALEPT);
+        if (LUA_OK != luaL_loadbufferx(W, reinterpret_cast<const char *>(chunk->data),
+                                       chunk->size, "=worker", "bt")) {
+            fail(-1, lua_tostring(W, -1));
+            lua_close(W);
+            return;
+        }
+        ll_worker_call_t call = {job, luaL_ref(W, LUA_REGISTRYINDEX), 0};
+        while (!failed) {
+            call.idx = next++;
+            if (call.idx >= njobs)
+                break;
+            lua_pushcfunction(W, WorkerCall);
+            lua_pushlightuserdata(W, &call);
+            if (LUA_OK != lua_pcall(W, 1, 0, 0)) {
+                fail(call.idx, lua_tostring(W, -1));
+                break;
+            }
+            lua_settop(W, 0);
+        }
+        lua_close(W);
+    };
+
+    for (l_int32 i = 0; i < nthreads; i++)
+        threads.emplace_back(worker);
+    for (auto &t : threads)
+        t.join();
+
+    if (failed) {
+        if (fail_idx < 0)
+            snprintf(msg, size, "%s", fail_msg.c_str());
+        else
+            snprintf(msg, size, "index %d: %s", fail_idx + 1, fail_msg.c_str());
+        return 1;
+    }
+    return 0;
+}
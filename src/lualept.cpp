@@ -55,6 +55,7 @@
  * - CompData
  * - CCBord
  * - CCBorda
+ * - Channel
  * - Dewarp
  * - Dewarpa
  * - DLList
@@ -63,6 +64,10 @@
  * - DPix
  * - FPix
  * - FPixa
+ * - Future
+ * - Float32Array
+ * - Float64Array
+ * - Int32Array
  * - Kernel
  * - Numa
  * - Numaa
@@ -71,8 +76,10 @@
  * - Pixa
  * - Pixaa
  * - PixColormap
+ * - PixPipeline
  * - PixTiling
  * - PixComp
+ * - PixelBuffer
  * - PixaComp
  * - Pta
  * - Ptaa
@@ -80,7 +87,12 @@
  * - Sarray
  * - Sel
  * - Sela
+ * - SharedPix
+ * - SharedQueue
+ * - SharedStack
  * - Stack
+ * - TiffPages
+ * - UInt32Array
  * - WShed
  *
  * Jürgen Buchmüller <pullmoll@t-online.de>
@@ -206,19 +218,397 @@ ll_ludata(const char *_fun, lua_State *L, int arg)
     return ptr;
 }
 
+/**
+ * \brief Registry key set to true in a lua_State which has the class tag
+ * fast path disabled (see ll_set_udata_fast()).
+ */
+static const char ll_udata_slow_key = 's';
+
+/**
+ * \brief Return the registry key for the metatable of a class with tag (%tag).
+ * The key is a light user data, and it is odd, so it does not clash with the
+ * addresses other libraries use as keys with lua_rawsetp().
+ * \param tag class tag
+ * \return light user data key.
+ */
+static inline const void *
+ll_tag_key(l_uint32 tag)
+{
+    return reinterpret_cast<const void *>((static_cast<uintptr_t>(tag) << 1) | 1);
+}
+
+/**
+ * \brief Return the ll_udata_t block at index %arg, if it was pushed by ll_push_udata().
+ * \param L Lua state.
+ * \param arg argument index
+ * \return pointer to the ll_udata_t, or nullptr if it is none.
+ */
+static inline ll_udata_t *
+ll_tagged_udata(lua_State *L, int arg)
+{
+    if (LUA_TUSERDATA != lua_type(L, arg) || sizeof(ll_udata_t) != lua_rawlen(L, arg))
+        return nullptr;
+    ll_udata_t *ud = reinterpret_cast<ll_udata_t *>(lua_touserdata(L, arg));
+    return LL_UDATA_MAGIC == ud->magic ? ud : nullptr;
+}
+
+/**
+ * \brief Return the ll_udata_t block at index %arg, if its class tag can be trusted.
+ * <pre>
+ * A block which ll_push_udata() flagged LL_UDATA_FAST and whose tag is
+ * %tag is accepted from its header alone, with integer compares only.
+ * Any other block must have the metatable which is cached under the
+ * registry key of its class tag (see ll_register_class()), so a block of
+ * the same size and magic from anywhere else is not mistaken for a
+ * lualept object. Without a cached metatable, i.e. with the fast path
+ * disabled in this state, nullptr is returned and the caller looks up
+ * the class by name.
+ * </pre>
+ * \param L Lua state.
+ * \param arg argument index
+ * \param tag class tag of the expected udata
+ * \return pointer to the ll_udata_t, or nullptr.
+ */
+static inline ll_udata_t *
+ll_cached_udata(lua_State *L, int arg, l_uint32 tag)
+{
+    ll_udata_t *ud = ll_tagged_udata(L, arg);
+    bool same;
+    if (!ud)
+        return nullptr;
+    if ((ud->flags & LL_UDATA_FAST) && tag == ud->tag)
+        return ud;
+    if (!lua_getmetatable(L, arg))
+        return nullptr;
+    same = LUA_TTABLE == lua_rawgetp(L, LUA_REGISTRYINDEX, ll_tag_key(ud->tag)) &&
+        lua_rawequal(L, -1, -2);
+    lua_pop(L, 2);
+    return same ? ud : nullptr;
+}
+
+/** Registry key for the ll_memstats_t of a lua_State */
+static const char ll_memstats_key = 'm';
+
+/**
+ * \brief Return the external memory accounting for the lua_State (%L).
+ * The ll_memstats_t is a user data in the registry, created on first use.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \return pointer to the ll_memstats_t.
+ */
+ll_memstats_t *
+ll_memstats(const char *_fun, lua_State *L)
+{
+    ll_memstats_t *ms = nullptr;
+    UNUSED(_fun);
+    if (LUA_TUSERDATA == lua_rawgetp(L, LUA_REGISTRYINDEX, &ll_memstats_key)) {
+        ms = reinterpret_cast<ll_memstats_t *>(lua_touserdata(L, -1));
+        lua_pop(L, 1);
+        return ms;
+    }
+    lua_pop(L, 1);
+    ms = reinterpret_cast<ll_memstats_t *>(lua_newuserdata(L, sizeof(ll_memstats_t)));
+    memset(ms, 0, sizeof(*ms));
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &ll_memstats_key);
+    return ms;
+}
+
+/**
+ * \brief Release the external bytes accounted for the user data at index %arg.
+ * Called when the object is taken out of the user data, i.e. by __gc or Destroy().
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg argument index
+ */
+void
+ll_udata_release(const char *_fun, lua_State *L, int arg)
+{
+    ll_udata_t *ud = ll_tagged_udata(L, arg);
+    ll_memstats_t *ms = nullptr;
+    if (!ud || !ud->bytes)
+        return;
+    ms = ll_memstats(_fun, L);
+    ms->external -= static_cast<l_int64>(ud->bytes);
+    ms->objects--;
+    ms->released += static_cast<l_int64>(ud->bytes);
+    ms->nreleased++;
+    ud->bytes = 0;
+}
+
+/**
+ * \brief Return true if the user data at %arg is borrowed from the host.
+ * \param L Lua state.
+ * \param arg argument index
+ * \return true if LL_UDATA_BORROWED is set.
+ */
+bool
+ll_udata_borrowed(lua_State *L, int arg)
+{
+    ll_udata_t *ud = ll_tagged_udata(L, arg);
+    return ud && (ud->flags & LL_UDATA_BORROWED);
+}
+
+/**
+ * \brief Mark the user data at %arg as borrowed from the host.
+ * The accounting of its external bytes is released, because Lua never
+ * destroys the object.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg argument index
+ */
+void
+ll_udata_borrow(const char *_fun, lua_State *L, int arg)
+{
+    ll_udata_t *ud = ll_tagged_udata(L, arg);
+    if (!ud)
+        return;
+    ll_udata_release(_fun, L, arg);
+    ud->flags |= LL_UDATA_BORROWED;
+}
+
+/**
+ * \brief Check that the user data at %arg is not borrowed from the host.
+ * A borrowed object stays the host's. It must not be inserted into another
+ * object, which would destroy it later, nor be reallocated; the header of
+ * a borrowed Bytea even lives in Lua memory (see ll_push_var()).
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg argument index
+ * \param tname type name of the user data, or "*" for any
+ */
+void
+ll_check_owned(const char *_fun, lua_State *L, int arg, const char *tname)
+{
+    if (!ll_udata_borrowed(L, arg))
+        return;
+    if (0 == strcmp(tname, "*"))
+        die(_fun, L, "user data at #%d is borrowed from the host; use a Copy()", arg);
+    else
+        die(_fun, L, "%s* at #%d is borrowed from the host; use a Copy()", tname, arg);
+}
+
+/**
+ * \brief Pin or unpin the user data at %arg.
+ * While a user data is pinned, its object is in use by another thread
+ * (see Pix:Async()) or is being encoded (see Pix:WriteTo()), and every
+ * check for the user data raises an error.
+ * \param L Lua state.
+ * \param arg argument index
+ * \param pin true to pin, false to unpin
+ */
+void
+ll_udata_pin(lua_State *L, int arg, bool pin)
+{
+    ll_udata_t *ud = ll_tagged_udata(L, arg);
+    if (!ud)
+        return;
+    if (pin)
+        ud->flags |= LL_UDATA_PINNED;
+    else
+        ud->flags &= ~LL_UDATA_PINNED;
+}
+
+/**
+ * \brief Return true if the user data at %arg was released.
+ * \param L Lua state.
+ * \param arg argument index
+ * \return true if LL_UDATA_RELEASED is set.
+ */
+bool
+ll_udata_released(lua_State *L, int arg)
+{
+    ll_udata_t *ud = ll_tagged_udata(L, arg);
+    return ud && (ud->flags & LL_UDATA_RELEASED);
+}
+
+/**
+ * \brief Mark the user data at %arg as read-only.
+ * The object is shared, e.g. the view of a SharedPix, and bindings which
+ * modify it in place refuse it (see ll_check_Pixd()).
+ * \param L Lua state.
+ * \param arg argument index
+ */
+void
+ll_udata_freeze(lua_State *L, int arg)
+{
+    ll_udata_t *ud = ll_tagged_udata(L, arg);
+    if (ud)
+        ud->flags |= LL_UDATA_READONLY;
+}
+
+/**
+ * \brief Return true if the user data at %arg is read-only.
+ * \param L Lua state.
+ * \param arg argument index
+ * \return true if LL_UDATA_READONLY is set.
+ */
+bool
+ll_udata_readonly(lua_State *L, int arg)
+{
+    ll_udata_t *ud = ll_tagged_udata(L, arg);
+    return ud && (ud->flags & LL_UDATA_READONLY);
+}
+
+/**
+ * \brief Raise an error if the user data at %arg is pinned or released.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg argument index
+ * \param tname tname of the expected udata
+ * \param ud pointer to the ll_udata_t, or nullptr
+ */
+static inline void
+ll_udata_check_usable(const char *_fun, lua_State *L, int arg, const char *tname, const ll_udata_t *ud)
+{
+    if (!ud || !(ud->flags & (LL_UDATA_PINNED | LL_UDATA_RELEASED)))
+        return;
+    if (ud->flags & LL_UDATA_RELEASED)
+        die(_fun, L, "%s* at #%d was released", tname, arg);
+    else
+        die(_fun, L, "user data at #%d is in use by an async call or a sink; await it first", arg);
+}
+
+/**
+ * \brief Drop the object of the user data at index 1 and mark the user data dead.
+ * <pre>
+ * Arg #1 is expected to be a user data of any lualept class.
+ *
+ * This is Release() and __close of every class (see ll_register_class()).
+ * The object is destroyed by the class' __gc right away, instead of when the
+ * garbage collector gets to it; with Lua 5.4 "local pix <close> = ..."
+ * does this at scope exit. Every later use of the user data raises an error.
+ * A borrowed object is left to its owner; only the user data dies.
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+ll_release(lua_State *L)
+{
+    FUNC("ll_release");
+    ll_udata_t *ud = ll_tagged_udata(L, 1);
+    if (!ud) {
+        die(_fun, L, "expected a user data at #%d", 1);
+        return 0;
+    }
+    if (ud->flags & LL_UDATA_RELEASED)
+        return 0;
+    if (LUA_TNIL != luaL_getmetafield(L, 1, "__gc")) {
+        lua_pushvalue(L, 1);
+        lua_call(L, 1, 0);
+    }
+    ud->flags |= LL_UDATA_RELEASED;
+    return 0;
+}
+
+/**
+ * \brief Change the class of the user data at %arg to %tname.
+ * The object in the user data is kept; its class tag and metatable are
+ * replaced, e.g. when Pix:Share() freezes a Pix* into a SharedPix*.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg argument index
+ * \param tname new class name
+ */
+void
+ll_udata_retag(const char *_fun, lua_State *L, int arg, const char *tname)
+{
+    ll_udata_t *ud = ll_tagged_udata(L, arg);
+    if (!ud) {
+        die(_fun, L, "expected a user data at #%d", arg);
+        return;
+    }
+    arg = lua_absindex(L, arg);
+    ll_open_class(L, tname);
+    ud->tag = ll_tag(tname);
+    lua_pushvalue(L, arg);
+    luaL_setmetatable(L, tname);
+    lua_pop(L, 1);
+}
+
+/**
+ * \brief Enable or disable the class tag fast path for user data in the lua_State (%L).
+ * <pre>
+ * The fast path uses the metatables cached under the registry keys of the
+ * class tags, so disabling it removes them from this state's registry and
+ * enabling it caches the metatables of all registered classes again.
+ * User data pushed while it is disabled are checked by their metatable;
+ * those pushed before keep the check of their header (LL_UDATA_FAST).
+ * Other Lua states are not affected.
+ * </pre>
+ * \param L Lua state.
+ * \param enable true to enable the fast path
+ * \return previous state of the fast path.
+ */
+bool
+ll_set_udata_fast(lua_State *L, bool enable)
+{
+    bool prev;
+    int names;
+    lua_Integer i, n = 0;
+
+    prev = LUA_TBOOLEAN != lua_rawgetp(L, LUA_REGISTRYINDEX, &ll_udata_slow_key);
+    lua_pop(L, 1);
+    if (enable) {
+        lua_pushnil(L);
+    } else {
+        lua_pushboolean(L, 1);
+    }
+    lua_rawsetp(L, LUA_REGISTRYINDEX, &ll_udata_slow_key);
+
+    /* collect the registered classes first; the registry is not modified while traversed */
+    lua_newtable(L);
+    names = lua_gettop(L);
+    lua_pushnil(L);
+    while (lua_next(L, LUA_REGISTRYINDEX)) {
+        if (LUA_TSTRING == lua_type(L, -2) && LUA_TTABLE == lua_type(L, -1)) {
+            /* a class metatable is registered under its __name */
+            if (LUA_TSTRING == lua_getfield(L, -1, "__name") && lua_rawequal(L, -1, -3)) {
+                lua_pushvalue(L, -3);
+                lua_rawseti(L, names, ++n);
+            }
+            lua_pop(L, 1);
+        }
+        lua_pop(L, 1);
+    }
+    for (i = 1; i <= n; i++) {
+        lua_rawgeti(L, names, i);
+        const char *tname = lua_tostring(L, -1);
+        if (enable) {
+            lua_getfield(L, LUA_REGISTRYINDEX, tname);
+        } else {
+            lua_pushnil(L);
+        }
+        lua_rawsetp(L, LUA_REGISTRYINDEX, ll_tag_key(ll_tag(tname)));
+        lua_pop(L, 1);
+    }
+    lua_pop(L, 1);
+    return prev;
+}
+
 /**
  * \brief Check Lua stack at index %arg for user data with %tname.
+ * If the class tag (%tag) is given, a user data block pushed by ll_push_udata()
+ * is accepted by comparing its tag, without looking up the metatable.
  * \param _fun calling function's name
  * \param L Lua state.
  * \param arg argument index
  * \param tname tname of the expected udata
+ * \param tag class tag of the expected udata, i.e. ll_tag(tname), or 0
  * \return pointer to the udata.
  */
 void **
-ll_udata(const char *_fun, lua_State *L, int arg, const char* tname)
+ll_udata(const char *_fun, lua_State *L, int arg, const char* tname, l_uint32 tag)
 {
     char msg[128];
     void **pptr = nullptr;
+    if (tag) {
+        ll_udata_t *ud = ll_cached_udata(L, arg, tag);
+        if (ud && ud->tag == tag) {
+            ll_udata_check_usable(_fun, L, arg, tname, ud);
+            return &ud->ptr;
+        }
+    }
     if (0 == strcmp(tname, "*")) {
         /* Wildcard: take any type */
         pptr = reinterpret_cast<void **>(lua_touserdata(L, arg));
@@ -229,6 +619,7 @@ ll_udata(const char *_fun, lua_State *L, int arg, const char* tname)
         snprintf(msg, sizeof(msg), "%s: expected '%s'", _fun, tname);
     }
     luaL_argcheck(L, pptr != nullptr, arg, msg);
+    ll_udata_check_usable(_fun, L, arg, tname, ll_tagged_udata(L, arg));
     return pptr;
 }
 
@@ -323,8 +714,9 @@ ll_istable(const char *_fun, lua_State *L, int arg)
 int
 ll_isudata(const char *_fun, lua_State *L, int arg, const char* tname)
 {
-    void **pptr = reinterpret_cast<void **>(luaL_testudata(L, arg, tname));
-    int res = nullptr != pptr;
+    const l_uint32 tag = ll_tag(tname);
+    ll_udata_t *ud = ll_cached_udata(L, arg, tag);
+    int res = ud ? ud->tag == tag : nullptr != luaL_testudata(L, arg, tname);
     UNUSED(_fun);
     DBG(LOG_CHECK_UDATA, "%s: res=%s\n", _fun, res ? "TRUE" : "FALSE");
     return res;
@@ -342,6 +734,7 @@ ll_free(void *ptr)
 
 /**
  * Register a luaL_Reg table of methods using a metatable
+ * Release() and __close are added unless the class defines them (see ll_release()).
  * \param _fun calling function's name
  * \param L Lua state.
  * \param tname table name for the udata
@@ -359,9 +752,28 @@ ll_register_class(const char *_fun, lua_State *L, const char *tname, const luaL_
     for (nm = 0; methods[nm].name; nm++)
         ;
     luaL_newmetatable(L, tname);
+    /* cache the metatable for ll_push_udata() under the class tag */
+    if (LUA_TBOOLEAN == lua_rawgetp(L, LUA_REGISTRYINDEX, &ll_udata_slow_key)) {
+        lua_pop(L, 1);
+    } else {
+        lua_pop(L, 1);
+        lua_pushvalue(L, -1);
+        lua_rawsetp(L, LUA_REGISTRYINDEX, ll_tag_key(ll_tag(tname)));
+    }
     lua_pushvalue(L, -1);
     lua_setfield(L, -2, "__index");
     luaL_setfuncs(L, methods, 0);
+    /* every class can be released explicitly, or at scope exit with Lua 5.4 <close> */
+    if (LUA_TNIL == lua_getfield(L, -1, "Release")) {
+        lua_pushcfunction(L, ll_release);
+        lua_setfield(L, -3, "Release");
+    }
+    lua_pop(L, 1);
+    if (LUA_TNIL == lua_getfield(L, -1, "__close")) {
+        lua_pushcfunction(L, ll_release);
+        lua_setfield(L, -3, "__close");
+    }
+    lua_pop(L, 1);
     lua_createtable(L, 0, 0);
     luaL_setfuncs(L, functions, 0);
     DBG(LOG_REGISTER, "%s: registered '%s' with %d methods\n", _fun,
@@ -407,23 +819,61 @@ ll_set_global_table(const char *_fun, lua_State *L, const char* tname, lua_CFunc
 
 /**
  * \brief Push user data %udata to the Lua stack and set its meta table %name.
+ * The external memory (%bytes) held by the object, e.g. its raster data,
+ * is reported to the garbage collector in steps of LL_GC_STEP_BYTES,
+ * so that unreachable large objects are collected as memory grows,
+ * not only as the (small) Lua heap grows.
  * \param _fun calling function's name
  * \param L Lua state.
  * \param name tname for the udata
  * \param udata pointer to the udata
+ * \param bytes number of external bytes held by %udata
  * \return 1 table on the stack.
  */
 int
-ll_push_udata(const char *_fun, lua_State *L, const char* name, void *udata)
+ll_push_udata(const char *_fun, lua_State *L, const char* name, void *udata, size_t bytes)
 {
-    void **ppvoid = reinterpret_cast<void **>(lua_newuserdata(L, sizeof(udata)));
-    *ppvoid = udata;
+    if (bytes > 0) {
+        ll_memstats_t *ms = ll_memstats(_fun, L);
+        ms->external += static_cast<l_int64>(bytes);
+        ms->objects++;
+        if (ms->external > ms->peak)
+            ms->peak = ms->external;
+        ms->debt += static_cast<l_int64>(bytes);
+        if (ms->debt >= LL_GC_STEP_BYTES) {
+            /* the step may run finalizers which update ms */
+            l_int64 kbytes = ms->debt / 1024;
+            ms->stepped += ms->debt;
+            ms->steps++;
+            ms->debt = 0;
+            lua_gc(L, LUA_GCSTEP, static_cast<int>(kbytes > INT_MAX ? INT_MAX : kbytes));
+        }
+    }
+
+    ll_udata_t *ud = reinterpret_cast<ll_udata_t *>(lua_newuserdata(L, sizeof(ll_udata_t)));
+    ud->ptr = udata;
+    ud->tag = ll_tag(name);
+    ud->magic = LL_UDATA_MAGIC;
+    ud->bytes = bytes;
+    ud->flags = 0;
     (void)_fun;
-    lua_getfield(L, LUA_REGISTRYINDEX, name);
+    if (LUA_TTABLE == lua_rawgetp(L, LUA_REGISTRYINDEX, ll_tag_key(ud->tag))) {
+        /* the metatable matches the tag, so checks can trust the header */
+        ud->flags |= LL_UDATA_FAST;
+    } else {
+        /* not cached: the fast path is disabled, or the class is not yet registered */
+        lua_pop(L, 1);
+        lua_getfield(L, LUA_REGISTRYINDEX, name);
+    }
+    if (lua_isnil(L, -1) && ll_open_class(L, name)) {
+        /* the class was not yet registered (see luaopen_lualept_lazy()) */
+        lua_pop(L, 1);
+        lua_getfield(L, LUA_REGISTRYINDEX, name);
+    }
     lua_setmetatable(L, -2);
     DBG(LOG_PUSH_UDATA, "%s: pushed '%s' ppvoid=%p udata=%p\n",
         _fun, name ? name : "<nil>",
-        reinterpret_cast<void *>(ppvoid),
+        reinterpret_cast<void *>(&ud->ptr),
         reinterpret_cast<void *>(udata));
     return 1;
 }
@@ -710,7 +1160,7 @@ ll_pack_Iarray(const char* _fun, lua_State *L, const l_int32 *iarray, l_int32 n)
     UNUSED(_fun);
     if (!n || !iarray)
         return ll_push_nil(_fun, L);
-    lua_newtable(L);
+    lua_createtable(L, n, 0);
     for (i = 0; i < n; i++) {
         DBG(LOG_PUSH_ARRAY, "%s: %s[%d] = 0x%08x\n", _fun,
             "iarray", i, iarray[i]);
@@ -735,7 +1185,7 @@ ll_pack_Uarray(const char* _fun, lua_State *L, const l_uint32 *uarray, l_int32 n
     UNUSED(_fun);
     if (!n || !uarray)
         return ll_push_nil(_fun, L);
-    lua_newtable(L);
+    lua_createtable(L, n, 0);
     for (i = 0; i < n; i++) {
         DBG(LOG_PUSH_ARRAY, "%s: %s[%d] = 0x%08x\n", _fun,
             "uarray", i, uarray[i]);
@@ -758,7 +1208,7 @@ int
 ll_pack_Uarray_2d(const char* _fun, lua_State *L, const l_uint32 *data, l_int32 wpl, l_int32 h)
 {
     l_int32 i;
-    lua_newtable(L);
+    lua_createtable(L, h, 0);
     for (i = 0; i < h; i++) {
         DBG(LOG_PUSH_ARRAY, "%s: %s = %d, %s = %p\n", _fun,
             "row", i,
@@ -785,7 +1235,7 @@ ll_pack_Farray(const char* _fun, lua_State *L, const l_float32 *farray, l_int32
     UNUSED(_fun);
     if (!n || !farray)
         return ll_push_nil(_fun, L);
-    lua_newtable(L);
+    lua_createtable(L, n, 0);
     for (i = 0; i < n; i++) {
         DBG(LOG_PUSH_ARRAY, "%s: %s[%d] = %.8g\n", _fun,
             "farray", i, static_cast<lua_Number>(farray[i]));
@@ -808,7 +1258,7 @@ int
 ll_pack_Farray_2d(const char* _fun, lua_State *L, const l_float32 *data, l_int32 wpl, l_int32 h)
 {
     l_int32 i;
-    lua_newtable(L);
+    lua_createtable(L, h, 0);
     for (i = 0; i < h; i++) {
         DBG(LOG_PUSH_ARRAY, "%s: %s = %d, %s = %p\n", _fun,
             "row", i,
@@ -835,7 +1285,7 @@ ll_pack_Darray(const char* _fun, lua_State *L, const l_float64 *darray, l_int32
     UNUSED(_fun);
     if (!n || !darray)
         return ll_push_nil(_fun, L);
-    lua_newtable(L);
+    lua_createtable(L, n, 0);
     for (i = 0; i < n; i++) {
         DBG(LOG_PUSH_ARRAY, "%s: %s[%d] = %.8g\n", _fun,
             "darray", i, darray[i]);
@@ -858,7 +1308,7 @@ int
 ll_pack_Darray_2d(const char* _fun, lua_State *L, const l_float64 *data, l_int32 wpl, l_int32 h)
 {
     l_int32 i;
-    lua_newtable(L);
+    lua_createtable(L, h, 0);
     for (i = 0; i < h; i++) {
         DBG(LOG_PUSH_ARRAY, "%s: %s = %d, %s = %p\n", _fun,
             "row", i,
@@ -885,7 +1335,7 @@ ll_pack_Sarray(const char* _fun, lua_State *L, Sarray *sa)
     UNUSED(_fun);
     if (!n || !sa)
         return ll_push_nil(_fun, L);
-    lua_newtable(L);
+    lua_createtable(L, n, 0);
     for (i = 0; i < n; i++) {
         const char* str = sarrayGetString(sa, i, L_NOCOPY);
         DBG(LOG_PUSH_ARRAY, "%s: %s[%d] = %p\n", _fun,
@@ -2068,818 +2518,905 @@ ll_typestr(ll_type_e type)
 }
 
 /**
- * \brief Set global variables defined in %vars.
+ * \brief Return a new reference to the object %obj of type %type.
+ * Only types with a reference count can be cloned.
+ * \param _fun calling function's name
  * \param L Lua state.
- * \param vars pointer to the ll_global_var_t array
- * \return 0 on success, or die on error.
+ * \param type one of ll_type_e values
+ * \param obj pointer to the object
+ * \return pointer to the clone, or die on error.
  */
-int
-ll_set_globals(lua_State *L, const ll_global_var_t *vars)
+static void *
+ll_clone_object(const char *_fun, lua_State *L, ll_type_e type, void *obj)
 {
-    FUNC("ll_set_globals");
-    const ll_global_var_t *var;
+    if (nullptr == obj)
+        return nullptr;
+    switch (type) {
+    case ll_box:
+        return boxClone(reinterpret_cast<Box *>(obj));
+    case ll_boxa:
+        return boxaCopy(reinterpret_cast<Boxa *>(obj), L_CLONE);
+    case ll_bytea:
+        return l_byteaCopy(reinterpret_cast<L_Bytea *>(obj), L_CLONE);
+    case ll_dna:
+        return l_dnaClone(reinterpret_cast<Dna *>(obj));
+    case ll_dpix:
+        return dpixClone(reinterpret_cast<DPix *>(obj));
+    case ll_fpix:
+        return fpixClone(reinterpret_cast<FPix *>(obj));
+    case ll_fpixa:
+        return fpixaCopy(reinterpret_cast<FPixa *>(obj), L_CLONE);
+    case ll_numa:
+        return numaClone(reinterpret_cast<Numa *>(obj));
+    case ll_pix:
+        return pixClone(reinterpret_cast<Pix *>(obj));
+    case ll_pixa:
+        return pixaCopy(reinterpret_cast<Pixa *>(obj), L_CLONE);
+    case ll_pta:
+        return ptaClone(reinterpret_cast<Pta *>(obj));
+    case ll_sarray:
+        return sarrayClone(reinterpret_cast<Sarray *>(obj));
+    default:
+        die(_fun, L, "Can not clone type '%s'\n", ll_typestr(type));
+    }
+    return nullptr;
+}
 
-    if (nullptr == vars)
-        return 0;
+/**
+ * \brief Push the value of the variable defined in %var to the Lua stack.
+ * Ownership of objects passes to Lua, i.e. the variable is set to nullptr.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param var pointer to the ll_global_var_t
+ * \return 1 value on the Lua stack, or die on error.
+ */
+static int
+ll_push_var(const char *_fun, lua_State *L, const ll_global_var_t *var)
+{
+    if (var->type > ll_pbytes && ll_transfer != var->mode) {
+        void *obj = *reinterpret_cast<void **>(var->u.pptr);
+        ll_global_var_t tmp = *var;
+        tmp.mode = ll_transfer;
+        if (ll_clone == var->mode) {
+            /* push a new reference and keep the host's */
+            void *clone = ll_clone_object(_fun, L, var->type, obj);
+            tmp.u.pptr = &clone;
+            return ll_push_var(_fun, L, &tmp);
+        }
+        /* push the host's object, but flag it as borrowed */
+        tmp.u.pptr = &obj;
+        ll_push_var(_fun, L, &tmp);
+        if (ll_tagged_udata(L, -1)) {
+            ll_udata_borrow(_fun, L, -1);
+        }
+        return 1;
+    }
 
-    for (var = vars; ll_invalid != var->type; var++) {
+    switch (var->type) {
+    case ll_boolean:
+        ll_push_boolean(_fun, L, *var->u.pb);
+        break;
 
-        switch (var->type) {
-        case ll_boolean:
-            ll_push_boolean(_fun, L, *var->u.pb);
-            lua_setglobal(L, var->name);
-            break;
-
-        case ll_int8:
-            ll_push_l_int8(_fun, L, *var->u.pi8);
-            lua_setglobal(L, var->name);
-            break;
-
-        case ll_uint8:
-            ll_push_l_uint8(_fun, L, *var->u.pu8);
-            lua_setglobal(L, var->name);
-            break;
-
-        case ll_int16:
-            ll_push_l_int16(_fun, L, *var->u.pi16);
-            lua_setglobal(L, var->name);
-            break;
-
-        case ll_uint16:
-            ll_push_l_uint16(_fun, L, *var->u.pu16);
-            lua_setglobal(L, var->name);
-            break;
-
-        case ll_int32:
-            ll_push_l_int32(_fun, L, *var->u.pi32);
-            lua_setglobal(L, var->name);
-            break;
-
-        case ll_uint32:
-            ll_push_l_uint32(_fun, L, *var->u.pu32);
-            lua_setglobal(L, var->name);
-            break;
-
-        case ll_int64:
-            ll_push_l_int64(_fun, L, *var->u.pi64);
-            lua_setglobal(L, var->name);
-            break;
-
-        case ll_uint64:
-            ll_push_l_uint64(_fun, L, *var->u.pu64);
-            lua_setglobal(L, var->name);
-            break;
-
-        case ll_float32:
-            ll_push_l_float32(_fun, L, *var->u.pf32);
-            lua_setglobal(L, var->name);
-            break;
-
-        case ll_float64:
-            ll_push_l_float64(_fun, L, *var->u.pf64);
-            lua_setglobal(L, var->name);
-            break;
-
-        case ll_pchars:
-            ll_push_string(_fun, L, *var->u.pchars);
-            *var->u.pchars = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+    case ll_int8:
+        ll_push_l_int8(_fun, L, *var->u.pi8);
+        break;
 
-        case ll_pbytes:
-            ll_push_bytes(_fun, L, var->u.pbytes->data, var->u.pbytes->size);
-            (*var->u.pbytes).data = nullptr;
-            (*var->u.pbytes).size = 0;
-            lua_setglobal(L, var->name);
-            break;
+    case ll_uint8:
+        ll_push_l_uint8(_fun, L, *var->u.pu8);
+        break;
 
-        case ll_amap:
-            ll_push_Amap(_fun, L, *var->u.pamap);
-            *var->u.pamap = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+    case ll_int16:
+        ll_push_l_int16(_fun, L, *var->u.pi16);
+        break;
 
-        case ll_aset:
-            ll_push_Aset(_fun, L, *var->u.paset);
-            *var->u.paset = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+    case ll_uint16:
+        ll_push_l_uint16(_fun, L, *var->u.pu16);
+        break;
 
-        case ll_bbuffer:
-            ll_push_ByteBuffer(_fun, L, *var->u.pbb);
-            *var->u.pbb = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+    case ll_int32:
+        ll_push_l_int32(_fun, L, *var->u.pi32);
+        break;
 
-        case ll_bmf:
-            ll_push_Bmf(_fun, L, *var->u.pbmf);
-            *var->u.pbmf = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+    case ll_uint32:
+        ll_push_l_uint32(_fun, L, *var->u.pu32);
+        break;
 
-        case ll_box:
-            ll_push_Box(_fun, L, *var->u.pbox);
-            *var->u.pbox = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+    case ll_int64:
+        ll_push_l_int64(_fun, L, *var->u.pi64);
+        break;
 
-        case ll_boxa:
-            ll_push_Boxa(_fun, L, *var->u.pboxa);
-            *var->u.pboxa = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+    case ll_uint64:
+        ll_push_l_uint64(_fun, L, *var->u.pu64);
+        break;
 
-        case ll_boxaa:
-            ll_push_Boxaa(_fun, L, *var->u.pboxaa);
-            *var->u.pboxaa = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+    case ll_float32:
+        ll_push_l_float32(_fun, L, *var->u.pf32);
+        break;
 
-        case ll_bytea:
-            ll_push_Bytea(_fun, L, *var->u.pbytea);
-            *var->u.pbytea = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+    case ll_float64:
+        ll_push_l_float64(_fun, L, *var->u.pf64);
+        break;
 
-        case ll_compdata:
-            ll_push_CompData(_fun, L, *var->u.pcid);
-            *var->u.pcid = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+    case ll_pchars:
+        ll_push_string(_fun, L, *var->u.pchars);
+        if (ll_transfer == var->mode)
+            *var->u.pchars = nullptr;
+        break;
+
+    case ll_pbytes:
+        if (ll_borrow == var->mode) {
+            /* a Bytea header in Lua memory pointing to the host's data */
+            L_Bytea *ba = reinterpret_cast<L_Bytea *>(lua_newuserdata(L, sizeof(L_Bytea)));
+            memset(ba, 0, sizeof(*ba));
+            ba->nalloc = var->u.pbytes->size;
+            ba->size = var->u.pbytes->size;
+            ba->refcount = 1;
+            ba->data = var->u.pbytes->data;
+            ll_push_Bytea(_fun, L, ba);
+            ll_tagged_udata(L, -1)->flags |= LL_UDATA_BORROWED;
+            /* the header lives as long as the Bytea */
+            lua_insert(L, -2);
+            lua_setuservalue(L, -2);
+        } else if (ll_clone == var->mode) {
+            lua_pushlstring(L, reinterpret_cast<const char *>(var->u.pbytes->data), var->u.pbytes->size);
+        } else {
+            ll_push_bytes(_fun, L, var->u.pbytes->data, var->u.pbytes->size);
+            (*var->u.pbytes).data = nullptr;
+            (*var->u.pbytes).size = 0;
+        }
+        break;
+
+    case ll_amap:
+        ll_push_Amap(_fun, L, *var->u.pamap);
+        *var->u.pamap = nullptr;
+        break;
+
+    case ll_aset:
+        ll_push_Aset(_fun, L, *var->u.paset);
+        *var->u.paset = nullptr;
+        break;
+
+    case ll_bbuffer:
+        ll_push_ByteBuffer(_fun, L, *var->u.pbb);
+        *var->u.pbb = nullptr;
+        break;
+
+    case ll_bmf:
+        ll_push_Bmf(_fun, L, *var->u.pbmf);
+        *var->u.pbmf = nullptr;
+        break;
+
+    case ll_box:
+        ll_push_Box(_fun, L, *var->u.pbox);
+        *var->u.pbox = nullptr;
+        break;
+
+    case ll_boxa:
+        ll_push_Boxa(_fun, L, *var->u.pboxa);
+        *var->u.pboxa = nullptr;
+        break;
+
+    case ll_boxaa:
+        ll_push_Boxaa(_fun, L, *var->u.pboxaa);
+        *var->u.pboxaa = nullptr;
+        break;
+
+    case ll_bytea:
+        ll_push_Bytea(_fun, L, *var->u.pbytea);
+        *var->u.pbytea = nullptr;
+        break;
+
+    case ll_compdata:
+        ll_push_CompData(_fun, L, *var->u.pcid);
+        *var->u.pcid = nullptr;
+        break;
+
+    case ll_ccbord:
+        ll_push_CCBord(_fun, L, *var->u.pccb);
+        *var->u.pccb = nullptr;
+        break;
+
+    case ll_ccborda:
+        ll_push_CCBorda(_fun, L, *var->u.pccba);
+        *var->u.pccba = nullptr;
+        break;
+
+    case ll_dewarp:
+        ll_push_Dewarp(_fun, L, *var->u.pdew);
+        *var->u.pdew = nullptr;
+        break;
+
+    case ll_dewarpa:
+        ll_push_Dewarpa(_fun, L, *var->u.pdewa);
+        *var->u.pdewa = nullptr;
+        break;
+
+    case ll_dllist:
+        ll_push_DLList(_fun, L, *var->u.plist);
+        *var->u.plist = nullptr;
+        break;
+
+    case ll_dna:
+        ll_push_Dna(_fun, L, *var->u.pda);
+        *var->u.pda = nullptr;
+        break;
+
+    case ll_dnaa:
+        ll_push_Dnaa(_fun, L, *var->u.pdaa);
+        *var->u.pdaa = nullptr;
+        break;
+
+    case ll_dnahash:
+        ll_push_DnaHash(_fun, L, *var->u.pdah);
+        *var->u.pdah = nullptr;
+        break;
+
+    case ll_dpix:
+        ll_push_DPix(_fun, L, *var->u.pdpix);
+        *var->u.pdpix = nullptr;
+        break;
+
+    case ll_fpix:
+        ll_push_FPix(_fun, L, *var->u.pfpix);
+        *var->u.pfpix = nullptr;
+        break;
+
+    case ll_fpixa:
+        ll_push_FPixa(_fun, L, *var->u.pfpixa);
+        *var->u.pfpixa = nullptr;
+        break;
+
+    case ll_kernel:
+        ll_push_Kernel(_fun, L, *var->u.pkel);
+        *var->u.pkel = nullptr;
+        break;
+
+    case ll_numa:
+        ll_push_Numa(_fun, L, *var->u.pna);
+        *var->u.pna = nullptr;
+        break;
+
+    case ll_numaa:
+        ll_push_Numaa(_fun, L, *var->u.pnaa);
+        *var->u.pnaa = nullptr;
+        break;
+
+    case ll_pdfdata:
+        ll_push_PdfData(_fun, L, *var->u.ppdd);
+        *var->u.ppdd = nullptr;
+        break;
+
+    case ll_pix:
+        ll_push_Pix(_fun, L, *var->u.ppix);
+        *var->u.ppix = nullptr;
+        break;
+
+    case ll_pixa:
+        ll_push_Pixa(_fun, L, *var->u.ppixa);
+        *var->u.ppixa = nullptr;
+        break;
+
+    case ll_pixaa:
+        ll_push_Pixaa(_fun, L, *var->u.ppixaa);
+        *var->u.ppixaa = nullptr;
+        break;
+
+    case ll_pixacc:
+        ll_push_Pixacc(_fun, L, *var->u.ppixacc);
+        *var->u.ppixacc = nullptr;
+        break;
+
+    case ll_pixcmap:
+        ll_push_PixColormap(_fun, L, *var->u.pcmap);
+        *var->u.pcmap = nullptr;
+        break;
+
+    case ll_pixtiling:
+        ll_push_PixTiling(_fun, L, *var->u.ppixt);
+        *var->u.ppixt = nullptr;
+        break;
+
+    case ll_pixcomp:
+        ll_push_PixComp(_fun, L, *var->u.ppixc);
+        *var->u.ppixc = nullptr;
+        break;
+
+    case ll_pixacomp:
+        ll_push_PixaComp(_fun, L, *var->u.ppixac);
+        *var->u.ppixac = nullptr;
+        break;
+
+    case ll_pta:
+        ll_push_Pta(_fun, L, *var->u.ppta);
+        *var->u.ppta = nullptr;
+        break;
+
+    case ll_ptaa:
+        ll_push_Ptaa(_fun, L, *var->u.pptaa);
+        *var->u.pptaa = nullptr;
+        break;
+
+    case ll_queue:
+        ll_push_Queue(_fun, L, *var->u.pqueue);
+        *var->u.pqueue = nullptr;
+        break;
+
+    case ll_rbtnode:
+        lua_pushlightuserdata(L, *var->u.pnode);
+        *var->u.pnode = nullptr;
+        break;
+
+    case ll_rbtree:
+        lua_pushlightuserdata(L, *var->u.ptree);
+        *var->u.ptree = nullptr;
+        break;
+
+    case ll_sarray:
+        ll_push_Sarray(_fun, L, *var->u.psa);
+        *var->u.psa = nullptr;
+        break;
+
+    case ll_sel:
+        ll_push_Sel(_fun, L, *var->u.psel);
+        *var->u.psel = nullptr;
+        break;
+
+    case ll_sela:
+        ll_push_Sela(_fun, L, *var->u.psela);
+        *var->u.psela = nullptr;
+        break;
+
+    case ll_stack:
+        ll_push_Stack(_fun, L, *var->u.pstack);
+        *var->u.pstack = nullptr;
+        break;
+
+    case ll_wshed:
+        ll_push_WShed(_fun, L, *var->u.pwshed);
+        *var->u.pwshed = nullptr;
+        break;
+
+    default:
+        die(_fun, L, "Unsupported type '%d' with name '%s'\n", var->type, var->name);
+    }
+    return 1;
+}
 
-        case ll_ccbord:
-            ll_push_CCBord(_fun, L, *var->u.pccb);
-            *var->u.pccb = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+/**
+ * \brief Get the variable defined in %var from the Lua stack at index %arg.
+ * Ownership of objects passes to the caller, i.e. the user data is taken.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg index of the value on the Lua stack
+ * \param var pointer to the ll_global_var_t
+ * \return 0 on success, or die on error.
+ */
+static int
+ll_get_var(const char *_fun, lua_State *L, int arg, const ll_global_var_t *var)
+{
+    arg = lua_absindex(L, arg);
+    if (var->type > ll_pbytes && ll_transfer != var->mode && LUA_TUSERDATA == lua_type(L, arg)) {
+        /* check the class, but leave the object to Lua */
+        void **pptr = ll_udata(_fun, L, arg, ll_typestr(var->type), ll_tag(ll_typestr(var->type)));
+        void **phost = reinterpret_cast<void **>(var->u.pptr);
+        if (ll_clone == var->mode && ll_bytea == var->type) {
+            /* l_byteaCopy(L_CLONE) would hand out the borrowed header */
+            ll_check_owned(_fun, L, arg, ll_typestr(var->type));
+        }
+        *phost = ll_clone == var->mode ? ll_clone_object(_fun, L, var->type, *pptr) : *pptr;
+        return 0;
+    }
 
-        case ll_ccborda:
-            ll_push_CCBorda(_fun, L, *var->u.pccba);
-            *var->u.pccba = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+    switch (var->type) {
+    case ll_boolean:
+        if (LUA_TBOOLEAN == lua_type(L, arg)) {
+            *var->u.pb = static_cast<bool>(lua_toboolean(L, arg));
+        } else {
+            *var->u.pb = false;
+        }
+        break;
 
-        case ll_dewarp:
-            ll_push_Dewarp(_fun, L, *var->u.pdew);
-            *var->u.pdew = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+    case ll_int8:
+        if (LUA_TNUMBER == lua_type(L, arg)) {
+            *var->u.pi8 = static_cast<l_int8>(lua_tointeger(L, arg));
+        } else {
+            *var->u.pi8 = 0;
+        }
+        break;
 
-        case ll_dewarpa:
-            ll_push_Dewarpa(_fun, L, *var->u.pdewa);
-            *var->u.pdewa = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+    case ll_uint8:
+        if (LUA_TNUMBER == lua_type(L, arg)) {
+            *var->u.pu8 = static_cast<l_uint8>(lua_tointeger(L, arg));
+        } else {
+            *var->u.pu8 = 0;
+        }
+        break;
+
+    case ll_int16:
+        if (LUA_TNUMBER == lua_type(L, arg)) {
+            *var->u.pi16 = static_cast<l_int16>(lua_tointeger(L, arg));
+        } else {
+            *var->u.pi16 = 0;
+        }
+        break;
+
+    case ll_uint16:
+        if (LUA_TNUMBER == lua_type(L, arg)) {
+            *var->u.pu16 = static_cast<l_uint16>(lua_tointeger(L, arg));
+        } else {
+            *var->u.pu16 = 0;
+        }
+        break;
+
+    case ll_int32:
+        if (LUA_TNUMBER == lua_type(L, arg)) {
+            *var->u.pi32 = static_cast<l_int32>(lua_tointeger(L, arg));
+        } else {
+            *var->u.pi32 = 0;
+        }
+        break;
+
+    case ll_uint32:
+        if (LUA_TNUMBER == lua_type(L, arg)) {
+            *var->u.pu32 = static_cast<l_uint32>(lua_tointeger(L, arg));
+        } else {
+            *var->u.pu32 = 0;
+        }
+        break;
+
+    case ll_int64:
+        if (LUA_TNUMBER == lua_type(L, arg)) {
+            *var->u.pi64 = static_cast<l_int64>(lua_tointeger(L, arg));
+        } else {
+            *var->u.pi64 = 0;
+        }
+        break;
+
+    case ll_uint64:
+        if (LUA_TNUMBER == lua_type(L, arg)) {
+            *var->u.pu64 = static_cast<l_uint64>(lua_tointeger(L, arg));
+        } else {
+            *var->u.pu64 = 0;
+        }
+        break;
+
+    case ll_float32:
+        if (LUA_TNUMBER == lua_type(L, arg)) {
+            *var->u.pf32 = static_cast<l_float32>(lua_tonumber(L, arg));
+        } else {
+            *var->u.pf32 = 0.0f;
+        }
+        break;
+
+    case ll_float64:
+        if (LUA_TNUMBER == lua_type(L, arg)) {
+            *var->u.pf64 = static_cast<l_float64>(lua_tonumber(L, arg));
+        } else {
+            *var->u.pf64 = 0.0;
+        }
+        break;
+
+    case ll_pchars:
+        if (LUA_TSTRING == lua_type(L, arg)) {
+            const char *str = lua_tostring(L, arg);
+            const size_t len = str ? strlen(str) + 1 : 1;
+            if (ll_borrow == var->mode) {
+                *var->u.pchars = const_cast<char *>(str);
+            } else {
+                *var->u.pchars = ll_calloc<char>(_fun, L, len);
+                memcpy(*var->u.pchars, str, len);
+            }
+        } else {
+            *var->u.pchars = nullptr;
+        }
+        break;
+
+    case ll_pbytes:
+        if (ll_borrow == var->mode && LUA_TUSERDATA == lua_type(L, arg)) {
+            /* point to the data of a Bytea */
+            L_Bytea *ba = ll_check_Bytea(_fun, L, arg);
+            (*var->u.pbytes).data = ba->data;
+            (*var->u.pbytes).size = ba->size;
+        } else if (LUA_TSTRING == lua_type(L, arg)) {
+            size_t size;
+            const l_uint8 *str = ll_check_lbytes(_fun, L, arg, &size);
+            if (ll_borrow == var->mode) {
+                /* point to the Lua string */
+                (*var->u.pbytes).data = const_cast<l_uint8 *>(str);
+            } else {
+                (*var->u.pbytes).data = ll_malloc<l_uint8>(_fun, L, size);
+                memcpy((*var->u.pbytes).data, str, size);
+            }
+            (*var->u.pbytes).size = size;
+        } else {
+            (*var->u.pbytes).data = nullptr;
+            (*var->u.pbytes).size = 0;
+        }
+        break;
+
+    case ll_amap:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pamap = ll_take_owned<Amap>(_fun, L, arg, ll_typestr(var->type));
+        } else {
+            *var->u.pamap = nullptr;
+        }
+        break;
+
+    case ll_aset:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.paset = ll_take_owned<Aset>(_fun, L, arg, ll_typestr(var->type));
+        } else {
+            *var->u.paset = nullptr;
+        }
+        break;
+
+    case ll_bbuffer:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pbb = ll_take_owned<ByteBuffer>(_fun, L, arg, ll_typestr(var->type));
+        } else {
+            *var->u.pbb = nullptr;
+        }
+        break;
+
+    case ll_bmf:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pbmf = ll_take_owned<Bmf>(_fun, L, arg, ll_typestr(var->type));
+        } else {
+            *var->u.pbmf = nullptr;
+        }
+        break;
+
+    case ll_box:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pbox = ll_take_owned<Box>(_fun, L, arg, ll_typestr(var->type));
+        } else {
+            *var->u.pbox = nullptr;
+        }
+        break;
+
+    case ll_boxa:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pboxa = ll_take_owned<Boxa>(_fun, L, arg, ll_typestr(var->type));
+        } else {
+            *var->u.pboxa = nullptr;
+        }
+        break;
+
+    case ll_boxaa:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pboxaa = ll_take_owned<Boxaa>(_fun, L, arg, ll_typestr(var->type));
+        } else {
+            *var->u.pboxaa = nullptr;
+        }
+        break;
+
+    case ll_bytea:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pbytea = ll_take_owned<Bytea>(_fun, L, arg, ll_typestr(var->type));
+        } else {
+            *var->u.pbytea = nullptr;
+        }
+        break;
+
+    case ll_compdata:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pcid = ll_take_owned<CompData>(_fun, L, arg, ll_typestr(var->type));
+        } else {
+            *var->u.pcid = nullptr;
+        }
+        break;
+
+    case ll_ccbord:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pccb = ll_take_owned<CCBord>(_fun, L, arg, ll_typestr(var->type));
+        } else {
+            *var->u.pccb = nullptr;
+        }
+        break;
 
-        case ll_dllist:
-            ll_push_DLList(_fun, L, *var->u.plist);
+    case ll_ccborda:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pccba = ll_take_owned<CCBorda>(_fun, L, arg, ll_typestr(var->type));
+        } else {
+            *var->u.pccba = nullptr;
+        }
+        break;
+
+    case ll_dewarp:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pdew = ll_take_owned<Dewarp>(_fun, L, arg, ll_typestr(var->type));
+        } else {
+            *var->u.pdew = nullptr;
+        }
+        break;
+
+    case ll_dewarpa:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pdewa = ll_take_owned<Dewarpa>(_fun, L, arg, ll_typestr(var->type));
+        } else {
+            *var->u.pdewa = nullptr;
+        }
+        break;
+
+    case ll_dllist:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.plist = ll_take_owned<DLList>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.plist = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_dna:
-            ll_push_Dna(_fun, L, *var->u.pda);
+    case ll_dna:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pda = ll_take_owned<Dna>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.pda = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_dnaa:
-            ll_push_Dnaa(_fun, L, *var->u.pdaa);
+    case ll_dnaa:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pdaa = ll_take_owned<Dnaa>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.pdaa = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_dnahash:
-            ll_push_DnaHash(_fun, L, *var->u.pdah);
+    case ll_dnahash:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pdah = ll_take_owned<DnaHash>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.pdah = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_dpix:
-            ll_push_DPix(_fun, L, *var->u.pdpix);
+    case ll_dpix:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pdpix = ll_take_owned<DPix>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.pdpix = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_fpix:
-            ll_push_FPix(_fun, L, *var->u.pfpix);
+    case ll_fpix:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pfpix = ll_take_owned<FPix>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.pfpix = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_fpixa:
-            ll_push_FPixa(_fun, L, *var->u.pfpixa);
+    case ll_fpixa:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pfpixa = ll_take_owned<FPixa>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.pfpixa = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_kernel:
-            ll_push_Kernel(_fun, L, *var->u.pkel);
+    case ll_kernel:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pkel = ll_take_owned<Kernel>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.pkel = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_numa:
-            ll_push_Numa(_fun, L, *var->u.pna);
+    case ll_numa:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pna = ll_take_owned<Numa>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.pna = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_numaa:
-            ll_push_Numaa(_fun, L, *var->u.pnaa);
+    case ll_numaa:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pnaa = ll_take_owned<Numaa>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.pnaa = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_pdfdata:
-            ll_push_PdfData(_fun, L, *var->u.ppdd);
+    case ll_pdfdata:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.ppdd = ll_take_owned<PdfData>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.ppdd = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_pix:
-            ll_push_Pix(_fun, L, *var->u.ppix);
+    case ll_pix:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.ppix = ll_take_owned<Pix>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.ppix = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_pixa:
-            ll_push_Pixa(_fun, L, *var->u.ppixa);
+    case ll_pixa:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.ppixa = ll_take_owned<Pixa>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.ppixa = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_pixaa:
-            ll_push_Pixaa(_fun, L, *var->u.ppixaa);
+    case ll_pixaa:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.ppixaa = ll_take_owned<Pixaa>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.ppixaa = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_pixacc:
-            ll_push_Pixacc(_fun, L, *var->u.ppixacc);
+    case ll_pixacc:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.ppixacc = ll_take_owned<Pixacc>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.ppixacc = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_pixcmap:
-            ll_push_PixColormap(_fun, L, *var->u.pcmap);
+    case ll_pixcmap:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pcmap = ll_take_owned<PixColormap>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.pcmap = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_pixtiling:
-            ll_push_PixTiling(_fun, L, *var->u.ppixt);
+    case ll_pixtiling:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.ppixt = ll_take_owned<PixTiling>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.ppixt = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_pixcomp:
-            ll_push_PixComp(_fun, L, *var->u.ppixc);
+    case ll_pixcomp:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.ppixc = ll_take_owned<PixComp>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.ppixc = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_pixacomp:
-            ll_push_PixaComp(_fun, L, *var->u.ppixac);
+    case ll_pixacomp:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.ppixac = ll_take_owned<PixaComp>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.ppixac = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_pta:
-            ll_push_Pta(_fun, L, *var->u.ppta);
+    case ll_pta:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.ppta = ll_take_owned<Pta>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.ppta = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_ptaa:
-            ll_push_Ptaa(_fun, L, *var->u.pptaa);
+    case ll_ptaa:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pptaa = ll_take_owned<Ptaa>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.pptaa = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_queue:
-            ll_push_Queue(_fun, L, *var->u.pqueue);
+    case ll_queue:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pqueue = ll_take_owned<Queue>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.pqueue = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_rbtnode:
-            lua_pushlightuserdata(L, *var->u.pnode);
+    case ll_rbtnode:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pnode = ll_check_ludata<RbtreeNode>(_fun, L, arg);
+        } else {
             *var->u.pnode = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_rbtree:
-            lua_pushlightuserdata(L, *var->u.ptree);
+    case ll_rbtree:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.ptree = ll_check_ludata<Rbtree>(_fun, L, arg);
+        } else {
             *var->u.ptree = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_sarray:
-            ll_push_Sarray(_fun, L, *var->u.psa);
+    case ll_sarray:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.psa = ll_take_owned<Sarray>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.psa = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_sel:
-            ll_push_Sel(_fun, L, *var->u.psel);
+    case ll_sel:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.psel = ll_take_owned<Sel>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.psel = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_sela:
-            ll_push_Sela(_fun, L, *var->u.psela);
+    case ll_sela:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.psela = ll_take_owned<Sela>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.psela = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_stack:
-            ll_push_Stack(_fun, L, *var->u.pstack);
+    case ll_stack:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pstack = ll_take_owned<Stack>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.pstack = nullptr;
-            lua_setglobal(L, var->name);
-            break;
+        }
+        break;
 
-        case ll_wshed:
-            ll_push_WShed(_fun, L, *var->u.pwshed);
+    case ll_wshed:
+        if (LUA_TUSERDATA == lua_type(L, arg)) {
+            *var->u.pwshed = ll_take_owned<WShed>(_fun, L, arg, ll_typestr(var->type));
+        } else {
             *var->u.pwshed = nullptr;
-            lua_setglobal(L, var->name);
-            break;
-
-        default:
-            die(_fun, L, "Unsupported type '%d' with name '%s'\n", var->type, var->name);
         }
+        break;
+
+    default:
+        die(_fun, L, "Unsupported type '%d' with name '%s'\n", var->type, var->name);
     }
     return 0;
 }
 
 /**
- * \brief Get all global variables defined in %vars.
+ * \brief Set global variables defined in %vars.
  * \param L Lua state.
  * \param vars pointer to the ll_global_var_t array
  * \return 0 on success, or die on error.
  */
 int
-ll_get_globals(lua_State *L, const ll_global_var_t *vars)
+ll_set_globals(lua_State *L, const ll_global_var_t *vars)
 {
-    FUNC("ll_get_globals");
+    FUNC("ll_set_globals");
     const ll_global_var_t *var;
 
     if (nullptr == vars)
         return 0;
 
     for (var = vars; ll_invalid != var->type; var++) {
+        ll_push_var(_fun, L, var);
+        lua_setglobal(L, var->name);
+    }
+    return 0;
+}
 
-        switch (var->type) {
-        case ll_boolean:
-            if (LUA_TBOOLEAN == lua_getglobal(L, var->name)) {
-                *var->u.pb = static_cast<bool>(lua_toboolean(L, 1));
-            } else {
-                *var->u.pb = false;
-            }
-            break;
-
-        case ll_int8:
-            if (LUA_TNUMBER == lua_getglobal(L, var->name)) {
-                *var->u.pi8 = static_cast<l_int8>(lua_tointeger(L, 1));
-            } else {
-                *var->u.pi8 = 0;
-            }
-            break;
-
-        case ll_uint8:
-            if (LUA_TNUMBER == lua_getglobal(L, var->name)) {
-                *var->u.pu8 = static_cast<l_uint8>(lua_tointeger(L, 1));
-            } else {
-                *var->u.pu8 = 0;
-            }
-            break;
-
-        case ll_int16:
-            if (LUA_TNUMBER == lua_getglobal(L, var->name)) {
-                *var->u.pi16 = static_cast<l_int16>(lua_tointeger(L, 1));
-            } else {
-                *var->u.pi16 = 0;
-            }
-            break;
-
-        case ll_uint16:
-            if (LUA_TNUMBER == lua_getglobal(L, var->name)) {
-                *var->u.pu16 = static_cast<l_uint16>(lua_tointeger(L, 1));
-            } else {
-                *var->u.pu16 = 0;
-            }
-            break;
-
-        case ll_int32:
-            if (LUA_TNUMBER == lua_getglobal(L, var->name)) {
-                *var->u.pi32 = static_cast<l_int32>(lua_tointeger(L, 1));
-            } else {
-                *var->u.pi32 = 0;
-            }
-            break;
-
-        case ll_uint32:
-            if (LUA_TNUMBER == lua_getglobal(L, var->name)) {
-                *var->u.pu32 = static_cast<l_uint32>(lua_tointeger(L, 1));
-            } else {
-                *var->u.pu32 = 0;
-            }
-            break;
-
-        case ll_int64:
-            if (LUA_TNUMBER == lua_getglobal(L, var->name)) {
-                *var->u.pi64 = static_cast<l_int64>(lua_tointeger(L, 1));
-            } else {
-                *var->u.pi64 = 0;
-            }
-            break;
-
-        case ll_uint64:
-            if (LUA_TNUMBER == lua_getglobal(L, var->name)) {
-                *var->u.pu64 = static_cast<l_uint64>(lua_tointeger(L, 1));
-            } else {
-                *var->u.pu64 = 0;
-            }
-            break;
-
-        case ll_float32:
-            if (LUA_TNUMBER == lua_getglobal(L, var->name)) {
-                *var->u.pf32 = static_cast<l_float32>(lua_tonumber(L, 1));
-            } else {
-                *var->u.pf32 = 0.0f;
-            }
-            break;
-
-        case ll_float64:
-            if (LUA_TNUMBER == lua_getglobal(L, var->name)) {
-                *var->u.pf64 = static_cast<l_float64>(lua_tonumber(L, 1));
-            } else {
-                *var->u.pf64 = 0.0;
-            }
-            break;
-
-        case ll_pchars:
-            if (LUA_TSTRING == lua_getglobal(L, var->name)) {
-                const char *str = lua_tostring(L, -1);
-                const size_t len = str ? strlen(str) + 1 : 1;
-                *var->u.pchars = ll_calloc<char>(_fun, L, len);
-                memcpy(*var->u.pchars, str, len);
-            } else {
-                *var->u.pf64 = 0.0;
-            }
-            break;
-
-        case ll_pbytes:
-            if (LUA_TSTRING == lua_getglobal(L, var->name)) {
-                size_t size;
-                const l_uint8 *str = ll_check_lbytes(_fun, L, -1, &size);
-                (*var->u.pbytes).data = ll_malloc<l_uint8>(_fun, L, size);
-                (*var->u.pbytes).size = size;
-                memcpy((*var->u.pbytes).data, str, size);
-            } else {
-                *var->u.pf64 = 0.0;
-            }
-            break;
-
-        case ll_amap:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pamap = ll_take_udata<Amap>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pamap = nullptr;
-            }
-            break;
-
-        case ll_aset:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.paset = ll_take_udata<Aset>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.paset = nullptr;
-            }
-            break;
-
-        case ll_bbuffer:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pbb = ll_take_udata<ByteBuffer>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pbb = nullptr;
-            }
-            break;
-
-        case ll_bmf:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pbmf = ll_take_udata<Bmf>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pbmf = nullptr;
-            }
-            break;
-
-        case ll_box:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pbox = ll_take_udata<Box>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pbox = nullptr;
-            }
-            break;
-
-        case ll_boxa:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pboxa = ll_take_udata<Boxa>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pboxa = nullptr;
-            }
-            break;
-
-        case ll_boxaa:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pboxaa = ll_take_udata<Boxaa>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pboxaa = nullptr;
-            }
-            break;
-
-        case ll_bytea:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pbytea = ll_take_udata<Bytea>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pbytea = nullptr;
-            }
-            break;
-
-        case ll_compdata:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pcid = ll_take_udata<CompData>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pcid = nullptr;
-            }
-            break;
-
-        case ll_ccbord:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pccb = ll_take_udata<CCBord>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pccb = nullptr;
-            }
-            break;
-
-        case ll_ccborda:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pccba = ll_take_udata<CCBorda>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pccba = nullptr;
-            }
-            break;
-
-        case ll_dewarp:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pdew = ll_take_udata<Dewarp>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pdew = nullptr;
-            }
-            break;
-
-        case ll_dewarpa:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pdewa = ll_take_udata<Dewarpa>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pdewa = nullptr;
-            }
-            break;
-
-        case ll_dllist:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.plist = ll_take_udata<DLList>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.plist = nullptr;
-            }
-            break;
-
-        case ll_dna:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pda = ll_take_udata<Dna>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pda = nullptr;
-            }
-            break;
-
-        case ll_dnaa:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pdaa = ll_take_udata<Dnaa>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pdaa = nullptr;
-            }
-            break;
-
-        case ll_dnahash:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pdah = ll_take_udata<DnaHash>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pdah = nullptr;
-            }
-            break;
-
-        case ll_dpix:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pdpix = ll_take_udata<DPix>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pdpix = nullptr;
-            }
-            break;
-
-        case ll_fpix:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pfpix = ll_take_udata<FPix>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pfpix = nullptr;
-            }
-            break;
-
-        case ll_fpixa:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pfpixa = ll_take_udata<FPixa>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pfpixa = nullptr;
-            }
-            break;
-
-        case ll_kernel:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pkel = ll_take_udata<Kernel>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pkel = nullptr;
-            }
-            break;
-
-        case ll_numa:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pna = ll_take_udata<Numa>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pna = nullptr;
-            }
-            break;
-
-        case ll_numaa:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pnaa = ll_take_udata<Numaa>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pnaa = nullptr;
-            }
-            break;
-
-        case ll_pdfdata:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.ppdd = ll_take_udata<PdfData>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.ppdd = nullptr;
-            }
-            break;
-
-        case ll_pix:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.ppix = ll_take_udata<Pix>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.ppix = nullptr;
-            }
-            break;
-
-        case ll_pixa:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.ppixa = ll_take_udata<Pixa>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.ppixa = nullptr;
-            }
-            break;
-
-        case ll_pixaa:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.ppixaa = ll_take_udata<Pixaa>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.ppixaa = nullptr;
-            }
-            break;
-
-        case ll_pixacc:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.ppixacc = ll_take_udata<Pixacc>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.ppixacc = nullptr;
-            }
-            break;
-
-        case ll_pixcmap:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pcmap = ll_take_udata<PixColormap>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pcmap = nullptr;
-            }
-            break;
-
-        case ll_pixtiling:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.ppixt = ll_take_udata<PixTiling>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.ppixt = nullptr;
-            }
-            break;
-
-        case ll_pixcomp:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.ppixc = ll_take_udata<PixComp>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.ppixc = nullptr;
-            }
-            break;
-
-        case ll_pixacomp:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.ppixac = ll_take_udata<PixaComp>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.ppixac = nullptr;
-            }
-            break;
-
-        case ll_pta:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.ppta = ll_take_udata<Pta>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.ppta = nullptr;
-            }
-            break;
-
-        case ll_ptaa:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pptaa = ll_take_udata<Ptaa>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pptaa = nullptr;
-            }
-            break;
-
-        case ll_queue:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pqueue = ll_take_udata<Queue>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pqueue = nullptr;
-            }
-            break;
-
-        case ll_rbtnode:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pnode = ll_check_ludata<RbtreeNode>(_fun, L, -1);
-            } else {
-                *var->u.pnode = nullptr;
-            }
-            break;
-
-        case ll_rbtree:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.ptree = ll_check_ludata<Rbtree>(_fun, L, -1);
-            } else {
-                *var->u.ptree = nullptr;
-            }
-            break;
-
-        case ll_sarray:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.psa = ll_take_udata<Sarray>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.psa = nullptr;
-            }
-            break;
-
-        case ll_sel:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.psel = ll_take_udata<Sel>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.psel = nullptr;
-            }
-            break;
-
-        case ll_sela:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.psela = ll_take_udata<Sela>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.psela = nullptr;
-            }
-            break;
-
-        case ll_stack:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pstack = ll_take_udata<Stack>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pstack = nullptr;
-            }
-            break;
+/**
+ * \brief Get all global variables defined in %vars.
+ * \param L Lua state.
+ * \param vars pointer to the ll_global_var_t array
+ * \return 0 on success, or die on error.
+ */
+int
+ll_get_globals(lua_State *L, const ll_global_var_t *vars)
+{
+    FUNC("ll_get_globals");
+    const ll_global_var_t *var;
 
-        case ll_wshed:
-            if (LUA_TUSERDATA == lua_getglobal(L, var->name)) {
-                *var->u.pwshed = ll_take_udata<WShed>(_fun, L, -1, ll_typestr(var->type));
-            } else {
-                *var->u.pwshed = nullptr;
-            }
-            break;
+    if (nullptr == vars)
+        return 0;
 
-        default:
-            die(_fun, L, "Unsupported type '%d' with name '%s'\n", var->type, var->name);
-        }
+    for (var = vars; ll_invalid != var->type; var++) {
+        lua_getglobal(L, var->name);
+        ll_get_var(_fun, L, -1, var);
+        lua_pop(L, 1);
     }
     return 0;
 }
@@ -2984,6 +3521,27 @@ Create(lua_State *L)
     return ll_new_lualept(L);
 }
 
+/**
+ * \brief Create a Channel* for moving objects between Lua states.
+ * <pre>
+ * Arg #1 (i.e. self) is an optional LuaLept* (ll).
+ * Arg #2 is an optional l_int32 (capacity), default 1.
+ *
+ * Can be called as LuaLept.Channel(capacity) or LuaLept:Channel(capacity).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 Channel* on the Lua stack.
+ */
+static int
+Channel(lua_State *L)
+{
+    LL_FUNC("Channel");
+    if (ll_isudata(_fun, L, 1, LL_LUALEPT))
+        lua_remove(L, 1);
+    ll_open_class(L, LL_CHANNEL);
+    return ll_new_Channel(L);
+}
+
 /**
  * \brief Destroy a LuaLept*.
  *
@@ -3336,6 +3894,228 @@ SetLeptDebugOK(lua_State *L)
     return 0;
 }
 
+/**
+ * \brief Return statistics about the memory held by the Lua state.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a LuaLept* (ll).
+ * Arg #2 is an optional boolean (collect, default false).
+ *
+ * The table contains:
+ *   lua        bytes in use by the Lua heap
+ *   external   external (raster) bytes held by user data not yet collected
+ *   objects    number of user data holding external bytes
+ *   peak       peak value of external
+ *   released   external bytes released by the collector or Destroy()
+ *   nreleased  number of user data released
+ *   pending    external bytes not yet reported to the collector
+ *   stepped    external bytes reported to the collector
+ *   steps      number of collector steps run for external bytes
+ *   mapped     bytes of input files read through mmap() (e.g. Pix.ReadMapped())
+ *   nmapped    number of input files read through mmap()
+ *   copied     bytes of input files read into a buffer instead
+ *   ncopied    number of input files read into a buffer
+ *
+ * If %collect is true, a full garbage collection is run first, and
+ * the external bytes it released are returned as "collectable", so
+ * that "external" then gives the bytes of objects still alive.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 table on the Lua stack.
+ */
+static int
+MemoryStats(lua_State *L)
+{
+    LL_FUNC("MemoryStats");
+    LuaLept *ll = ll_check_lualept(_fun, L, 1);
+    l_int32 collect = ll_opt_boolean(_fun, L, 2, FALSE);
+    ll_memstats_t *ms = ll_memstats(_fun, L);
+    l_int64 collectable = 0;
+    UNUSED(ll);
+
+    if (collect) {
+        collectable = ms->external;
+        lua_gc(L, LUA_GCCOLLECT, 0);
+        collectable -= ms->external;
+    }
+
+    lua_createtable(L, 0, 15);
+    lua_pushinteger(L, static_cast<lua_Integer>(lua_gc(L, LUA_GCCOUNT, 0)) * 1024 + lua_gc(L, LUA_GCCOUNTB, 0));
+    lua_setfield(L, -2, "lua");
+    lua_pushinteger(L, static_cast<lua_Integer>(ms->external));
+    lua_setfield(L, -2, "external");
+    lua_pushinteger(L, static_cast<lua_Integer>(ms->objects));
+    lua_setfield(L, -2, "objects");
+    lua_pushinteger(L, static_cast<lua_Integer>(ms->peak));
+    lua_setfield(L, -2, "peak");
+    lua_pushinteger(L, static_cast<lua_Integer>(ms->released));
+    lua_setfield(L, -2, "released");
+    lua_pushinteger(L, static_cast<lua_Integer>(ms->nreleased));
+    lua_setfield(L, -2, "nreleased");
+    lua_pushinteger(L, static_cast<lua_Integer>(ms->debt));
+    lua_setfield(L, -2, "pending");
+    lua_pushinteger(L, static_cast<lua_Integer>(ms->stepped));
+    lua_setfield(L, -2, "stepped");
+    lua_pushinteger(L, static_cast<lua_Integer>(ms->steps));
+    lua_setfield(L, -2, "steps");
+    lua_pushinteger(L, static_cast<lua_Integer>(ms->mapped));
+    lua_setfield(L, -2, "mapped");
+    lua_pushinteger(L, static_cast<lua_Integer>(ms->nmapped));
+    lua_setfield(L, -2, "nmapped");
+    lua_pushinteger(L, static_cast<lua_Integer>(ms->copied));
+    lua_setfield(L, -2, "copied");
+    lua_pushinteger(L, static_cast<lua_Integer>(ms->ncopied));
+    lua_setfield(L, -2, "ncopied");
+    if (collect) {
+        lua_pushinteger(L, static_cast<lua_Integer>(collectable));
+        lua_setfield(L, -2, "collectable");
+    }
+    return 1;
+}
+
+/**
+ * \brief Return the counters of the cache of compiled Lua chunks.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a LuaLept* (ll).
+ *
+ * The table contains the fields hits, disk_hits, misses, stores,
+ * entries and bytes (see ll_set_bytecode_cache()).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 table on the Lua stack.
+ */
+static int
+BytecodeStats(lua_State *L)
+{
+    LL_FUNC("BytecodeStats");
+    LuaLept *ll = ll_check_lualept(_fun, L, 1);
+    ll_bytecode_stats_t stats;
+    UNUSED(ll);
+    ll_get_bytecode_stats(&stats);
+    lua_createtable(L, 0, 6);
+    ll_push_l_uint64(_fun, L, stats.hits);
+    lua_setfield(L, -2, "hits");
+    ll_push_l_uint64(_fun, L, stats.disk_hits);
+    lua_setfield(L, -2, "disk_hits");
+    ll_push_l_uint64(_fun, L, stats.misses);
+    lua_setfield(L, -2, "misses");
+    ll_push_l_uint64(_fun, L, stats.stores);
+    lua_setfield(L, -2, "stores");
+    ll_push_size_t(_fun, L, stats.entries);
+    lua_setfield(L, -2, "entries");
+    ll_push_size_t(_fun, L, stats.bytes);
+    lua_setfield(L, -2, "bytes");
+    return 1;
+}
+
+/**
+ * \brief Configure the pool of Pix raster data.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a LuaLept* (ll).
+ * Arg #2 is expected to be a table with the optional fields
+ *   max        cap on the raster bytes cached in the pool (0 disables it)
+ *   min        rasters smaller than this many bytes are not pooled
+ *   hugepages  boolean: back large rasters by transparent huge pages
+ *
+ * Fields which are not given keep their current value.
+ * The pool is process wide, because Leptonica's memory manager is.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 boolean on the Lua stack.
+ */
+static int
+SetPixPool(lua_State *L)
+{
+    LL_FUNC("SetPixPool");
+    LuaLept *ll = ll_check_lualept(_fun, L, 1);
+    ll_pixpool_t pool;
+    UNUSED(ll);
+    luaL_checktype(L, 2, LUA_TTABLE);
+    ll_get_pixpool(&pool, nullptr);
+    if (LUA_TNIL != lua_getfield(L, 2, "max"))
+        pool.max_bytes = ll_check_size_t(_fun, L, -1);
+    lua_pop(L, 1);
+    if (LUA_TNIL != lua_getfield(L, 2, "min"))
+        pool.min_bytes = ll_check_size_t(_fun, L, -1);
+    lua_pop(L, 1);
+    if (LUA_TNIL != lua_getfield(L, 2, "hugepages"))
+        pool.hugepages = lua_toboolean(L, -1) ? true : false;
+    lua_pop(L, 1);
+    return ll_push_boolean(_fun, L, 0 == ll_set_pixpool(&pool));
+}
+
+/**
+ * \brief Return the configuration and counters of the pool of Pix raster data.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a LuaLept* (ll).
+ *
+ * The table contains the fields max, min and hugepages (see SetPixPool),
+ * and the counters hits, misses, bypassed, released, trimmed,
+ * live_bytes, live_blocks, cached_bytes and cached_blocks.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 table on the Lua stack.
+ */
+static int
+PixPoolStats(lua_State *L)
+{
+    LL_FUNC("PixPoolStats");
+    LuaLept *ll = ll_check_lualept(_fun, L, 1);
+    ll_pixpool_t pool;
+    ll_pixpool_stats_t stats;
+    UNUSED(ll);
+    ll_get_pixpool(&pool, &stats);
+    lua_createtable(L, 0, 12);
+    ll_push_size_t(_fun, L, pool.max_bytes);
+    lua_setfield(L, -2, "max");
+    ll_push_size_t(_fun, L, pool.min_bytes);
+    lua_setfield(L, -2, "min");
+    ll_push_boolean(_fun, L, pool.hugepages);
+    lua_setfield(L, -2, "hugepages");
+    ll_push_l_uint64(_fun, L, stats.hits);
+    lua_setfield(L, -2, "hits");
+    ll_push_l_uint64(_fun, L, stats.misses);
+    lua_setfield(L, -2, "misses");
+    ll_push_l_uint64(_fun, L, stats.bypassed);
+    lua_setfield(L, -2, "bypassed");
+    ll_push_l_uint64(_fun, L, stats.released);
+    lua_setfield(L, -2, "released");
+    ll_push_l_uint64(_fun, L, stats.trimmed);
+    lua_setfield(L, -2, "trimmed");
+    ll_push_size_t(_fun, L, stats.live_bytes);
+    lua_setfield(L, -2, "live_bytes");
+    ll_push_size_t(_fun, L, stats.live_blocks);
+    lua_setfield(L, -2, "live_blocks");
+    ll_push_size_t(_fun, L, stats.cached_bytes);
+    lua_setfield(L, -2, "cached_bytes");
+    ll_push_size_t(_fun, L, stats.cached_blocks);
+    lua_setfield(L, -2, "cached_blocks");
+    return 1;
+}
+
+/**
+ * \brief Enable or disable the class tag fast path for user data.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a LuaLept* (ll).
+ * Arg #2 is an optional boolean (enable, default true).
+ *
+ * With the fast path disabled, user data are pushed and checked by
+ * looking up their metatable by class name in the registry.
+ * The setting is per Lua state (see ll_set_udata_fast()).
+ * This is meant for benchmarking (see lua/bench-udata.lua).
+ * </pre>
+ * \param L Lua state.
+ * \return 1 boolean (previous state) on the Lua stack.
+ */
+static int
+SetFastUdata(lua_State *L)
+{
+    LL_FUNC("SetFastUdata");
+    LuaLept *ll = ll_check_lualept(_fun, L, 1);
+    bool enable = ll_opt_boolean(_fun, L, 2, TRUE) ? true : false;
+    UNUSED(ll);
+    return ll_push_boolean(_fun, L, ll_set_udata_fast(L, enable));
+}
+
 /**
  * \brief SetMsgSeverity() brief comment goes here.
  * <pre>
@@ -3361,6 +4141,30 @@ SetMsgSeverity(lua_State *L)
     return ll_push_l_int32(_fun, L, result);
 }
 
+/**
+ * \brief Set the default number of threads of the banded Pix filters.
+ * <pre>
+ * Arg #1 (i.e. self) is expected to be a LuaLept* (ll).
+ * Arg #2 is expected to be a l_int32 (nthreads).
+ *
+ * Neighborhood filters like Pix:Blockconv() or Pix:MedianFilter() split
+ * the image into horizontal bands and run them on %nthreads threads.
+ * A value of 1 (the default) disables this, a value of 0 uses as many
+ * threads as there are cores. A {threads=n} option of a call overrides it.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 l_int32 (previous number of threads) on the Lua stack.
+ */
+static int
+SetThreads(lua_State *L)
+{
+    LL_FUNC("SetThreads");
+    LuaLept *ll = ll_check_lualept(_fun, L, 1);
+    l_int32 nthreads = ll_check_l_int32(_fun, L, 2);
+    UNUSED(ll);
+    return ll_push_l_int32(_fun, L, ll_set_threads(nthreads));
+}
+
 /**
  * \brief SplitPathAtDirectory() brief comment goes here.
  * <pre>
@@ -3560,12 +4364,128 @@ ll_new_lualept(lua_State *L)
 }
 
 /**
- * \brief Register the BOX methods and functions in the LL_BOX meta table.
+ * \brief Table of class names and the functions registering them.
+ * ll_open_TypedArray() registers all four typed array classes.
+ */
+static const struct {
+    const char *tname;      /*!< class name (global and meta table name) */
+    lua_CFunction open;     /*!< function to register the class */
+}   ll_classes[] = {
+    {LL_AMAP,           ll_open_Amap},
+    {LL_ASET,           ll_open_Aset},
+    {LL_BMF,            ll_open_Bmf},
+    {LL_BOX,            ll_open_Box},
+    {LL_BOXA,           ll_open_Boxa},
+    {LL_BOXAA,          ll_open_Boxaa},
+    {LL_BBUFFER,        ll_open_ByteBuffer},
+    {LL_BYTEA,          ll_open_Bytea},
+    {LL_CCBORD,         ll_open_CCBord},
+    {LL_CCBORDA,        ll_open_CCBorda},
+    {LL_CHANNEL,        ll_open_Channel},
+    {LL_COMPDATA,       ll_open_CompData},
+    {LL_DPIX,           ll_open_DPix},
+    {LL_DEWARP,         ll_open_Dewarp},
+    {LL_DEWARPA,        ll_open_Dewarpa},
+    {LL_DNA,            ll_open_Dna},
+    {LL_DNAA,           ll_open_Dnaa},
+    {LL_DNAHASH,        ll_open_DnaHash},
+    {LL_DLLIST,         ll_open_DLList},
+    {LL_FPIX,           ll_open_FPix},
+    {LL_FPIXA,          ll_open_FPixa},
+    {LL_FUTURE,         ll_open_Future},
+    {LL_KERNEL,         ll_open_Kernel},
+    {LL_NUMA,           ll_open_Numa},
+    {LL_NUMAA,          ll_open_Numaa},
+    {LL_PDFDATA,        ll_open_PdfData},
+    {LL_PIX,            ll_open_Pix},
+    {LL_PIXA,           ll_open_Pixa},
+    {LL_PIXAA,          ll_open_Pixaa},
+    {LL_PIXACC,         ll_open_Pixacc},
+    {LL_PIXCMAP,        ll_open_PixColormap},
+    {LL_PIXCOMP,        ll_open_PixComp},
+    {LL_PIXELBUFFER,    ll_open_PixelBuffer},
+    {LL_PIXACOMP,       ll_open_PixaComp},
+    {LL_PIXPIPELINE,    ll_open_PixPipeline},
+    {LL_PIXTILING,      ll_open_PixTiling},
+    {LL_PTA,            ll_open_Pta},
+    {LL_PTAA,           ll_open_Ptaa},
+    {LL_QUEUE,          ll_open_Queue},
+    {LL_SARRAY,         ll_open_Sarray},
+    {LL_SEL,            ll_open_Sel},
+    {LL_SELA,           ll_open_Sela},
+    {LL_SHAREDPIX,      ll_open_SharedPix},
+    {LL_SHAREDQUEUE,    ll_open_SharedQueue},
+    {LL_SHAREDSTACK,    ll_open_SharedStack},
+    {LL_STACK,          ll_open_Stack},
+    {LL_TIFFPAGES,      ll_open_TiffPages},
+    {LL_INT32ARRAY,     ll_open_TypedArray},
+    {LL_UINT32ARRAY,    ll_open_TypedArray},
+    {LL_FLOAT32ARRAY,   ll_open_TypedArray},
+    {LL_FLOAT64ARRAY,   ll_open_TypedArray},
+    {LL_WSHED,          ll_open_WShed}
+};
+
+/**
+ * \brief Register the class %tname, if it is known and not yet registered.
+ * \param L Lua state.
+ * \param tname class name
+ * \return true if the class is registered now, false if %tname is unknown.
+ */
+bool
+ll_open_class(lua_State *L, const char *tname)
+{
+    size_t i;
+
+    if (nullptr == tname)
+        return false;
+    for (i = 0; i < ARRAYSIZE(ll_classes); i++) {
+        if (strcmp(tname, ll_classes[i].tname))
+            continue;
+        if (LUA_TNIL == luaL_getmetatable(L, tname)) {
+            int top = lua_gettop(L) - 1;
+            ll_classes[i].open(L);
+            lua_settop(L, top);
+        } else {
+            lua_pop(L, 1);
+        }
+        return true;
+    }
+    return false;
+}
+
+/**
+ * \brief Register a class on first access to its global name.
+ * <pre>
+ * Arg #1 is expected to be the globals table (t).
+ * Arg #2 is expected to be a string with the class name (key).
+ *
+ * This is the __index metamethod of the globals table which
+ * luaopen_lualept_lazy() installs.
+ * </pre>
+ * \param L Lua state.
+ * \return 1 value (the class constructor) or nil on the Lua stack.
+ */
+static int
+LazyIndex(lua_State *L)
+{
+    const char *key = LUA_TSTRING == lua_type(L, 2) ? lua_tostring(L, 2) : nullptr;
+    if (!ll_open_class(L, key)) {
+        lua_pushnil(L);
+        return 1;
+    }
+    lua_pushvalue(L, 2);
+    lua_rawget(L, 1);
+    return 1;
+}
+
+/**
+ * \brief Register the LuaLept methods and all classes, or their lazy loader.
  * \param L Lua state.
+ * \param lazy if true, register classes on first use
  * \return 1 table on the Lua stack.
  */
-int
-luaopen_lualept(lua_State *L)
+static int
+ll_open_lualept(lua_State *L, bool lazy)
 {
     static const luaL_Reg methods[] = {
         {"__gc",                    Destroy},
@@ -3574,6 +4494,7 @@ luaopen_lualept(lua_State *L)
         {"DebugOff",                DebugOff},
         {"Debug",                   Debug},
         {"Create",                  Create},
+        {"Channel",                 Channel},
         {"Version",                 Version},
         {"ComposeRGB",              ComposeRGB},
         {"ComposeRGBA",             ComposeRGBA},
@@ -3587,9 +4508,15 @@ luaopen_lualept(lua_State *L)
         {"MinMaxComponent",         MinMaxComponent},
         {"MinComponent",            MinComponent},   /* alias without 2nd parameter */
         {"MaxComponent",            MaxComponent},   /* alias without 2nd parameter */
+        {"BytecodeStats",           BytecodeStats},
+        {"MemoryStats",             MemoryStats},
         {"CheckForChars",           CheckForChars},
+        {"PixPoolStats",            PixPoolStats},
+        {"SetFastUdata",            SetFastUdata},
+        {"SetPixPool",              SetPixPool},
         {"SetLeptDebugOK",          SetLeptDebugOK},
         {"SetMsgSeverity",          SetMsgSeverity},
+        {"SetThreads",              SetThreads},
         {"SplitPathAtDirectory",    SplitPathAtDirectory},
         {"SplitPathAtExtension",    SplitPathAtExtension},
         {"SplitStringToParagraphs", SplitStringToParagraphs},
@@ -3599,46 +4526,24 @@ luaopen_lualept(lua_State *L)
     };
     LO_FUNC(TNAME);
 
-    ll_open_Amap(L);
-    ll_open_Aset(L);
-    ll_open_Bmf(L);
-    ll_open_Box(L);
-    ll_open_Boxa(L);
-    ll_open_Boxaa(L);
-    ll_open_ByteBuffer(L);
-    ll_open_Bytea(L);
-    ll_open_CCBord(L);
-    ll_open_CCBorda(L);
-    ll_open_CompData(L);
-    ll_open_DPix(L);
-    ll_open_Dewarp(L);
-    ll_open_Dewarpa(L);
-    ll_open_Dna(L);
-    ll_open_Dnaa(L);
-    ll_open_DnaHash(L);
-    ll_open_DLList(L);
-    ll_open_FPix(L);
-    ll_open_FPixa(L);
-    ll_open_Kernel(L);
-    ll_open_Numa(L);
-    ll_open_Numaa(L);
-    ll_open_PdfData(L);
-    ll_open_Pix(L);
-    ll_open_Pixa(L);
-    ll_open_Pixaa(L);
-    ll_open_Pixacc(L);
-    ll_open_PixColormap(L);
-    ll_open_PixComp(L);
-    ll_open_PixaComp(L);
-    ll_open_PixTiling(L);
-    ll_open_Pta(L);
-    ll_open_Ptaa(L);
-    ll_open_Queue(L);
-    ll_open_Sarray(L);
-    ll_open_Sel(L);
-    ll_open_Sela(L);
-    ll_open_Stack(L);
-    ll_open_WShed(L);
+    size_t i;
+
+    lua_pushglobaltable(L);
+    if (lazy && !lua_getmetatable(L, -1)) {
+        /* Register the classes on first access to their global names */
+        lua_createtable(L, 0, 1);
+        lua_pushcfunction(L, LazyIndex);
+        lua_setfield(L, -2, "__index");
+        lua_setmetatable(L, -2);
+        DBG(LOG_REGISTER, "%s: classes are registered on first use\n", _fun);
+    } else {
+        /* The globals table may have a meta table of its own already */
+        if (lazy)
+            lua_pop(L, 1);
+        for (i = 0; i < ARRAYSIZE(ll_classes); i++)
+            ll_open_class(L, ll_classes[i].tname);
+    }
+    lua_pop(L, 1);
 
     ll_set_global_cfunct(_fun, L, TNAME, ll_new_lualept);
     ll_register_class(_fun, L, TNAME, methods);
@@ -3646,12 +4551,44 @@ luaopen_lualept(lua_State *L)
     return 1;
 }
 
+/**
+ * \brief Register the LuaLept methods and all classes.
+ * \param L Lua state.
+ * \return 1 table on the Lua stack.
+ */
+int
+luaopen_lualept(lua_State *L)
+{
+    return ll_open_lualept(L, false);
+}
+
+/**
+ * \brief Register the LuaLept methods and register classes on first use.
+ * <pre>
+ * A class is registered when a script first reads its global name
+ * (e.g. Pix), or when an object of the class is first pushed.
+ * Until then the class does not show up in pairs(_G).
+ * If the globals table has a meta table already, all classes are
+ * registered immediately, as with luaopen_lualept().
+ * </pre>
+ * \param L Lua state.
+ * \return 1 table on the Lua stack.
+ */
+int
+luaopen_lualept_lazy(lua_State *L)
+{
+    return ll_open_lualept(L, true);
+}
+
 /**
  * @brief Open a new lua_State* L, load the Lua libraries and lualept.
+ * @param debug enable Leptonica debugging
+ * @param pool optional configuration of the Pix raster pool
+ * @param lazy if true, register the classes on first use
  * @return Pointer to the Lua state.
  */
 lua_State*
-ll_open(bool debug)
+ll_open(bool debug, const ll_pixpool_t *pool, bool lazy)
 {
     FUNC("ll_open");
     lua_State *L;
@@ -3659,6 +4596,10 @@ ll_open(bool debug)
     /* Disable Leptonica debugging (pixDisplay ...) */
     setLeptDebugOK(debug);
 
+    /* Configure the Pix raster pool */
+    if (pool)
+        ll_set_pixpool(pool);
+
     /* Allocate a new Lua state */
     L = luaL_newstate();
 
@@ -3666,7 +4607,11 @@ ll_open(bool debug)
     luaL_openlibs(L);
 
     /* Register our libraries */
-    luaopen_lualept(L);
+    if (lazy) {
+        luaopen_lualept_lazy(L);
+    } else {
+        luaopen_lualept(L);
+    }
 
     return L;
 }
@@ -3707,23 +4652,13 @@ ll_run(lua_State* L, const char *name, const char *script)
     FUNC("ll_run");
     int res;
 
-    if (nullptr == script) {
-        /* load from a file %name */
-        res = luaL_loadfile(L, name);
-        if (LUA_OK != res) {
-            const char* msg = lua_tostring(L, -1);
-            lua_close(L);
-            return ERROR_INT(msg, _fun, 1);
-        }
-    } else {
-        /* load from text string %script and use %name as chunk name */
-        size_t size = strlen(script);
-        res = luaL_loadbufferx(L, script, size, name, "t");
-        if (LUA_OK != res) {
-            const char* msg = lua_tostring(L, -1);
-            lua_close(L);
-            return ERROR_INT(msg, _fun, 1);
-        }
+    /* load from a file %name, or from text string %script using %name as chunk name */
+    res = ll_load_cached(L, name, script);
+    if (LUA_OK != res) {
+        const char* msg = lua_tostring(L, -1);
+        ERROR_INT(msg, _fun, 1);
+        lua_close(L);
+        return 1;
     }
 
     ll_new_lualept(L);
@@ -3739,6 +4674,171 @@ ll_run(lua_State* L, const char *name, const char *script)
     return 0;
 }
 
+/**
+ * \brief Load and run a Lua script once, keeping the state for ll_call().
+ * <pre>
+ * Unlike ll_run(), the Lua state is not closed on errors and the
+ * LuaLept global is created only once. The script usually just
+ * defines functions, which are resolved with ll_ref() and then
+ * called for each job with ll_call().
+ * </pre>
+ * \param L Lua state.
+ * \param name filename of an external file to load, if script == nullptr
+ * \param script if != nullptr, load the string and run it
+ *        using %name as chunk name for debug output
+ * \return 0 on success, or 1 on error.
+ */
+int
+ll_load(lua_State* L, const char *name, const char *script)
+{
+    FUNC("ll_load");
+    int top = lua_gettop(L);
+    int res;
+
+    /* load from a file %name, or from text string %script using %name as chunk name */
+    res = ll_load_cached(L, name, script);
+
+    if (LUA_OK == res) {
+        if (LUA_TUSERDATA != lua_getglobal(L, LL_LUALEPT)) {
+            ll_new_lualept(L);
+            lua_setglobal(L, LL_LUALEPT);
+        }
+        lua_pop(L, 1);
+        res = lua_pcall(L, 0, 0, 0);
+    }
+
+    if (LUA_OK != res) {
+        ERROR_INT(lua_tostring(L, -1), _fun, 1);
+        lua_settop(L, top);
+        return 1;
+    }
+    lua_settop(L, top);
+    return 0;
+}
+
+/**
+ * \brief Resolve the global function %function to a registry reference.
+ * \param L Lua state.
+ * \param function name of a global function defined by the script
+ * \return reference for ll_call(), or LUA_NOREF on error.
+ */
+int
+ll_ref(lua_State* L, const char *function)
+{
+    FUNC("ll_ref");
+    char msg[256];
+
+    if (LUA_TFUNCTION != lua_getglobal(L, function)) {
+        lua_pop(L, 1);
+        snprintf(msg, sizeof(msg), "no global function '%s'", function);
+        return ERROR_INT(msg, _fun, LUA_NOREF);
+    }
+    return luaL_ref(L, LUA_REGISTRYINDEX);
+}
+
+/**
+ * \brief Release a reference returned by ll_ref().
+ * \param L Lua state.
+ * \param ref reference to release
+ * \return 0 on success.
+ */
+int
+ll_unref(lua_State* L, int ref)
+{
+    luaL_unref(L, LUA_REGISTRYINDEX, ref);
+    return 0;
+}
+
+/**
+ * The structure ll_call_t holds the parameters of ll_call()
+ * while they are passed to ProtectedCall().
+ */
+typedef struct ll_call_s {
+    int                     ref;        /*!< reference to the function */
+    const ll_global_var_t  *args;       /*!< arguments to pass */
+    const ll_global_var_t  *results;    /*!< results to return */
+}   ll_call_t;
+
+/**
+ * \brief Call a function with the arguments and results of an ll_call_t.
+ * <pre>
+ * Arg #1 is expected to be a light user data (ll_call_t*).
+ * </pre>
+ * \param L Lua state.
+ * \return 0 for nothing on the Lua stack.
+ */
+static int
+ProtectedCall(lua_State *L)
+{
+    FUNC("ll_call");
+    const ll_call_t *call = reinterpret_cast<const ll_call_t *>(lua_touserdata(L, 1));
+    const ll_global_var_t *var;
+    int nargs = 0;
+    int nresults = 0;
+    int base, i;
+
+    for (var = call->args; var && ll_invalid != var->type; var++)
+        nargs++;
+    for (var = call->results; var && ll_invalid != var->type; var++)
+        nresults++;
+    luaL_checkstack(L, 1 + nargs + nresults, _fun);
+
+    base = lua_gettop(L);
+    if (LUA_TFUNCTION != lua_rawgeti(L, LUA_REGISTRYINDEX, call->ref)) {
+        die(_fun, L, "invalid function reference %d\n", call->ref);
+        return 0;
+    }
+    for (var = call->args; var && ll_invalid != var->type; var++)
+        ll_push_var(_fun, L, var);
+    lua_call(L, nargs, nresults);
+    for (i = 0, var = call->results; i < nresults; i++, var++)
+        ll_get_var(_fun, L, base + 1 + i, var);
+    return 0;
+}
+
+/**
+ * \brief Call a function of a script loaded with ll_load().
+ * <pre>
+ * The values defined in %args are passed as arguments in order,
+ * and the results are stored in the variables defined by %results
+ * in order; the %name fields are not used. Both arrays end with
+ * LL_SENTINEL and may be nullptr. Ownership of objects is passed
+ * the same way as for ll_set_globals() and ll_get_globals().
+ *
+ * Typical use for a job which runs the same script many times:
+ *
+ *   L = ll_open(false);
+ *   ll_load(L, "thumbnail.lua");
+ *   ref = ll_ref(L, "thumbnail");
+ *   for each image:
+ *       ll_call(L, ref, args, results);
+ *   ll_unref(L, ref);
+ *   ll_close(L);
+ * </pre>
+ * \param L Lua state.
+ * \param ref reference returned by ll_ref()
+ * \param args pointer to the ll_global_var_t array of arguments
+ * \param results pointer to the ll_global_var_t array of results
+ * \return 0 on success, or 1 on error.
+ */
+int
+ll_call(lua_State* L, int ref, const ll_global_var_t *args, const ll_global_var_t *results)
+{
+    FUNC("ll_call");
+    int top = lua_gettop(L);
+    ll_call_t call = {ref, args, results};
+
+    lua_pushcfunction(L, ProtectedCall);
+    lua_pushlightuserdata(L, &call);
+    if (LUA_OK != lua_pcall(L, 1, 0, 0)) {
+        ERROR_INT(lua_tostring(L, -1), _fun, 1);
+        lua_settop(L, top);
+        return 1;
+    }
+    lua_settop(L, top);
+    return 0;
+}
+
 /**
  * @brief Close the lua_State* L
  * \param L Lua state.
@@ -146,6 +146,31 @@ typedef struct ll_bytes_s {
     size_t   size;
 }   ll_bytes_t;
 
+/**
+ * The ll_var_mode_e enumeration defines how objects and byte buffers
+ * of a ll_global_var_t are passed between the host and the script.
+ *
+ * ll_transfer: ownership passes to the receiver, the sender's pointer is
+ *   cleared (set) or the object is taken from Lua (get). Strings and byte
+ *   buffers are copied.
+ * ll_clone: the receiver gets a new reference (e.g. pixClone()), the
+ *   sender keeps its own. No raster or array data is copied. Only types
+ *   with a reference count are supported. Strings and byte buffers are
+ *   copied, but the host keeps its buffer.
+ * ll_borrow: the receiver uses the sender's object without owning it.
+ *   A borrowed object is never destroyed by Lua and can not be given
+ *   away by the script: inserting it into another object, or appending
+ *   to a borrowed Bytea, raises an error. The host must keep it alive
+ *   while the Lua state can reach it. A byte buffer is passed as a Bytea pointing to the
+ *   host's data (set), or the host gets a pointer to the data of the Lua
+ *   string or Bytea (get), which is valid while the value is reachable.
+ */
+typedef enum ll_var_mode_e {
+    ll_transfer,        /*!< pass ownership (default) */
+    ll_clone,           /*!< pass a new reference */
+    ll_borrow           /*!< pass the object without ownership */
+}   ll_var_mode_e;
+
 /**
  * The structure ll_global_var_s is used to define global
  * variables to set before and get after the script is run.
@@ -213,13 +238,74 @@ typedef struct ll_global_var_s {
         Stack       **pstack;               /*!< pointer to a Stack */
         WShed       **pwshed;               /*!< pointer to a WShed */
     }   u;
+    ll_var_mode_e   mode;   /*!< How to pass objects and byte buffers */
 }   ll_global_var_t;
 
+/**
+ * The structure ll_pixpool_s configures the pool of Pix raster data
+ * (see ll_set_pixpool() and LuaLept:SetPixPool()).
+ */
+typedef struct ll_pixpool_s {
+    size_t      max_bytes;  /*!< Cap on the raster bytes cached in the pool; 0 disables the pool */
+    size_t      min_bytes;  /*!< Rasters smaller than this are not pooled */
+    bool        hugepages;  /*!< Back rasters of 2 MiB and more by transparent huge pages */
+}   ll_pixpool_t;
+
+/**
+ * The structure ll_pixpool_stats_s returns the counters of the pool of Pix raster data.
+ */
+typedef struct ll_pixpool_stats_s {
+    l_uint64    hits;           /*!< Rasters served from the pool */
+    l_uint64    misses;         /*!< Rasters newly allocated for the pool */
+    l_uint64    bypassed;       /*!< Rasters allocated with malloc() (pool disabled or too small) */
+    l_uint64    released;       /*!< Rasters freed because the pool was full */
+    l_uint64    trimmed;        /*!< Cached rasters freed when the cap was lowered */
+    size_t      live_bytes;     /*!< Bytes of pool rasters in use */
+    size_t      live_blocks;    /*!< Number of pool rasters in use */
+    size_t      cached_bytes;   /*!< Bytes of rasters cached in the pool */
+    size_t      cached_blocks;  /*!< Number of rasters cached in the pool */
+}   ll_pixpool_stats_t;
+
+/**
+ * The structure ll_bytecode_stats_s returns the counters of the cache
+ * of compiled Lua chunks (see ll_set_bytecode_cache()).
+ */
+typedef struct ll_bytecode_stats_s {
+    l_uint64    hits;           /*!< Chunks loaded from the in-process cache */
+    l_uint64    disk_hits;      /*!< Chunks loaded from the cache directory */
+    l_uint64    misses;         /*!< Chunks compiled from source */
+    l_uint64    stores;         /*!< Chunks written to the cache directory */
+    size_t      entries;        /*!< Number of chunks in the in-process cache */
+    size_t      bytes;          /*!< Bytes of chunks in the in-process cache */
+}   ll_bytecode_stats_t;
+
+/**
+ * A Pix raster shared read-only between Lua states and threads
+ * (see ll_share_pix() and Lua class SharedPix).
+ */
+typedef struct ll_shared_pix_s ll_shared_pix_t;
+
+/**
+ * A bounded queue moving objects between Lua states and threads
+ * (see ll_create_channel() and Lua class Channel).
+ */
+typedef struct ll_channel_s ll_channel_t;
+
+/**
+ * Lock-free queue and stack shared between Lua states and threads
+ * (see Lua classes SharedQueue and SharedStack).
+ */
+typedef struct ll_shared_queue_s ll_shared_queue_t;
+typedef struct ll_shared_stack_s ll_shared_stack_t;
+
 /** Use this macro to initialize one entry in a ll_global_var_t array */
-#define LL_GLOBAL(type, name, ptr) {type, name, {ptr}}
+#define LL_GLOBAL(type, name, ptr) {type, name, {ptr}, ll_transfer}
+
+/** Use this macro to initialize one entry with a ll_var_mode_e (%mode) */
+#define LL_GLOBAL_MODE(type, name, ptr, mode) {type, name, {ptr}, mode}
 
 /** Use this sentinel as the last entry in an array of ll_global_var_t */
-#define LL_SENTINEL {ll_invalid, nullptr, {nullptr}}
+#define LL_SENTINEL {ll_invalid, nullptr, {nullptr}, ll_transfer}
 
 LUALEPT_DLL extern int ll_open_Amap(lua_State *L);
 LUALEPT_DLL extern int ll_open_Aset(lua_State *L);
@@ -240,9 +326,11 @@ LUALEPT_DLL extern int ll_open_Box(lua_State *L);
 LUALEPT_DLL extern int ll_open_Boxa(lua_State *L);
 LUALEPT_DLL extern int ll_open_Boxaa(lua_State *L);
 LUALEPT_DLL extern int ll_open_CCBord(lua_State *L);
+LUALEPT_DLL extern int ll_open_Channel(lua_State *L);
 LUALEPT_DLL extern int ll_open_CCBorda(lua_State *L);
 LUALEPT_DLL extern int ll_open_PixColormap(lua_State *L);
 LUALEPT_DLL extern int ll_open_PixComp(lua_State *L);
+LUALEPT_DLL extern int ll_open_PixelBuffer(lua_State *L);
 LUALEPT_DLL extern int ll_open_PixaComp(lua_State *L);
 LUALEPT_DLL extern int ll_open_Pix(lua_State *L);
 LUALEPT_DLL extern int ll_open_Pixa(lua_State *L);
@@ -250,8 +338,14 @@ LUALEPT_DLL extern int ll_open_Pixaa(lua_State *L);
 LUALEPT_DLL extern int ll_open_Pixacc(lua_State *L);
 LUALEPT_DLL extern int ll_open_FPix(lua_State *L);
 LUALEPT_DLL extern int ll_open_FPixa(lua_State *L);
+LUALEPT_DLL extern int ll_open_Future(lua_State *L);
 LUALEPT_DLL extern int ll_open_DPix(lua_State *L);
+LUALEPT_DLL extern int ll_open_PixPipeline(lua_State *L);
 LUALEPT_DLL extern int ll_open_PixTiling(lua_State *L);
+LUALEPT_DLL extern int ll_open_TiffPages(lua_State *L);
+LUALEPT_DLL extern int ll_open_SharedPix(lua_State *L);
+LUALEPT_DLL extern int ll_open_SharedQueue(lua_State *L);
+LUALEPT_DLL extern int ll_open_SharedStack(lua_State *L);
 LUALEPT_DLL extern int ll_open_Sel(lua_State *L);
 LUALEPT_DLL extern int ll_open_Sela(lua_State *L);
 LUALEPT_DLL extern int ll_open_Kernel(lua_State *L);
@@ -260,14 +354,42 @@ LUALEPT_DLL extern int ll_open_PdfData(lua_State *L);
 LUALEPT_DLL extern int ll_open_Queue(lua_State *L);
 LUALEPT_DLL extern int ll_open_Sarray(lua_State *L);
 LUALEPT_DLL extern int ll_open_Stack(lua_State *L);
+LUALEPT_DLL extern int ll_open_TypedArray(lua_State *L);
 LUALEPT_DLL extern int ll_open_WShed(lua_State *L);
 
 LUALEPT_DLL extern int ll_set_globals(lua_State *L, const ll_global_var_t *vars);
 LUALEPT_DLL extern int ll_get_globals(lua_State *L, const ll_global_var_t *vars);
 LUALEPT_DLL extern int luaopen_lualept(lua_State *L);
-LUALEPT_DLL extern lua_State* ll_open(bool debug);
+LUALEPT_DLL extern int luaopen_lualept_lazy(lua_State *L);
+LUALEPT_DLL extern lua_State* ll_open(bool debug, const ll_pixpool_t *pool = nullptr, bool lazy = false);
+LUALEPT_DLL extern int ll_set_pixpool(const ll_pixpool_t *pool);
+LUALEPT_DLL extern int ll_get_pixpool(ll_pixpool_t *pool, ll_pixpool_stats_t *stats);
+LUALEPT_DLL extern int ll_set_bytecode_cache(bool enable, const char *dir = nullptr);
+LUALEPT_DLL extern int ll_get_bytecode_stats(ll_bytecode_stats_t *stats);
+LUALEPT_DLL extern int ll_prebuild(const char *filename);
+LUALEPT_DLL extern l_int32 ll_set_threads(l_int32 nthreads);
+LUALEPT_DLL extern ll_shared_pix_t* ll_share_pix(Pix *pix);
+LUALEPT_DLL extern ll_shared_pix_t* ll_get_shared_pix(lua_State *L, int arg);
+LUALEPT_DLL extern int ll_push_shared_pix(lua_State *L, ll_shared_pix_t *sp);
+LUALEPT_DLL extern void ll_release_shared_pix(ll_shared_pix_t **psp);
+LUALEPT_DLL extern ll_channel_t* ll_create_channel(size_t capacity);
+LUALEPT_DLL extern ll_channel_t* ll_get_channel(lua_State *L, int arg);
+LUALEPT_DLL extern int ll_push_channel(lua_State *L, ll_channel_t *ch);
+LUALEPT_DLL extern void ll_release_channel(ll_channel_t **pch);
+LUALEPT_DLL extern ll_shared_queue_t* ll_create_shared_queue(size_t capacity);
+LUALEPT_DLL extern ll_shared_queue_t* ll_get_shared_queue(lua_State *L, int arg);
+LUALEPT_DLL extern int ll_push_shared_queue(lua_State *L, ll_shared_queue_t *q);
+LUALEPT_DLL extern void ll_release_shared_queue(ll_shared_queue_t **pq);
+LUALEPT_DLL extern ll_shared_stack_t* ll_create_shared_stack(size_t capacity);
+LUALEPT_DLL extern ll_shared_stack_t* ll_get_shared_stack(lua_State *L, int arg);
+LUALEPT_DLL extern int ll_push_shared_stack(lua_State *L, ll_shared_stack_t *s);
+LUALEPT_DLL extern void ll_release_shared_stack(ll_shared_stack_t **ps);
 LUALEPT_DLL extern int ll_set_arg(lua_State *L, int argc, char **argv);
 LUALEPT_DLL extern int ll_run(lua_State *L, const char* filename, const char* script = nullptr);
+LUALEPT_DLL extern int ll_load(lua_State *L, const char* name, const char* script = nullptr);
+LUALEPT_DLL extern int ll_ref(lua_State *L, const char* function);
+LUALEPT_DLL extern int ll_unref(lua_State *L, int ref);
+LUALEPT_DLL extern int ll_call(lua_State *L, int ref, const ll_global_var_t *args, const ll_global_var_t *results);
 LUALEPT_DLL extern int ll_close(lua_State *L);
 
 #if defined(_MSC_VER)
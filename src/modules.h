@@ -64,6 +64,7 @@
 #define	LL_BOX		"Box"           /*!< Lua class: Box (quad l_int32 for x,y,w,h) */
 #define	LL_BOXA		"Boxa"          /*!< Lua class: Boxa (array of Box) */
 #define	LL_BOXAA	"Boxaa"         /*!< Lua class: Boxaa (array of Boxa) */
+#define	LL_CHANNEL      "Channel"       /*!< Lua class: Channel (moves objects between states) */
 #define	LL_COMPDATA     "CompData"      /*!< Lua class: CompData */
 #define	LL_CCBORD       "CCBord"        /*!< Lua class: CCBord */
 #define	LL_CCBORDA      "CCBorda"       /*!< Lua class: CCBorda (array of CCBord) */
@@ -76,6 +77,10 @@
 #define	LL_DPIX		"DPix"          /*!< Lua class: DPix */
 #define	LL_FPIX		"FPix"          /*!< Lua class: FPix */
 #define	LL_FPIXA	"FPixa"         /*!< Lua class: FPixa (array of FPix) */
+#define	LL_FUTURE       "Future"        /*!< Lua class: Future (result of an async method call) */
+#define	LL_FLOAT32ARRAY "Float32Array"  /*!< Lua class: Float32Array (typed array of l_float32) */
+#define	LL_FLOAT64ARRAY "Float64Array"  /*!< Lua class: Float64Array (typed array of l_float64) */
+#define	LL_INT32ARRAY   "Int32Array"    /*!< Lua class: Int32Array (typed array of l_int32) */
 #define	LL_KERNEL       "Kernel"        /*!< Lua class: Kernel */
 #define	LL_NUMA		"Numa"          /*!< Lua class: Numa array of floats (l_float32) */
 #define	LL_NUMAA	"Numaa"         /*!< Lua class: Numaa (array of Numa) */
@@ -84,8 +89,10 @@
 #define	LL_PIXA		"Pixa"          /*!< Lua class: Pixa (array of Pix) */
 #define	LL_PIXAA        "Pixaa"         /*!< Lua class: Pixaa (array of Pixa) */
 #define	LL_PIXCMAP	"PixColormap"   /*!< Lua class: PixColormap (color map) */
+#define	LL_PIXPIPELINE  "PixPipeline"   /*!< Lua class: PixPipeline (compiled list of Pix operations) */
 #define	LL_PIXTILING	"PixTiling"     /*!< Lua class: PixTiling */
 #define	LL_PIXCOMP      "PixComp"       /*!< Lua class: PixComp (compressed Pix) */
+#define	LL_PIXELBUFFER  "PixelBuffer"   /*!< Lua class: PixelBuffer (view of a Pix raster) */
 #define	LL_PIXACOMP     "PixaComp"      /*!< Lua class: PixaComp (array of PixComp) */
 #define	LL_PIXACC	"Pixacc"        /*!< Lua class: Pixacc (Pix accumulator) */
 #define	LL_PTA		"Pta"           /*!< Lua class: Pta (array of points, i.e. pair of l_float32) */
@@ -96,7 +103,12 @@
 #define	LL_SARRAY	"Sarray"        /*!< Lua class: Sarray (array of strings) */
 #define	LL_SEL		"Sel"           /*!< Lua class: Sel */
 #define	LL_SELA		"Sela"          /*!< Lua class: array of Sel */
+#define	LL_SHAREDPIX    "SharedPix"     /*!< Lua class: SharedPix (read-only Pix shared between states) */
+#define	LL_SHAREDQUEUE  "SharedQueue"   /*!< Lua class: SharedQueue (lock-free queue shared between states) */
+#define	LL_SHAREDSTACK  "SharedStack"   /*!< Lua class: SharedStack (lock-free stack shared between states) */
 #define	LL_STACK        "Stack"         /*!< Lua class: Stack */
+#define	LL_TIFFPAGES    "TiffPages"     /*!< Lua class: TiffPages (iterator over the pages of a multipage TIFF) */
+#define	LL_UINT32ARRAY  "UInt32Array"   /*!< Lua class: UInt32Array (typed array of l_uint32) */
 #define	LL_WSHED        "WShed"         /*!< Lua class: Stack */
 
 #define	LL_LUALEPT      "LuaLept"       /*!< Lua class: LuaLept (top level) */
@@ -166,6 +178,12 @@ enum dbg_enable_flags {
 #if defined(HAVE_SYS_STAT_H)
 #include <sys/stat.h>
 #endif
+#if defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#endif
+#if defined(HAVE_FCNTL_H)
+#include <fcntl.h>
+#endif
 #if defined(HAVE_TIME_H)
 #include <time.h>
 #endif
@@ -181,6 +199,10 @@ enum dbg_enable_flags {
 #if defined(HAVE_SDL2)
 #include <SDL.h>
 #endif
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
 
 #if !defined(ARRAYSIZE)
 /** Return the number of elements in array %t */
@@ -271,6 +293,66 @@ extern "C" {
 /** Allocate a static string with a luaopen_%name */
 #define LO_FUNC(name) FUNC("ll_open_" name)
 
+/** Magic number in every ll_udata_t block pushed by ll_push_udata() ('llud') */
+#define LL_UDATA_MAGIC  0x6c6c7564u
+
+/*! Layout of the user data block of all lualept classes */
+typedef struct ll_udata_t {
+    void       *ptr;                        /*!< pointer to the object (must be first, see ll_check_udata) */
+    l_uint32    tag;                        /*!< class tag, i.e. ll_tag() of the class name */
+    l_uint32    magic;                      /*!< LL_UDATA_MAGIC */
+    size_t      bytes;                      /*!< external bytes (e.g. raster data) accounted for the object */
+    l_uint32    flags;                      /*!< LL_UDATA_BORROWED, LL_UDATA_PINNED, LL_UDATA_RELEASED, LL_UDATA_READONLY, LL_UDATA_FAST */
+}   ll_udata_t;
+
+/** Flag in ll_udata_t: the object is owned by the host, Lua never destroys it */
+#define LL_UDATA_BORROWED   (1u << 0)
+
+/** Flag in ll_udata_t: the object is in use by another thread, Lua must not touch it */
+#define LL_UDATA_PINNED     (1u << 1)
+
+/** Flag in ll_udata_t: the object was dropped by Release() (or __close), the user data is dead */
+#define LL_UDATA_RELEASED   (1u << 2)
+
+/** Flag in ll_udata_t: the object is shared read-only, bindings which modify it refuse it */
+#define LL_UDATA_READONLY   (1u << 3)
+
+/** Flag in ll_udata_t: pushed with the metatable cached under its tag, so the tag can be trusted */
+#define LL_UDATA_FAST       (1u << 4)
+
+/** Number of external bytes after which ll_push_udata() runs a garbage collector step */
+#define LL_GC_STEP_BYTES    (1024 * 1024)
+
+/*! Per lua_State accounting of the external memory held by user data */
+typedef struct ll_memstats_t {
+    l_int64     external;                   /*!< external bytes held by user data not yet collected */
+    l_int64     objects;                    /*!< number of user data holding external bytes */
+    l_int64     peak;                       /*!< peak value of external */
+    l_int64     released;                   /*!< external bytes released by __gc or Destroy() */
+    l_int64     nreleased;                  /*!< number of user data released */
+    l_int64     debt;                       /*!< external bytes not yet reported to the collector */
+    l_int64     stepped;                    /*!< external bytes reported to the collector */
+    l_int64     steps;                      /*!< number of collector steps run for external bytes */
+    l_int64     mapped;                     /*!< bytes of input files read through mmap() (see ll_map_file()) */
+    l_int64     nmapped;                    /*!< number of input files read through mmap() */
+    l_int64     copied;                     /*!< bytes of input files read into a buffer, because mmap() was not possible */
+    l_int64     ncopied;                    /*!< number of input files read into a buffer */
+}   ll_memstats_t;
+
+/**
+ * \brief Compute the class tag for a class name (%tname).
+ * The tag is the 32 bit FNV-1a hash of the name, so it is the same
+ * in every lua_State and folds to a constant for string literals.
+ * \param tname class name
+ * \param hash hash of the preceding characters
+ * \return class tag.
+ */
+constexpr l_uint32
+ll_tag(const char *tname, l_uint32 hash = 2166136261u)
+{
+    return *tname ? ll_tag(tname + 1, (hash ^ static_cast<l_uint8>(*tname)) * 16777619u) : hash;
+}
+
 /*! Dummy structure for the top level Lua class LL_LUALEPT */
 typedef struct LuaLept {
     char str_version[32];                   /*!< Our own version number */
@@ -278,6 +360,46 @@ typedef struct LuaLept {
     char str_version_lept[32];              /*!< Leptonica's version number */
 }   LuaLept;
 
+/*! Structure for the Lua class LL_PIXELBUFFER: a view into a Pix raster */
+typedef struct PixelBuffer {
+    Pix        *pix;                        /*!< Pix* owning the raster (one reference held) */
+    l_int32     w;                          /*!< width of the Pix in pixels */
+    l_int32     h;                          /*!< number of rows in the view */
+    l_int32     d;                          /*!< depth of the Pix in bits per pixel */
+    l_int32     wpl;                        /*!< words per line of the Pix */
+    l_int32     y0;                         /*!< first row of the view in the Pix */
+}   PixelBuffer;
+
+/*! Structure behind the Lua class LL_SHAREDPIX: a raster shared by Pix* views */
+struct ll_shared_pix_s {
+    std::atomic<l_int32> refs;              /*!< number of views and handles referencing %data */
+    l_uint32   *data;                       /*!< the raster; never written while shared */
+    l_int32     w;                          /*!< width in pixels */
+    l_int32     h;                          /*!< height in pixels */
+    l_int32     d;                          /*!< depth in bits per pixel */
+    l_int32     spp;                        /*!< samples per pixel */
+    l_int32     xres;                       /*!< horizontal resolution */
+    l_int32     yres;                       /*!< vertical resolution */
+    l_int32     informat;                   /*!< input file format */
+    PixColormap *cmap;                      /*!< colormap copied to each view, or nullptr */
+};
+
+/*! Element types of the typed array Lua classes */
+typedef enum ll_array_type_e {
+    LL_ARRAY_INT32,                         /*!< LL_INT32ARRAY: l_int32 elements */
+    LL_ARRAY_UINT32,                        /*!< LL_UINT32ARRAY: l_uint32 elements */
+    LL_ARRAY_FLOAT32,                       /*!< LL_FLOAT32ARRAY: l_float32 elements */
+    LL_ARRAY_FLOAT64,                       /*!< LL_FLOAT64ARRAY: l_float64 elements */
+    LL_ARRAY_ANY = -1                       /*!< any of the above (for ll_opt_TypedArray) */
+}   ll_array_type_e;
+
+/*! Structure for the typed array Lua classes: a contiguous array of numbers */
+typedef struct TypedArray {
+    l_int32     type;                       /*!< element type (ll_array_type_e) */
+    l_int32     n;                          /*!< number of elements */
+    void       *data;                       /*!< contiguous element data (LEPT_MALLOC) */
+}   TypedArray;
+
 /**
  * The structure lept_enum is used to define key strings (%key),
  * their Leptonica enum name (%name), and their enumeration value (%value)
@@ -294,7 +416,17 @@ typedef struct lept_enum {
 
 /* llept.cpp */
 extern void *ll_ludata(const char *_fun, lua_State* L, int arg);
-extern void **ll_udata(const char *_fun, lua_State* L, int arg, const char *tname);
+extern void **ll_udata(const char *_fun, lua_State* L, int arg, const char *tname, l_uint32 tag = 0);
+extern void ll_udata_release(const char *_fun, lua_State *L, int arg);
+extern bool ll_udata_borrowed(lua_State *L, int arg);
+extern void ll_udata_borrow(const char *_fun, lua_State *L, int arg);
+extern void ll_check_owned(const char *_fun, lua_State *L, int arg, const char *tname);
+extern void ll_udata_pin(lua_State *L, int arg, bool pin);
+extern bool ll_udata_released(lua_State *L, int arg);
+extern void ll_udata_freeze(lua_State *L, int arg);
+extern bool ll_udata_readonly(lua_State *L, int arg);
+extern void ll_udata_retag(const char *_fun, lua_State *L, int arg, const char *tname);
+extern ll_memstats_t *ll_memstats(const char *_fun, lua_State *L);
 
 /**
  * \brief Cast the result of LEPT_MALLOC() to the given type.
@@ -380,7 +512,7 @@ ll_calloc(const char* _fun, lua_State *L, l_int32 nmemb)
 template<typename T> T **
 ll_check_udata(const char *_fun, lua_State *L, int arg, const char* tname)
 {
-    return reinterpret_cast<T **>(ll_udata(_fun, L, arg, tname));
+    return reinterpret_cast<T **>(ll_udata(_fun, L, arg, tname, ll_tag(tname)));
 }
 
 /**
@@ -397,16 +529,41 @@ ll_check_udata(const char *_fun, lua_State *L, int arg, const char* tname)
 template<typename T> T *
 ll_take_udata(const char *_fun, lua_State *L, int arg, const char* tname)
 {
-    T **pptr = reinterpret_cast<T **>(ll_udata(_fun, L, arg, tname));
+    if (ll_udata_released(L, arg))
+        return nullptr;         /* already dropped by Release() */
+    T **pptr = reinterpret_cast<T **>(ll_udata(_fun, L, arg, tname, ll_tag(tname)));
     T *ptr = pptr ? *pptr : nullptr;
     DBG(LOG_TAKE, "%s: %s = %p, %s = %p\n", _fun,
         "pptr", reinterpret_cast<void *>(pptr),
         "ptr", reinterpret_cast<void *>(ptr));
-    if (nullptr != pptr)
+    if (nullptr != pptr) {
+        if (ll_udata_borrowed(L, arg))
+            return nullptr;     /* the host still owns the object */
+        ll_udata_release(_fun, L, arg);
         *pptr = nullptr;
+    }
     return ptr;
 }
 
+/**
+ * \brief Check Lua stack at index %arg for user data with type name %tname.
+ * T is the typename of the expected return value.
+ * This version takes ownership like ll_take_udata(), but dies if the
+ * object is borrowed from the host instead of quietly returning nullptr.
+ * Use it where the object is inserted into another one.
+ * \param _fun calling function's name
+ * \param L Lua state.
+ * \param arg argument index
+ * \param tname tname of the expected udata
+ * \return pointer to the T contained in the udata.
+ */
+template<typename T> T *
+ll_take_owned(const char *_fun, lua_State *L, int arg, const char* tname)
+{
+    ll_check_owned(_fun, L, arg, tname);
+    return ll_take_udata<T>(_fun, L, arg, tname);
+}
+
 /**
  * \brief Check Lua stack at index %arg for light user data.
  * T is the typename of the return value.
@@ -431,9 +588,12 @@ extern int              ll_istable(const char *_fun, lua_State* L, int arg);
 extern int              ll_isudata(const char *_fun, lua_State* L, int arg, const char *tname);
 
 extern int              ll_register_class(const char *_fun, lua_State *L, const char *name, const luaL_Reg* methods);
+extern bool             ll_set_udata_fast(lua_State *L, bool enable);
+extern bool             ll_open_class(lua_State *L, const char *tname);
+
 extern int              ll_set_global_cfunct(const char *_fun, lua_State *L, const char* tname, lua_CFunction cfunct);
 extern int              ll_set_global_table(const char *_fun, lua_State *L, const char* tname);
-extern int              ll_push_udata(const char *_fun, lua_State *L, const char *name, void *udata);
+extern int              ll_push_udata(const char *_fun, lua_State *L, const char *name, void *udata, size_t bytes = 0);
 extern int              ll_push_nil(const char *_fun, lua_State *L);
 extern int              ll_push_boolean(const char* _fun, lua_State *L, bool b);
 extern int              ll_push_l_int8(const char *_fun, lua_State *L, l_int8 val);
@@ -666,6 +826,151 @@ extern LuaLept        * ll_check_lualept(const char *_fun, lua_State *L, int arg
 extern int              ll_push_lualept(const char *_fun, lua_State *L, LuaLept *lept);
 extern int              ll_new_lualept(lua_State *L);
 
+/* lualept-worker.cpp */
+
+/**
+ * The structure ll_worker_arg_s holds a value passed from one Lua state
+ * to another, e.g. to every job (see ll_capture_arg()).
+ */
+typedef struct ll_worker_arg_s {
+    int                 type;   /*!< LUA_TNIL, LUA_TBOOLEAN, LUA_TNUMBER, LUA_TSTRING or LUA_TUSERDATA */
+    bool                isint;  /*!< number is an integer */
+    lua_Integer         i;      /*!< boolean or integer value */
+    lua_Number          n;      /*!< floating point value */
+    std::string         str;    /*!< string value */
+    ll_shared_pix_t    *sp;     /*!< SharedPix value (one reference held) */
+    ll_channel_t       *ch;     /*!< Channel value (one reference held) */
+    ll_shared_queue_t  *sq;     /*!< SharedQueue value (one reference held) */
+    ll_shared_stack_t  *ss;     /*!< SharedStack value (one reference held) */
+}   ll_worker_arg_t;
+
+/** Values passed to every job after the job's own arguments */
+typedef std::vector<ll_worker_arg_t> ll_worker_args_t;
+
+/**
+ * The structure ll_worker_job_s defines the callbacks of ll_run_workers().
+ * Both run in a worker thread and may raise Lua errors in the worker state.
+ */
+typedef struct ll_worker_job_s {
+    int       (*push)(lua_State *W, l_int32 idx, void *ctx);   /*!< push the arguments for job %idx; return their number */
+    void      (*take)(lua_State *W, l_int32 idx, void *ctx);   /*!< take the result of job %idx from the top of the stack */
+    void       *ctx;                                            /*!< context of the callbacks */
+    const ll_worker_args_t *args;                               /*!< extra arguments for every job, or nullptr */
+}   ll_worker_job_t;
+
+extern int              ll_dump_chunk(const char *_fun, lua_State *L, int arg, const char *tname, ll_bytes_t *chunk);
+extern l_int32          ll_worker_count(l_int32 nthreads, l_int32 njobs);
+extern bool             ll_capture_arg(lua_State *L, int arg, ll_worker_arg_t *val);
+extern void             ll_free_arg(ll_worker_arg_t *val);
+extern int              ll_push_arg(const char *_fun, lua_State *L, const ll_worker_arg_t *val);
+extern int              ll_check_args(const char *_fun, lua_State *L, int first);
+extern int              ll_capture_args(const char *_fun, lua_State *L, int first, ll_worker_args_t *args);
+extern void             ll_free_args(ll_worker_args_t *args);
+extern int              ll_run_workers(const ll_bytes_t *chunk, l_int32 njobs, l_int32 nthreads, const ll_worker_job_t *job, char *msg, size_t size);
+
+/* lualept-items.cpp */
+
+/** Class of an object moved between Lua states (see lualept-items.cpp) */
+typedef struct ll_item_type_s ll_item_type_t;
+
+/**
+ * The structure ll_item_s holds a value or an object moved from one
+ * Lua state to another (see ll_take_item() and ll_push_item()).
+ */
+typedef struct ll_item_s {
+    ll_worker_arg_t         value;  /*!< copied value, or a reference to a shared object */
+    const ll_item_type_t   *type;   /*!< class of a moved object, or nullptr */
+    void                   *ptr;    /*!< the moved object */
+    bool                    pinned; /*!< the object stays with its pinned user data in the sending state */
+}   ll_item_t;
+
+/** Flag for ll_check_item(): accept objects owned by the host */
+#define LL_ITEM_HOST_OK     (1u << 0)
+
+/** Flag for ll_check_item(): accept objects referenced elsewhere */
+#define LL_ITEM_SHARED_OK   (1u << 1)
+
+extern const ll_item_type_t * ll_check_item(const char *_fun, lua_State *L, int arg, l_uint32 flags = 0);
+extern void             ll_take_item(const char *_fun, lua_State *L, int arg, const ll_item_type_t *type, ll_item_t *item);
+extern void             ll_pin_item(const char *_fun, lua_State *L, int arg, const ll_item_type_t *type, ll_item_t *item);
+extern int              ll_push_item(const char *_fun, lua_State *L, ll_item_t *item);
+extern void             ll_free_item(ll_item_t *item);
+
+/* lualept-bands.cpp */
+extern l_int32          ll_opt_threads(const char *_fun, lua_State *L, int arg);
+extern int              ll_run_bands(Pix *pixs, l_int32 halo, l_int32 nthreads, l_int32 nout, Pix **out,
+                                     const std::function<int(Pix *band, Pix **out)> &filter);
+
+/* lualept-pixpool.cpp */
+extern void             ll_pixpool_install(void);
+
+/* lualept-bytecode.cpp */
+extern int              ll_load_cached(lua_State *L, const char *name, const char *script = nullptr);
+
+/* lualept-mapped.cpp */
+/*! Contents of a file in memory, mapped or copied (see ll_map_file()) */
+typedef struct ll_mapped_file_s {
+    const l_uint8  *data;                   /*!< contents of the file */
+    size_t          size;                   /*!< size of the file in bytes */
+    bool            mapped;                 /*!< true if mmap()ed, false if read into a buffer */
+}   ll_mapped_file_t;
+
+extern bool             ll_map_file(const char *_fun, lua_State *L, const char *filename, ll_mapped_file_t *mf);
+extern void             ll_unmap_file(ll_mapped_file_t *mf);
+extern Pix            * ll_read_mapped_pix(const char *_fun, lua_State *L, const char *filename, l_int32 page = -1);
+
+/* lualept-sink.cpp */
+/** Default size of the chunks passed to a sink function */
+#define LL_SINK_CHUNK   65536
+
+/*! A FILE* writing to a Lua function or io handle (see ll_open_sink()) */
+typedef struct ll_sink_s {
+    lua_State      *L;                      /*!< Lua state calling the function */
+    int             arg;                    /*!< stack index of the function or io handle */
+    FILE           *fp;                     /*!< stream to write to */
+    bool            owned;                  /*!< %fp was opened for a function */
+    bool            spooled;                /*!< %fp is a temporary file passed to the function on close */
+    size_t          chunk;                  /*!< size of the chunks passed to the function */
+    int             error;                  /*!< reference to the error raised by the function, or LUA_NOREF */
+    size_t          bytes;                  /*!< bytes passed to the function */
+    size_t          chunks;                 /*!< number of calls of the function */
+    char           *spool;                  /*!< buffer passing a spooled %fp to the function */
+    int             pinned;                 /*!< stack index of a user data pinned while writing, or 0 */
+}   ll_sink_t;
+
+extern FILE           * ll_open_sink(const char *_fun, lua_State *L, int arg, ll_sink_t *sink, size_t chunk = 0);
+extern bool             ll_write_sink(ll_sink_t *sink, const l_uint8 *data, size_t size);
+extern bool             ll_close_sink(const char *_fun, lua_State *L, ll_sink_t *sink);
+
+/* lualept-source.cpp */
+/** Number of bytes at the start of a source kept for rewinding */
+#define LL_SOURCE_HEAD  65536
+
+/*! A FILE* reading from a Lua function (see ll_open_source()) */
+typedef struct ll_source_s {
+    lua_State      *L;                      /*!< Lua state calling the function */
+    int             arg;                    /*!< stack index of the function */
+    FILE           *fp;                     /*!< stream to read from */
+    l_uint8        *head;                   /*!< the first LL_SOURCE_HEAD bytes */
+    size_t          hlen;                   /*!< number of bytes in %head */
+    int             chunk;                  /*!< reference to the current chunk, or LUA_NOREF */
+    const l_uint8  *cdata;                  /*!< data of the current chunk */
+    size_t          cstart;                 /*!< position of the current chunk */
+    size_t          clen;                   /*!< length of the current chunk */
+    size_t          total;                  /*!< bytes returned by the function so far */
+    size_t          pos;                    /*!< current read position */
+    size_t          chunks;                 /*!< number of chunks returned by the function */
+    bool            eof;                    /*!< the function returned nil */
+    int             error;                  /*!< reference to the error raised by the function, or LUA_NOREF */
+}   ll_source_t;
+
+extern FILE           * ll_open_source(const char *_fun, lua_State *L, int arg, ll_source_t *src);
+extern l_uint8        * ll_read_source(const char *_fun, lua_State *L, ll_source_t *src, size_t *psize);
+extern void             ll_close_source(const char *_fun, lua_State *L, ll_source_t *src);
+
+/* lualept-stream.cpp */
+extern bool             ll_stream_bands(const char *_fun, lua_State *L, const char *input, const char *output, int process, int opts);
+
 /* llamap.cpp */
 extern Amap           * ll_check_Amap(const char *_fun, lua_State *L, int arg);
 extern Amap           * ll_opt_Amap(const char *_fun, lua_State *L, int arg);
@@ -774,6 +1079,12 @@ extern Boxaa          * ll_opt_Boxaa(const char *_fun, lua_State *L, int arg);
 extern int              ll_push_Boxaa(const char *_fun, lua_State *L, Boxaa *boxaa);
 extern int              ll_new_Boxaa(lua_State *L);
 
+/* llchannel.cpp */
+extern ll_channel_t   * ll_check_Channel(const char *_fun, lua_State *L, int arg);
+extern ll_channel_t   * ll_opt_Channel(const char *_fun, lua_State *L, int arg);
+extern int              ll_push_Channel(const char *_fun, lua_State *L, ll_channel_t *ch);
+extern int              ll_new_Channel(lua_State *L);
+
 /* llccbord.cpp */
 extern CCBord         * ll_check_CCBord(const char *_fun, lua_State *L, int arg);
 extern CCBord         * ll_opt_CCBord(const char *_fun, lua_State *L, int arg);
@@ -808,8 +1119,28 @@ extern int              ll_new_PixaComp(lua_State *L);
 extern Pix            * ll_check_Pix(const char *_fun, lua_State *L, int arg);
 extern Pix            * ll_opt_Pix(const char *_fun, lua_State *L, int arg);
 extern int              ll_push_Pix(const char *_fun, lua_State *L, Pix *pix);
+extern Pix            * ll_check_Pixd(const char *_fun, lua_State *L, int arg);
+extern Pix            * ll_opt_Pixd(const char *_fun, lua_State *L, int arg);
+extern int              ll_push_Pixd(const char *_fun, lua_State *L, int arg, Pix *pix);
 extern int              ll_new_Pix(lua_State *L);
 
+/* llpixelbuffer.cpp */
+extern PixelBuffer    * ll_check_PixelBuffer(const char *_fun, lua_State *L, int arg);
+extern PixelBuffer    * ll_opt_PixelBuffer(const char *_fun, lua_State *L, int arg);
+extern int              ll_push_PixelBuffer(const char *_fun, lua_State *L, PixelBuffer *buf);
+extern PixelBuffer    * ll_create_PixelBuffer(const char *_fun, lua_State *L, Pix *pix, l_int32 y0 = 0, l_int32 h = -1);
+extern int              ll_new_PixelBuffer(lua_State *L);
+
+/* lltypedarray.cpp */
+extern TypedArray     * ll_check_TypedArray(const char *_fun, lua_State *L, int arg, l_int32 type = LL_ARRAY_ANY);
+extern TypedArray     * ll_opt_TypedArray(const char *_fun, lua_State *L, int arg, l_int32 type = LL_ARRAY_ANY);
+extern int              ll_push_TypedArray(const char *_fun, lua_State *L, TypedArray *ta);
+extern TypedArray     * ll_create_TypedArray(const char *_fun, lua_State *L, l_int32 type, l_int32 n, const void *src = nullptr);
+extern int              ll_new_Int32Array(lua_State *L);
+extern int              ll_new_UInt32Array(lua_State *L);
+extern int              ll_new_Float32Array(lua_State *L);
+extern int              ll_new_Float64Array(lua_State *L);
+
 /* llpixa.cpp */
 extern Pixa           * ll_check_Pixa(const char *_fun, lua_State *L, int arg);
 extern Pixa           * ll_opt_Pixa(const char *_fun, lua_State *L, int arg);
@@ -832,6 +1163,8 @@ extern int              ll_new_Pixacc(lua_State *L);
 extern FPix           * ll_check_FPix(const char *_fun, lua_State *L, int arg);
 extern FPix           * ll_opt_FPix(const char *_fun, lua_State *L, int arg);
 extern int              ll_push_FPix(const char *_fun, lua_State *L, FPix *fpix);
+extern FPix           * ll_opt_FPixd(const char *_fun, lua_State *L, int arg);
+extern int              ll_push_FPixd(const char *_fun, lua_State *L, int arg, FPix *fpix);
 extern int              ll_new_FPix(lua_State *L);
 
 /* llfpixa.cpp */
@@ -840,12 +1173,38 @@ extern FPixa          * ll_opt_FPixa(const char *_fun, lua_State *L, int arg);
 extern int              ll_push_FPixa(const char *_fun, lua_State *L, FPixa *fpixa);
 extern int              ll_new_FPixa(lua_State *L);
 
+/* llfuture.cpp */
+typedef struct ll_future_s ll_future_t;
+extern ll_future_t    * ll_check_Future(const char *_fun, lua_State *L, int arg);
+extern ll_future_t    * ll_opt_Future(const char *_fun, lua_State *L, int arg);
+extern int              ll_push_Future(const char *_fun, lua_State *L, ll_future_t *f);
+extern int              ll_async(const char *_fun, lua_State *L, const char *tname);
+extern int              ll_new_Future(lua_State *L);
+
 /* lldpix.cpp */
 extern DPix           * ll_check_DPix(const char *_fun, lua_State *L, int arg);
 extern DPix           * ll_opt_DPix(const char *_fun, lua_State *L, int arg);
 extern int              ll_push_DPix(const char *_fun, lua_State *L, DPix *fpix);
 extern int              ll_new_DPix(lua_State *L);
 
+/* llpixpipeline.cpp */
+typedef struct ll_pixpipeline_s ll_pixpipeline_t;
+extern ll_pixpipeline_t * ll_check_PixPipeline(const char *_fun, lua_State *L, int arg);
+extern ll_pixpipeline_t * ll_opt_PixPipeline(const char *_fun, lua_State *L, int arg);
+extern int              ll_push_PixPipeline(const char *_fun, lua_State *L, ll_pixpipeline_t *pl);
+extern ll_pixpipeline_t * ll_compile_pipeline(const char *_fun, lua_State *L, int arg);
+extern void             ll_free_pipeline(ll_pixpipeline_t **ppl);
+extern Pix            * ll_run_pipeline(ll_pixpipeline_t *pl, Pix *pixs, Pix **pspare, const char **pname = nullptr);
+extern l_int32          ll_pipeline_halo(const ll_pixpipeline_t *pl, const char **pname);
+extern int              ll_new_PixPipeline(lua_State *L);
+
+/* lltiffpages.cpp */
+typedef struct ll_tiffpages_s ll_tiffpages_t;
+extern ll_tiffpages_t * ll_check_TiffPages(const char *_fun, lua_State *L, int arg);
+extern ll_tiffpages_t * ll_opt_TiffPages(const char *_fun, lua_State *L, int arg);
+extern int              ll_push_TiffPages(const char *_fun, lua_State *L, ll_tiffpages_t *tp);
+extern int              ll_new_TiffPages(lua_State *L);
+
 /* llpixtiling.cpp */
 extern PixTiling      * ll_check_PixTiling(const char *_fun, lua_State *L, int arg);
 extern PixTiling      * ll_opt_PixTiling(const char *_fun, lua_State *L, int arg);
@@ -864,6 +1223,27 @@ extern Sela           * ll_opt_Sela(const char *_fun, lua_State *L, int arg);
 extern int              ll_push_Sela(const char *_fun, lua_State *L, Sela *sela);
 extern int              ll_new_Sela(lua_State *L);
 
+/* llsharedpix.cpp */
+extern Pix            * ll_check_SharedPix(const char *_fun, lua_State *L, int arg);
+extern Pix            * ll_opt_SharedPix(const char *_fun, lua_State *L, int arg);
+extern int              ll_push_SharedPix(const char *_fun, lua_State *L, ll_shared_pix_t *sp);
+extern Pix            * ll_shared_pix_view(ll_shared_pix_t *sp);
+extern bool             ll_is_shared_raster(const void *data);
+extern bool             ll_shared_raster_unref(void *data);
+extern int              ll_new_SharedPix(lua_State *L);
+
+/* llsharedqueue.cpp */
+extern ll_shared_queue_t * ll_check_SharedQueue(const char *_fun, lua_State *L, int arg);
+extern ll_shared_queue_t * ll_opt_SharedQueue(const char *_fun, lua_State *L, int arg);
+extern int              ll_push_SharedQueue(const char *_fun, lua_State *L, ll_shared_queue_t *q);
+extern int              ll_new_SharedQueue(lua_State *L);
+
+/* llsharedstack.cpp */
+extern ll_shared_stack_t * ll_check_SharedStack(const char *_fun, lua_State *L, int arg);
+extern ll_shared_stack_t * ll_opt_SharedStack(const char *_fun, lua_State *L, int arg);
+extern int              ll_push_SharedStack(const char *_fun, lua_State *L, ll_shared_stack_t *s);
+extern int              ll_new_SharedStack(lua_State *L);
+
 /* llkernel.cpp */
 extern Kernel         * ll_check_Kernel(const char *_fun, lua_State *L, int arg);
 extern Kernel         * ll_opt_Kernel(const char *_fun, lua_State *L, int arg);